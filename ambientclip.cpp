@@ -0,0 +1,322 @@
+#include "ambientclip.h"
+
+#include <QAudioBuffer>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QFileInfo>
+#include <QUrl>
+
+#include <algorithm>
+#include "resampler.h"
+#include "tracerecorder.h"
+
+namespace {
+constexpr quint32 PCM_CACHE_VERSION = 1; // Bump when decoding changes
+}
+
+QAudioFormat AmbientClip::decodeFormat()
+{
+    QAudioFormat format;
+    format.setSampleRate(SAMPLE_RATE);
+    format.setChannelCount(CHANNELS);
+    format.setSampleFormat(QAudioFormat::Float);
+    return format;
+}
+
+QAudioFormat AmbientClip::outputFormat()
+{
+    QAudioFormat format;
+    format.setSampleRate(SAMPLE_RATE);
+    format.setChannelCount(CHANNELS);
+    format.setSampleFormat(QAudioFormat::Int16);
+    return format;
+}
+
+// =================== LOADER ===================
+AmbientClipLoader::AmbientClipLoader(QObject *parent)
+    : QObject(parent)
+    , m_decoder(new QAudioDecoder(this))
+    , m_maxBytes(DEFAULT_MAX_BYTES)
+    , m_cacheBytes(DEFAULT_CACHE_BYTES)
+    , m_storing(false)
+{
+    m_decoder->setAudioFormat(AmbientClip::decodeFormat());
+
+    connect(m_decoder, &QAudioDecoder::bufferReady, this, &AmbientClipLoader::readBuffers);
+    connect(m_decoder, &QAudioDecoder::durationChanged, this, &AmbientClipLoader::checkDuration);
+    connect(m_decoder, &QAudioDecoder::finished, this, &AmbientClipLoader::decodingFinished);
+    connect(m_decoder, qOverload<QAudioDecoder::Error>(&QAudioDecoder::error),
+            this, &AmbientClipLoader::decoderError);
+}
+
+AmbientClipLoader::~AmbientClipLoader()
+{
+    if (m_storeWorker.joinable()) {
+        m_storeWorker.join();
+    }
+}
+
+void AmbientClipLoader::setCache(const QString &directory, qint64 maxBytes)
+{
+    m_cacheDirectory = directory;
+    m_cacheBytes = qMax<qint64>(0, maxBytes);
+}
+
+void AmbientClipLoader::load(const QString &path, qint64 maxBytes)
+{
+    cancel();
+    BINAURAL_TRACE_INSTANT("media", "AmbientClipLoader::load");
+
+    m_maxBytes = maxBytes;
+    if (std::shared_ptr<const AmbientClip> cached = loadCached(path, maxBytes)) {
+        m_result = std::move(cached);
+        BINAURAL_TRACE_INSTANT("media", "AmbientClipLoader::cacheHit", "frames", m_result->frames());
+        emit finished();
+        return;
+    }
+
+    m_clip = std::make_shared<AmbientClip>();
+    m_clip->filePath = path;
+    m_resampler.reset();
+
+    m_decoder->setSource(QUrl::fromLocalFile(path));
+    m_decoder->start();
+}
+
+void AmbientClipLoader::cancel()
+{
+    if (m_clip) {
+        m_clip.reset();
+        m_decoder->stop();
+    }
+}
+
+bool AmbientClipLoader::isLoading() const
+{
+    return m_clip != nullptr;
+}
+
+void AmbientClipLoader::checkDuration(qint64 durationMs)
+{
+    if (!m_clip || durationMs <= 0) {
+        return;
+    }
+
+    const qint64 expectedSamples = durationMs * AmbientClip::SAMPLE_RATE / 1000 * AmbientClip::CHANNELS;
+    if (expectedSamples * qint64(sizeof(float)) > m_maxBytes) {
+        fail(QString("%1 decodes to more than %2 MB")
+                 .arg(m_clip->filePath).arg(m_maxBytes / (1024 * 1024)));
+        return;
+    }
+    // Allow for a duration estimate that is a little short
+    m_clip->samples.reserve(size_t(expectedSamples + expectedSamples / 50));
+}
+
+void AmbientClipLoader::readBuffers()
+{
+    BINAURAL_TRACE_SCOPE("media", "AmbientClipLoader::readBuffers");
+    while (m_clip && m_decoder->bufferAvailable()) {
+        if (!appendBuffer(m_decoder->read())) {
+            return;
+        }
+    }
+}
+
+bool AmbientClipLoader::appendBuffer(const QAudioBuffer &buffer)
+{
+    if (!buffer.isValid()) {
+        return true;
+    }
+
+    const QAudioFormat format = buffer.format();
+    const int rate = format.sampleRate();
+    if (rate != AmbientClip::SAMPLE_RATE && !m_resampler) {
+        // The backend ignored the requested rate; convert it here
+        m_resampler = std::make_unique<Resampler>(rate, AmbientClip::SAMPLE_RATE);
+        BINAURAL_TRACE_INSTANT("media", "AmbientClipLoader::resample", "rate", rate);
+    }
+    if (m_resampler && (!m_resampler->isValid() || m_resampler->inputRate() != rate)) {
+        // Let the caller stream it
+        fail(QString("%1: cannot convert the decoder's %2 Hz to %3 Hz")
+                 .arg(m_clip->filePath).arg(rate).arg(AmbientClip::SAMPLE_RATE));
+        return false;
+    }
+
+    const qint64 frames = buffer.frameCount();
+    const int channels = format.channelCount();
+    if (channels < 1) {
+        return true;
+    }
+    const qint64 outputFrames = m_resampler ? m_resampler->maxOutputFrames(frames) : frames;
+    if (qint64(m_clip->samples.size() + outputFrames * AmbientClip::CHANNELS) * qint64(sizeof(float)) > m_maxBytes) {
+        fail(QString("%1 decodes to more than %2 MB")
+                 .arg(m_clip->filePath).arg(m_maxBytes / (1024 * 1024)));
+        return false;
+    }
+
+    // Mono feeds both ears; channels past the first two are dropped
+    const int rightChannel = channels > 1 ? 1 : 0;
+    std::vector<float> &samples = m_clip->samples;
+    const size_t first = samples.size();
+    float *out;
+    if (m_resampler) {
+        m_unconverted.resize(size_t(frames) * AmbientClip::CHANNELS);
+        out = m_unconverted.data();
+    } else {
+        samples.resize(first + size_t(frames) * AmbientClip::CHANNELS);
+        out = samples.data() + first;
+    }
+
+    if (format.sampleFormat() == QAudioFormat::Float) {
+        const float *in = buffer.constData<float>();
+        for (qint64 i = 0; i < frames; ++i) {
+            out[2 * i] = in[i * channels];
+            out[2 * i + 1] = in[i * channels + rightChannel];
+        }
+    } else if (format.sampleFormat() == QAudioFormat::Int16) {
+        const qint16 *in = buffer.constData<qint16>();
+        for (qint64 i = 0; i < frames; ++i) {
+            out[2 * i] = in[i * channels] / 32768.0f;
+            out[2 * i + 1] = in[i * channels + rightChannel] / 32768.0f;
+        }
+    } else {
+        const char *in = buffer.constData<char>();
+        const int bytesPerSample = format.bytesPerSample();
+        for (qint64 i = 0; i < frames; ++i) {
+            const char *frame = in + i * format.bytesPerFrame();
+            out[2 * i] = format.normalizedSampleValue(frame);
+            out[2 * i + 1] = format.normalizedSampleValue(frame + rightChannel * bytesPerSample);
+        }
+    }
+
+    if (m_resampler) {
+        samples.resize(first + size_t(outputFrames) * AmbientClip::CHANNELS);
+        const qint64 converted = m_resampler->process(m_unconverted.data(), frames, samples.data() + first);
+        samples.resize(first + size_t(converted) * AmbientClip::CHANNELS);
+    }
+    return true;
+}
+
+void AmbientClipLoader::decodingFinished()
+{
+    if (!m_clip) {
+        return;
+    }
+    readBuffers();
+    if (!m_clip) {
+        return; // Failed on the last buffers
+    }
+    if (m_resampler) {
+        // The frames held back for the filter's last taps
+        std::vector<float> &samples = m_clip->samples;
+        const size_t first = samples.size();
+        samples.resize(first + size_t(m_resampler->maxFinishFrames()) * AmbientClip::CHANNELS);
+        const qint64 converted = m_resampler->finish(samples.data() + first);
+        samples.resize(first + size_t(converted) * AmbientClip::CHANNELS);
+        m_resampler.reset();
+        m_unconverted = std::vector<float>();
+    }
+    if (m_clip->samples.empty()) {
+        fail(QString("%1 decoded to no audio").arg(m_clip->filePath));
+        return;
+    }
+
+    m_clip->samples.shrink_to_fit();
+    m_result = std::move(m_clip);
+    m_clip.reset();
+    BINAURAL_TRACE_INSTANT("media", "AmbientClipLoader::finished", "frames", m_result->frames());
+    storeCached(m_result);
+    emit finished();
+}
+
+// =================== DECODED AUDIO CACHE ===================
+QString AmbientClipLoader::cacheKey(const QString &filePath)
+{
+    // A file edited or replaced in place is decoded again
+    const QFileInfo info(filePath);
+    const QString identity = QString("v%1|%2|size=%3|mtime=%4|rate=%5")
+                                 .arg(PCM_CACHE_VERSION)
+                                 .arg(info.absoluteFilePath())
+                                 .arg(info.size())
+                                 .arg(info.lastModified().toMSecsSinceEpoch())
+                                 .arg(AmbientClip::SAMPLE_RATE);
+    return MappedFileCache::hashKey(identity.toUtf8());
+}
+
+std::shared_ptr<const AmbientClip> AmbientClipLoader::loadCached(const QString &path, qint64 maxBytes)
+{
+    if (m_cacheDirectory.isEmpty() || m_cacheBytes == 0) {
+        return nullptr;
+    }
+
+    // Opening refreshes the entry's place in the eviction order
+    MappedFileCache cache(m_cacheDirectory, m_cacheBytes, "pcm");
+    const QString key = cacheKey(path);
+    std::unique_ptr<MappedCacheEntry> entry = cache.open(key);
+    if (!entry) {
+        return nullptr;
+    }
+
+    QDataStream in(entry->header());
+    quint32 sampleRate = 0;
+    quint32 channels = 0;
+    qint64 frames = 0;
+    in >> sampleRate >> channels >> frames;
+    const qint64 bytes = frames * AmbientClip::CHANNELS * qint64(sizeof(float));
+    if (in.status() != QDataStream::Ok || int(sampleRate) != AmbientClip::SAMPLE_RATE
+        || int(channels) != AmbientClip::CHANNELS || frames <= 0 || entry->payloadSize() != bytes) {
+        cache.remove(key);
+        return nullptr;
+    }
+    if (bytes > maxBytes) {
+        return nullptr; // The limit was lowered since; stream it
+    }
+
+    auto clip = std::make_shared<AmbientClip>();
+    clip->filePath = path;
+    clip->mapped = std::move(entry);
+    return clip;
+}
+
+void AmbientClipLoader::storeCached(std::shared_ptr<const AmbientClip> clip)
+{
+    if (m_cacheDirectory.isEmpty() || m_cacheBytes == 0 || clip->bytes() > m_cacheBytes) {
+        return;
+    }
+    if (m_storeWorker.joinable()) {
+        m_storeWorker.join(); // The previous file; rarely still writing
+    }
+
+    QByteArray header;
+    QDataStream out(&header, QIODevice::WriteOnly);
+    out << quint32(AmbientClip::SAMPLE_RATE) << quint32(AmbientClip::CHANNELS) << qint64(clip->frames());
+
+    // Writing tens of megabytes is the worker's job, not the GUI's
+    m_storing = true;
+    m_storeWorker = std::thread([this, clip, header, key = cacheKey(clip->filePath),
+                                 directory = m_cacheDirectory, maxBytes = m_cacheBytes]() {
+        BINAURAL_TRACE_SCOPE("media", "AmbientClipLoader::storeCached", "bytes", clip->bytes());
+        MappedFileCache cache(directory, maxBytes, "pcm");
+        if (!cache.store(key, header, reinterpret_cast<const char *>(clip->data()), clip->bytes())) {
+            qWarning() << "Could not cache decoded audio in" << directory;
+        }
+        m_storing = false;
+    });
+}
+
+void AmbientClipLoader::decoderError(QAudioDecoder::Error error)
+{
+    Q_UNUSED(error);
+    if (m_clip) {
+        fail(QString("Could not decode %1: %2").arg(m_clip->filePath, m_decoder->errorString()));
+    }
+}
+
+void AmbientClipLoader::fail(const QString &error)
+{
+    BINAURAL_TRACE_INSTANT("media", "AmbientClipLoader::error");
+    m_clip.reset();
+    m_decoder->stop();
+    emit errorOccurred(error);
+}
@@ -0,0 +1,173 @@
+#ifndef AMBIENTCLIP_H
+#define AMBIENTCLIP_H
+
+#include <QAudioDecoder>
+#include <QAudioFormat>
+#include <QIODevice>
+#include <QObject>
+#include <QString>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "mappedfilecache.h"
+
+class Resampler;
+
+// An ambient file decoded once into float PCM. Playing it is a pointer
+// walk through memory, so a loop repeats with no seek, no re-decode and no
+// gap, and an idle layer costs no decoding pipeline. The PCM is either
+// decoded into `samples` or mapped from the decoded audio cache.
+struct AmbientClip
+{
+    static constexpr int SAMPLE_RATE = 44100; // The engines' output rate
+    static constexpr int CHANNELS = 2;
+
+    QString filePath;
+    std::vector<float> samples; // Interleaved stereo, -1..1; empty when mapped
+    std::unique_ptr<MappedCacheEntry> mapped; // Payload as `samples` would hold it
+
+    const float *data() const
+    {
+        return mapped ? reinterpret_cast<const float *>(mapped->payload()) : samples.data();
+    }
+    qint64 sampleCount() const
+    {
+        return mapped ? mapped->payloadSize() / qint64(sizeof(float)) : qint64(samples.size());
+    }
+    bool isMapped() const { return mapped != nullptr; }
+
+    qint64 frames() const { return sampleCount() / CHANNELS; }
+    qint64 durationMs() const { return frames() * 1000 / SAMPLE_RATE; }
+    qint64 bytes() const { return sampleCount() * qint64(sizeof(float)); }
+
+    // What the decoder is asked for, and what voices play
+    static QAudioFormat decodeFormat(); // Float
+    static QAudioFormat outputFormat(); // Int16, as the engines
+};
+
+// Where a repeating voice loops within its clip: frames [start, end), the
+// last seamFrames() of them played from `seam` (a crossfade into the audio
+// before start, see LoopPoints) instead of the clip. The whole clip is a
+// loop with start 0, end frames() and no seam.
+struct AmbientLoop
+{
+    qint64 start = 0;
+    qint64 end = 0;
+    std::vector<float> seam; // Interleaved stereo
+
+    qint64 seamFrames() const { return qint64(seam.size()) / AmbientClip::CHANNELS; }
+};
+
+// Walks a clip the way a voice plays it: from `position` through the seam
+// of `loop` (null: the whole clip) and back to its start while `looping`,
+// handing each contiguous run of interleaved stereo to consume(from, runFrames).
+// Returns the frames walked, short of `frames` only where a clip that does
+// not loop ends; `position` and `wraps` are advanced.
+template<typename Consume>
+qint64 walkClip(const AmbientClip &clip, const AmbientLoop *loop, bool looping,
+                qint64 &position, qint64 frames, qint64 &wraps, Consume consume)
+{
+    const qint64 total = clip.frames();
+    if (!looping) {
+        loop = nullptr; // Straight through to the end of the clip
+    }
+    const qint64 loopStart = loop ? loop->start : 0;
+    const qint64 loopEnd = loop ? loop->end : total;
+    const qint64 seamStart = loop ? loop->end - loop->seamFrames() : total;
+
+    qint64 walked = 0;
+    while (walked < frames && total > 0) {
+        if (position >= loopEnd) {
+            if (!looping) {
+                break;
+            }
+            position = loopStart;
+            ++wraps;
+        }
+
+        qint64 run;
+        if (position < seamStart) {
+            run = std::min(frames - walked, seamStart - position);
+            consume(clip.data() + position * AmbientClip::CHANNELS, run);
+        } else {
+            run = std::min(frames - walked, loopEnd - position);
+            consume(loop->seam.data() + (position - seamStart) * AmbientClip::CHANNELS, run);
+        }
+        walked += run;
+        position += run;
+    }
+    return walked;
+}
+
+// =================== LOADER ===================
+// Decodes a file into an AmbientClip with QAudioDecoder. Files that would
+// decode to more than maxBytes are abandoned as soon as that is known (up
+// front when the decoder reports a duration), so the caller can fall back
+// to streaming them. Audio a backend delivers at another rate than asked
+// for is converted to SAMPLE_RATE as it arrives (see Resampler), so
+// playing it never resamples.
+//
+// With a cache directory set, decoded PCM is written there on a worker
+// thread, keyed by file path, size and modification time, and later loads
+// of the same file map it instead of decoding.
+class AmbientClipLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr qint64 DEFAULT_MAX_BYTES = 64 * 1024 * 1024; // ~3 minutes
+    static constexpr qint64 DEFAULT_CACHE_BYTES = 1024LL * 1024 * 1024;
+
+    explicit AmbientClipLoader(QObject *parent = nullptr);
+    ~AmbientClipLoader(); // Waits for a cache write in progress
+
+    // Empty directory (the default) or 0 bytes: no cache. Least recently
+    // loaded files are evicted past maxBytes.
+    void setCache(const QString &directory, qint64 maxBytes = DEFAULT_CACHE_BYTES);
+    bool isStoring() const { return m_storing.load(); }
+
+    // finished() or errorOccurred() follows; a load in progress is
+    // cancelled. A cached file is mapped and finished() emitted before
+    // this returns.
+    void load(const QString &path, qint64 maxBytes = DEFAULT_MAX_BYTES);
+    void cancel();
+    bool isLoading() const;
+
+    // Hands over the clip decoded by the last load(); null until finished()
+    std::shared_ptr<const AmbientClip> takeClip() { return std::move(m_result); }
+
+signals:
+    void finished();
+    void errorOccurred(const QString &error);
+
+private slots:
+    void readBuffers();
+    void checkDuration(qint64 durationMs);
+    void decodingFinished();
+    void decoderError(QAudioDecoder::Error error);
+
+private:
+    bool appendBuffer(const QAudioBuffer &buffer);
+    void fail(const QString &error);
+    static QString cacheKey(const QString &filePath);
+    std::shared_ptr<const AmbientClip> loadCached(const QString &path, qint64 maxBytes);
+    void storeCached(std::shared_ptr<const AmbientClip> clip);
+
+    QAudioDecoder *m_decoder;
+    std::shared_ptr<AmbientClip> m_clip;   // Being decoded
+    std::unique_ptr<Resampler> m_resampler; // While it arrives at another rate
+    std::vector<float> m_unconverted;       // A buffer's stereo frames before conversion
+    std::shared_ptr<const AmbientClip> m_result;
+    qint64 m_maxBytes;
+
+    QString m_cacheDirectory;
+    qint64 m_cacheBytes;
+    std::thread m_storeWorker;
+    std::atomic<bool> m_storing;
+};
+
+#endif // AMBIENTCLIP_H
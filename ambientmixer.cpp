@@ -0,0 +1,754 @@
+#include "ambientmixer.h"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "ambientspatializer.h"
+#include "gaincurve.h"
+#include "outputsink.h"
+#include "tracerecorder.h"
+
+namespace {
+const std::shared_ptr<const AmbientClip> NO_CLIP;
+
+// Uniform in [0, 1)
+inline double unitRandom(std::minstd_rand &random)
+{
+    return double(random() - std::minstd_rand::min()) / (double(std::minstd_rand::max() - std::minstd_rand::min()) + 1.0);
+}
+}
+
+// =================== SCATTER SET ===================
+bool ScatterSet::isValid() const
+{
+    if (clips.empty() || minIntervalSeconds <= 0.0 || maxIntervalSeconds < minIntervalSeconds) {
+        return false;
+    }
+    return std::all_of(clips.begin(), clips.end(), [](const std::shared_ptr<const AmbientClip> &clip) {
+        return clip && clip->frames() > 0;
+    });
+}
+
+// =================== MIXER ===================
+AmbientMixer::AmbientMixer(QObject *parent)
+    : QIODevice(parent)
+    , m_mix(size_t(BLOCK_FRAMES) * AmbientClip::CHANNELS)
+    , m_levels(size_t(BLOCK_FRAMES))
+    , m_voiceMix(size_t(BLOCK_FRAMES) * AmbientClip::CHANNELS)
+    , m_readEpoch(0)
+    , m_fadeCommit(0)
+    , m_fadeSerial(1)
+    , m_duckSources(0)
+    , m_duckDepthDb(-12.0f)
+    , m_duckAttackFrames(AmbientClip::SAMPLE_RATE / 4)
+    , m_duckReleaseFrames(AmbientClip::SAMPLE_RATE * 3 / 2)
+    , m_duckGain(1.0f)
+    , m_duckAmount(0.0f)
+    , m_duckFrom(1.0f)
+    , m_duckStep(0.0f)
+    , m_spatializer(nullptr)
+{
+    m_retired.reserve(MAX_VOICES);
+    // Unbuffered: a seek or a new voice is heard on the very next pull
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+}
+
+AmbientMixer::~AmbientMixer() = default;
+
+AmbientMixer::Voice *AmbientMixer::slot(int voice)
+{
+    if (voice < 0 || voice >= MAX_VOICES || m_voices[size_t(voice)].state != ACQUIRED) {
+        return nullptr;
+    }
+    return &m_voices[size_t(voice)];
+}
+
+const AmbientMixer::Voice *AmbientMixer::slot(int voice) const
+{
+    if (voice < 0 || voice >= MAX_VOICES || m_voices[size_t(voice)].state != ACQUIRED) {
+        return nullptr;
+    }
+    return &m_voices[size_t(voice)];
+}
+
+int AmbientMixer::acquire(std::shared_ptr<const AmbientClip> clip)
+{
+    if (!clip) {
+        return -1;
+    }
+    reclaim();
+    for (int i = 0; i < MAX_VOICES; ++i) {
+        Voice &voice = m_voices[size_t(i)];
+        if (voice.state != FREE) {
+            continue;
+        }
+        voice.state = ACQUIRED;
+        voice.owner = std::move(clip);
+        voice.loopOwner.reset();
+        voice.position.store(0);
+        voice.loopCount.store(0);
+        voice.gain.store(1.0f);
+        voice.looping.store(true);
+        voice.playing.store(false);
+        voice.ended.store(false);
+        voice.loop.store(nullptr);
+        voice.fadeSerial.store(0);
+        voice.fadeSeen = 0;
+        voice.fadePower = 1.0f;
+        voice.fadeLeft = 0;
+        voice.stopAfterFade = false;
+        voice.ramp = GainRamp();
+        voice.direction.store(AmbientSpatializer::PLAIN);
+        voice.heardDirection = AmbientSpatializer::PLAIN;
+        voice.clip.store(voice.owner.get()); // Last: the mixer skips the slot until now
+        return i;
+    }
+    return -1;
+}
+
+void AmbientMixer::release(int voice)
+{
+    Voice *v = slot(voice);
+    if (!v) {
+        return;
+    }
+    v->playing.store(false);
+    v->clip.store(nullptr);
+    v->loop.store(nullptr);
+    v->state = RELEASED;
+    retire(std::move(v->loopOwner), -1);
+    retire(std::move(v->owner), voice);
+    v->loopOwner.reset();
+    v->owner.reset();
+}
+
+int AmbientMixer::voiceCount() const
+{
+    return int(std::count_if(m_voices.begin(), m_voices.end(),
+                             [](const Voice &voice) { return voice.state == ACQUIRED; }));
+}
+
+int AmbientMixer::playingCount() const
+{
+    const auto voices = std::count_if(m_voices.begin(), m_voices.end(), [](const Voice &voice) {
+        return voice.state == ACQUIRED && voice.playing.load(std::memory_order_relaxed);
+    });
+    const auto scatters = std::count_if(m_scatters.begin(), m_scatters.end(), [](const Scatter &scatter) {
+        return scatter.state == ACQUIRED && scatter.playing.load(std::memory_order_relaxed);
+    });
+    return int(voices + scatters);
+}
+
+const std::shared_ptr<const AmbientClip> &AmbientMixer::clip(int voice) const
+{
+    const Voice *v = slot(voice);
+    return v ? v->owner : NO_CLIP;
+}
+
+void AmbientMixer::setPlaying(int voice, bool playing)
+{
+    if (Voice *v = slot(voice)) {
+        v->ended.store(false, std::memory_order_relaxed);
+        v->playing.store(playing, std::memory_order_relaxed);
+    }
+}
+
+bool AmbientMixer::isPlaying(int voice) const
+{
+    const Voice *v = slot(voice);
+    return v && v->playing.load(std::memory_order_relaxed);
+}
+
+bool AmbientMixer::hasEnded(int voice) const
+{
+    const Voice *v = slot(voice);
+    return v && v->ended.load(std::memory_order_relaxed);
+}
+
+void AmbientMixer::setGain(int voice, float gain)
+{
+    if (Voice *v = slot(voice)) {
+        v->gain.store(std::max(0.0f, gain), std::memory_order_relaxed);
+    }
+}
+
+float AmbientMixer::gain(int voice) const
+{
+    const Voice *v = slot(voice);
+    return v ? v->gain.load(std::memory_order_relaxed) : 0.0f;
+}
+
+void AmbientMixer::setLooping(int voice, bool looping)
+{
+    if (Voice *v = slot(voice)) {
+        v->looping.store(looping, std::memory_order_relaxed);
+    }
+}
+
+void AmbientMixer::setLoop(int voice, std::shared_ptr<const AmbientLoop> loop)
+{
+    Voice *v = slot(voice);
+    if (!v) {
+        return;
+    }
+    v->loop.store(loop.get());
+    retire(std::move(v->loopOwner), -1);
+    v->loopOwner = std::move(loop);
+    reclaim();
+}
+
+qint64 AmbientMixer::positionFrames(int voice) const
+{
+    const Voice *v = slot(voice);
+    return v ? v->position.load(std::memory_order_relaxed) : 0;
+}
+
+void AmbientMixer::setPositionFrames(int voice, qint64 frame)
+{
+    if (Voice *v = slot(voice)) {
+        v->ended.store(false, std::memory_order_relaxed);
+        v->position.store(qBound<qint64>(0, frame, v->owner->frames()), std::memory_order_relaxed);
+    }
+}
+
+qint64 AmbientMixer::loopCount(int voice) const
+{
+    const Voice *v = slot(voice);
+    return v ? v->loopCount.load(std::memory_order_relaxed) : 0;
+}
+
+void AmbientMixer::setFade(int voice, float from, float to, qint64 frames, bool stopAtEnd)
+{
+    Voice *v = slot(voice);
+    if (!v) {
+        return;
+    }
+    v->fadeFrom.store(from < 0.0f ? -1.0f : from, std::memory_order_relaxed);
+    v->fadeTo.store(std::max(0.0f, to), std::memory_order_relaxed);
+    v->fadeFrames.store(std::max<qint64>(0, frames), std::memory_order_relaxed);
+    v->fadeStop.store(stopAtEnd, std::memory_order_relaxed);
+    v->fadeSerial.store(m_fadeSerial); // Last: publishes the fields above
+}
+
+void AmbientMixer::commitFades()
+{
+    m_fadeCommit.store(m_fadeSerial);
+    ++m_fadeSerial;
+}
+
+void AmbientMixer::setSpatialPosition(int voice, float azimuth, float elevation)
+{
+    Voice *v = slot(voice);
+    if (!v) {
+        return;
+    }
+    if (!m_spatializerOwner) {
+        BINAURAL_TRACE_SCOPE("media", "AmbientMixer::createSpatializer");
+        m_spatializerOwner = std::make_unique<AmbientSpatializer>(HrtfSet::builtin(), BLOCK_FRAMES);
+        m_spatializer.store(m_spatializerOwner.get());
+    }
+    v->direction.store(m_spatializerOwner->set().nearest(azimuth, elevation));
+}
+
+void AmbientMixer::clearSpatialPosition(int voice)
+{
+    if (Voice *v = slot(voice)) {
+        v->direction.store(AmbientSpatializer::PLAIN);
+    }
+}
+
+bool AmbientMixer::isSpatial(int voice) const
+{
+    const Voice *v = slot(voice);
+    return v && v->direction.load(std::memory_order_relaxed) != AmbientSpatializer::PLAIN;
+}
+
+void AmbientMixer::setDuck(quint32 source, bool active)
+{
+    if (active) {
+        m_duckSources.fetch_or(source, std::memory_order_relaxed);
+    } else {
+        m_duckSources.fetch_and(~source, std::memory_order_relaxed);
+    }
+}
+
+void AmbientMixer::setDuckShape(float depthDb, int attackMs, int releaseMs)
+{
+    m_duckDepthDb.store(std::clamp(depthDb, GainCurve::MIN_DB, 0.0f), std::memory_order_relaxed);
+    m_duckAttackFrames.store(qint64(std::max(0, attackMs)) * AmbientClip::SAMPLE_RATE / 1000,
+                             std::memory_order_relaxed);
+    m_duckReleaseFrames.store(qint64(std::max(0, releaseMs)) * AmbientClip::SAMPLE_RATE / 1000,
+                              std::memory_order_relaxed);
+}
+
+float AmbientMixer::duckGain() const
+{
+    return m_duckGain.load(std::memory_order_relaxed);
+}
+
+// =================== GAIN ===================
+void AmbientMixer::GainRamp::update(float wanted)
+{
+    if (!live) {
+        current = target = wanted;
+        left = 0;
+        live = true;
+    } else if (wanted != target) {
+        target = wanted;
+        left = GAIN_RAMP_FRAMES;
+        step = (target - current) / float(GAIN_RAMP_FRAMES);
+    }
+}
+
+const float *AmbientMixer::rampLevels(GainRamp &ramp, float wanted, qint64 frames)
+{
+    ramp.update(wanted);
+    if (ramp.left == 0 && m_duckStep == 0.0f) {
+        return nullptr; // Steady: ramp.current * m_duckFrom throughout
+    }
+    float duck = m_duckFrom;
+    for (qint64 i = 0; i < frames; ++i) {
+        m_levels[size_t(i)] = ramp.next() * duck;
+        duck += m_duckStep;
+    }
+    return m_levels.data();
+}
+
+void AmbientMixer::advanceDuck(qint64 frames)
+{
+    const bool ducked = m_duckSources.load(std::memory_order_relaxed) != 0;
+    const qint64 length = (ducked ? m_duckAttackFrames : m_duckReleaseFrames).load(std::memory_order_relaxed);
+    const float move = length > 0 ? float(frames) / float(length) : 1.0f;
+    const float amount = ducked ? std::min(1.0f, m_duckAmount + move) : std::max(0.0f, m_duckAmount - move);
+
+    // Even steps in dB, straight lines within the block
+    m_duckFrom = m_duckGain.load(std::memory_order_relaxed);
+    const float to = GainCurve::dbToGain(m_duckDepthDb.load(std::memory_order_relaxed) * amount);
+    m_duckStep = (to - m_duckFrom) / float(frames);
+    m_duckAmount = amount;
+    m_duckGain.store(to, std::memory_order_relaxed);
+}
+
+// =================== SCATTERS ===================
+AmbientMixer::Scatter *AmbientMixer::scatterSlot(int scatter)
+{
+    if (scatter < 0 || scatter >= MAX_SCATTERS || m_scatters[size_t(scatter)].state != ACQUIRED) {
+        return nullptr;
+    }
+    return &m_scatters[size_t(scatter)];
+}
+
+const AmbientMixer::Scatter *AmbientMixer::scatterSlot(int scatter) const
+{
+    if (scatter < 0 || scatter >= MAX_SCATTERS || m_scatters[size_t(scatter)].state != ACQUIRED) {
+        return nullptr;
+    }
+    return &m_scatters[size_t(scatter)];
+}
+
+int AmbientMixer::acquireScatter(std::shared_ptr<const ScatterSet> set)
+{
+    if (!set || !set->isValid()) {
+        return -1;
+    }
+    reclaim();
+    for (int i = 0; i < MAX_SCATTERS; ++i) {
+        Scatter &scatter = m_scatters[size_t(i)];
+        if (scatter.state != FREE) {
+            continue;
+        }
+        // The mixer skips the slot until `set` is published
+        scatter.state = ACQUIRED;
+        scatter.owner = std::move(set);
+        scatter.random.seed(scatter.owner->seed);
+        scatter.lastClip = -1;
+        scatter.shots.fill(Shot());
+        scatter.untilNext = nextInterval(scatter, *scatter.owner);
+        scatter.ramp = GainRamp();
+        scatter.gain.store(1.0f);
+        scatter.playing.store(false);
+        scatter.triggers.store(0);
+        scatter.set.store(scatter.owner.get());
+        return i;
+    }
+    return -1;
+}
+
+void AmbientMixer::releaseScatter(int scatter)
+{
+    Scatter *s = scatterSlot(scatter);
+    if (!s) {
+        return;
+    }
+    s->playing.store(false);
+    s->set.store(nullptr);
+    s->state = RELEASED;
+    retire(std::move(s->owner), -1, scatter);
+    s->owner.reset();
+}
+
+int AmbientMixer::scatterCount() const
+{
+    return int(std::count_if(m_scatters.begin(), m_scatters.end(),
+                             [](const Scatter &scatter) { return scatter.state == ACQUIRED; }));
+}
+
+void AmbientMixer::setScatterPlaying(int scatter, bool playing)
+{
+    if (Scatter *s = scatterSlot(scatter)) {
+        s->playing.store(playing, std::memory_order_relaxed);
+    }
+}
+
+bool AmbientMixer::isScatterPlaying(int scatter) const
+{
+    const Scatter *s = scatterSlot(scatter);
+    return s && s->playing.load(std::memory_order_relaxed);
+}
+
+void AmbientMixer::setScatterGain(int scatter, float gain)
+{
+    if (Scatter *s = scatterSlot(scatter)) {
+        s->gain.store(std::max(0.0f, gain), std::memory_order_relaxed);
+    }
+}
+
+qint64 AmbientMixer::scatterTriggerCount(int scatter) const
+{
+    const Scatter *s = scatterSlot(scatter);
+    return s ? s->triggers.load(std::memory_order_relaxed) : 0;
+}
+
+qint64 AmbientMixer::nextInterval(Scatter &scatter, const ScatterSet &set)
+{
+    const double seconds = set.minIntervalSeconds
+                           + (set.maxIntervalSeconds - set.minIntervalSeconds) * unitRandom(scatter.random);
+    return std::max<qint64>(1, std::llround(seconds * AmbientClip::SAMPLE_RATE));
+}
+
+void AmbientMixer::mixScatter(Scatter &scatter, const ScatterSet &set, qint64 frames)
+{
+    // Triggers due in this block start at their own frame of it
+    while (scatter.untilNext < frames) {
+        auto free = std::find_if(scatter.shots.begin(), scatter.shots.end(),
+                                 [](const Shot &shot) { return shot.clip == nullptr; });
+        const int count = int(set.clips.size());
+        const int choices = (count > 1 && scatter.lastClip >= 0) ? count - 1 : count;
+        int index = std::min(int(unitRandom(scatter.random) * choices), choices - 1);
+        if (choices < count && index >= scatter.lastClip) {
+            ++index; // Skip the one just played
+        }
+        const float gain = set.minGain + (set.maxGain - set.minGain) * float(unitRandom(scatter.random));
+        const float pan = set.panWidth * float(2.0 * unitRandom(scatter.random) - 1.0);
+        if (free != scatter.shots.end()) {
+            // Equal power, unity in the centre
+            const float angle = float(M_PI) / 4.0f * (pan + 1.0f);
+            free->clip = set.clips[size_t(index)].get();
+            free->position = 0;
+            free->delay = scatter.untilNext;
+            free->leftGain = gain * std::cos(angle) * float(M_SQRT2);
+            free->rightGain = gain * std::sin(angle) * float(M_SQRT2);
+            scatter.lastClip = index;
+            scatter.triggers.fetch_add(1, std::memory_order_relaxed);
+        }
+        scatter.untilNext += nextInterval(scatter, set);
+    }
+    scatter.untilNext -= frames;
+
+    const float *levels = rampLevels(scatter.ramp, scatter.gain.load(std::memory_order_relaxed), frames);
+    const float steady = scatter.ramp.current * m_duckFrom;
+    for (Shot &shot : scatter.shots) {
+        if (!shot.clip) {
+            continue;
+        }
+        const float left = shot.leftGain;
+        const float right = shot.rightGain;
+        float *mix = m_mix.data() + shot.delay * AmbientClip::CHANNELS;
+        qint64 frame = shot.delay;
+        qint64 wraps = 0;
+        const qint64 wanted = frames - shot.delay;
+        const qint64 walked = walkClip(*shot.clip, nullptr, false, shot.position, wanted, wraps,
+                                       [&mix, &frame, levels, steady, left, right](const float *from, qint64 run) {
+            for (qint64 i = 0; i < run; ++i, ++frame) {
+                const float level = levels ? levels[frame] : steady;
+                mix[2 * i] += from[2 * i] * left * level;
+                mix[2 * i + 1] += from[2 * i + 1] * right * level;
+            }
+            mix += run * AmbientClip::CHANNELS;
+        });
+        shot.delay = 0;
+        if (walked < wanted) {
+            shot.clip = nullptr; // Played out
+        }
+    }
+}
+
+void AmbientMixer::retire(std::shared_ptr<const void> object, int voice, int scatter)
+{
+    if (!object && voice < 0 && scatter < 0) {
+        return;
+    }
+    // Read after the pointer was unpublished: a read that starts later
+    // cannot see it
+    m_retired.push_back({std::move(object), voice, scatter, m_readEpoch.load()});
+}
+
+void AmbientMixer::reclaim()
+{
+    const quint64 epoch = m_readEpoch.load();
+    auto done = std::remove_if(m_retired.begin(), m_retired.end(), [this, epoch](const Retired &retired) {
+        // Even: no read was running. Odd: that read has finished since
+        const bool safe = retired.epoch % 2 == 0 || epoch > retired.epoch;
+        if (safe && retired.voice >= 0) {
+            m_voices[size_t(retired.voice)].state = FREE;
+        }
+        if (safe && retired.scatter >= 0) {
+            m_scatters[size_t(retired.scatter)].state = FREE;
+        }
+        return safe;
+    });
+    m_retired.erase(done, m_retired.end());
+}
+
+void AmbientMixer::startFade(Voice &voice, quint64 committed)
+{
+    const quint64 serial = voice.fadeSerial.load();
+    if (serial == voice.fadeSeen || serial > committed) {
+        return;
+    }
+    voice.fadeSeen = serial;
+    const float from = voice.fadeFrom.load(std::memory_order_relaxed);
+    const float to = voice.fadeTo.load(std::memory_order_relaxed);
+    const qint64 frames = voice.fadeFrames.load(std::memory_order_relaxed);
+    if (from >= 0.0f) {
+        voice.fadePower = from * from;
+    }
+    voice.fadeTarget = to * to;
+    voice.fadeLeft = frames;
+    voice.fadeStep = frames > 0 ? (voice.fadeTarget - voice.fadePower) / float(frames) : 0.0f;
+    voice.stopAfterFade = voice.fadeStop.load(std::memory_order_relaxed);
+    if (frames == 0) {
+        voice.fadePower = voice.fadeTarget;
+    }
+}
+
+void AmbientMixer::mixVoice(Voice &voice, qint64 frames)
+{
+    const AmbientClip *clip = voice.clip.load();
+    if (!clip) {
+        return;
+    }
+    // Stopped, or waiting for its fade in to be committed
+    if (!voice.playing.load(std::memory_order_relaxed)
+        || (voice.fadeSerial.load(std::memory_order_relaxed) != voice.fadeSeen
+            && voice.fadeFrom.load(std::memory_order_relaxed) >= 0.0f)) {
+        voice.ramp.live = false;
+        return;
+    }
+
+    // Placed voices are mixed on their own, then handed to the spatializer;
+    // one (re)starting is heard where it is placed at once
+    const int direction = voice.direction.load();
+    if (!voice.ramp.live) {
+        voice.heardDirection = direction;
+    }
+    AmbientSpatializer *spatializer = nullptr;
+    if (direction != AmbientSpatializer::PLAIN || voice.heardDirection != AmbientSpatializer::PLAIN) {
+        spatializer = m_spatializer.load();
+        std::fill(m_voiceMix.begin(), m_voiceMix.begin() + frames * AmbientClip::CHANNELS, 0.0f);
+    }
+
+    const float *levels = rampLevels(voice.ramp, voice.gain.load(std::memory_order_relaxed), frames);
+    const float steady = voice.ramp.current * m_duckFrom;
+    const qint64 start = voice.position.load(std::memory_order_relaxed);
+    qint64 position = start;
+    qint64 wraps = 0;
+    float *mix = spatializer ? m_voiceMix.data() : m_mix.data();
+    qint64 walked = 0;
+    if (!levels && voice.fadeLeft == 0) {
+        const float level = steady * std::sqrt(voice.fadePower);
+        walked = walkClip(*clip, voice.loop.load(), voice.looping.load(std::memory_order_relaxed),
+                          position, frames, wraps, [&mix, level](const float *from, qint64 run) {
+            for (qint64 i = 0; i < run * AmbientClip::CHANNELS; ++i) {
+                mix[i] += from[i] * level;
+            }
+            mix += run * AmbientClip::CHANNELS;
+        });
+    } else {
+        qint64 frame = 0;
+        walked = walkClip(*clip, voice.loop.load(), voice.looping.load(std::memory_order_relaxed),
+                          position, frames, wraps,
+                          [&mix, &voice, &frame, levels, steady](const float *from, qint64 run) {
+            for (qint64 i = 0; i < run; ++i, ++frame) {
+                const float level = (levels ? levels[frame] : steady) * std::sqrt(std::max(0.0f, voice.fadePower));
+                mix[2 * i] += from[2 * i] * level;
+                mix[2 * i + 1] += from[2 * i + 1] * level;
+                if (voice.fadeLeft > 0) {
+                    // From the end, so rounding does not add up over the fade
+                    voice.fadePower = voice.fadeTarget - voice.fadeStep * float(--voice.fadeLeft);
+                }
+            }
+            mix += run * AmbientClip::CHANNELS;
+        });
+    }
+    voice.loopCount.fetch_add(wraps, std::memory_order_relaxed);
+    if (spatializer) {
+        voice.heardDirection = spatializer->addSource(voice.heardDirection, direction, m_voiceMix.data(),
+                                                      int(frames), m_mix.data());
+    }
+
+    // A seek made while we read wins over our advance
+    qint64 expected = start;
+    voice.position.compare_exchange_strong(expected, position, std::memory_order_relaxed);
+    const bool fadedOut = voice.stopAfterFade && voice.fadeLeft == 0;
+    if (walked < frames || fadedOut) {
+        voice.stopAfterFade = false;
+        voice.playing.store(false, std::memory_order_relaxed);
+        voice.ended.store(true, std::memory_order_relaxed);
+    }
+}
+
+qint64 AmbientMixer::readData(char *data, qint64 maxlen)
+{
+    m_readEpoch.fetch_add(1); // Odd: voices may be in use
+
+    const qint64 wanted = maxlen / qint64(AmbientClip::CHANNELS * sizeof(qint16));
+    qint16 *out = reinterpret_cast<qint16 *>(data);
+
+    // Fades committed together start on the first frame of this read
+    const quint64 committed = m_fadeCommit.load();
+    for (Voice &voice : m_voices) {
+        if (voice.clip.load()) {
+            startFade(voice, committed);
+        }
+    }
+
+    for (qint64 done = 0; done < wanted; done += BLOCK_FRAMES) {
+        const qint64 frames = std::min<qint64>(BLOCK_FRAMES, wanted - done);
+        std::fill(m_mix.begin(), m_mix.begin() + frames * AmbientClip::CHANNELS, 0.0f);
+
+        advanceDuck(frames);
+        for (Voice &voice : m_voices) {
+            mixVoice(voice, frames);
+        }
+        for (Scatter &scatter : m_scatters) {
+            const ScatterSet *set = scatter.set.load();
+            if (set && scatter.playing.load(std::memory_order_relaxed)) {
+                mixScatter(scatter, *set, frames);
+            } else if (set) {
+                scatter.ramp.live = false;
+            }
+        }
+        if (AmbientSpatializer *spatializer = m_spatializer.load()) {
+            spatializer->render(m_mix.data(), int(frames));
+        }
+
+        qint16 *to = out + done * AmbientClip::CHANNELS;
+        for (qint64 i = 0; i < frames * AmbientClip::CHANNELS; ++i) {
+            to[i] = static_cast<qint16>(std::clamp(m_mix[size_t(i)], -1.0f, 1.0f) * 32767.0f);
+        }
+    }
+
+    m_readEpoch.fetch_add(1);
+    // Silence when nothing plays: the pool stops the output instead
+    return wanted * qint64(AmbientClip::CHANNELS * sizeof(qint16));
+}
+
+qint64 AmbientMixer::writeData(const char *data, qint64 len)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(len);
+    return -1;
+}
+
+// =================== VOICE POOL ===================
+AmbientVoicePool::AmbientVoicePool(QObject *parent)
+    : QObject(parent)
+    , m_mixer(new AmbientMixer(this))
+    , m_sink(nullptr)
+    , m_outputActive(false)
+{
+    // The output is created with the first voice that plays
+}
+
+AmbientVoicePool::~AmbientVoicePool()
+{
+    if (m_sink) {
+        m_sink->stop();
+    }
+}
+
+void AmbientVoicePool::setPlaying(int voice, bool playing)
+{
+    m_mixer->setPlaying(voice, playing);
+    updateOutput();
+}
+
+void AmbientVoicePool::setScatterPlaying(int scatter, bool playing)
+{
+    m_mixer->setScatterPlaying(scatter, playing);
+    updateOutput();
+}
+
+void AmbientVoicePool::commitFades()
+{
+    m_mixer->commitFades();
+    updateOutput();
+}
+
+bool AmbientVoicePool::isOutputActive() const
+{
+    return m_outputActive;
+}
+
+void AmbientVoicePool::updateOutput()
+{
+    const bool wanted = m_mixer->playingCount() > 0;
+    if (wanted == m_outputActive) {
+        return;
+    }
+
+    if (!wanted) {
+        BINAURAL_TRACE_INSTANT("media", "AmbientVoicePool::stopOutput");
+        m_outputActive = false;
+        m_sink->stop();
+        return;
+    }
+
+    BINAURAL_TRACE_SCOPE("media", "AmbientVoicePool::startOutput");
+    if (!m_sink) {
+        QString error;
+        m_sink = OutputSink::create(AmbientClip::outputFormat(), this, &error);
+        if (!m_sink) {
+            stopAllVoices();
+            emit errorOccurred(error);
+            return;
+        }
+        connect(m_sink, &OutputSink::stateChanged, this, &AmbientVoicePool::handleStateChanged);
+    }
+    m_outputActive = true;
+    m_sink->start(m_mixer);
+}
+
+void AmbientVoicePool::handleStateChanged(QAudio::State state)
+{
+    if (state == QAudio::StoppedState && m_outputActive && m_sink->error() != QAudio::NoError) {
+        const QAudio::Error error = m_sink->error();
+        m_outputActive = false;
+        stopAllVoices();
+        emit errorOccurred(QString("Ambient output stopped with error %1").arg(int(error)));
+    }
+}
+
+void AmbientVoicePool::stopAllVoices()
+{
+    for (int voice = 0; voice < AmbientMixer::MAX_VOICES; ++voice) {
+        m_mixer->setPlaying(voice, false);
+    }
+    for (int scatter = 0; scatter < AmbientMixer::MAX_SCATTERS; ++scatter) {
+        m_mixer->setScatterPlaying(scatter, false);
+    }
+}
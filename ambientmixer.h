@@ -0,0 +1,313 @@
+#ifndef AMBIENTMIXER_H
+#define AMBIENTMIXER_H
+
+#include <QAudio>
+#include <QIODevice>
+#include <QObject>
+#include <QString>
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "ambientclip.h"
+
+class AmbientSpatializer;
+class OutputSink;
+
+// =================== SCATTER SET ===================
+// Short one-shot samples (birds, drips, chimes) a scatter of the mixer fires
+// at random: each trigger comes a uniform [minIntervalSeconds,
+// maxIntervalSeconds] after the last, playing a random clip (not the same
+// one twice running, given a choice) at a random gain and pan. Immutable
+// once handed to the mixer.
+struct ScatterSet
+{
+    std::vector<std::shared_ptr<const AmbientClip>> clips;
+    double minIntervalSeconds = 2.0;
+    double maxIntervalSeconds = 8.0;
+    float minGain = 0.5f;
+    float maxGain = 1.0f;
+    float panWidth = 0.8f; // 0: all in the centre, 1: anywhere left to right
+    quint32 seed = 1;      // Same seed, same scene
+
+    bool isValid() const;
+};
+
+// =================== MIXER ===================
+// Pull-mode QIODevice mixing up to MAX_VOICES decoded clips into one stream
+// in AmbientClip::outputFormat(). A voice is a slot of atomics (clip, loop
+// region, position, gain, flags): an ambient layer costs its clip's memory
+// and a multiply-add per sample while it plays, not a decoding pipeline and
+// an audio device of its own.
+//
+// Scatters play a ScatterSet: the mixer schedules their one-shots itself,
+// to the frame, so a long scene that never repeats costs a few short clips
+// and only the shots sounding at the moment.
+//
+// A voice can be placed around the listener instead of playing in stereo:
+// it is then rendered through the HRTF set by the spatializer, created with
+// the first voice placed and shared by all of them.
+//
+// Gain changes are picked up once a block and ramped over GAIN_RAMP_FRAMES,
+// so a volume slider or a duck never steps. Fades ride on top of a voice's
+// gain and are committed together, so a preset switch crossfades every
+// layer from the same frame.
+//
+// Voices and scatters are acquired, changed and released from the GUI
+// thread while the sink pulls. A released clip or set, or a replaced loop
+// region, is kept alive until no read that may have seen it is running.
+class AmbientMixer : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    static constexpr int MAX_VOICES = 64;
+    static constexpr int MAX_SCATTERS = 16;
+    static constexpr int MAX_SHOTS = 16;      // Per scatter at once; more triggers are skipped
+    static constexpr int BLOCK_FRAMES = 512; // Mixed in float, then converted
+    static constexpr int GAIN_RAMP_FRAMES = BLOCK_FRAMES;
+    static constexpr quint32 DUCK_MUSIC = 1u << 0;
+
+    explicit AmbientMixer(QObject *parent = nullptr);
+    ~AmbientMixer() override;
+
+    // A stopped voice at frame 0, looping, at unity gain; -1 when all are in use
+    int acquire(std::shared_ptr<const AmbientClip> clip);
+    void release(int voice);
+    int voiceCount() const;   // Acquired
+    int playingCount() const; // Voices and scatters playing
+
+    const std::shared_ptr<const AmbientClip> &clip(int voice) const;
+
+    void setPlaying(int voice, bool playing);
+    bool isPlaying(int voice) const;
+    // Set when a voice that does not loop plays to the end of its clip, or
+    // fades out with stopAtEnd (it stops by itself); cleared by
+    // setPlaying() and setPositionFrames()
+    bool hasEnded(int voice) const;
+
+    void setGain(int voice, float gain);
+    float gain(int voice) const;
+
+    void setLooping(int voice, bool looping);
+    // Null loops the whole clip
+    void setLoop(int voice, std::shared_ptr<const AmbientLoop> loop);
+
+    qint64 positionFrames(int voice) const;
+    void setPositionFrames(int voice, qint64 frame);
+    qint64 loopCount(int voice) const;
+
+    // Equal-power fade of the voice's envelope (1 when acquired) from
+    // `from`, or from where it is when `from` is negative, to `to` over
+    // `frames`. It starts at the next commitFades(), with every other fade
+    // set before it; until then a voice fading from a given level is held
+    // silent at its position even if it plays.
+    void setFade(int voice, float from, float to, qint64 frames, bool stopAtEnd = false);
+    void commitFades();
+
+    // Heard from the nearest direction of the HRTF set on headphones, a
+    // spatializer latency later, rather than in stereo: azimuth in degrees
+    // clockwise from ahead (-90 left), elevation up from the horizon (90
+    // overhead). A voice that plays moves over one block.
+    void setSpatialPosition(int voice, float azimuth, float elevation);
+    void clearSpatialPosition(int voice);
+    bool isSpatial(int voice) const;
+
+    // Sidechain duck: while any source bit is set (DUCK_MUSIC, ...) every
+    // voice and scatter is lowered by depthDb, reached over attackMs and
+    // undone over releaseMs, moved along in the mix a block at a time.
+    // Separate bits keep one source ending from lifting another's duck.
+    void setDuck(quint32 source, bool active);
+    void setDuckShape(float depthDb, int attackMs, int releaseMs);
+    float duckGain() const; // 1 undocked, down to the depth
+
+    // A stopped scatter at unity gain; -1 when all are in use or the set is
+    // not valid. Its first shot comes one interval after it starts playing.
+    int acquireScatter(std::shared_ptr<const ScatterSet> set);
+    void releaseScatter(int scatter);
+    int scatterCount() const;
+
+    void setScatterPlaying(int scatter, bool playing);
+    bool isScatterPlaying(int scatter) const;
+    void setScatterGain(int scatter, float gain);
+    qint64 scatterTriggerCount(int scatter) const; // Shots fired so far
+
+    bool isSequential() const override { return true; }
+
+protected:
+    qint64 readData(char *data, qint64 maxlen) override;
+    qint64 writeData(const char *data, qint64 len) override;
+
+private:
+    enum SlotState { FREE, ACQUIRED, RELEASED };
+
+    // Gain a voice or scatter is heard at, ramped to a new target once a
+    // block sees it (mixer only)
+    struct GainRamp
+    {
+        float current = 1.0f;
+        float target = 1.0f;
+        float step = 0.0f;
+        qint64 left = 0;
+        bool live = false; // Mixed last block; starting (again) jumps
+
+        void update(float wanted);
+        float next()
+        {
+            const float gain = current;
+            if (left > 0) {
+                current = target - step * float(--left);
+            }
+            return gain;
+        }
+    };
+
+    struct Voice
+    {
+        // Shared with the mixer
+        std::atomic<const AmbientClip *> clip{nullptr};
+        std::atomic<const AmbientLoop *> loop{nullptr};
+        std::atomic<qint64> position{0};
+        std::atomic<qint64> loopCount{0};
+        std::atomic<float> gain{1.0f};
+        std::atomic<bool> looping{true};
+        std::atomic<bool> playing{false};
+        std::atomic<bool> ended{false};
+        std::atomic<float> fadeFrom{-1.0f};
+        std::atomic<float> fadeTo{1.0f};
+        std::atomic<qint64> fadeFrames{0};
+        std::atomic<bool> fadeStop{false};
+        std::atomic<quint64> fadeSerial{0}; // Of the last setFade(); 0: none
+        std::atomic<int> direction{-1};     // In the HRTF set; -1: stereo
+
+        // Mixer only (set up by the GUI before `clip` is published)
+        quint64 fadeSeen = 0; // Serial of the fade running
+        float fadePower = 1.0f; // Envelope squared, ramped linearly
+        float fadeTarget = 1.0f;
+        float fadeStep = 0.0f;
+        qint64 fadeLeft = 0;
+        bool stopAfterFade = false;
+        GainRamp ramp;
+        int heardDirection = -1; // Where the last block went
+
+        // GUI thread only
+        SlotState state = FREE;
+        std::shared_ptr<const AmbientClip> owner;
+        std::shared_ptr<const AmbientLoop> loopOwner;
+    };
+
+    struct Shot
+    {
+        const AmbientClip *clip = nullptr; // Null: slot free
+        qint64 position = 0;
+        qint64 delay = 0; // Frames into the block before it starts
+        float leftGain = 0.0f;
+        float rightGain = 0.0f;
+    };
+
+    struct Scatter
+    {
+        // Shared with the mixer
+        std::atomic<const ScatterSet *> set{nullptr};
+        std::atomic<float> gain{1.0f};
+        std::atomic<bool> playing{false};
+        std::atomic<qint64> triggers{0};
+
+        // Mixer only (set up by the GUI before `set` is published)
+        std::minstd_rand random;
+        qint64 untilNext = 0;
+        int lastClip = -1;
+        std::array<Shot, MAX_SHOTS> shots;
+        GainRamp ramp;
+
+        // GUI thread only
+        SlotState state = FREE;
+        std::shared_ptr<const ScatterSet> owner;
+    };
+
+    // Waits for the reads that may still use it (see m_readEpoch)
+    struct Retired
+    {
+        std::shared_ptr<const void> object;
+        int voice;   // Slot freed with it, or -1
+        int scatter; // Likewise
+        quint64 epoch;
+    };
+
+    Voice *slot(int voice);
+    const Voice *slot(int voice) const;
+    Scatter *scatterSlot(int scatter);
+    const Scatter *scatterSlot(int scatter) const;
+    void retire(std::shared_ptr<const void> object, int voice, int scatter = -1);
+    void reclaim();
+    void startFade(Voice &voice, quint64 committed);
+    void mixVoice(Voice &voice, qint64 frames);
+    void mixScatter(Scatter &scatter, const ScatterSet &set, qint64 frames);
+    const float *rampLevels(GainRamp &ramp, float wanted, qint64 frames);
+    void advanceDuck(qint64 frames);
+    static qint64 nextInterval(Scatter &scatter, const ScatterSet &set);
+
+    std::array<Voice, MAX_VOICES> m_voices;
+    std::array<Scatter, MAX_SCATTERS> m_scatters;
+    std::vector<Retired> m_retired;
+    std::vector<float> m_mix;            // Mixer only
+    std::vector<float> m_levels;         // Mixer only: a block's gains while they move
+    std::vector<float> m_voiceMix;       // Mixer only: a placed voice's block
+    std::atomic<quint64> m_readEpoch;    // Odd while a read runs
+    std::atomic<quint64> m_fadeCommit;   // Fades up to this serial may start
+    quint64 m_fadeSerial;                // GUI thread only: the next fade's
+
+    std::atomic<quint32> m_duckSources;
+    std::atomic<float> m_duckDepthDb;
+    std::atomic<qint64> m_duckAttackFrames;
+    std::atomic<qint64> m_duckReleaseFrames;
+    std::atomic<float> m_duckGain;       // Published for duckGain()
+    float m_duckAmount;                  // Mixer only: 0 undocked, 1 at depth
+    float m_duckFrom;                    // Mixer only: this block's duck
+    float m_duckStep;                    //   gain at its start, and per frame
+
+    std::unique_ptr<AmbientSpatializer> m_spatializerOwner; // GUI thread only
+    std::atomic<AmbientSpatializer *> m_spatializer;        // Published before any direction
+};
+
+// =================== VOICE POOL ===================
+// The mixer and the one output it plays through, shared by every ambient
+// layer. The output runs while any voice plays and is stopped after the
+// last one stops, so a silent soundscape holds no audio device.
+class AmbientVoicePool : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AmbientVoicePool(QObject *parent = nullptr);
+    ~AmbientVoicePool();
+
+    AmbientMixer *mixer() const { return m_mixer; }
+
+    // AmbientMixer::setPlaying(), setScatterPlaying() and commitFades(),
+    // plus starting or stopping the output
+    void setPlaying(int voice, bool playing);
+    void setScatterPlaying(int scatter, bool playing);
+    void commitFades();
+    bool isOutputActive() const;
+
+signals:
+    // The output could not be started or failed; every voice was stopped
+    void errorOccurred(const QString &error);
+
+private slots:
+    void handleStateChanged(QAudio::State state);
+
+private:
+    void updateOutput();
+    void stopAllVoices();
+
+    AmbientMixer *m_mixer;
+    OutputSink *m_sink;
+    bool m_outputActive;
+};
+
+#endif // AMBIENTMIXER_H
@@ -2,20 +2,46 @@
 
 #include <QDebug>
 #include<QAudioOutput>
+#include <QTimer>
+#include"ambientclip.h"
+#include"ambientmixer.h"
+#include"gaincurve.h"
+#include"loopanalyzer.h"
+#include"tracerecorder.h"
+
+namespace {
+const int POSITION_INTERVAL_MS = 250; // Dialog progress while a voice plays
+const int FADE_RELEASE_MARGIN_MS = 500; // Output latency after a fade out
+}
+
+qint64 AmbientPlayer::s_maxDecodedBytes = AmbientClipLoader::DEFAULT_MAX_BYTES;
+qint64 AmbientPlayer::s_decodedCacheBytes = AmbientClipLoader::DEFAULT_CACHE_BYTES;
 
-AmbientPlayer::AmbientPlayer(QObject *parent)
+AmbientPlayer::AmbientPlayer(AmbientVoicePool *pool, QObject *parent)
     : QObject(parent)
     , m_name("Unnamed")
     , m_volume(50)
     , m_enabled(false)
     , m_autoRepeat(true)
+    , m_spatial(false)
+    , m_azimuth(0.0f)
+    , m_elevation(0.0f)
+    , m_player(nullptr)
+    , m_outputVolume(1.0f)
+    , m_muted(false)
+    , m_streaming(false)
+    , m_loader(nullptr)
+    , m_loopAnalyzer(nullptr)
+    , m_pool(pool)
+    , m_voice(-1)
+    , m_voiceState(QMediaPlayer::StoppedState)
+    , m_positionTimer(new QTimer(this))
     , m_baseVolume(50)
     , m_masterRatio(1.0f)
 {
-    // Create audio player
-    m_player = new QMediaPlayer(this);
-    m_audioOutput = new QAudioOutput(this);
-    m_player->setAudioOutput(m_audioOutput);
+    // The clip is decoded, or the streaming player created, on first play()
+    m_positionTimer->setInterval(POSITION_INTERVAL_MS);
+    connect(m_positionTimer, &QTimer::timeout, this, &AmbientPlayer::updateVoicePosition);
 
     // Create toolbar button
     m_button = new QPushButton(m_name);
@@ -32,33 +58,260 @@ AmbientPlayer::~AmbientPlayer()
     // Buttons are owned by their parent widget (MainWindow toolbar)
     // QMediaPlayer is owned by this object (via parent hierarchy)
     // So no manual deletion needed
+    releaseVoice();
+    const QList<int> fading = m_fadingVoices;
+    for (int voice : fading) {
+        releaseFadedVoice(voice);
+    }
 }
 
-void AmbientPlayer::setupConnections()
+void AmbientPlayer::setMaxDecodedBytes(qint64 bytes)
 {
-    // Connect player state to button updates
-    connect(m_player, &QMediaPlayer::playbackStateChanged,
-            this, &AmbientPlayer::updateButtonState);
+    s_maxDecodedBytes = qMax<qint64>(0, bytes);
+}
 
+qint64 AmbientPlayer::maxDecodedBytes()
+{
+    return s_maxDecodedBytes;
+}
+
+void AmbientPlayer::setDecodedCacheBytes(qint64 bytes)
+{
+    s_decodedCacheBytes = qMax<qint64>(0, bytes);
+}
+
+qint64 AmbientPlayer::decodedCacheBytes()
+{
+    return s_decodedCacheBytes;
+}
+
+void AmbientPlayer::setupConnections()
+{
     // Connect button click to toggle play/pause
     connect(m_button, &QPushButton::clicked, this, [this]() {
-        if (m_player->playbackState() == QMediaPlayer::PlayingState) {
+        if (playbackState() == QMediaPlayer::PlayingState) {
             pause();
         } else {
             play();
         }
     });
+}
+
+void AmbientPlayer::ensureMediaPlayer()
+{
+    if (m_player) {
+        return;
+    }
+    BINAURAL_TRACE_SCOPE("media", "AmbientPlayer::ensureMediaPlayer");
+
+    // Create audio player with the settings made so far
+    m_player = new QMediaPlayer(this);
+    m_audioOutput = new QAudioOutput(this);
+    m_player->setAudioOutput(m_audioOutput);
+    m_audioOutput->setVolume(m_outputVolume);
+    m_audioOutput->setMuted(m_muted);
+    m_player->setLoops(m_autoRepeat ? QMediaPlayer::Infinite : 1);
+    if (!m_filePath.isEmpty()) {
+        m_player->setSource(QUrl::fromLocalFile(m_filePath));
+    }
+
+    // Connect player state to button updates
+    connect(m_player, &QMediaPlayer::playbackStateChanged,
+            this, &AmbientPlayer::updateButtonState);
+    connect(m_player, &QMediaPlayer::positionChanged, this, &AmbientPlayer::positionChanged);
+    connect(m_player, &QMediaPlayer::durationChanged, this, &AmbientPlayer::durationChanged);
+    connect(m_player, &QMediaPlayer::playbackStateChanged, this, [](QMediaPlayer::PlaybackState state) {
+        BINAURAL_TRACE_INSTANT("media", "AmbientPlayer::playbackStateChanged", "state", state);
+    });
+    connect(m_player, &QMediaPlayer::mediaStatusChanged, this, [](QMediaPlayer::MediaStatus status) {
+        BINAURAL_TRACE_INSTANT("media", "AmbientPlayer::mediaStatusChanged", "status", status);
+    });
 
     // Connect errors for debugging
-    connect(m_player, &QMediaPlayer::errorOccurred, this, [this]() {
+    connect(m_player, &QMediaPlayer::errorOccurred, this, [this](QMediaPlayer::Error error) {
+        BINAURAL_TRACE_INSTANT("media", "AmbientPlayer::error", "error", error);
         qWarning() << "AmbientPlayer error:" << m_player->errorString();
     });
 }
 
+// =================== DECODED VOICE ===================
+void AmbientPlayer::adoptClip(std::shared_ptr<const AmbientClip> clip)
+{
+    m_clip = std::move(clip);
+    emit durationChanged(m_clip->durationMs());
+
+    // Cached loop points arrive before this returns; new files are
+    // analyzed in the background while the voice loops the whole clip
+    if (!m_loopAnalyzer) {
+        m_loopAnalyzer = new LoopAnalyzer(ConstantGlobals::loopPointCachePath, this);
+        connect(m_loopAnalyzer, &LoopAnalyzer::finished, this, &AmbientPlayer::loopPointsFound);
+    }
+    m_loopAnalyzer->analyze(m_clip);
+}
+
+void AmbientPlayer::clipLoaded()
+{
+    adoptClip(m_loader->takeClip());
+
+    // Paused or stopped while decoding: start on the next play()
+    if (m_voiceState == QMediaPlayer::PlayingState) {
+        startVoice();
+    }
+}
+
+void AmbientPlayer::clipFailed(const QString &error)
+{
+    qInfo() << "AmbientPlayer: streaming" << m_name << "-" << error;
+    const bool wasPlaying = m_voiceState == QMediaPlayer::PlayingState;
+    setVoiceState(QMediaPlayer::StoppedState);
+    m_streaming = true;
+    if (wasPlaying) {
+        playStreaming();
+    }
+}
+
+void AmbientPlayer::loopPointsFound()
+{
+    if (!m_clip || m_loopAnalyzer->resultFilePath() != m_clip->filePath) {
+        return; // For a file this player no longer plays
+    }
+    m_loop = LoopAnalyzer::buildLoop(*m_clip, m_loopAnalyzer->result());
+    if (m_voice >= 0) {
+        m_pool->mixer()->setLoop(m_voice, m_loop);
+    }
+}
+
+AmbientVoicePool* AmbientPlayer::voicePool()
+{
+    if (!m_pool) {
+        m_pool = new AmbientVoicePool(this);
+    }
+    return m_pool;
+}
+
+void AmbientPlayer::startVoice(qint64 fadeInFrames)
+{
+    BINAURAL_TRACE_SCOPE("media", "AmbientPlayer::startVoice");
+    AmbientVoicePool* pool = voicePool();
+    if (m_voice < 0) {
+        m_voice = pool->mixer()->acquire(m_clip);
+        if (m_voice < 0) {
+            qWarning() << "AmbientPlayer error: all" << AmbientMixer::MAX_VOICES
+                       << "ambient voices are in use";
+            setVoiceState(QMediaPlayer::StoppedState);
+            return;
+        }
+        connect(pool, &AmbientVoicePool::errorOccurred, this, &AmbientPlayer::voicePoolFailed,
+                Qt::UniqueConnection);
+        pool->mixer()->setLoop(m_voice, m_loop);
+    }
+    pool->mixer()->setLooping(m_voice, m_autoRepeat);
+    applyVoiceGain();
+    applySpatialPosition();
+    if (fadeInFrames > 0) {
+        pool->mixer()->setFade(m_voice, 0.0f, 1.0f, fadeInFrames);
+    }
+    m_positionTimer->start();
+    setVoiceState(QMediaPlayer::PlayingState);
+    pool->setPlaying(m_voice, true);
+}
+
+void AmbientPlayer::releaseVoice()
+{
+    if (m_loader) {
+        m_loader->cancel();
+    }
+    if (m_voice >= 0 && m_pool) {
+        m_pool->setPlaying(m_voice, false);
+        m_pool->mixer()->release(m_voice);
+    }
+    m_voice = -1;
+    m_clip.reset();
+    m_loop.reset();
+    m_streaming = false;
+}
+
+void AmbientPlayer::releaseFadedVoice(int voice)
+{
+    if (m_fadingVoices.removeOne(voice) && m_pool) {
+        m_pool->setPlaying(voice, false);
+        m_pool->mixer()->release(voice);
+    }
+}
+
+void AmbientPlayer::applyVoiceGain()
+{
+    if (m_voice >= 0) {
+        m_pool->mixer()->setGain(m_voice, m_muted ? 0.0f : m_outputVolume);
+    }
+}
+
+void AmbientPlayer::applySpatialPosition()
+{
+    if (m_voice < 0) {
+        return;
+    }
+    if (m_spatial) {
+        m_pool->mixer()->setSpatialPosition(m_voice, m_azimuth, m_elevation);
+    } else {
+        m_pool->mixer()->clearSpatialPosition(m_voice);
+    }
+}
+
+void AmbientPlayer::updateVoicePosition()
+{
+    if (m_voice >= 0 && m_pool->mixer()->hasEnded(m_voice)) {
+        // Played once without repeat
+        stop();
+        return;
+    }
+    emit positionChanged(position());
+}
+
+void AmbientPlayer::voicePoolFailed(const QString &error)
+{
+    if (!m_streaming && m_voiceState == QMediaPlayer::PlayingState) {
+        qWarning() << "AmbientPlayer error:" << error;
+        setVoiceState(QMediaPlayer::StoppedState);
+    }
+}
+
+void AmbientPlayer::setVoiceState(QMediaPlayer::PlaybackState state)
+{
+    if (m_voiceState == state) {
+        return;
+    }
+    m_voiceState = state;
+    if (state != QMediaPlayer::PlayingState) {
+        m_positionTimer->stop();
+    }
+    emit positionChanged(position());
+    updateButtonState();
+}
+
+void AmbientPlayer::setOutputVolume(float volume)
+{
+    m_outputVolume = qBound(0.0f, volume, 1.0f); // As QAudioOutput clamps
+    if (m_audioOutput) {
+        m_audioOutput->setVolume(m_outputVolume);
+    }
+    applyVoiceGain();
+}
+
+void AmbientPlayer::setMuted(bool muted)
+{
+    m_muted = muted;
+    if (m_audioOutput) {
+        m_audioOutput->setMuted(muted);
+    }
+    applyVoiceGain();
+}
+
 void AmbientPlayer::updateButtonState()
 {
+    BINAURAL_TRACE_SCOPE("media", "AmbientPlayer::updateButtonState");
     QString icon;
-    switch (m_player->playbackState()) {
+    switch (playbackState()) {
     case QMediaPlayer::PlayingState:
         icon = " ❚❚";  // Pause symbol
         m_button->setStyleSheet("QPushButton { color: green; }");
@@ -89,8 +342,13 @@ void AmbientPlayer::updateButtonState()
 void AmbientPlayer::updatePlayerSettings()
 {
     // Apply current settings to the player
-    m_audioOutput->setVolume(m_volume);
-    m_player->setLoops(m_autoRepeat ? QMediaPlayer::Infinite : 1);
+    setOutputVolume(GainCurve::perceptual(m_volume / 100.0f));
+    if (m_player) {
+        m_player->setLoops(m_autoRepeat ? QMediaPlayer::Infinite : 1);
+    }
+    if (m_voice >= 0) {
+        m_pool->mixer()->setLooping(m_voice, m_autoRepeat);
+    }
 
 
     // Visual cue for enabled/disabled
@@ -123,8 +381,14 @@ void AmbientPlayer::setName(const QString &name)
 void AmbientPlayer::setFilePath(const QString &path)
 {
     if (m_filePath != path) {
+        if (m_voiceState != QMediaPlayer::StoppedState) {
+            setVoiceState(QMediaPlayer::StoppedState);
+        }
+        releaseVoice();  // Decoded again on the next play()
         m_filePath = path;
-        if (!path.isEmpty()) {
+        if (!m_player) {
+            // Loaded by ensureMediaPlayer()
+        } else if (!path.isEmpty()) {
             m_player->setSource(QUrl::fromLocalFile(path));
         } else {
             m_player->setSource(QUrl());  // Clear source
@@ -139,8 +403,8 @@ void AmbientPlayer::setVolume(int volume)  // volume is 0-100
     volume = qBound(0, volume, 100);
     if (m_volume != volume) {
         m_volume = volume;
-        // Convert 0-100 to 0.0-1.0 for Qt6
-        m_audioOutput->setVolume(m_volume / 100.0f);  // ← FIXED!
+        // Even in dB along the slider
+        setOutputVolume(GainCurve::perceptual(m_volume / 100.0f));
         emit needsUpdate();
     }
 }
@@ -152,9 +416,9 @@ void AmbientPlayer::applyMasterVolume(float ratio)
 
     // Calculate actual output: base × master × perceptual curve
     float linear = m_baseVolume * m_masterRatio / 100.0f;
-    float perceptual = qPow(linear, 0.5f);  // Square root curve
+    float perceptual = GainCurve::perceptual(linear);  // Even in dB
 
-    m_audioOutput->setVolume(perceptual);
+    setOutputVolume(perceptual);
 }
 
 void AmbientPlayer::setEnabled(bool enabled)
@@ -163,8 +427,8 @@ void AmbientPlayer::setEnabled(bool enabled)
         m_enabled = enabled;
 
         // If disabling, stop playback
-        if (!m_enabled && m_player->playbackState() == QMediaPlayer::PlayingState) {
-            m_player->stop();
+        if (!m_enabled && playbackState() == QMediaPlayer::PlayingState) {
+            stop();
         }
 
         updatePlayerSettings();  // Update button appearance
@@ -176,7 +440,33 @@ void AmbientPlayer::setAutoRepeat(bool repeat)
 {
     if (m_autoRepeat != repeat) {
         m_autoRepeat = repeat;
-        m_player->setLoops(m_autoRepeat ? QMediaPlayer::Infinite : 1);
+        if (m_player) {
+            m_player->setLoops(m_autoRepeat ? QMediaPlayer::Infinite : 1);
+        }
+        if (m_voice >= 0) {
+            m_pool->mixer()->setLooping(m_voice, m_autoRepeat);
+        }
+        emit needsUpdate();
+    }
+}
+
+void AmbientPlayer::setSpatial(bool spatial)
+{
+    if (m_spatial != spatial) {
+        m_spatial = spatial;
+        applySpatialPosition();
+        emit needsUpdate();
+    }
+}
+
+void AmbientPlayer::setSpatialPosition(float azimuth, float elevation)
+{
+    azimuth = qBound(-180.0f, azimuth, 180.0f);
+    elevation = qBound(-90.0f, elevation, 90.0f);
+    if (m_azimuth != azimuth || m_elevation != elevation) {
+        m_azimuth = azimuth;
+        m_elevation = elevation;
+        applySpatialPosition();
         emit needsUpdate();
     }
 }
@@ -194,6 +484,39 @@ void AmbientPlayer::play()
         return;
     }
 
+    BINAURAL_TRACE_SCOPE("media", "AmbientPlayer::play");
+    startPlayback();
+}
+
+void AmbientPlayer::startPlayback()
+{
+    if (m_streaming || s_maxDecodedBytes == 0) {
+        m_streaming = true;
+        playStreaming();
+    } else if (m_clip) {
+        if (m_voiceState != QMediaPlayer::PlayingState) {
+            startVoice();
+        }
+    } else {
+        // Playing from the user's point of view; the voice starts when
+        // the clip is ready (at once if cached), or the player streams if
+        // it cannot be
+        if (!m_loader) {
+            m_loader = new AmbientClipLoader(this);
+            m_loader->setCache(ConstantGlobals::decodedAudioCachePath, s_decodedCacheBytes);
+            connect(m_loader, &AmbientClipLoader::finished, this, &AmbientPlayer::clipLoaded);
+            connect(m_loader, &AmbientClipLoader::errorOccurred, this, &AmbientPlayer::clipFailed);
+        }
+        setVoiceState(QMediaPlayer::PlayingState);
+        if (!m_loader->isLoading()) {
+            m_loader->load(m_filePath, s_maxDecodedBytes);
+        }
+    }
+}
+
+void AmbientPlayer::playStreaming()
+{
+    ensureMediaPlayer();
     if (m_player->playbackState() == QMediaPlayer::StoppedState) {
         // If stopped, need to potentially reload source
         if (m_player->source().isEmpty() && !m_filePath.isEmpty()) {
@@ -206,21 +529,117 @@ void AmbientPlayer::play()
 
 void AmbientPlayer::pause()
 {
-    if (m_player->playbackState() == QMediaPlayer::PlayingState) {
+    if (playbackState() != QMediaPlayer::PlayingState) {
+        return;
+    }
+    if (m_streaming) {
         m_player->pause();
+    } else {
+        // The voice keeps its position and resumes on play()
+        if (m_voice >= 0) {
+            m_pool->setPlaying(m_voice, false);
+        }
+        setVoiceState(QMediaPlayer::PausedState);
     }
 }
 
 void AmbientPlayer::stop()
 {
-    if (m_player->playbackState() != QMediaPlayer::StoppedState) {
+    if (playbackState() == QMediaPlayer::StoppedState) {
+        return;
+    }
+    if (m_streaming) {
+        m_player->stop();
+    } else {
+        if (m_voice >= 0) {
+            m_pool->setPlaying(m_voice, false);
+            m_pool->mixer()->setPositionFrames(m_voice, 0);
+        }
+        setVoiceState(QMediaPlayer::StoppedState);
+    }
+}
+
+void AmbientPlayer::crossfadeTo(const QString &path, std::shared_ptr<const AmbientClip> clip, bool preloadFailed,
+                                bool play, int fadeMs)
+{
+    const bool wasPlaying = playbackState() == QMediaPlayer::PlayingState;
+    if (path == m_filePath && wasPlaying == play) {
+        return; // Plays on, or stays silent
+    }
+    BINAURAL_TRACE_SCOPE("media", "AmbientPlayer::crossfadeTo");
+    fadeMs = qMax(0, fadeMs);
+    const qint64 fadeFrames = qint64(fadeMs) * AmbientClip::SAMPLE_RATE / 1000;
+
+    // The sound playing now goes out; a decoded one keeps its voice until
+    // it has faded
+    if (wasPlaying && m_streaming) {
         m_player->stop();
+    } else if (wasPlaying && m_voice >= 0) {
+        const int voice = m_voice;
+        m_pool->mixer()->setFade(voice, -1.0f, 0.0f, fadeFrames, true);
+        m_fadingVoices.append(voice);
+        QTimer::singleShot(fadeMs + FADE_RELEASE_MARGIN_MS, this, [this, voice]() {
+            releaseFadedVoice(voice);
+        });
+        m_voice = -1;
+    }
+    setVoiceState(QMediaPlayer::StoppedState);
+
+    if (path != m_filePath) {
+        setFilePath(path);
+        if (clip) {
+            adoptClip(std::move(clip));
+        } else if (preloadFailed && !path.isEmpty()) {
+            m_streaming = true; // Could not be decoded ahead, so it will not be now
+        }
+    }
+    if (!play || m_filePath.isEmpty()) {
+        return;
+    }
+    if (m_clip) {
+        startVoice(fadeFrames);
+    } else {
+        startPlayback(); // At once: streaming or still decoding
     }
 }
 
 QMediaPlayer::PlaybackState AmbientPlayer::playbackState() const
 {
-    return m_player->playbackState();
+    if (m_streaming) {
+        return m_player ? m_player->playbackState() : QMediaPlayer::StoppedState;
+    }
+    return m_voiceState;
+}
+
+qint64 AmbientPlayer::position() const
+{
+    if (m_streaming) {
+        return m_player ? m_player->position() : 0;
+    }
+    if (m_voice < 0) {
+        return 0;
+    }
+    return m_pool->mixer()->positionFrames(m_voice) * 1000 / AmbientClip::SAMPLE_RATE;
+}
+
+qint64 AmbientPlayer::duration() const
+{
+    if (m_streaming) {
+        return m_player ? m_player->duration() : 0;
+    }
+    return m_clip ? m_clip->durationMs() : 0;
+}
+
+void AmbientPlayer::setPosition(qint64 position)
+{
+    if (m_streaming) {
+        if (m_player && m_player->isSeekable()) {
+            m_player->setPosition(position);
+        }
+    } else if (m_voice >= 0) {
+        m_pool->mixer()->setPositionFrames(m_voice, position * AmbientClip::SAMPLE_RATE / 1000);
+        emit positionChanged(this->position());
+    }
 }
 
 /*
@@ -2,20 +2,44 @@
 #define AMBIENTPLAYER_H
 
 #include <QObject>
+#include <QAudio>
 
 #include <QMediaPlayer>
+#include <QPointer>
 #include <QPushButton>
 #include<QAudioOutput>
+#include <memory>
+
+struct AmbientClip;
+struct AmbientLoop;
+class AmbientClipLoader;
+class AmbientVoicePool;
+class LoopAnalyzer;
+class QTimer;
 
 class AmbientPlayer : public QObject
 {
     Q_OBJECT
 
 public:
-    // Constructor
-    explicit AmbientPlayer(QObject *parent = nullptr);
+    // Decoded files play as a voice of `pool`, shared by every layer; a
+    // player given none makes its own
+    explicit AmbientPlayer(AmbientVoicePool *pool = nullptr, QObject *parent = nullptr);
     ~AmbientPlayer();
+    // Files that decode to at most this many bytes of float PCM are decoded
+    // once and looped from memory; larger ones, or ones the decoder cannot
+    // handle, stream through a QMediaPlayer. 0 streams everything.
+    static void setMaxDecodedBytes(qint64 bytes);
+    static qint64 maxDecodedBytes();
+    // Decoded PCM kept in ConstantGlobals::decodedAudioCachePath, so the
+    // next load of a file maps it instead of decoding. 0 keeps none.
+    static void setDecodedCacheBytes(qint64 bytes);
+    static qint64 decodedCacheBytes();
+
+    // Null unless the current file streams: idle players, or players
+    // looping from memory, cost no media backends
     QMediaPlayer* mediaPlayer() const { return m_player; }
+    bool isStreaming() const { return m_streaming; }
     // ----- SIMPLE SETTERS/GETTERS (No need for complex ones) -----
     void setName(const QString &name);
     QString name() const { return m_name; }
@@ -32,6 +56,15 @@ public:
     void setAutoRepeat(bool repeat);
     bool autoRepeat() const { return m_autoRepeat; }
 
+    // Placed around the listener for headphones instead of played in
+    // stereo (decoded files only): azimuth in degrees clockwise from ahead,
+    // elevation up from the horizon
+    void setSpatial(bool spatial);
+    bool isSpatial() const { return m_spatial; }
+    void setSpatialPosition(float azimuth, float elevation);
+    float azimuth() const { return m_azimuth; }
+    float elevation() const { return m_elevation; }
+
     // ----- PLAYBACK CONTROL -----
     void play();
     void pause();
@@ -39,6 +72,23 @@ public:
 
     QMediaPlayer::PlaybackState playbackState() const;
 
+    // Preset switching: takes `path` over, already decoded as `clip`, or
+    // streamed if `preloadFailed` (it could not be decoded ahead); with
+    // neither it is decoded when it first plays. Plays it if `play`,
+    // enabled or not. A decoded sound playing now fades out over `fadeMs`
+    // as a decoded new one fades in; both fades start at the pool's next
+    // commitFades(), so the caller switches every layer and then commits.
+    // Streamed sounds switch at once.
+    void crossfadeTo(const QString &path, std::shared_ptr<const AmbientClip> clip, bool preloadFailed,
+                     bool play, int fadeMs);
+
+    // Milliseconds, whichever backend plays the file
+    qint64 position() const;
+    qint64 duration() const;
+    void setPosition(qint64 position);
+
+    void setMuted(bool muted);
+
     // ----- UI GETTER (MainWindow will use this) -----
     QPushButton* button() const { return m_button; }
 
@@ -51,9 +101,16 @@ signals:
     void nameChanged(const QString &newName);
     void stateChanged();
     void needsUpdate();  // Generic "something changed" signal
+    void positionChanged(qint64 position);
+    void durationChanged(qint64 duration);
 
 private slots:
     void updateButtonState();
+    void clipLoaded();
+    void clipFailed(const QString &error);
+    void loopPointsFound();
+    void updateVoicePosition();
+    void voicePoolFailed(const QString &error);
 
 private:
     // Core Data
@@ -62,14 +119,45 @@ private:
     int m_volume;
     bool m_enabled;
     bool m_autoRepeat;
+    bool m_spatial;
+    float m_azimuth;
+    float m_elevation;
 
-    // Audio Engine
+    // Audio Engine: a pool voice over the decoded clip, or a streaming player
     QMediaPlayer* m_player;
+    float m_outputVolume;  // Applied to the active output, kept until it exists
+    bool m_muted;
+    bool m_streaming;      // Current file is too large or undecodable
+
+    AmbientClipLoader* m_loader;
+    std::shared_ptr<const AmbientClip> m_clip;
+    LoopAnalyzer* m_loopAnalyzer;
+    std::shared_ptr<const AmbientLoop> m_loop; // Null: loop the whole clip
+    QPointer<AmbientVoicePool> m_pool; // Cleared if the pool goes first
+    int m_voice;           // In m_pool's mixer; -1 until the clip first plays
+    QList<int> m_fadingVoices; // Faded out by a switch, released after it
+    QMediaPlayer::PlaybackState m_voiceState; // Playing while the clip decodes
+    QTimer* m_positionTimer;
+
+    static qint64 s_maxDecodedBytes;
+    static qint64 s_decodedCacheBytes;
 
     // UI Element (One button in toolbar)
     QPushButton* m_button;
 
     void setupConnections();
+    void ensureMediaPlayer();
+    void startPlayback();
+    void playStreaming();
+    void adoptClip(std::shared_ptr<const AmbientClip> clip);
+    AmbientVoicePool* voicePool();
+    void startVoice(qint64 fadeInFrames = 0);
+    void releaseVoice();
+    void releaseFadedVoice(int voice);
+    void applyVoiceGain();
+    void applySpatialPosition();
+    void setVoiceState(QMediaPlayer::PlaybackState state);
+    void setOutputVolume(float volume);
     void updatePlayerSettings();
     QAudioOutput *m_audioOutput = nullptr;
 
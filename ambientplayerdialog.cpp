@@ -44,6 +44,14 @@ AmbientPlayerDialog::AmbientPlayerDialog(AmbientPlayer* player, QWidget *parent)
     m_enabledCheck = new QCheckBox(tr("Enabled"), this);
     m_repeatCheck = new QCheckBox(tr("Auto-Repeat"), this);
 
+    m_spatialCheck = new QCheckBox(tr("3D Position (headphones)"), this);
+    m_spatialCheck->setToolTip(tr("Place this sound around you instead of in stereo"));
+    m_azimuthSlider = new QSlider(Qt::Horizontal, this);
+    m_azimuthSlider->setRange(-180, 180);
+    m_elevationSlider = new QSlider(Qt::Horizontal, this);
+    m_elevationSlider->setRange(-40, 90);
+    m_positionLabel = new QLabel(this);
+
     m_applyButton = new QPushButton(tr("Apply"), this);
     m_okButton = new QPushButton(tr("OK"), this);
     m_cancelButton = new QPushButton(tr("Cancel"), this);
@@ -82,8 +90,15 @@ void AmbientPlayerDialog::setupLayout()
     QHBoxLayout* settingsLayout = new QHBoxLayout();
     settingsLayout->addWidget(m_enabledCheck);
     settingsLayout->addWidget(m_repeatCheck);
+    settingsLayout->addWidget(m_spatialCheck);
     settingsLayout->addStretch();
 
+    // 3D position
+    QFormLayout* positionLayout = new QFormLayout();
+    positionLayout->addRow(tr("Direction:"), m_azimuthSlider);
+    positionLayout->addRow(tr("Height:"), m_elevationSlider);
+    positionLayout->addRow(QString(), m_positionLabel);
+
     // Dialog buttons
     QHBoxLayout* buttonLayout = new QHBoxLayout();
     buttonLayout->addStretch();
@@ -110,6 +125,7 @@ void AmbientPlayerDialog::setupLayout()
     QVBoxLayout* settingsGroupLayout = new QVBoxLayout();
     settingsGroupLayout->addLayout(volumeLayout);
     settingsGroupLayout->addLayout(settingsLayout);
+    settingsGroupLayout->addLayout(positionLayout);
     settingsGroup->setLayout(settingsGroupLayout);
 
     // Main layout
@@ -138,21 +154,22 @@ void AmbientPlayerDialog::setupConnections()
     connect(m_nameEdit, &QLineEdit::textChanged, this, &AmbientPlayerDialog::onNameChanged);
     connect(m_enabledCheck, &QCheckBox::toggled, this, &AmbientPlayerDialog::onEnabledToggled);
     connect(m_repeatCheck, &QCheckBox::toggled, this, &AmbientPlayerDialog::onRepeatToggled);
+    connect(m_spatialCheck, &QCheckBox::toggled, this, &AmbientPlayerDialog::onSpatialToggled);
+    connect(m_azimuthSlider, &QSlider::valueChanged, this, &AmbientPlayerDialog::onSpatialPositionChanged);
+    connect(m_elevationSlider, &QSlider::valueChanged, this, &AmbientPlayerDialog::onSpatialPositionChanged);
 
     // Connect to player signals if player exists
     if (m_player) {
         connect(m_player, &AmbientPlayer::stateChanged, this, &AmbientPlayerDialog::onPlayerStateChanged);
         connect(m_player, &AmbientPlayer::needsUpdate, this, &AmbientPlayerDialog::updateUI);
 
-        // Connect to player's QMediaPlayer signals for progress updates
+        // Progress comes from whichever backend plays the file: the
+        // decoded voice or a streaming QMediaPlayer
         //QMediaPlayer* mediaPlayer = m_player->button()->parent()->findChild<QMediaPlayer*>();
-        QMediaPlayer* mediaPlayer = m_player->mediaPlayer();
-        if (mediaPlayer) {
-            connect(mediaPlayer, &QMediaPlayer::positionChanged, this, &AmbientPlayerDialog::onPositionChanged);
-            connect(mediaPlayer, &QMediaPlayer::durationChanged, this, &AmbientPlayerDialog::onDurationChanged);
-            connect(m_progressSlider, &QSlider::sliderReleased, this, &AmbientPlayerDialog::seekAudio);
-
-        }
+        connect(m_player, &AmbientPlayer::positionChanged, this, &AmbientPlayerDialog::onPositionChanged);
+        connect(m_player, &AmbientPlayer::durationChanged, this, &AmbientPlayerDialog::onDurationChanged);
+        onDurationChanged(m_player->duration());
+        connect(m_progressSlider, &QSlider::sliderReleased, this, &AmbientPlayerDialog::seekAudio);
     }
 
     connect(m_okButton, &QPushButton::clicked, this, [this]() {
@@ -176,6 +193,12 @@ void AmbientPlayerDialog::loadPlayerData()
     m_volumeSlider->setValue(m_player->volume());
     m_enabledCheck->setChecked(m_player->isEnabled());
     m_repeatCheck->setChecked(m_player->autoRepeat());
+    m_spatialCheck->setChecked(m_player->isSpatial());
+    // Both at once: each slider alone would move the player
+    const QSignalBlocker azimuthBlocker(m_azimuthSlider);
+    const QSignalBlocker elevationBlocker(m_elevationSlider);
+    m_azimuthSlider->setValue(qRound(m_player->azimuth()));
+    m_elevationSlider->setValue(qRound(m_player->elevation()));
 
     updateUI();
 }
@@ -197,6 +220,15 @@ void AmbientPlayerDialog::updateUI()
     // Update enabled state
     m_playPauseButton->setEnabled(m_player->hasAudio());
     m_stopButton->setEnabled(m_player->hasAudio());
+
+    // Update 3D position
+    m_azimuthSlider->setEnabled(m_player->isSpatial());
+    m_elevationSlider->setEnabled(m_player->isSpatial());
+    m_positionLabel->setText(tr("%1° %2, %3° %4")
+                                 .arg(qAbs(qRound(m_player->azimuth())))
+                                 .arg(m_player->azimuth() < 0 ? tr("left") : tr("right"))
+                                 .arg(qAbs(qRound(m_player->elevation())))
+                                 .arg(m_player->elevation() < 0 ? tr("below") : tr("above")));
 }
 
 void AmbientPlayerDialog::onBrowseClicked()
@@ -265,6 +297,23 @@ void AmbientPlayerDialog::onRepeatToggled(bool checked)
     m_changesMade = true;
 }
 
+void AmbientPlayerDialog::onSpatialToggled(bool checked)
+{
+    // Heard straight away, like the volume
+    m_changesMade = true;
+    if (m_player) {
+        m_player->setSpatial(checked);
+    }
+}
+
+void AmbientPlayerDialog::onSpatialPositionChanged()
+{
+    m_changesMade = true;
+    if (m_player) {
+        m_player->setSpatialPosition(m_azimuthSlider->value(), m_elevationSlider->value());
+    }
+}
+
 void AmbientPlayerDialog::onApplyClicked()
 {
     applyChanges();
@@ -379,8 +428,5 @@ void AmbientPlayerDialog::hideEvent(QHideEvent *event)
 void AmbientPlayerDialog::seekAudio()
 {
     int position = m_progressSlider->value();
-       QMediaPlayer* mediaPlayer = m_player->mediaPlayer();
-       if (mediaPlayer && mediaPlayer->isSeekable()) {
-           mediaPlayer->setPosition(position);
-       }
+       m_player->setPosition(position);
 }
@@ -53,6 +53,8 @@ private slots:
     void onNameChanged(const QString &text);
     void onEnabledToggled(bool checked);
     void onRepeatToggled(bool checked);
+    void onSpatialToggled(bool checked);
+    void onSpatialPositionChanged();
     void onApplyClicked();
     void onPlayerStateChanged();
     void onPositionChanged(qint64 position);
@@ -76,6 +78,10 @@ private:
     QLabel* m_durationLabel;
     QCheckBox* m_enabledCheck;
     QCheckBox* m_repeatCheck;
+    QCheckBox* m_spatialCheck;
+    QSlider* m_azimuthSlider;
+    QSlider* m_elevationSlider;
+    QLabel* m_positionLabel;
     QPushButton* m_applyButton;
     QPushButton* m_okButton;
     QPushButton* m_cancelButton;
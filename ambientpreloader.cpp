@@ -0,0 +1,123 @@
+#include "ambientpreloader.h"
+
+#include <QDebug>
+#include <QThread>
+
+#include "ambientclip.h"
+#include "tracerecorder.h"
+
+AmbientPreloader::AmbientPreloader(QObject *parent)
+    : QObject(parent)
+    , m_cacheBytes(0)
+    , m_maxBytes(AmbientClipLoader::DEFAULT_MAX_BYTES)
+    , m_done(0)
+    , m_total(0)
+{
+    // Loaders are created as a batch needs them
+}
+
+int AmbientPreloader::maxParallel()
+{
+    return qBound(2, QThread::idealThreadCount(), 8);
+}
+
+void AmbientPreloader::setCache(const QString &directory, qint64 maxBytes)
+{
+    m_cacheDirectory = directory;
+    m_cacheBytes = maxBytes;
+    for (AmbientClipLoader *loader : std::as_const(m_loaders)) {
+        loader->setCache(directory, maxBytes);
+    }
+}
+
+void AmbientPreloader::preload(const QStringList &paths, qint64 maxBytes)
+{
+    BINAURAL_TRACE_SCOPE("media", "AmbientPreloader::preload");
+    cancel();
+    m_clips.clear();
+    m_maxBytes = maxBytes;
+    m_queue = paths;
+    m_queue.removeDuplicates();
+    m_queue.removeAll(QString());
+    m_done = 0;
+    m_total = int(m_queue.size());
+
+    if (m_queue.isEmpty()) {
+        emit finished();
+        return;
+    }
+    loadNext();
+}
+
+void AmbientPreloader::cancel()
+{
+    for (auto it = m_loading.begin(); it != m_loading.end(); ++it) {
+        it.key()->cancel();
+    }
+    m_loading.clear();
+    m_queue.clear();
+}
+
+std::shared_ptr<const AmbientClip> AmbientPreloader::clip(const QString &path) const
+{
+    return m_clips.value(path);
+}
+
+bool AmbientPreloader::failed(const QString &path) const
+{
+    const auto it = m_clips.constFind(path);
+    return it != m_clips.constEnd() && !it.value();
+}
+
+void AmbientPreloader::clear()
+{
+    cancel();
+    m_clips.clear();
+}
+
+void AmbientPreloader::loadNext()
+{
+    // A cached file finishes inside load(), which comes back here
+    while (!m_queue.isEmpty() && m_loading.size() < maxParallel()) {
+        AmbientClipLoader *loader = nullptr;
+        for (AmbientClipLoader *idle : std::as_const(m_loaders)) {
+            if (!m_loading.contains(idle)) {
+                loader = idle;
+                break;
+            }
+        }
+        if (!loader) {
+            loader = new AmbientClipLoader(this);
+            loader->setCache(m_cacheDirectory, m_cacheBytes);
+            connect(loader, &AmbientClipLoader::finished, this, [this, loader]() {
+                loaderDone(loader, true);
+            });
+            connect(loader, &AmbientClipLoader::errorOccurred, this, [this, loader](const QString &error) {
+                qInfo() << "AmbientPreloader: will stream" << m_loading.value(loader) << "-" << error;
+                loaderDone(loader, false);
+            });
+            m_loaders.append(loader);
+        }
+        const QString path = m_queue.takeFirst();
+        m_loading.insert(loader, path);
+        loader->load(path, m_maxBytes);
+    }
+}
+
+void AmbientPreloader::loaderDone(AmbientClipLoader *loader, bool ok)
+{
+    if (!m_loading.contains(loader)) {
+        return; // From a cancelled batch
+    }
+    const QString path = m_loading.take(loader);
+    m_clips.insert(path, ok ? loader->takeClip() : nullptr);
+    ++m_done;
+    emit progress(m_done, m_total);
+
+    if (m_loading.isEmpty() && m_queue.isEmpty()) {
+        BINAURAL_TRACE_INSTANT("media", "AmbientPreloader::finished", "files", m_total);
+        emit finished();
+        return;
+    }
+    loadNext();
+}
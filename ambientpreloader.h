@@ -0,0 +1,63 @@
+#ifndef AMBIENTPRELOADER_H
+#define AMBIENTPRELOADER_H
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+#include <memory>
+
+struct AmbientClip;
+class AmbientClipLoader;
+
+// Decodes the files of the next ambient scene while the current one plays,
+// several at once: each loader has a QAudioDecoder of its own, so the
+// files are opened, probed and decoded in parallel and none of it happens
+// when the scene is switched. Cached files are mapped at once.
+class AmbientPreloader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AmbientPreloader(QObject *parent = nullptr);
+
+    // Loaders at work at once: the cores, within 2-8
+    static int maxParallel();
+
+    void setCache(const QString &directory, qint64 maxBytes);
+
+    // Drops the previous batch, finished or not. finished() follows once
+    // every file is decoded or has failed, before this returns if all of
+    // them were cached (or there are none).
+    void preload(const QStringList &paths, qint64 maxBytes);
+    void cancel();
+    bool isLoading() const { return !m_loading.isEmpty() || !m_queue.isEmpty(); }
+
+    // Null for files that failed or decode past maxBytes, and for files
+    // not in the batch; failed() tells the first apart: they stream
+    std::shared_ptr<const AmbientClip> clip(const QString &path) const;
+    bool failed(const QString &path) const;
+    void clear();
+
+signals:
+    void progress(int done, int total);
+    void finished();
+
+private:
+    void loadNext();
+    void loaderDone(AmbientClipLoader *loader, bool ok);
+
+    QList<AmbientClipLoader*> m_loaders;
+    QHash<AmbientClipLoader*, QString> m_loading;
+    QStringList m_queue;
+    QHash<QString, std::shared_ptr<const AmbientClip>> m_clips;
+    QString m_cacheDirectory;
+    qint64 m_cacheBytes;
+    qint64 m_maxBytes;
+    int m_done;
+    int m_total;
+};
+
+#endif // AMBIENTPRELOADER_H
@@ -0,0 +1,262 @@
+#include "ambientscatter.h"
+
+#include <QDebug>
+#include <QJsonArray>
+
+#include "ambientclip.h"
+#include "ambientmixer.h"
+#include "gaincurve.h"
+#include "tracerecorder.h"
+
+QJsonObject ScatterSettings::toJson() const
+{
+    QJsonObject json;
+    json["name"] = name;
+    json["files"] = QJsonArray::fromStringList(files);
+    json["minInterval"] = minIntervalSeconds;
+    json["maxInterval"] = maxIntervalSeconds;
+    json["minGain"] = minGain;
+    json["maxGain"] = maxGain;
+    json["panWidth"] = panWidth;
+    json["seed"] = qint64(seed);
+    json["volume"] = volume;
+    json["enabled"] = enabled;
+    return json;
+}
+
+ScatterSettings ScatterSettings::fromJson(const QJsonObject &json)
+{
+    ScatterSettings settings;
+    settings.name = json["name"].toString(settings.name);
+    for (const QJsonValue &file : json["files"].toArray()) {
+        settings.files.append(file.toString());
+    }
+    settings.minIntervalSeconds = qMax(0.05, json["minInterval"].toDouble(settings.minIntervalSeconds));
+    settings.maxIntervalSeconds = qMax(settings.minIntervalSeconds,
+                                       json["maxInterval"].toDouble(settings.maxIntervalSeconds));
+    settings.minGain = qBound(0.0f, float(json["minGain"].toDouble(settings.minGain)), 1.0f);
+    settings.maxGain = qBound(settings.minGain, float(json["maxGain"].toDouble(settings.maxGain)), 1.0f);
+    settings.panWidth = qBound(0.0f, float(json["panWidth"].toDouble(settings.panWidth)), 1.0f);
+    settings.seed = quint32(json["seed"].toInteger(settings.seed));
+    settings.volume = qBound(0, json["volume"].toInt(settings.volume), 100);
+    settings.enabled = json["enabled"].toBool(settings.enabled);
+    return settings;
+}
+
+// =================== SAMPLE BANK ===================
+AmbientSampleBank::AmbientSampleBank(QObject *parent)
+    : QObject(parent)
+    , m_loader(new AmbientClipLoader(this))
+{
+    connect(m_loader, &AmbientClipLoader::finished, this, &AmbientSampleBank::loaderFinished);
+    connect(m_loader, &AmbientClipLoader::errorOccurred, this, &AmbientSampleBank::loaderFailed);
+}
+
+void AmbientSampleBank::setCache(const QString &directory, qint64 maxBytes)
+{
+    m_loader->setCache(directory, maxBytes);
+}
+
+void AmbientSampleBank::request(const QStringList &paths)
+{
+    for (const QString &path : paths) {
+        if (!m_clips.contains(path) && !m_failed.contains(path) && !isPending(path)) {
+            m_queue.append(path);
+        }
+    }
+    if (m_loading.isEmpty()) {
+        loadNext();
+    }
+}
+
+std::shared_ptr<const AmbientClip> AmbientSampleBank::clip(const QString &path) const
+{
+    return m_clips.value(path);
+}
+
+bool AmbientSampleBank::isPending(const QString &path) const
+{
+    return path == m_loading || m_queue.contains(path);
+}
+
+void AmbientSampleBank::releaseUnused()
+{
+    for (auto it = m_clips.begin(); it != m_clips.end();) {
+        if (it.value().use_count() == 1) {
+            it = m_clips.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void AmbientSampleBank::loadNext()
+{
+    // A cached sample finishes inside load(), which comes back here
+    while (m_loading.isEmpty() && !m_queue.isEmpty()) {
+        m_loading = m_queue.takeFirst();
+        m_loader->load(m_loading, MAX_SAMPLE_BYTES);
+    }
+}
+
+void AmbientSampleBank::loaderFinished()
+{
+    const QString path = m_loading;
+    m_clips.insert(path, m_loader->takeClip());
+    m_loading.clear();
+    emit clipReady(path);
+    loadNext();
+}
+
+void AmbientSampleBank::loaderFailed(const QString &error)
+{
+    const QString path = m_loading;
+    qWarning() << "AmbientSampleBank: leaving out" << error;
+    m_failed.insert(path);
+    m_loading.clear();
+    emit clipFailed(path, error);
+    loadNext();
+}
+
+// =================== SCATTER LAYER ===================
+AmbientScatterLayer::AmbientScatterLayer(AmbientVoicePool *pool, AmbientSampleBank *bank, QObject *parent)
+    : QObject(parent)
+    , m_pool(pool)
+    , m_bank(bank)
+    , m_scatter(-1)
+    , m_wantPlaying(false)
+    , m_muted(false)
+{
+    connect(m_bank, &AmbientSampleBank::clipReady, this, &AmbientScatterLayer::sampleReady);
+    connect(m_bank, &AmbientSampleBank::clipFailed, this, &AmbientScatterLayer::sampleReady);
+}
+
+AmbientScatterLayer::~AmbientScatterLayer()
+{
+    releaseScatter();
+}
+
+void AmbientScatterLayer::setSettings(const ScatterSettings &settings)
+{
+    m_settings = settings;
+    releaseScatter();
+    if (m_wantPlaying) {
+        start();
+    }
+}
+
+void AmbientScatterLayer::setVolume(int volume)
+{
+    m_settings.volume = qBound(0, volume, 100);
+    applyGain();
+}
+
+void AmbientScatterLayer::setMuted(bool muted)
+{
+    m_muted = muted;
+    applyGain();
+}
+
+void AmbientScatterLayer::play()
+{
+    if (!m_settings.enabled || m_settings.files.isEmpty() || m_wantPlaying) {
+        return;
+    }
+    BINAURAL_TRACE_SCOPE("media", "AmbientScatterLayer::play");
+    m_wantPlaying = true;
+    start();
+    emit stateChanged();
+}
+
+void AmbientScatterLayer::pause()
+{
+    if (!m_wantPlaying) {
+        return;
+    }
+    m_wantPlaying = false;
+    if (m_scatter >= 0 && m_pool) {
+        m_pool->setScatterPlaying(m_scatter, false);
+    }
+    emit stateChanged();
+}
+
+void AmbientScatterLayer::stop()
+{
+    const bool wasPlaying = m_wantPlaying;
+    m_wantPlaying = false;
+    releaseScatter();
+    if (wasPlaying) {
+        emit stateChanged();
+    }
+}
+
+qint64 AmbientScatterLayer::triggerCount() const
+{
+    return (m_scatter >= 0 && m_pool) ? m_pool->mixer()->scatterTriggerCount(m_scatter) : 0;
+}
+
+void AmbientScatterLayer::sampleReady(const QString &path)
+{
+    if (m_wantPlaying && m_scatter < 0 && m_settings.files.contains(path)) {
+        start();
+    }
+}
+
+void AmbientScatterLayer::start()
+{
+    if (!m_pool || !m_bank) {
+        return;
+    }
+    if (m_scatter >= 0) {
+        m_pool->setScatterPlaying(m_scatter, true);
+        return;
+    }
+
+    // Wait for every sample; the ones that failed are left out
+    m_bank->request(m_settings.files);
+    auto set = std::make_shared<ScatterSet>();
+    for (const QString &file : std::as_const(m_settings.files)) {
+        if (m_bank->isPending(file)) {
+            return;
+        }
+        if (std::shared_ptr<const AmbientClip> clip = m_bank->clip(file)) {
+            set->clips.push_back(std::move(clip));
+        }
+    }
+    set->minIntervalSeconds = m_settings.minIntervalSeconds;
+    set->maxIntervalSeconds = m_settings.maxIntervalSeconds;
+    set->minGain = m_settings.minGain;
+    set->maxGain = m_settings.maxGain;
+    set->panWidth = m_settings.panWidth;
+    set->seed = m_settings.seed;
+
+    m_scatter = m_pool->mixer()->acquireScatter(std::move(set));
+    if (m_scatter < 0) {
+        qWarning() << "AmbientScatterLayer:" << m_settings.name << "has no playable samples"
+                   << "or all" << AmbientMixer::MAX_SCATTERS << "scatters are in use";
+        m_wantPlaying = false;
+        emit stateChanged();
+        return;
+    }
+    applyGain();
+    m_pool->setScatterPlaying(m_scatter, true);
+}
+
+void AmbientScatterLayer::releaseScatter()
+{
+    if (m_scatter >= 0 && m_pool) {
+        m_pool->setScatterPlaying(m_scatter, false);
+        m_pool->mixer()->releaseScatter(m_scatter);
+    }
+    m_scatter = -1;
+    if (m_bank) {
+        m_bank->releaseUnused();
+    }
+}
+
+void AmbientScatterLayer::applyGain()
+{
+    if (m_scatter >= 0 && m_pool) {
+        m_pool->mixer()->setScatterGain(m_scatter, m_muted ? 0.0f : GainCurve::perceptual(m_settings.volume / 100.0f));
+    }
+}
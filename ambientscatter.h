@@ -0,0 +1,125 @@
+#ifndef AMBIENTSCATTER_H
+#define AMBIENTSCATTER_H
+
+#include <QHash>
+#include <QJsonObject>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+#include <memory>
+
+struct AmbientClip;
+class AmbientClipLoader;
+class AmbientVoicePool;
+
+// What a scatter layer plays: its one-shot files and how they are strewn
+// (see ScatterSet). Stored in ambient presets under "scatters".
+struct ScatterSettings
+{
+    QString name = "Scatter";
+    QStringList files;
+    double minIntervalSeconds = 2.0;
+    double maxIntervalSeconds = 8.0;
+    float minGain = 0.5f;
+    float maxGain = 1.0f;
+    float panWidth = 0.8f;
+    quint32 seed = 1;
+    int volume = 50; // 0-100
+    bool enabled = true;
+
+    QJsonObject toJson() const;
+    static ScatterSettings fromJson(const QJsonObject &json);
+};
+
+// =================== SAMPLE BANK ===================
+// Decoded one-shot samples shared by every scatter layer: a file several
+// layers use is decoded (or mapped from the decoded audio cache) once, one
+// file at a time, and kept while any layer holds it.
+class AmbientSampleBank : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr qint64 MAX_SAMPLE_BYTES = 8 * 1024 * 1024; // ~20 s: one-shots are short
+
+    explicit AmbientSampleBank(QObject *parent = nullptr);
+
+    void setCache(const QString &directory, qint64 maxBytes);
+
+    // Queues the files not loaded (or failed) yet; clipReady() or
+    // clipFailed() follows for each of them
+    void request(const QStringList &paths);
+    std::shared_ptr<const AmbientClip> clip(const QString &path) const;
+    bool isPending(const QString &path) const;
+
+    // Forgets clips no scatter holds any more
+    void releaseUnused();
+
+signals:
+    void clipReady(const QString &path);
+    void clipFailed(const QString &path, const QString &error);
+
+private slots:
+    void loaderFinished();
+    void loaderFailed(const QString &error);
+
+private:
+    void loadNext();
+
+    AmbientClipLoader *m_loader;
+    QStringList m_queue;
+    QString m_loading;
+    QHash<QString, std::shared_ptr<const AmbientClip>> m_clips;
+    QSet<QString> m_failed; // Not tried again this session
+};
+
+// =================== SCATTER LAYER ===================
+// An ambient layer of scattered one-shots, played by a scatter of the
+// shared mixer. Playing starts once its samples are in the bank; files
+// that cannot be decoded are left out of the scene.
+class AmbientScatterLayer : public QObject
+{
+    Q_OBJECT
+
+public:
+    AmbientScatterLayer(AmbientVoicePool *pool, AmbientSampleBank *bank, QObject *parent = nullptr);
+    ~AmbientScatterLayer();
+
+    // Takes effect at once, restarting the scene if it plays
+    void setSettings(const ScatterSettings &settings);
+    const ScatterSettings &settings() const { return m_settings; }
+
+    void setVolume(int volume); // 0-100
+    void setMuted(bool muted);
+
+    void play();
+    void pause();
+    void stop(); // The next play() starts the scene over
+    bool isPlaying() const { return m_wantPlaying; }
+
+    // Shots fired since the scene started
+    qint64 triggerCount() const;
+
+signals:
+    void stateChanged();
+
+private slots:
+    void sampleReady(const QString &path);
+
+private:
+    void start();
+    void releaseScatter();
+    void applyGain();
+
+    QPointer<AmbientVoicePool> m_pool;
+    QPointer<AmbientSampleBank> m_bank;
+    ScatterSettings m_settings;
+    int m_scatter;      // In m_pool's mixer; -1 until the samples are in
+    bool m_wantPlaying; // Also while the samples load
+    bool m_muted;
+};
+
+#endif // AMBIENTSCATTER_H
@@ -0,0 +1,274 @@
+#include "ambientspatializer.h"
+
+#include <algorithm>
+
+AmbientSpatializer::AmbientSpatializer(std::shared_ptr<const HrtfSet> set, int maxBlockFrames, int partitionFrames)
+    : m_set(std::move(set))
+    , m_maxBlockFrames(std::max(1, maxBlockFrames))
+    , m_partitionFrames(FftPlan::isPowerOfTwo(partitionFrames) ? partitionFrames : DEFAULT_PARTITION_FRAMES)
+    , m_partitionCount((HrtfSet::LENGTH + m_partitionFrames - 1) / m_partitionFrames)
+    , m_bins(m_partitionFrames + 1)
+    , m_plan(2 * m_partitionFrames)
+    , m_buses(MAX_BUSES)
+    , m_busOfDirection(size_t(m_set->directionCount()), -1)
+    , m_pendingFrames(0)
+    , m_re(size_t(2 * m_partitionFrames))
+    , m_im(size_t(2 * m_partitionFrames))
+    , m_sumRe(size_t(2 * m_bins))
+    , m_sumIm(size_t(2 * m_bins))
+    , m_output(size_t(m_maxBlockFrames + m_partitionFrames) * 2, 0.0f)
+    , m_outputFrames(m_partitionFrames) // The latency, as silence
+{
+    // Every partition of every direction, transformed once: zero-padded
+    // to twice its length for overlap-save
+    const size_t perDirection = size_t(2 * m_partitionCount * m_bins);
+    m_filtersRe.resize(perDirection * size_t(m_set->directionCount()));
+    m_filtersIm.resize(m_filtersRe.size());
+    for (int direction = 0; direction < m_set->directionCount(); ++direction) {
+        for (int ear = 0; ear < 2; ++ear) {
+            const float *taps = ear == 0 ? m_set->left(direction) : m_set->right(direction);
+            for (int partition = 0; partition < m_partitionCount; ++partition) {
+                std::fill(m_re.begin(), m_re.end(), 0.0f);
+                std::fill(m_im.begin(), m_im.end(), 0.0f);
+                const int first = partition * m_partitionFrames;
+                const int count = std::min(m_partitionFrames, HrtfSet::LENGTH - first);
+                std::copy(taps + first, taps + first + count, m_re.begin());
+                m_plan.forward(m_re.data(), m_im.data());
+                const size_t at = filterOffset(direction, ear, partition);
+                std::copy(m_re.begin(), m_re.begin() + m_bins, m_filtersRe.begin() + ptrdiff_t(at));
+                std::copy(m_im.begin(), m_im.begin() + m_bins, m_filtersIm.begin() + ptrdiff_t(at));
+            }
+        }
+    }
+
+    for (Bus &bus : m_buses) {
+        bus.input.assign(size_t(m_maxBlockFrames + m_partitionFrames), 0.0f);
+        bus.previous.assign(size_t(m_partitionFrames), 0.0f);
+        bus.spectraRe.assign(size_t(m_partitionCount * m_bins), 0.0f);
+        bus.spectraIm.assign(bus.spectraRe.size(), 0.0f);
+    }
+    m_active.reserve(MAX_BUSES);
+}
+
+size_t AmbientSpatializer::filterOffset(int direction, int ear, int partition) const
+{
+    return ((size_t(direction) * 2 + size_t(ear)) * size_t(m_partitionCount) + size_t(partition)) * size_t(m_bins);
+}
+
+int AmbientSpatializer::activeBuses() const
+{
+    return int(std::count_if(m_buses.begin(), m_buses.end(), [](const Bus &bus) { return bus.direction != PLAIN; }));
+}
+
+AmbientSpatializer::Bus *AmbientSpatializer::busFor(int direction)
+{
+    if (direction < 0 || direction >= m_set->directionCount()) {
+        return nullptr;
+    }
+    if (m_busOfDirection[size_t(direction)] >= 0) {
+        return &m_buses[size_t(m_busOfDirection[size_t(direction)])];
+    }
+    for (size_t i = 0; i < m_buses.size(); ++i) {
+        Bus &bus = m_buses[i];
+        if (bus.direction != PLAIN) {
+            continue;
+        }
+        // Its input is kept zeroed past what is pending
+        bus.direction = direction;
+        std::fill(bus.previous.begin(), bus.previous.end(), 0.0f);
+        std::fill(bus.spectraRe.begin(), bus.spectraRe.end(), 0.0f);
+        std::fill(bus.spectraIm.begin(), bus.spectraIm.end(), 0.0f);
+        bus.head = 0;
+        bus.quiet = 0;
+        m_busOfDirection[size_t(direction)] = int(i);
+        return &bus;
+    }
+    return nullptr;
+}
+
+int AmbientSpatializer::addSource(int previous, int direction, const float *stereo, int frames, float *plain)
+{
+    Bus *to = busFor(direction);
+    if (!to) {
+        direction = PLAIN;
+    }
+    float *toInput = to ? to->input.data() + m_pendingFrames : nullptr;
+
+    if (previous == direction) {
+        if (toInput) {
+            for (int i = 0; i < frames; ++i) {
+                toInput[i] += 0.5f * (stereo[2 * i] + stereo[2 * i + 1]);
+            }
+        } else {
+            for (int i = 0; i < 2 * frames; ++i) {
+                plain[i] += stereo[i];
+            }
+        }
+        return direction;
+    }
+
+    // Moved: out of the old bus (or the plain mix) and into the new one
+    Bus *from = busFor(previous);
+    float *fromInput = from ? from->input.data() + m_pendingFrames : nullptr;
+    const float step = 1.0f / float(frames);
+    for (int i = 0; i < frames; ++i) {
+        const float in = float(i + 1) * step;
+        const float out = 1.0f - in;
+        const float left = stereo[2 * i];
+        const float right = stereo[2 * i + 1];
+        const float mono = 0.5f * (left + right);
+        if (fromInput) {
+            fromInput[i] += mono * out;
+        } else {
+            plain[2 * i] += left * out;
+            plain[2 * i + 1] += right * out;
+        }
+        if (toInput) {
+            toInput[i] += mono * in;
+        } else {
+            plain[2 * i] += left * in;
+            plain[2 * i + 1] += right * in;
+        }
+    }
+    return direction;
+}
+
+void AmbientSpatializer::processPartition(int offset)
+{
+    const int size = 2 * m_partitionFrames;
+    float *out = m_output.data() + size_t(m_outputFrames) * 2;
+    m_outputFrames += m_partitionFrames;
+
+    m_active.clear();
+    for (Bus &bus : m_buses) {
+        if (bus.direction != PLAIN) {
+            m_active.push_back(&bus);
+        }
+    }
+    if (m_active.empty()) {
+        std::fill(out, out + 2 * m_partitionFrames, 0.0f);
+        return;
+    }
+
+    // Each bus's last two partitions of input, transformed two buses at a
+    // time: one in the real part, one in the imaginary
+    auto load = [this, offset](Bus &bus, float *to) {
+        const float *input = bus.input.data() + offset;
+        std::copy(bus.previous.begin(), bus.previous.end(), to);
+        std::copy(input, input + m_partitionFrames, to + m_partitionFrames);
+        std::copy(input, input + m_partitionFrames, bus.previous.begin());
+        const bool silent = std::all_of(input, input + m_partitionFrames, [](float x) { return x == 0.0f; });
+        bus.quiet = silent ? bus.quiet + 1 : 0;
+        bus.head = (bus.head + 1) % m_partitionCount;
+    };
+    for (size_t a = 0; a < m_active.size(); a += 2) {
+        Bus &first = *m_active[a];
+        Bus *second = a + 1 < m_active.size() ? m_active[a + 1] : nullptr;
+        load(first, m_re.data());
+        if (second) {
+            load(*second, m_im.data());
+        } else {
+            std::fill(m_im.begin(), m_im.end(), 0.0f);
+        }
+        m_plan.forward(m_re.data(), m_im.data());
+
+        // Both inputs are real: each spectrum is the (anti)symmetric part
+        float *firstRe = first.spectraRe.data() + size_t(first.head * m_bins);
+        float *firstIm = first.spectraIm.data() + size_t(first.head * m_bins);
+        float *secondRe = second ? second->spectraRe.data() + size_t(second->head * m_bins) : nullptr;
+        float *secondIm = second ? second->spectraIm.data() + size_t(second->head * m_bins) : nullptr;
+        for (int k = 0; k < m_bins; ++k) {
+            const int mirror = (size - k) & (size - 1);
+            const float zr = m_re[size_t(k)];
+            const float zi = m_im[size_t(k)];
+            const float wr = m_re[size_t(mirror)];
+            const float wi = m_im[size_t(mirror)];
+            firstRe[k] = 0.5f * (zr + wr);
+            firstIm[k] = 0.5f * (zi - wi);
+            if (second) {
+                secondRe[k] = 0.5f * (zi + wi);
+                secondIm[k] = 0.5f * (wr - zr);
+            }
+        }
+    }
+
+    // Every bus's delay line against its direction's partitions, summed
+    std::fill(m_sumRe.begin(), m_sumRe.end(), 0.0f);
+    std::fill(m_sumIm.begin(), m_sumIm.end(), 0.0f);
+    const int bins = m_bins;
+    for (const Bus *bus : m_active) {
+        for (int partition = 0; partition < m_partitionCount; ++partition) {
+            const int slot = (bus->head - partition + m_partitionCount) % m_partitionCount;
+            const float *xr = bus->spectraRe.data() + size_t(slot * bins);
+            const float *xi = bus->spectraIm.data() + size_t(slot * bins);
+            for (int ear = 0; ear < 2; ++ear) {
+                const size_t at = filterOffset(bus->direction, ear, partition);
+                const float *hr = m_filtersRe.data() + at;
+                const float *hi = m_filtersIm.data() + at;
+                float *sr = m_sumRe.data() + size_t(ear * bins);
+                float *si = m_sumIm.data() + size_t(ear * bins);
+                for (int k = 0; k < bins; ++k) {
+                    sr[k] += xr[k] * hr[k] - xi[k] * hi[k];
+                    si[k] += xr[k] * hi[k] + xi[k] * hr[k];
+                }
+            }
+        }
+    }
+
+    // One inverse transform for both ears: left + i * right
+    const float *leftRe = m_sumRe.data();
+    const float *leftIm = m_sumIm.data();
+    const float *rightRe = leftRe + bins;
+    const float *rightIm = leftIm + bins;
+    for (int k = 0; k < bins; ++k) {
+        m_re[size_t(k)] = leftRe[k] - rightIm[k];
+        m_im[size_t(k)] = leftIm[k] + rightRe[k];
+    }
+    for (int k = bins; k < size; ++k) {
+        const int j = size - k;
+        m_re[size_t(k)] = leftRe[j] + rightIm[j];
+        m_im[size_t(k)] = rightRe[j] - leftIm[j];
+    }
+    m_plan.inverse(m_re.data(), m_im.data());
+
+    // Overlap-save: the second half is this partition's output
+    for (int i = 0; i < m_partitionFrames; ++i) {
+        out[2 * i] = m_re[size_t(m_partitionFrames + i)];
+        out[2 * i + 1] = m_im[size_t(m_partitionFrames + i)];
+    }
+}
+
+void AmbientSpatializer::render(float *stereo, int frames)
+{
+    m_pendingFrames += frames;
+    int offset = 0;
+    for (; m_pendingFrames - offset >= m_partitionFrames; offset += m_partitionFrames) {
+        processPartition(offset);
+    }
+
+    // What is left waits for the next block; buses silent for longer than
+    // their delay line are freed
+    const int left = m_pendingFrames - offset;
+    if (offset > 0) {
+        for (Bus &bus : m_buses) {
+            if (bus.direction == PLAIN) {
+                continue;
+            }
+            float *input = bus.input.data();
+            std::copy(input + offset, input + m_pendingFrames, input);
+            std::fill(input + left, input + m_pendingFrames, 0.0f);
+            if (bus.quiet > m_partitionCount
+                && std::all_of(input, input + left, [](float x) { return x == 0.0f; })) {
+                m_busOfDirection[size_t(bus.direction)] = -1;
+                bus.direction = PLAIN;
+            }
+        }
+    }
+    m_pendingFrames = left;
+
+    for (int i = 0; i < 2 * frames; ++i) {
+        stereo[i] += m_output[size_t(i)];
+    }
+    m_outputFrames -= frames;
+    std::copy(m_output.begin() + 2 * frames, m_output.begin() + 2 * (frames + m_outputFrames), m_output.begin());
+}
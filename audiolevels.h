@@ -0,0 +1,102 @@
+#ifndef AUDIOLEVELS_H
+#define AUDIOLEVELS_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+// Per-channel meter reading (linear, 0.0-1.0 of full scale)
+struct AudioLevels
+{
+    float peakLeft = 0.0f;
+    float peakRight = 0.0f;
+    float rmsLeft = 0.0f;
+    float rmsRight = 0.0f;
+};
+
+// Accumulates peak and mean square inside a render loop. Samples are fed
+// as they are written, so metering never needs a second pass over memory.
+class LevelAccumulator
+{
+public:
+    inline void add(float left, float right)
+    {
+        m_peakLeft = std::max(m_peakLeft, std::fabs(left));
+        m_peakRight = std::max(m_peakRight, std::fabs(right));
+        m_sumLeft += left * left;
+        m_sumRight += right * right;
+        ++m_count;
+    }
+
+    AudioLevels result() const
+    {
+        AudioLevels levels;
+        levels.peakLeft = m_peakLeft;
+        levels.peakRight = m_peakRight;
+        if (m_count > 0) {
+            levels.rmsLeft = static_cast<float>(std::sqrt(m_sumLeft / m_count));
+            levels.rmsRight = static_cast<float>(std::sqrt(m_sumRight / m_count));
+        }
+        return levels;
+    }
+
+    bool isEmpty() const { return m_count == 0; }
+    long count() const { return m_count; }
+
+private:
+    float m_peakLeft = 0.0f;
+    float m_peakRight = 0.0f;
+    double m_sumLeft = 0.0;
+    double m_sumRight = 0.0;
+    long m_count = 0;
+};
+
+// Lock-free hand-off of meter readings from the render path to the GUI.
+// The renderer publishes once per block; the GUI takes a reading at its own
+// rate. Peaks are held (max-merged) until taken so short transients between
+// two polls are never lost; RMS is simply the latest block.
+class AudioLevelTap
+{
+public:
+    void publish(const AudioLevels &levels)
+    {
+        mergePeak(m_peakLeft, levels.peakLeft);
+        mergePeak(m_peakRight, levels.peakRight);
+        m_rmsLeft.store(levels.rmsLeft, std::memory_order_relaxed);
+        m_rmsRight.store(levels.rmsRight, std::memory_order_relaxed);
+    }
+
+    AudioLevels take()
+    {
+        AudioLevels levels;
+        levels.peakLeft = m_peakLeft.exchange(0.0f, std::memory_order_relaxed);
+        levels.peakRight = m_peakRight.exchange(0.0f, std::memory_order_relaxed);
+        levels.rmsLeft = m_rmsLeft.load(std::memory_order_relaxed);
+        levels.rmsRight = m_rmsRight.load(std::memory_order_relaxed);
+        return levels;
+    }
+
+    void clear()
+    {
+        m_peakLeft.store(0.0f, std::memory_order_relaxed);
+        m_peakRight.store(0.0f, std::memory_order_relaxed);
+        m_rmsLeft.store(0.0f, std::memory_order_relaxed);
+        m_rmsRight.store(0.0f, std::memory_order_relaxed);
+    }
+
+private:
+    static void mergePeak(std::atomic<float> &target, float value)
+    {
+        float current = target.load(std::memory_order_relaxed);
+        while (value > current
+               && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    std::atomic<float> m_peakLeft{0.0f};
+    std::atomic<float> m_peakRight{0.0f};
+    std::atomic<float> m_rmsLeft{0.0f};
+    std::atomic<float> m_rmsRight{0.0f};
+};
+
+#endif // AUDIOLEVELS_H
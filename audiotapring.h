@@ -0,0 +1,217 @@
+#ifndef AUDIOTAPRING_H
+#define AUDIOTAPRING_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Single-producer / single-consumer ring of interleaved stereo float frames
+// used to tap the render path for visualizers and analyzers.
+//
+// The render side appends whole blocks with at most two memcpy calls and a
+// release store; it never waits for the reader. The reader copies out the
+// most recent frames and detects (rather than prevents) being overrun, so a
+// slow GUI only ever sees a stale or retried snapshot, never a blocked
+// audio thread.
+//
+// Overruns are detected seqlock-style: before copying, the writer announces
+// the frames it is about to write (m_reserveIndex), and after copying, a
+// reader checks that announcement. Anything the writer may have been
+// overwriting mid-copy is older than reserve - capacity, and is not used.
+class AudioTapRing
+{
+public:
+    explicit AudioTapRing(int capacityFrames = 8192)
+    {
+        int capacity = 1;
+        while (capacity < capacityFrames) {
+            capacity <<= 1;
+        }
+        m_capacity = capacity;
+        m_mask = capacity - 1;
+        m_frames.assign(static_cast<size_t>(capacity) * 2, 0.0f);
+    }
+
+    int capacity() const { return m_capacity; }
+
+    // Producer: append frameCount interleaved stereo frames
+    void write(const float *interleaved, int frameCount)
+    {
+        if (frameCount <= 0) {
+            return;
+        }
+        if (frameCount > m_capacity) {
+            interleaved += static_cast<size_t>(frameCount - m_capacity) * 2;
+            frameCount = m_capacity;
+        }
+
+        uint64_t head = m_writeIndex.load(std::memory_order_relaxed);
+        // Announced before any frame changes: a reader that sees one of
+        // the new frames sees the announcement too
+        m_reserveIndex.store(head + static_cast<uint64_t>(frameCount), std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        int start = static_cast<int>(head & m_mask);
+        int first = std::min(frameCount, m_capacity - start);
+
+        std::memcpy(&m_frames[static_cast<size_t>(start) * 2], interleaved,
+                    static_cast<size_t>(first) * 2 * sizeof(float));
+        if (first < frameCount) {
+            std::memcpy(&m_frames[0], interleaved + static_cast<size_t>(first) * 2,
+                        static_cast<size_t>(frameCount - first) * 2 * sizeof(float));
+        }
+
+        m_writeIndex.store(head + static_cast<uint64_t>(frameCount), std::memory_order_release);
+    }
+
+    // Total frames ever written; lets readers detect fresh data cheaply
+    uint64_t writeIndex() const { return m_writeIndex.load(std::memory_order_acquire); }
+
+    // Consumer: copy the newest frameCount frames into dst. Returns the
+    // number of frames copied (0 if the writer overran the copy twice).
+    int readLatest(float *dst, int frameCount) const
+    {
+        frameCount = std::min(frameCount, m_capacity / 2);
+
+        for (int attempt = 0; attempt < 2; ++attempt) {
+            uint64_t head = m_writeIndex.load(std::memory_order_acquire);
+            int available = static_cast<int>(std::min<uint64_t>(head, static_cast<uint64_t>(frameCount)));
+            if (available == 0) {
+                return 0;
+            }
+
+            uint64_t from = head - static_cast<uint64_t>(available);
+            int start = static_cast<int>(from & m_mask);
+            int first = std::min(available, m_capacity - start);
+
+            std::memcpy(dst, &m_frames[static_cast<size_t>(start) * 2],
+                        static_cast<size_t>(first) * 2 * sizeof(float));
+            if (first < available) {
+                std::memcpy(dst + static_cast<size_t>(first) * 2, &m_frames[0],
+                            static_cast<size_t>(available - first) * 2 * sizeof(float));
+            }
+
+            // Valid unless the writer lapped into the region while we copied
+            if (firstIntact() <= from) {
+                return available;
+            }
+        }
+        return 0;
+    }
+
+    // Consumer: copy up to maxFrames frames written after `cursor` and
+    // advance it. A reader that fell more than a ring behind skips to the
+    // newest half, and frames the writer overwrote during the copy are
+    // dropped from its front (either gap is lost, not replayed); a cursor
+    // past the head, as after clear(), is pulled back to it.
+    int readSince(uint64_t &cursor, float *dst, int maxFrames) const
+    {
+        for (int attempt = 0; attempt < 2; ++attempt) {
+            uint64_t head = m_writeIndex.load(std::memory_order_acquire);
+            if (cursor > head) {
+                cursor = head;
+            }
+            if (head - cursor > static_cast<uint64_t>(m_capacity)) {
+                cursor = head - static_cast<uint64_t>(m_capacity / 2);
+            }
+
+            int count = static_cast<int>(std::min<uint64_t>(head - cursor, static_cast<uint64_t>(maxFrames)));
+            if (count <= 0) {
+                return 0;
+            }
+
+            int start = static_cast<int>(cursor & m_mask);
+            int first = std::min(count, m_capacity - start);
+
+            std::memcpy(dst, &m_frames[static_cast<size_t>(start) * 2],
+                        static_cast<size_t>(first) * 2 * sizeof(float));
+            if (first < count) {
+                std::memcpy(dst + static_cast<size_t>(first) * 2, &m_frames[0],
+                            static_cast<size_t>(count - first) * 2 * sizeof(float));
+            }
+
+            const uint64_t intact = firstIntact();
+            if (intact <= cursor) {
+                cursor += static_cast<uint64_t>(count);
+                return count;
+            }
+            const uint64_t torn = intact - cursor;
+            if (torn < static_cast<uint64_t>(count)) {
+                const int kept = count - static_cast<int>(torn);
+                std::memmove(dst, dst + static_cast<size_t>(torn) * 2, static_cast<size_t>(kept) * 2 * sizeof(float));
+                cursor = intact + static_cast<uint64_t>(kept);
+                return kept;
+            }
+        }
+        return 0;
+    }
+
+    // Only safe while the producer is idle (engine stopped)
+    void clear()
+    {
+        std::fill(m_frames.begin(), m_frames.end(), 0.0f);
+        m_reserveIndex.store(0, std::memory_order_relaxed);
+        m_writeIndex.store(0, std::memory_order_release);
+    }
+
+private:
+    // After a copy out of the ring: the oldest frame the writer cannot
+    // have been overwriting during it
+    uint64_t firstIntact() const
+    {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t reserve = m_reserveIndex.load(std::memory_order_relaxed);
+        const uint64_t capacity = static_cast<uint64_t>(m_capacity);
+        return reserve > capacity ? reserve - capacity : 0;
+    }
+
+    std::vector<float> m_frames;
+    int m_capacity = 0;
+    int m_mask = 0;
+    std::atomic<uint64_t> m_writeIndex{0};
+    std::atomic<uint64_t> m_reserveIndex{0}; // End of the block being written
+};
+
+// Render-side helper that gathers (optionally decimated) frames into a small
+// block and hands whole blocks to the ring, so the per-sample cost of a tap
+// is two stores and a counter.
+class AudioTapWriter
+{
+public:
+    explicit AudioTapWriter(int decimation = 1)
+        : m_decimation(std::max(1, decimation))
+    {
+    }
+
+    inline void push(AudioTapRing &ring, float left, float right)
+    {
+        if (++m_countdown < m_decimation) {
+            return;
+        }
+        m_countdown = 0;
+        m_block[2 * m_frames] = left;
+        m_block[2 * m_frames + 1] = right;
+        if (++m_frames == BLOCK_FRAMES) {
+            flush(ring);
+        }
+    }
+
+    void flush(AudioTapRing &ring)
+    {
+        if (m_frames > 0) {
+            ring.write(m_block, m_frames);
+            m_frames = 0;
+        }
+    }
+
+private:
+    static constexpr int BLOCK_FRAMES = 512;
+    int m_decimation;
+    int m_countdown = 0;
+    int m_frames = 0;
+    float m_block[BLOCK_FRAMES * 2];
+};
+
+#endif // AUDIOTAPRING_H
@@ -0,0 +1,356 @@
+// Engine benchmarks (Google Benchmark):
+//
+//   BM_Stream              ns per stereo frame of the streaming renderer,
+//                          for every waveform x tone mode
+//   BM_StreamParameterChange
+//                          GUI post -> first stereo block rendered with the
+//                          new setting, through the command queue
+//   BM_GenerateAudioBuffer BinauralEngine::generateAudioBuffer() for 1, 5
+//                          and 60 minutes, with the bytes held per minute
+//   BM_BinauralParameterChange
+//                          frequency change -> regenerated default buffer
+//   BM_NullSinkPlayback    DynamicEngine::start() into the free-running
+//                          null sink, streaming only and hybrid: the whole
+//                          playback path, no sound hardware needed
+//
+// Results are also written to bench_engines.json unless --benchmark_out is
+// given, so two builds can be compared with Google Benchmark's compare.py:
+//
+//   bench_engines [--benchmark_filter=Stream] [--benchmark_out=before.json]
+//
+// --speedup_baseline=<json> reads such a file (normally the default build
+// of the same commit, see the pgo target) and adds a speedup counter,
+// baseline time / this time, to every benchmark in both outputs.
+
+#include "binauralengine.h"
+#include "dynamicengine.h"
+#include "enginecommandqueue.h"
+#include "enginecontrol.h"
+#include "outputsink.h"
+#include "tonekernels.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifndef BINAURAL_BUILD_CONFIG
+#define BINAURAL_BUILD_CONFIG "unknown"
+#endif
+#ifndef BINAURAL_GIT_COMMIT
+#define BINAURAL_GIT_COMMIT "unknown"
+#endif
+
+namespace {
+
+constexpr int BLOCK_FRAMES = 512; // A typical sink period
+
+// ns per frame: a rate counter over frames * 1e-9, inverted
+benchmark::Counter nsPerFrame(double frames)
+{
+    return benchmark::Counter(frames * 1e-9,
+                              benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+const char *waveformName(int waveform)
+{
+    switch (waveform) {
+    case ToneKernels::SQUARE_WAVE: return "square";
+    case ToneKernels::TRIANGLE_WAVE: return "triangle";
+    case ToneKernels::SAWTOOTH_WAVE: return "sawtooth";
+    default: return "sine";
+    }
+}
+
+// What DynamicEngine's device does per span, minus the taps: render,
+// convert to 16-bit
+void renderBlock(ToneKernels::ToneStream &stream, int16_t *out, int frames)
+{
+    double left[BLOCK_FRAMES];
+    double right[BLOCK_FRAMES];
+    stream.render(left, right, frames);
+    for (int i = 0; i < frames; ++i) {
+        out[2 * i] = static_cast<int16_t>(left[i] * 32767);
+        out[2 * i + 1] = static_cast<int16_t>(right[i] * 32767);
+    }
+}
+
+} // namespace
+
+// =================== STREAMING ===================
+static void BM_Stream(benchmark::State &state)
+{
+    ToneKernels::ToneParameters params;
+    params.waveform = static_cast<int>(state.range(0));
+    params.mode = static_cast<ToneKernels::ToneMode>(state.range(1));
+
+    ToneKernels::ToneStream stream;
+    stream.retune(params);
+    int16_t out[2 * BLOCK_FRAMES];
+
+    for (auto _ : state) {
+        renderBlock(stream, out, BLOCK_FRAMES);
+        benchmark::DoNotOptimize(out);
+    }
+
+    state.SetLabel(std::string(waveformName(params.waveform))
+                   + (params.mode == ToneKernels::ISOCHRONIC_MODE ? "/isochronic" : "/binaural"));
+    state.counters["ns_per_frame"] = nsPerFrame(static_cast<double>(state.iterations()) * BLOCK_FRAMES);
+}
+BENCHMARK(BM_Stream)->ArgsProduct({ { ToneKernels::SINE_WAVE, ToneKernels::SQUARE_WAVE,
+                                      ToneKernels::TRIANGLE_WAVE, ToneKernels::SAWTOOTH_WAVE },
+                                    { ToneKernels::BINAURAL_MODE, ToneKernels::ISOCHRONIC_MODE } })
+    ->ArgNames({ "waveform", "mode" });
+
+static void BM_StreamParameterChange(benchmark::State &state)
+{
+    ToneKernels::ToneParameters params;
+    EngineCommandQueue queue;
+    EngineControl control;
+    control.reset(params, false, 1.0);
+
+    ToneKernels::ToneStream stream;
+    stream.retune(params);
+    int16_t out[2 * BLOCK_FRAMES];
+
+    double hz = params.leftFrequency;
+    for (auto _ : state) {
+        // GUI side
+        EngineCommand command;
+        command.parameter = EngineCommand::LEFT_FREQUENCY;
+        command.value = (hz += 0.01);
+        queue.push(command);
+
+        // Audio side, up to the first block that carries the change
+        control.collect(queue);
+        control.applyDue();
+        stream.update(control.parameters());
+        renderBlock(stream, out, BLOCK_FRAMES);
+        control.advance(BLOCK_FRAMES);
+        benchmark::DoNotOptimize(out);
+    }
+}
+BENCHMARK(BM_StreamParameterChange);
+
+// =================== PRERENDERED BUFFER ===================
+// Reaches BinauralEngine's private render path
+class BinauralEngineBenchmark
+{
+public:
+    static void generate(BinauralEngine &engine, int durationMs)
+    {
+        engine.generateAudioBuffer(durationMs);
+    }
+
+    static qint64 bufferBytes(const BinauralEngine &engine)
+    {
+        qint64 bytes = engine.m_levelTable.size() * static_cast<qint64>(sizeof(AudioLevels));
+        if (engine.m_audioBuffer) {
+            bytes += engine.m_audioBuffer->size();
+        }
+        return bytes;
+    }
+
+    static int defaultDurationMs(const BinauralEngine &engine)
+    {
+        return static_cast<int>(engine.m_bufferDurationMs);
+    }
+};
+
+static void BM_GenerateAudioBuffer(benchmark::State &state)
+{
+    const int minutes = static_cast<int>(state.range(0));
+    BinauralEngine engine;
+    engine.setNoiseType(NoiseGenerator::PINK_NOISE);
+
+    for (auto _ : state) {
+        BinauralEngineBenchmark::generate(engine, minutes * 60000);
+    }
+
+    const double bytes = static_cast<double>(BinauralEngineBenchmark::bufferBytes(engine));
+    state.counters["bytes_per_minute"] = bytes / minutes;
+    state.counters["ns_per_frame"] = nsPerFrame(static_cast<double>(state.iterations())
+                                                * engine.getSampleRate() * 60.0 * minutes);
+}
+BENCHMARK(BM_GenerateAudioBuffer)->Arg(1)->Arg(5)->Arg(60)
+    ->Unit(benchmark::kMillisecond)->Iterations(1);
+
+static void BM_BinauralParameterChange(benchmark::State &state)
+{
+    BinauralEngine engine;
+    double hz = engine.getLeftFrequency();
+
+    for (auto _ : state) {
+        engine.setLeftFrequency(hz += 0.01);
+        BinauralEngineBenchmark::generate(engine, BinauralEngineBenchmark::defaultDurationMs(engine));
+    }
+}
+BENCHMARK(BM_BinauralParameterChange)->Unit(benchmark::kMillisecond)->Iterations(3);
+
+// =================== END TO END ===================
+static void BM_NullSinkPlayback(benchmark::State &state)
+{
+    constexpr qint64 AUDIO_USECS = 10 * 1000000; // Per iteration
+    OutputSink::setDefaultBackend(OutputSink::NULL_BACKEND);
+
+    double frames = 0.0;
+    double sampleRate = 0.0;
+    for (auto _ : state) {
+        DynamicEngine engine;
+        engine.setLoopPlaybackEnabled(state.range(0) != 0);
+        if (!engine.start()) {
+            state.SkipWithError("DynamicEngine::start() failed");
+            break;
+        }
+        engine.audioOutput()->setBufferSize(BLOCK_FRAMES * 4); // Stereo Int16 periods
+        while (engine.audioOutput()->processedUSecs() < AUDIO_USECS) {
+            QCoreApplication::processEvents();
+        }
+        sampleRate = engine.getSampleRate();
+        frames += static_cast<double>(engine.audioOutput()->processedUSecs()) * sampleRate / 1e6;
+        engine.stop();
+    }
+
+    state.SetLabel(state.range(0) != 0 ? "hybrid" : "stream");
+    state.counters["ns_per_frame"] = nsPerFrame(frames);
+    if (sampleRate > 0.0) {
+        // Seconds of audio per second of wall time
+        state.counters["x_realtime"] = benchmark::Counter(frames / sampleRate, benchmark::Counter::kIsRate);
+    }
+}
+BENCHMARK(BM_NullSinkPlayback)->Arg(0)->Arg(1)->ArgName("loops")
+    ->Unit(benchmark::kMillisecond)->Iterations(3)->UseRealTime();
+
+// =================== SPEEDUP REPORT ===================
+namespace {
+
+double nanoseconds(double time, const QString &unit)
+{
+    if (unit == "s") return time * 1e9;
+    if (unit == "ms") return time * 1e6;
+    if (unit == "us") return time * 1e3;
+    return time;
+}
+
+// Real time per iteration in ns by benchmark name, from a JSON results file
+bool loadBaseline(const QString &filename, QHash<QString, double> &times, QString &commit)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    commit = root["context"].toObject()["commit"].toString();
+
+    const QJsonArray runs = root["benchmarks"].toArray();
+    for (const QJsonValue &value : runs) {
+        QJsonObject run = value.toObject();
+        if (run["error_occurred"].toBool() || run["aggregate_unit"].toString() == "percentage") {
+            continue;
+        }
+        times.insert(run["name"].toString(),
+                     nanoseconds(run["real_time"].toDouble(), run["time_unit"].toString()));
+    }
+    return !times.isEmpty();
+}
+
+// Adds "speedup" to every run with a baseline entry before the wrapped
+// reporter prints it; used for both the console and the JSON file
+template <class Reporter>
+class SpeedupReporter : public Reporter
+{
+public:
+    template <class... Args>
+    explicit SpeedupReporter(const QHash<QString, double> *baseline, Args... args)
+        : Reporter(args...)
+        , m_baseline(baseline)
+    {
+    }
+
+    void ReportRuns(const std::vector<benchmark::BenchmarkReporter::Run> &reports) override
+    {
+        std::vector<benchmark::BenchmarkReporter::Run> runs = reports;
+        for (benchmark::BenchmarkReporter::Run &run : runs) {
+            if (run.error_occurred || run.aggregate_unit != benchmark::kTime) {
+                continue;
+            }
+            auto it = m_baseline->constFind(QString::fromStdString(run.benchmark_name()));
+            double time = run.GetAdjustedRealTime() * 1e9
+                          / benchmark::GetTimeUnitMultiplier(run.time_unit);
+            if (it != m_baseline->constEnd() && time > 0.0) {
+                run.counters["speedup"] = benchmark::Counter(it.value() / time);
+            }
+        }
+        Reporter::ReportRuns(runs);
+    }
+
+private:
+    const QHash<QString, double> *m_baseline;
+};
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    // JSON alongside the console table unless the caller picked a file
+    std::vector<char *> args;
+    QString baselineFile;
+    bool hasOut = false;
+    for (int i = 0; i < argc; ++i) {
+        if (std::strncmp(argv[i], "--speedup_baseline=", 19) == 0) {
+            baselineFile = QString::fromLocal8Bit(argv[i] + 19);
+            continue;
+        }
+        hasOut = hasOut || std::strncmp(argv[i], "--benchmark_out=", 16) == 0;
+        args.push_back(argv[i]);
+    }
+    char outArg[] = "--benchmark_out=bench_engines.json";
+    char formatArg[] = "--benchmark_out_format=json";
+    if (!hasOut) {
+        args.push_back(outArg);
+        args.push_back(formatArg);
+    }
+
+    int count = static_cast<int>(args.size());
+    benchmark::Initialize(&count, args.data());
+    if (benchmark::ReportUnrecognizedArguments(count, args.data())) {
+        return 1;
+    }
+    benchmark::AddCustomContext("build", BINAURAL_BUILD_CONFIG);
+    benchmark::AddCustomContext("commit", BINAURAL_GIT_COMMIT);
+
+    if (baselineFile.isEmpty()) {
+        benchmark::RunSpecifiedBenchmarks();
+        benchmark::Shutdown();
+        return 0;
+    }
+
+    QHash<QString, double> baseline;
+    QString baselineCommit;
+    if (!loadBaseline(baselineFile, baseline, baselineCommit)) {
+        std::fprintf(stderr, "Cannot read benchmark results from %s\n", qPrintable(baselineFile));
+        return 1;
+    }
+    if (baselineCommit != QLatin1String(BINAURAL_GIT_COMMIT)) {
+        std::fprintf(stderr, "Warning: baseline is from commit %s, this build is %s\n",
+                     qPrintable(baselineCommit), BINAURAL_GIT_COMMIT);
+    }
+    benchmark::AddCustomContext("speedup_baseline", baselineFile.toStdString());
+
+    SpeedupReporter<benchmark::ConsoleReporter> console(&baseline, benchmark::ConsoleReporter::OO_None);
+    SpeedupReporter<benchmark::JSONReporter> json(&baseline);
+    benchmark::RunSpecifiedBenchmarks(&console, &json);
+    benchmark::Shutdown();
+    return 0;
+}
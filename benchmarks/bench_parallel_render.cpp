@@ -0,0 +1,54 @@
+// Times a five-minute loop render with 1, 2, 4 and 8 threads and checks
+// that every thread count produces exactly the same samples.
+//
+//   bench_parallel_render [seconds] [binaural|isochronic]
+
+#include "tonekernels.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+int main(int argc, char *argv[])
+{
+    int seconds = argc > 1 ? std::atoi(argv[1]) : 300;
+    bool isochronic = argc > 2 && std::strcmp(argv[2], "isochronic") == 0;
+
+    ToneKernels::ToneParameters params;
+    params.mode = isochronic ? ToneKernels::ISOCHRONIC_MODE : ToneKernels::BINAURAL_MODE;
+    params.noiseType = NoiseGenerator::PINK_NOISE;
+    params.noiseLevel = 0.1f;
+
+    const int64_t frames = static_cast<int64_t>(params.sampleRate) * seconds;
+    std::vector<int16_t> reference(static_cast<size_t>(frames) * 2);
+    std::vector<int16_t> output(reference.size());
+    std::vector<AudioLevels> levels(static_cast<size_t>(ToneKernels::levelCount(frames)));
+
+    std::printf("%s, %lld frames, %u hardware threads\n",
+                isochronic ? "isochronic" : "binaural",
+                static_cast<long long>(frames), std::thread::hardware_concurrency());
+    std::printf("%8s %12s %9s %10s\n", "threads", "ms", "speedup", "identical");
+
+    double baseline = 0.0;
+    for (int threads : { 1, 2, 4, 8 }) {
+        std::vector<int16_t> &target = (threads == 1) ? reference : output;
+
+        auto begin = std::chrono::steady_clock::now();
+        ToneKernels::renderLoop(params, frames, target.data(), levels.data(), threads);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+        if (threads == 1) {
+            baseline = ms;
+        }
+        bool identical = std::memcmp(reference.data(), target.data(),
+                                     reference.size() * sizeof(int16_t)) == 0;
+        std::printf("%8d %12.1f %8.2fx %10s\n", threads, ms, baseline / ms, identical ? "yes" : "NO");
+        if (!identical) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,78 @@
+// Times converting one stereo source from each common rate to 44.1 kHz at
+// every quality and kernel, as a share of one core per source playing in
+// real time, and fails if any rate or quality is over budget with the
+// kernel this CPU runs. Slower kernels are timed for comparison only.
+//
+//   bench_resampler [seconds]
+
+#include "resampler.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+constexpr int OUTPUT_RATE = 44100;  // AmbientClip::SAMPLE_RATE
+constexpr double BUDGET_PERCENT = 0.5; // Of one core, per source
+const char *const QUALITIES[] = { "fast", "standard", "high" };
+const char *const KERNELS[] = { "scalar", "sse", "avx2" };
+}
+
+int main(int argc, char *argv[])
+{
+    const int seconds = argc > 1 ? std::atoi(argv[1]) : 20;
+
+    std::printf("one source, %d s of audio, best kernel here: %s; other kernels' budget in parentheses, not checked\n",
+                seconds, KERNELS[Resampler::bestKernel()]);
+    std::printf("%8s %9s %7s %5s %10s %10s\n", "from", "quality", "kernel", "taps", "% of core", "budget");
+    bool overBudget = false;
+    for (Resampler::Quality quality : { Resampler::FAST, Resampler::STANDARD, Resampler::HIGH }) {
+        Resampler::prepareBanks(OUTPUT_RATE, quality); // Not timed
+    }
+    for (int rate : Resampler::COMMON_RATES) {
+        if (rate == OUTPUT_RATE) {
+            continue;
+        }
+        const int64_t frames = int64_t(rate) * seconds;
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> sample(-0.5f, 0.5f);
+        std::vector<float> in(size_t(2 * frames));
+        for (float &value : in) {
+            value = sample(random);
+        }
+
+        for (Resampler::Quality quality : { Resampler::FAST, Resampler::STANDARD, Resampler::HIGH }) {
+            for (Resampler::Kernel kernel : { Resampler::SCALAR_KERNEL, Resampler::SSE_KERNEL, Resampler::AVX2_KERNEL }) {
+                Resampler resampler(rate, OUTPUT_RATE, quality);
+                if (!resampler.setKernel(kernel)) {
+                    continue;
+                }
+                std::vector<float> out(size_t(2 * (resampler.maxOutputFrames(frames) + resampler.maxFinishFrames())));
+
+                // In decoder-sized buffers
+                const auto begin = std::chrono::steady_clock::now();
+                int64_t written = 0;
+                for (int64_t done = 0; done < frames; done += 4096) {
+                    const int64_t block = std::min<int64_t>(4096, frames - done);
+                    written += resampler.process(in.data() + 2 * done, block, out.data() + 2 * written);
+                }
+                resampler.finish(out.data() + 2 * written);
+                const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+                const double percent = 100.0 * ms / (1000.0 * seconds);
+                const bool runsHere = kernel == Resampler::bestKernel();
+                const bool over = percent > BUDGET_PERCENT;
+                overBudget = overBudget || (runsHere && over);
+                std::printf("%8d %9s %7s %5d %9.2f%% %10s\n", rate, QUALITIES[quality], KERNELS[kernel],
+                            resampler.taps(), percent, !runsHere ? (over ? "(over)" : "(ok)") : over ? "OVER" : "ok");
+            }
+        }
+    }
+    if (overBudget) {
+        std::printf("over the %.1f%% budget with the %s kernel\n", BUDGET_PERCENT, KERNELS[Resampler::bestKernel()]);
+        return 1;
+    }
+    return 0;
+}
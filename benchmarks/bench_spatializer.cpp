@@ -0,0 +1,65 @@
+// Times ten ambient layers placed around the listener through the
+// spatializer at each partition size, as a share of one core in real
+// time, and fails if the default size is over budget.
+//
+//   bench_spatializer [seconds]
+
+#include "ambientspatializer.h"
+#include "hrtfset.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+constexpr int LAYERS = 10;
+constexpr int BLOCK_FRAMES = 512;     // As the ambient mixer reads
+constexpr double BUDGET_PERCENT = 2.0; // Of one core: half a percent of a 4-core laptop
+}
+
+int main(int argc, char *argv[])
+{
+    const int seconds = argc > 1 ? std::atoi(argv[1]) : 60;
+    const int64_t frames = int64_t(HrtfSet::SAMPLE_RATE) * seconds;
+    const std::shared_ptr<const HrtfSet> set = HrtfSet::builtin();
+
+    // A block of noise per layer, placed around and above the head
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> sample(-0.3f, 0.3f);
+    std::vector<std::vector<float>> blocks(LAYERS, std::vector<float>(2 * BLOCK_FRAMES));
+    std::vector<int> directions;
+    for (int layer = 0; layer < LAYERS; ++layer) {
+        for (float &value : blocks[size_t(layer)]) {
+            value = sample(random);
+        }
+        directions.push_back(set->nearest(-180.0f + 36.0f * layer, layer % 2 ? 40.0f : 0.0f));
+    }
+    std::vector<float> mix(2 * BLOCK_FRAMES);
+
+    std::printf("%d layers, %d s, %d-frame blocks\n", LAYERS, seconds, BLOCK_FRAMES);
+    std::printf("%10s %8s %12s %10s %10s\n", "partition", "latency", "ms", "% of core", "budget");
+    double defaultPercent = 0.0;
+    for (int partition : { 64, 128, 256, 512 }) {
+        AmbientSpatializer spatializer(set, BLOCK_FRAMES, partition);
+        auto begin = std::chrono::steady_clock::now();
+        for (int64_t done = 0; done < frames; done += BLOCK_FRAMES) {
+            std::fill(mix.begin(), mix.end(), 0.0f);
+            for (int layer = 0; layer < LAYERS; ++layer) {
+                spatializer.addSource(directions[size_t(layer)], directions[size_t(layer)],
+                                      blocks[size_t(layer)].data(), BLOCK_FRAMES, mix.data());
+            }
+            spatializer.render(mix.data(), BLOCK_FRAMES);
+        }
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        const double percent = 100.0 * ms / (1000.0 * seconds);
+        if (partition == AmbientSpatializer::DEFAULT_PARTITION_FRAMES) {
+            defaultPercent = percent;
+        }
+        std::printf("%10d %6.1fms %12.1f %9.2f%% %10s\n", partition,
+                    1000.0 * spatializer.latencyFrames() / HrtfSet::SAMPLE_RATE, ms, percent,
+                    percent <= BUDGET_PERCENT ? "ok" : "OVER");
+    }
+    return defaultPercent <= BUDGET_PERCENT ? 0 : 1;
+}
@@ -0,0 +1,155 @@
+// PGO training workload: what a listening session spends its CPU on, run
+// headless so an instrumented build (BINAURAL_PGO=GENERATE) can record it.
+//
+//   - each standard preset played through DynamicEngine offline: a
+//     streamed start, a frequency glide, then the loop render and loop
+//     playback once the settings settle
+//   - a playlist saved and loaded back through PlaylistFile
+//
+// Both engines render through ToneKernels, so the kernel profile covers
+// BinauralEngine's buffers too.
+//
+//   pgo_training [--presets=<dir>] [--seconds=<n>]
+//
+// --presets trains on the presets saved in <dir> instead of the built-in set.
+
+#include "brainwavepreset.h"
+#include "dynamicengine.h"
+#include "playlistfile.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+constexpr int BLOCK_FRAMES = 1024;
+constexpr int PLAYLIST_TRACKS = 500;
+
+BrainwavePreset makePreset(const char *name, int toneType, double left, double right,
+                           int waveform, double pulse, int noiseType)
+{
+    BrainwavePreset preset;
+    preset.name = name;
+    preset.toneType = toneType;
+    preset.leftFrequency = left;
+    preset.rightFrequency = right;
+    preset.waveform = waveform;
+    preset.pulseFrequency = pulse;
+    preset.volume = 70.0;
+    preset.noiseType = noiseType;
+    preset.noiseLevel = 10.0;
+    return preset;
+}
+
+// The README examples plus one preset per remaining waveform/noise type
+QList<BrainwavePreset> standardPresets()
+{
+    return {
+        makePreset("Alpha (Relaxation)", 0, 360.0, 367.83, DynamicEngine::SINE_WAVE, 7.83, NoiseGenerator::NO_NOISE),
+        makePreset("Theta (Meditation)", 0, 200.0, 206.0, DynamicEngine::SINE_WAVE, 6.0, NoiseGenerator::PINK_NOISE),
+        makePreset("Focus", 0, 400.0, 410.0, DynamicEngine::TRIANGLE_WAVE, 10.0, NoiseGenerator::BROWN_NOISE),
+        makePreset("Beta Isochronic", 1, 300.0, 300.0, DynamicEngine::SQUARE_WAVE, 18.0, NoiseGenerator::NO_NOISE),
+        makePreset("Delta Isochronic", 1, 150.0, 150.0, DynamicEngine::SINE_WAVE, 2.5, NoiseGenerator::WHITE_NOISE),
+        makePreset("Gamma Generator", 2, 440.0, 480.0, DynamicEngine::SAWTOOTH_WAVE, 40.0, NoiseGenerator::NO_NOISE),
+    };
+}
+
+qint64 playPreset(const BrainwavePreset &preset, int seconds)
+{
+    DynamicEngine engine;
+    preset.applyTo(&engine);
+    engine.setVolume(preset.volume / 100.0);
+    if (!engine.startOffline()) {
+        return 0;
+    }
+
+    const qint64 total = static_cast<qint64>(seconds) * engine.getSampleRate();
+    const qint64 glideAt = total / 4;
+    std::vector<int16_t> block(2 * BLOCK_FRAMES);
+
+    qint64 done = 0;
+    while (done < total) {
+        if (done <= glideAt && glideAt < done + BLOCK_FRAMES) {
+            engine.rampParameter(EngineCommand::LEFT_FREQUENCY, preset.leftFrequency * 1.02, 500);
+        }
+        qint64 count = qMin<qint64>(BLOCK_FRAMES, total - done);
+        qint64 rendered = engine.renderOffline(block.data(), count);
+        if (rendered <= 0) {
+            break;
+        }
+        done += rendered;
+    }
+
+    engine.stop();
+    return done;
+}
+
+bool roundTripPlaylist(const QString &directory)
+{
+    PlaylistFile playlist;
+    playlist.name = "Training";
+    for (int i = 0; i < PLAYLIST_TRACKS; ++i) {
+        PlaylistTrack track;
+        track.filePath = QString("%1/music/track-%2.mp3").arg(directory).arg(i);
+        track.title = QString("Track %1").arg(i);
+        track.duration = 180000 + i;
+        playlist.tracks.append(track);
+    }
+
+    const QString filename = directory + "/training-playlist.json";
+    PlaylistFile loaded;
+    return playlist.saveToFile(filename)
+           && PlaylistFile::loadFromFile(filename, loaded)
+           && loaded.tracks.size() == PLAYLIST_TRACKS;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QString presetDir;
+    int seconds = 8; // Long enough to settle into a loop after the glide
+    for (int i = 1; i < argc; ++i) {
+        if (std::strncmp(argv[i], "--presets=", 10) == 0) {
+            presetDir = QString::fromLocal8Bit(argv[i] + 10);
+        } else if (std::strncmp(argv[i], "--seconds=", 10) == 0) {
+            seconds = qMax(1, std::atoi(argv[i] + 10));
+        } else {
+            qWarning() << "Usage: pgo_training [--presets=<dir>] [--seconds=<n>]";
+            return 1;
+        }
+    }
+
+    QList<BrainwavePreset> presets = presetDir.isEmpty() ? standardPresets()
+                                                         : BrainwavePreset::loadAll(presetDir);
+    if (presets.isEmpty()) {
+        qWarning() << "No valid presets in" << presetDir;
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    qint64 frames = 0;
+    for (const BrainwavePreset &preset : presets) {
+        frames += playPreset(preset, seconds);
+    }
+
+    QTemporaryDir scratch;
+    if (!scratch.isValid() || !roundTripPlaylist(scratch.path())) {
+        qWarning() << "Playlist round trip failed";
+        return 1;
+    }
+
+    qInfo().noquote() << QString("Trained on %1 presets, %2 frames in %3 ms")
+                             .arg(presets.size()).arg(frames).arg(timer.elapsed());
+    return 0;
+}
@@ -6,33 +6,52 @@
 #include<QTimer>
 #include<QTime>
 #include"constants.h"
+#include"mappedfilecache.h"
+#include"tonekernels.h"
+#include"tracerecorder.h"
+#include<QDataStream>
 
 // =================== CONSTRUCTOR/DESTRUCTOR ===================
 BinauralEngine::BinauralEngine(QObject *parent)
     : QObject(parent)
     , m_audioOutput(nullptr)
     , m_audioBuffer(nullptr)
+    , m_playbackDevice(nullptr)
+    , m_mappedBuffer(nullptr)
+    , m_renderCache(new MappedFileCache(ConstantGlobals::renderCachePath,
+                                        DEFAULT_RENDER_CACHE_BYTES, "pcm"))
+    , m_renderCacheEnabled(true)
+    , m_renderThreadCount(0)
     , m_leftFrequency(360.0)      // Default: 200Hz left
     , m_rightFrequency(367.83)    // Default: 207.83Hz right (7.83Hz beat)
     , m_amplitude(DEFAULT_AMPLITUDE)
     , m_outputVolume(DEFAULT_VOLUME)
     , m_currentWaveform(SINE_WAVE)
+    , m_toneMode(BINAURAL_TONE)
+    , m_noiseType(NoiseGenerator::NO_NOISE)
+    , m_noiseLevel(DEFAULT_NOISE_LEVEL)
     , m_phaseLeft(0.0)
     , m_phaseRight(0.0)
     , m_isPlaying(false)
     , m_parametersChanged(false)
     , m_sampleRate(44100)         // CD quality
     , m_bufferDurationMs(300000) // 5 minute buffer = 300000
+    , m_levelTimer(new QTimer(this))
     , m_pulseFrequency(7.83)
 {
     initializeAudioFormat();
+
+    // Meter readings come from the table built with the loop buffer
+    m_levelTimer->setInterval(LEVEL_POLL_INTERVAL_MS);
+    connect(m_levelTimer, &QTimer::timeout, this, &BinauralEngine::pollAudioLevels);
 }
 
 BinauralEngine::~BinauralEngine()
 {
     stop(); // Ensure audio is stopped
-    delete m_audioBuffer;
     delete m_audioOutput;
+    m_audioOutput = nullptr;
+    releaseLoopBuffer();
 }
 
 // =================== INITIALIZATION METHODS ===================
@@ -49,19 +68,14 @@ bool BinauralEngine::initializeAudioOutput()
         delete m_audioOutput;
     }
 
-    QAudioDevice audioDevice = QMediaDevices::defaultAudioOutput();
-    if (audioDevice.isNull()) {
-        emit errorOccurred("No audio output device available");
-        return false;
-    }
-
-    if (!audioDevice.isFormatSupported(m_audioFormat)) {
-        emit errorOccurred("Audio format not supported by device");
+    QString error;
+    m_audioOutput = OutputSink::create(m_audioFormat, this, &error);
+    if (!m_audioOutput) {
+        emit errorOccurred(error);
         return false;
     }
 
-    m_audioOutput = new QAudioSink(audioDevice, m_audioFormat, this);
-    connect(m_audioOutput, &QAudioSink::stateChanged,
+    connect(m_audioOutput, &OutputSink::stateChanged,
             this, &BinauralEngine::handleAudioStateChanged);
 
     m_audioOutput->setVolume(m_outputVolume);
@@ -80,26 +94,21 @@ bool BinauralEngine::start()
         return false;
     }
 
-    // === ONLY GENERATE BUFFER IF NEEDED ===
-    if (!m_audioBuffer || m_parametersChanged) {
-        generateAudioBuffer(m_bufferDurationMs);
-
-        if (!m_audioBuffer || m_audioBuffer->size() == 0) {
-            if (m_audioBuffer) {
-            }
+    // === ONLY PREPARE BUFFER IF NEEDED (cache hit or render) ===
+    if (!m_playbackDevice || m_parametersChanged) {
+        if (!prepareLoopBuffer()) {
             emit errorOccurred("Failed to generate audio buffer");
             return false;
         }
-
-        m_audioBuffer->open(QIODevice::ReadOnly);
         m_parametersChanged = false; // Reset flag
     }
 
     // === ALWAYS SEEK TO START ===
-    m_audioBuffer->seek(0);
+    m_playbackDevice->seek(0);
 
-    m_audioOutput->start(m_audioBuffer);
+    m_audioOutput->start(m_playbackDevice);
     m_isPlaying = true;
+    m_levelTimer->start();
 
     // Connect to the idle state for looping
     //connect(m_audioOutput, &QAudioSink::stateChanged,
@@ -122,11 +131,16 @@ void BinauralEngine::stop()
     if (m_audioBuffer && m_audioBuffer->isOpen()) {
     }
 
+    m_levelTimer->stop();
+
     bool wasPlaying = m_isPlaying;
     m_isPlaying = false;
     resetPhase();
 
     if (wasPlaying) {
+        // Drop the meter back to silence
+        emit audioLevelsChanged(0.0, 0.0, 0.0, 0.0);
+        emit audioLevelChanged(0.0);
         emit playbackStopped();
     }
 }
@@ -185,7 +199,7 @@ void BinauralEngine::setRightFrequency(double hz)
 */
 
 void BinauralEngine::setRightFrequency(double hz) {
-    if (ConstantGlobals::currentToneType == 1) {
+    if (m_toneMode == ISOCHRONIC_TONE) {
 
     } else {
         // Original binaural validation
@@ -237,6 +251,24 @@ double BinauralEngine::getBeatFrequency() const
     return m_rightFrequency - m_leftFrequency;
 }
 
+// =================== TONE MODE ===================
+void BinauralEngine::setToneMode(ToneMode mode)
+{
+    if (m_toneMode != mode) {
+        m_toneMode = mode;
+        m_parametersChanged = true;
+
+        if (m_isPlaying) {
+            updateAudioParameters();
+        }
+    }
+}
+
+BinauralEngine::ToneMode BinauralEngine::getToneMode() const
+{
+    return m_toneMode;
+}
+
 // =================== WAVEFORM & AUDIO CONTROL ===================
 void BinauralEngine::setWaveform(Waveform type)
 {
@@ -346,7 +378,7 @@ bool BinauralEngine::isEngineActive() const
 
 void BinauralEngine::generateAudioBuffer(int durationMs)
 {
-    if (ConstantGlobals::currentToneType == 1) {
+    if (m_toneMode == ISOCHRONIC_TONE) {
            generateIsochronicBuffer(durationMs);
            return;
        }
@@ -360,40 +392,44 @@ void BinauralEngine::generateAudioBuffer(int durationMs)
 
     if (durationMs <= 0) return;
 
-    // Generate buffer that's 4x longer for seamless looping
-    //int loopCount = 4;
-    //int totalDurationMs = durationMs * loopCount;
-    int totalDurationMs = durationMs;      // <-- USE DIRECT DURATION
-    qint64 sampleCount = (static_cast<qint64>(m_sampleRate) * totalDurationMs) / 1000;
+    renderLoopBuffer(toneParameters(ToneKernels::BINAURAL_MODE), durationMs);
+}
+
+ToneKernels::ToneParameters BinauralEngine::toneParameters(ToneKernels::ToneMode mode) const
+{
+    ToneKernels::ToneParameters params;
+    params.mode = mode;
+    params.waveform = m_currentWaveform;
+    params.leftFrequency = m_leftFrequency;    // Carrier when isochronic
+    params.rightFrequency = m_rightFrequency;
+    params.pulseFrequency = m_pulseFrequency;
+    params.amplitude = m_amplitude;
+    params.sampleRate = m_sampleRate;
+    params.leftPhase = m_phaseLeft;            // Continue from the saved phases
+    params.rightPhase = m_phaseRight;
+    params.noiseType = m_noiseType;
+    params.noiseLevel = static_cast<float>(m_noiseLevel);
+    return params;
+}
+
+void BinauralEngine::renderLoopBuffer(const ToneKernels::ToneParameters &params, int durationMs)
+{
+    qint64 sampleCount = (static_cast<qint64>(m_sampleRate) * durationMs) / 1000;
+    BINAURAL_TRACE_SCOPE("audio", "BinauralEngine::renderLoopBuffer", "frames", sampleCount);
 
     QByteArray audioData;
     audioData.resize(sampleCount * 2 * sizeof(int16_t));
     int16_t *data = reinterpret_cast<int16_t*>(audioData.data());
 
-    // Generate continuous audio without phase reset
-    double leftPhaseIncrement = (2.0 * M_PI * m_leftFrequency) / m_sampleRate;
-    double rightPhaseIncrement = (2.0 * M_PI * m_rightFrequency) / m_sampleRate;
-
-    for (qint64 i = 0; i < sampleCount; ++i) {
-        // Calculate samples using current phase
-        double leftSample = calculateSample(m_phaseLeft, m_currentWaveform);
-        double rightSample = calculateSample(m_phaseRight, m_currentWaveform);
+    // Segments render in parallel with analytic start phases; the result
+    // does not depend on the thread count. The decimated meter table is
+    // filled in the same pass.
+    m_levelTable.resize(ToneKernels::levelCount(sampleCount));
+    ToneKernels::renderLoop(params, sampleCount, data, m_levelTable.data(), m_renderThreadCount);
 
-        leftSample *= m_amplitude;
-        rightSample *= m_amplitude;
-
-        // Convert to 16-bit
-        data[2 * i] = static_cast<int16_t>(leftSample * 32767);
-        data[2 * i + 1] = static_cast<int16_t>(rightSample * 32767);
-
-        // Update phase continuously
-        m_phaseLeft += leftPhaseIncrement;
-        m_phaseRight += rightPhaseIncrement;
-
-        // Keep phase in range
-        if (m_phaseLeft > 2.0 * M_PI) m_phaseLeft -= 2.0 * M_PI;
-        if (m_phaseRight > 2.0 * M_PI) m_phaseRight -= 2.0 * M_PI;
-    }
+    // Save phases for continuation
+    m_phaseLeft = ToneKernels::phaseAt(params.leftPhase, ToneKernels::leftIncrement(params), sampleCount);
+    m_phaseRight = ToneKernels::phaseAt(params.rightPhase, ToneKernels::rightIncrement(params), sampleCount);
 
     // Apply crossfade between loops (eliminates click)
    // applyCrossfade(audioData, durationMs);
@@ -525,7 +561,7 @@ double BinauralEngine::calculateSquareSample(double phase)
     //return (std::sin(phase) >= 0.0) ? 1.0 : -1.0;
 
     // For ISOCHRONIC: On/Off (not +1/-1)
-        if (ConstantGlobals::currentToneType == 1) {
+        if (m_toneMode == ISOCHRONIC_TONE) {
             return (std::sin(phase) >= 0.0) ? 1.0 : 0.0;  // On/Off
         } else {
             return (std::sin(phase) >= 0.0) ? 1.0 : -1.0; // Original +1/-1
@@ -582,16 +618,35 @@ QBuffer *BinauralEngine::audioBuffer() const
     return m_audioBuffer;
 }
 
-QAudioSink *BinauralEngine::audioOutput() const
+OutputSink *BinauralEngine::audioOutput() const
 {
     return m_audioOutput;
 }
 
 
 
+// =================== LEVEL METERING ===================
+void BinauralEngine::pollAudioLevels()
+{
+    if (!m_audioOutput || m_levelTable.isEmpty()) {
+        return;
+    }
+
+    // Map the sink's play position into the looped buffer
+    qint64 playedFrames = m_audioOutput->processedUSecs() * m_sampleRate / 1000000;
+    qint64 loopFrames = static_cast<qint64>(m_levelTable.size()) * LEVEL_BLOCK_FRAMES;
+    int index = static_cast<int>((playedFrames % loopFrames) / LEVEL_BLOCK_FRAMES);
+
+    const AudioLevels &levels = m_levelTable.at(qMin(index, int(m_levelTable.size()) - 1));
+    emit audioLevelsChanged(levels.peakLeft, levels.peakRight,
+                            levels.rmsLeft, levels.rmsRight);
+    emit audioLevelChanged(qMax(levels.peakLeft, levels.peakRight));
+}
+
 // =================== AUDIO STATE HANDLER ===================
 void BinauralEngine::handleAudioStateChanged(QAudio::State state)
 {
+    BINAURAL_TRACE_INSTANT("audio", "BinauralEngine::sinkStateChanged", "state", state);
     switch (state) {
         case QAudio::ActiveState:
             // Audio is playing normally
@@ -610,13 +665,13 @@ void BinauralEngine::handleAudioStateChanged(QAudio::State state)
     case QAudio::IdleState:
         // Buffer has been fully played
 
-            if (m_isPlaying && m_audioBuffer) {  // <-- KEEP only this check
+            if (m_isPlaying && m_playbackDevice) {  // <-- KEEP only this check
 
 
                 QTimer::singleShot(0, this, [this]() {
                            // Now Qt has finished state transition
-                           m_audioBuffer->seek(0);
-                           m_audioOutput->start(m_audioBuffer);
+                           m_playbackDevice->seek(0);
+                           m_audioOutput->start(m_playbackDevice);
                        });
 
             }
@@ -660,69 +715,11 @@ void BinauralEngine::generateIsochronicBuffer(int durationMs) {
 
     if (durationMs <= 0) return;
 
-    // Generate buffer with same duration logic
-    int totalDurationMs = durationMs;
-    qint64 sampleCount = (static_cast<qint64>(m_sampleRate) * totalDurationMs) / 1000;
-
-    QByteArray audioData;
-    audioData.resize(sampleCount * 2 * sizeof(int16_t));  // Stereo buffer
-    int16_t *data = reinterpret_cast<int16_t*>(audioData.data());
-
     // ISOCHRONIC LOGIC:
     // m_leftFrequency = Carrier frequency (e.g., 200Hz)
-    // m_rightFrequency = Pulse rate (e.g., 10Hz for 10 pulses/second)
-    double carrierFreq = m_leftFrequency;
-    double pulseFreq = m_pulseFrequency;
-
-    // Phase increments (same as binaural but different meaning)
-    double carrierPhaseIncrement = (2.0 * M_PI * carrierFreq) / m_sampleRate;
-    double pulsePhaseIncrement = (2.0 * M_PI * pulseFreq) / m_sampleRate;
-
-    // Reuse existing phase variables
-    double carrierPhase = m_phaseLeft;
-    double pulsePhase = m_phaseRight;
-
-    for (qint64 i = 0; i < sampleCount; ++i) {
-        // 1. Generate carrier wave (sine/square based on m_currentWaveform)
-        double carrierSample = calculateSample(carrierPhase, m_currentWaveform);
-
-        // 2. Generate pulse wave (square wave for on/off)
-        // sin(pulsePhase) >= 0 ? 1.0 : 0.0 = Square wave, 50% duty cycle
-        double pulseValue = (std::sin(pulsePhase) >= 0.0) ? 1.0 : 0.0;
-
-        // 3. Modulate: carrier × pulse
-        double modulatedSample = carrierSample * pulseValue * m_amplitude;
-
-        // 4. Same signal to both ears (stereo identical)
-        data[2 * i] = static_cast<int16_t>(modulatedSample * 32767);     // Left
-        data[2 * i + 1] = static_cast<int16_t>(modulatedSample * 32767); // Right
-
-        // 5. Update phases (same as binaural)
-        carrierPhase += carrierPhaseIncrement;
-        pulsePhase += pulsePhaseIncrement;
-
-        // 6. Keep phase in range (same as binaural)
-        if (carrierPhase > 2.0 * M_PI) carrierPhase -= 2.0 * M_PI;
-        if (pulsePhase > 2.0 * M_PI) pulsePhase -= 2.0 * M_PI;
-    }
-
-    // Save phases for continuation (same as binaural)
-    m_phaseLeft = carrierPhase;
-    m_phaseRight = pulsePhase;
-
-    // Apply same fade as binaural
-    applyLoopFade(audioData, durationMs);
-
-    if (m_audioBuffer) {
-        if (m_audioBuffer->isOpen()) {
-            m_audioBuffer->close();
-        }
-        delete m_audioBuffer;
-        m_audioBuffer = nullptr;
-    }
-
-    m_audioBuffer = new QBuffer(this);
-    m_audioBuffer->setData(audioData);
+    // m_pulseFrequency = Pulse rate (e.g., 10Hz for 10 pulses/second)
+    // Phases reuse m_phaseLeft (carrier) and m_phaseRight (pulse)
+    renderLoopBuffer(toneParameters(ToneKernels::ISOCHRONIC_MODE), durationMs);
 }
 
 double BinauralEngine::getPulseFrequency() const{
@@ -745,12 +742,192 @@ void BinauralEngine::setPulseFrequency(double hz)
 }
 
 
+void BinauralEngine::setNoiseType(NoiseGenerator::NoiseType type)
+{
+    if (m_noiseType != type) {
+        m_noiseType = type;
+        m_parametersChanged = true;
+
+        if (m_isPlaying) {
+            updateAudioParameters();
+        }
+    }
+}
+
+NoiseGenerator::NoiseType BinauralEngine::getNoiseType() const
+{
+    return m_noiseType;
+}
+
+void BinauralEngine::setNoiseLevel(double level)
+{
+    if (!validateAmplitude(level)) {
+        emit errorOccurred(QString("Invalid noise level: %1").arg(level));
+        return;
+    }
+
+    m_noiseLevel = level;
+    m_parametersChanged = true;
+
+    if (m_isPlaying) {
+        updateAudioParameters();
+    }
+}
+
+double BinauralEngine::getNoiseLevel() const
+{
+    return m_noiseLevel;
+}
+
 void BinauralEngine::forceBufferRegeneration() {
     m_parametersChanged = true;  // Force buffer rebuild
-    if (m_audioBuffer) {
+    releaseLoopBuffer();
+}
+
+// =================== RENDER CACHE ===================
+void BinauralEngine::setRenderCacheEnabled(bool enabled)
+{
+    m_renderCacheEnabled = enabled;
+}
+
+bool BinauralEngine::isRenderCacheEnabled() const
+{
+    return m_renderCacheEnabled;
+}
+
+void BinauralEngine::setRenderCacheLimit(qint64 bytes)
+{
+    m_renderCache->setMaxBytes(bytes);
+}
+
+qint64 BinauralEngine::renderCacheLimit() const
+{
+    return m_renderCache->maxBytes();
+}
+
+void BinauralEngine::clearRenderCache()
+{
+    m_renderCache->clear();
+}
+
+void BinauralEngine::setRenderThreadCount(int threads)
+{
+    m_renderThreadCount = qMax(0, threads);
+}
+
+int BinauralEngine::renderThreadCount() const
+{
+    return m_renderThreadCount;
+}
+
+bool BinauralEngine::prepareLoopBuffer()
+{
+    BINAURAL_TRACE_SCOPE("audio", "BinauralEngine::prepareLoopBuffer");
+    releaseLoopBuffer();
+
+    QString key;
+    if (m_renderCacheEnabled) {
+        key = renderCacheKey();
+        if (loadCachedLoop(key)) {
+            BINAURAL_TRACE_INSTANT("audio", "BinauralEngine::renderCacheHit");
+            return true;
+        }
+    }
+
+    generateAudioBuffer(m_bufferDurationMs);
+    if (!m_audioBuffer || m_audioBuffer->size() == 0) {
+        return false;
+    }
+
+    // Persist, then play from the mapping so the loop does not stay on the heap
+    if (m_renderCacheEnabled && storeCachedLoop(key) && loadCachedLoop(key)) {
         delete m_audioBuffer;
         m_audioBuffer = nullptr;
+        return true;
     }
+
+    // Cache disabled or not writable: play the rendered buffer directly
+    m_audioBuffer->open(QIODevice::ReadOnly);
+    m_playbackDevice = m_audioBuffer;
+    return true;
+}
+
+void BinauralEngine::releaseLoopBuffer()
+{
+    m_playbackDevice = nullptr;
+
+    delete m_mappedBuffer;
+    m_mappedBuffer = nullptr;
+
+    delete m_audioBuffer;
+    m_audioBuffer = nullptr;
+}
+
+QString BinauralEngine::renderCacheKey() const
+{
+    // Everything that changes the rendered samples, and nothing else
+    // (output volume is applied by the sink)
+    bool isochronic = (m_toneMode == ISOCHRONIC_TONE);
+    QString identity = QString("v2|tone=%1|L=%2|wave=%3|amp=%4|rate=%5|ms=%6|noise=%7|noiseLevel=%8")
+                           .arg(isochronic ? "iso" : "bin")
+                           .arg(double(m_leftFrequency), 0, 'g', 17)
+                           .arg(int(m_currentWaveform.load()))
+                           .arg(double(m_amplitude), 0, 'g', 17)
+                           .arg(m_sampleRate)
+                           .arg(m_bufferDurationMs)
+                           .arg(int(m_noiseType.load()))
+                           .arg(double(m_noiseLevel), 0, 'g', 17);
+    identity += isochronic ? QString("|pulse=%1").arg(m_pulseFrequency, 0, 'g', 17)
+                           : QString("|R=%1").arg(double(m_rightFrequency), 0, 'g', 17);
+
+    return MappedFileCache::hashKey(identity.toUtf8());
+}
+
+bool BinauralEngine::loadCachedLoop(const QString &key)
+{
+    std::unique_ptr<MappedCacheEntry> entry = m_renderCache->open(key);
+    if (!entry) {
+        return false;
+    }
+
+    // Header: format check plus the meter table rendered with the loop
+    QDataStream in(entry->header());
+    in.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    quint32 sampleRate = 0, channels = 0, levelBlockFrames = 0, levelCount = 0;
+    in >> sampleRate >> channels >> levelBlockFrames >> levelCount;
+    if (in.status() != QDataStream::Ok || int(sampleRate) != m_sampleRate || channels != 2
+        || int(levelBlockFrames) != LEVEL_BLOCK_FRAMES || entry->payloadSize() == 0
+        || levelCount > quint32(entry->header().size() / (4 * sizeof(float)))) {
+        return false;
+    }
+
+    QVector<AudioLevels> levelTable(static_cast<int>(levelCount));
+    for (AudioLevels &levels : levelTable) {
+        in >> levels.peakLeft >> levels.peakRight >> levels.rmsLeft >> levels.rmsRight;
+    }
+    if (in.status() != QDataStream::Ok) {
+        return false;
+    }
+
+    m_levelTable = levelTable;
+    m_mappedBuffer = new MappedCacheDevice(std::move(entry), this);
+    m_playbackDevice = m_mappedBuffer;
+    return true;
+}
+
+bool BinauralEngine::storeCachedLoop(const QString &key)
+{
+    QByteArray header;
+    QDataStream out(&header, QIODevice::WriteOnly);
+    out.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    out << quint32(m_sampleRate) << quint32(2) << quint32(LEVEL_BLOCK_FRAMES)
+        << quint32(m_levelTable.size());
+    for (const AudioLevels &levels : std::as_const(m_levelTable)) {
+        out << levels.peakLeft << levels.peakRight << levels.rmsLeft << levels.rmsRight;
+    }
+
+    const QByteArray &pcm = m_audioBuffer->buffer();
+    return m_renderCache->store(key, header, pcm.constData(), pcm.size());
 }
 
 double BinauralEngine::calculateTriangleSample(double phase) {
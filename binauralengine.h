@@ -2,13 +2,22 @@
 #define BINAURALENGINE_H
 
 #include <QObject>
-#include <QAudioSink>
 #include <QAudioFormat>
 #include <QBuffer>
 #include <QIODevice>
 #include <QMediaDevices>
 #include <atomic>
 #include <cmath>
+#include <memory>
+#include "noisegenerator.h"
+#include "audiolevels.h"
+#include "tonekernels.h"
+#include "outputsink.h"
+#include <QVector>
+
+class QTimer;
+class MappedFileCache;
+class MappedCacheDevice;
 
 class BinauralEngine : public QObject
 {
@@ -25,6 +34,14 @@ public:
     };
     Q_ENUM(Waveform)
 
+    // Same values as ConstantGlobals::currentToneType
+    enum ToneMode {
+        BINAURAL_TONE = 0,
+        ISOCHRONIC_TONE = 1,
+        GENERATOR_TONE = 2
+    };
+    Q_ENUM(ToneMode)
+
     explicit BinauralEngine(QObject *parent = nullptr);
     ~BinauralEngine();
 
@@ -33,6 +50,10 @@ public:
     void stop();
     bool isPlaying() const;
 
+    // =================== TONE MODE ===================
+    void setToneMode(ToneMode mode);
+    ToneMode getToneMode() const;
+
     // =================== FREQUENCY CONTROL ===================
     void setLeftFrequency(double hz);
     void setRightFrequency(double hz);
@@ -66,12 +87,35 @@ public:
     bool isEngineActive() const;
 
 
-    QAudioSink *audioOutput() const;
+    OutputSink *audioOutput() const;
 
     void setPulseFrequency(double newPulseFrequency);
 
     QBuffer *audioBuffer() const;
 
+    // =================== NOISE LAYER ===================
+    void setNoiseType(NoiseGenerator::NoiseType type);
+    NoiseGenerator::NoiseType getNoiseType() const;
+
+    void setNoiseLevel(double level); // 0.0-1.0 of full scale
+    double getNoiseLevel() const;
+
+    // =================== RENDER CACHE ===================
+    // Rendered loops are kept on disk (ConstantGlobals::renderCachePath)
+    // and played straight from a read-only mapping
+    void setRenderCacheEnabled(bool enabled);
+    bool isRenderCacheEnabled() const;
+
+    void setRenderCacheLimit(qint64 bytes);
+    qint64 renderCacheLimit() const;
+
+    void clearRenderCache();
+
+    // Threads used to render a loop (0 = one per core). Output is
+    // identical for every setting.
+    void setRenderThreadCount(int threads);
+    int renderThreadCount() const;
+
 signals:
     // Playback state signals
     void playbackStarted();
@@ -92,12 +136,18 @@ signals:
 
     // Information signals
     void parametersUpdated();
-    void audioLevelChanged(double peakLevel); // For potential VU meter
+    void audioLevelChanged(double peakLevel); // Louder channel peak, ~30 Hz while playing
+    void audioLevelsChanged(double peakLeft, double peakRight,
+                            double rmsLeft, double rmsRight);
 
 private slots:
     void handleAudioStateChanged(QAudio::State state);
+    void pollAudioLevels();
 
 private:
+    friend class BinauralEngineBenchmark; // benchmarks/bench_engines.cpp
+    friend class GoldenOutputTest;        // tests/tst_goldenoutput.cpp
+
     // =================== PRIVATE METHODS ===================
     void initializeAudioFormat();
     bool initializeAudioOutput();
@@ -120,18 +170,39 @@ private:
     void updateAudioParameters();
     void resetPhase();
 
+    // Loop buffer source: cached mapping or freshly rendered QBuffer
+    bool prepareLoopBuffer();
+    void releaseLoopBuffer();
+    QString renderCacheKey() const;
+    bool loadCachedLoop(const QString &key);
+    bool storeCachedLoop(const QString &key);
+
+    // Loop rendering through the shared tone kernels
+    ToneKernels::ToneParameters toneParameters(ToneKernels::ToneMode mode) const;
+    void renderLoopBuffer(const ToneKernels::ToneParameters &params, int durationMs);
+
     // =================== MEMBER VARIABLES ===================
     // Audio playback components
-    QAudioSink *m_audioOutput;
+    OutputSink *m_audioOutput;
     QBuffer *m_audioBuffer;
     QAudioFormat m_audioFormat;
 
+    // What the sink plays: m_audioBuffer or m_mappedBuffer
+    QIODevice *m_playbackDevice;
+    MappedCacheDevice *m_mappedBuffer;
+    std::unique_ptr<MappedFileCache> m_renderCache;
+    bool m_renderCacheEnabled;
+    int m_renderThreadCount;
+
     // Current audio parameters (atomic for thread safety)
     std::atomic<double> m_leftFrequency;
     std::atomic<double> m_rightFrequency;
     std::atomic<double> m_amplitude;
     std::atomic<double> m_outputVolume;
     std::atomic<Waveform> m_currentWaveform;
+    std::atomic<ToneMode> m_toneMode;
+    std::atomic<NoiseGenerator::NoiseType> m_noiseType;
+    std::atomic<double> m_noiseLevel;
 
     double m_phaseLeft;    // Regular double, not atomic
     double m_phaseRight;   // Regular double, not atomic
@@ -155,11 +226,19 @@ private:
     static constexpr double MAX_AMPLITUDE = 1.0;
     static constexpr double DEFAULT_AMPLITUDE = 0.3;
     static constexpr double DEFAULT_VOLUME = 0.15; // Subtle background level
+    static constexpr double DEFAULT_NOISE_LEVEL = 0.1;
+    static constexpr qint64 DEFAULT_RENDER_CACHE_BYTES = 512LL * 1024 * 1024; // ~9 five-minute loops
 
     void applyCrossfade(QByteArray &buffer, int loopDurationMs);
     void applyLoopFade(QByteArray &buffer, int durationMs);
     int m_loopCounter = 0;
 
+    // Level metering: one decimated reading per LEVEL_BLOCK_FRAMES of the loop
+    QVector<AudioLevels> m_levelTable;
+    QTimer *m_levelTimer;
+    static constexpr int LEVEL_BLOCK_FRAMES = ToneKernels::LEVEL_BLOCK_FRAMES;
+    static constexpr int LEVEL_POLL_INTERVAL_MS = 33;
+
     //isochronic
 private:
     void generateIsochronicBuffer(int durationMs);
@@ -0,0 +1,121 @@
+#include "brainwavepreset.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include "dynamicengine.h"
+#include "noisegenerator.h"
+
+// =================== JSON ===================
+QJsonObject BrainwavePreset::toJson() const {
+    QJsonObject json;
+    json["name"] = name;
+    json["toneType"] = toneType;
+    json["leftFrequency"] = leftFrequency;
+    json["rightFrequency"] = rightFrequency;
+    json["waveform"] = waveform;
+    json["pulseFrequency"] = pulseFrequency;
+    json["volume"] = volume;
+    json["noiseType"] = noiseType;
+    json["noiseLevel"] = noiseLevel;
+    json["version"] = "1.0";
+    json["created"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+    return json;
+}
+
+BrainwavePreset BrainwavePreset::fromJson(const QJsonObject &json) {
+    BrainwavePreset preset;
+    preset.name = json["name"].toString();
+    preset.toneType = json["toneType"].toInt();
+    preset.leftFrequency = json["leftFrequency"].toDouble();
+    preset.rightFrequency = json["rightFrequency"].toDouble();
+    preset.waveform = json["waveform"].toInt();
+    preset.pulseFrequency = json["pulseFrequency"].toDouble();
+    preset.volume = json["volume"].toDouble();
+    preset.noiseType = json["noiseType"].toInt(NoiseGenerator::NO_NOISE);
+    preset.noiseLevel = json["noiseLevel"].toDouble(10.0);
+    return preset;
+}
+
+bool BrainwavePreset::isValid() const {
+    return !name.isEmpty() &&
+           toneType >= 0 && toneType <= 2 &&
+           leftFrequency >= 20.0 && leftFrequency <= 20000.0 &&
+           rightFrequency >= 20.0 && rightFrequency <= 20000.0 &&
+           waveform >= 0 && waveform <= 3 &&
+           pulseFrequency >= 0.0 && pulseFrequency <= 100.0 &&
+           volume >= 0.0 && volume <= 100.0 &&
+           noiseType >= NoiseGenerator::NO_NOISE && noiseType <= NoiseGenerator::BROWN_NOISE &&
+           noiseLevel >= 0.0 && noiseLevel <= 100.0;
+}
+
+// =================== FILES ===================
+bool BrainwavePreset::saveToFile(const QString &filename) const {
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Could not open preset file for writing:" << filename;
+        return false;
+    }
+
+    QJsonDocument doc(toJson());
+    file.write(doc.toJson(QJsonDocument::Indented));
+    file.close();
+
+    return true;
+}
+
+BrainwavePreset BrainwavePreset::loadFromFile(const QString &filename) {
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Could not open preset file:" << filename;
+        return BrainwavePreset();
+    }
+
+    QByteArray data = file.readAll();
+    file.close();
+
+    QJsonParseError error;
+    QJsonDocument doc = QJsonDocument::fromJson(data, &error);
+
+    if (error.error != QJsonParseError::NoError) {
+        qWarning() << "JSON parse error in preset file:" << error.errorString();
+        return BrainwavePreset();
+    }
+
+    if (!doc.isObject()) {
+        qWarning() << "Preset file is not a valid JSON object";
+        return BrainwavePreset();
+    }
+
+    return fromJson(doc.object());
+}
+
+QList<BrainwavePreset> BrainwavePreset::loadAll(const QString &directory) {
+    QList<BrainwavePreset> presets;
+    QDir presetDir(directory);
+
+    const QStringList presetFiles = presetDir.entryList({"*.json"}, QDir::Files);
+    for (const QString &file : presetFiles) {
+        BrainwavePreset preset = loadFromFile(presetDir.filePath(file));
+        if (preset.isValid()) {
+            presets.append(preset);
+        }
+    }
+
+    return presets;
+}
+
+// =================== ENGINE ===================
+void BrainwavePreset::applyTo(DynamicEngine *engine) const {
+    auto toneMode = static_cast<DynamicEngine::ToneMode>(toneType);
+    engine->setToneMode(toneMode);
+    engine->setLeftFrequency(leftFrequency);
+    engine->setRightFrequency(toneMode == DynamicEngine::ISOCHRONIC_TONE ? leftFrequency
+                                                                         : rightFrequency);
+    engine->setPulseFrequency(pulseFrequency);
+    engine->setWaveform(static_cast<DynamicEngine::Waveform>(waveform));
+    engine->setNoiseType(static_cast<NoiseGenerator::NoiseType>(noiseType));
+    engine->setNoiseLevel(noiseLevel / 100.0);
+}
@@ -0,0 +1,38 @@
+#ifndef BRAINWAVEPRESET_H
+#define BRAINWAVEPRESET_H
+
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+
+class DynamicEngine;
+
+// A saved tone setting (one JSON file in ConstantGlobals::presetFilePath).
+// Widget-free, so headless runners and tests load presets the same way
+// the GUI does.
+struct BrainwavePreset {
+    QString name;
+    int toneType = 0;           // 0=Binaural, 1=Isochronic, 2=Generator
+    double leftFrequency = 0.0;
+    double rightFrequency = 0.0;
+    int waveform = 0;           // 0=Sine, 1=Square, 2=Triangle, 3=Sawtooth
+    double pulseFrequency = 0.0; // For isochronic
+    double volume = 0.0;        // 0-100%
+    int noiseType = 0;          // 0=None, 1=White, 2=Pink, 3=Brown
+    double noiseLevel = 10.0;   // 0-100%
+
+    // JSON serialization
+    QJsonObject toJson() const;
+    static BrainwavePreset fromJson(const QJsonObject &json);
+    bool isValid() const;
+
+    // Files; a failed load returns an invalid preset
+    bool saveToFile(const QString &filename) const;
+    static BrainwavePreset loadFromFile(const QString &filename);
+    static QList<BrainwavePreset> loadAll(const QString &directory); // Valid ones only
+
+    // Tone mode, frequencies, waveform and noise; volume is left to the caller
+    void applyTo(DynamicEngine *engine) const;
+};
+
+#endif // BRAINWAVEPRESET_H
@@ -0,0 +1,96 @@
+# Three-stage profile-guided build, run through the pgo target:
+#
+#   cmake --build build --target pgo
+#
+# 1. baseline   default Release build, bench_engines -> baseline.json
+# 2. optimized  BINAURAL_PGO=GENERATE, run pgo_training to record profiles
+# 3. optimized  reconfigured with BINAURAL_PGO=USE and rebuilt in place,
+#               bench_engines -> optimized.json with a speedup column
+#
+# Stages 2 and 3 share a build tree (GCC finds profiles by object path) and
+# use the same LTO/target_clones settings, so the profiled code and the
+# optimized code have the same shape. Stages 1 and 3 run bench_engines, so
+# Google Benchmark must be installed (or on PREFIX_PATH).
+
+foreach(var SOURCE_DIR BINARY_DIR GENERATOR)
+    if(NOT DEFINED ${var})
+        message(FATAL_ERROR "PgoBuild.cmake needs -D${var}=...")
+    endif()
+endforeach()
+
+set(PROFILE_DIR "${BINARY_DIR}/profiles")
+set(COMMON_ARGS
+    -G "${GENERATOR}"
+    -DCMAKE_BUILD_TYPE=Release
+    -DBINAURAL_BUILD_BENCHMARKS=ON
+)
+if(CXX_COMPILER)
+    list(APPEND COMMON_ARGS "-DCMAKE_CXX_COMPILER=${CXX_COMPILER}")
+endif()
+if(PREFIX_PATH)
+    list(APPEND COMMON_ARGS "-DCMAKE_PREFIX_PATH=${PREFIX_PATH}")
+endif()
+set(OPTIMIZED_ARGS
+    -DBINAURAL_ENABLE_LTO=ON
+    -DBINAURAL_TARGET_CLONES=ON
+    "-DBINAURAL_PGO_DIR=${PROFILE_DIR}"
+)
+
+function(run_step description)
+    message(STATUS "[pgo] ${description}")
+    execute_process(COMMAND ${ARGN} RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "[pgo] ${description} failed (${result})")
+    endif()
+endfunction()
+
+# 1. Baseline
+set(BASELINE_DIR "${BINARY_DIR}/baseline")
+run_step("Configuring baseline"
+    ${CMAKE_COMMAND} -S "${SOURCE_DIR}" -B "${BASELINE_DIR}" ${COMMON_ARGS}
+    -DBINAURAL_ENABLE_LTO=OFF -DBINAURAL_TARGET_CLONES=OFF -DBINAURAL_PGO=OFF)
+file(STRINGS "${BASELINE_DIR}/CMakeCache.txt" BENCHMARK_DIR REGEX "^benchmark_DIR:")
+if(NOT BENCHMARK_DIR OR BENCHMARK_DIR MATCHES "NOTFOUND$")
+    message(FATAL_ERROR "[pgo] Google Benchmark not found: bench_engines measures "
+                        "both builds. Install it or add its prefix to CMAKE_PREFIX_PATH")
+endif()
+run_step("Building baseline"
+    ${CMAKE_COMMAND} --build "${BASELINE_DIR}" --target bench_engines)
+run_step("Benchmarking baseline"
+    "${BASELINE_DIR}/bench_engines" "--benchmark_out=${BINARY_DIR}/baseline.json")
+
+# 2. Instrumented build and training run
+set(OPTIMIZED_DIR "${BINARY_DIR}/optimized")
+file(REMOVE_RECURSE "${PROFILE_DIR}")
+file(MAKE_DIRECTORY "${PROFILE_DIR}")
+run_step("Configuring instrumented build"
+    ${CMAKE_COMMAND} -S "${SOURCE_DIR}" -B "${OPTIMIZED_DIR}" ${COMMON_ARGS} ${OPTIMIZED_ARGS}
+    -DBINAURAL_PGO=GENERATE)
+run_step("Building instrumented pgo_training"
+    ${CMAKE_COMMAND} --build "${OPTIMIZED_DIR}" --target pgo_training)
+run_step("Running training workload"
+    "${OPTIMIZED_DIR}/pgo_training")
+
+file(GLOB RAW_PROFILES "${PROFILE_DIR}/*.profraw")
+if(RAW_PROFILES)
+    # Clang: merge into the file BINAURAL_PGO=USE reads
+    find_program(LLVM_PROFDATA NAMES llvm-profdata)
+    if(NOT LLVM_PROFDATA)
+        message(FATAL_ERROR "[pgo] llvm-profdata is needed to merge Clang profiles")
+    endif()
+    run_step("Merging profiles"
+        ${LLVM_PROFDATA} merge -o "${PROFILE_DIR}/default.profdata" ${RAW_PROFILES})
+endif()
+
+# 3. Profile-guided rebuild in the same tree
+run_step("Configuring optimized build"
+    ${CMAKE_COMMAND} -S "${SOURCE_DIR}" -B "${OPTIMIZED_DIR}" ${COMMON_ARGS} ${OPTIMIZED_ARGS}
+    -DBINAURAL_PGO=USE)
+run_step("Building optimized targets"
+    ${CMAKE_COMMAND} --build "${OPTIMIZED_DIR}")
+run_step("Benchmarking optimized build against the baseline"
+    "${OPTIMIZED_DIR}/bench_engines"
+    "--benchmark_out=${BINARY_DIR}/optimized.json"
+    "--speedup_baseline=${BINARY_DIR}/baseline.json")
+
+message(STATUS "[pgo] Optimized binaries in ${OPTIMIZED_DIR}, results in ${BINARY_DIR}/optimized.json")
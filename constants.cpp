@@ -1,13 +1,15 @@
 #include "constants.h"
-#include<QApplication>
 namespace ConstantGlobals {
 
 const QString appDirPath = QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation) + "/BinauralPlayer";
 const QString ambientFilePath = appDirPath + "/ambient-tracks";
+const QString loopPointCachePath = appDirPath + "/ambient-loop-points";
+const QString decodedAudioCachePath = appDirPath + "/ambient-pcm-cache";
 const QString presetFilePath = appDirPath + "/brainwave-presets";
 const QString playlistFilePath = appDirPath + "/playlists";
 const QString musicFilePath = appDirPath + "/music";
 const QString ambientPresetFilePath = appDirPath + "/ambient-presets";
+const QString renderCachePath = appDirPath + "/render-cache";
 
 int currentToneType = 0;
 }
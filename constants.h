@@ -7,10 +7,13 @@
 namespace ConstantGlobals {
 extern const QString appDirPath;
 extern const QString ambientFilePath;
+extern const QString loopPointCachePath;
+extern const QString decodedAudioCachePath;
 extern const QString presetFilePath;
 extern const QString playlistFilePath;
 extern const QString musicFilePath;
 extern const QString ambientPresetFilePath;
+extern const QString renderCachePath;
 
 extern int currentToneType;
 }
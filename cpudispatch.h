@@ -0,0 +1,22 @@
+#ifndef CPUDISPATCH_H
+#define CPUDISPATCH_H
+
+// Function multiversioning for the hot render kernels. When the build
+// defines BINAURAL_TARGET_CLONES (CMake option of the same name), GCC and
+// Clang compile one copy of each marked function per listed ISA and the
+// dynamic loader picks the best one for the running CPU through an ifunc,
+// so this needs an x86-64 ELF target; elsewhere the marker is empty.
+// Mark definitions only: on a declaration GCC binds callers in other
+// translation units straight to clones they cannot see.
+//
+// FMA is left out of the list on purpose: contracting a * b + c changes
+// rounding, and a clone must render bit-identically to the default build
+// on the same machine (render cache, golden references).
+#if defined(BINAURAL_TARGET_CLONES) && defined(__x86_64__) && defined(__ELF__) \
+    && (defined(__GNUC__) || defined(__clang__))
+#define BINAURAL_HOT_KERNEL __attribute__((target_clones("avx2", "sse4.2", "default")))
+#else
+#define BINAURAL_HOT_KERNEL
+#endif
+
+#endif // CPUDISPATCH_H
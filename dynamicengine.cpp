@@ -4,7 +4,9 @@
 #include <QTimer>
 #include <QTime>
 #include <QElapsedTimer>
-#include "constants.h"
+#include <cstring>
+#include "enginecontrol.h"
+#include "tracerecorder.h"
 
 // =================== CONSTRUCTOR/DESTRUCTOR ===================
 DynamicEngine::DynamicEngine(QObject *parent)
@@ -16,21 +18,48 @@ DynamicEngine::DynamicEngine(QObject *parent)
     , m_amplitude(DEFAULT_AMPLITUDE)
     , m_outputVolume(DEFAULT_VOLUME)
     , m_currentWaveform(SINE_WAVE)
+    , m_toneMode(BINAURAL_TONE)
     , m_phaseLeft(0.0)
     , m_phaseRight(0.0)
     , m_isPlaying(false)
-    , m_parametersChanged(false)
+    , m_offline(false)
     , m_sampleRate(44100)
     , m_bufferDurationMs(300000)
     , m_pulseFrequency(7.83)
+    , m_noiseType(NoiseGenerator::NO_NOISE)
+    , m_noiseLevel(DEFAULT_NOISE_LEVEL)
+    , m_muted(false)
+    , m_fadeGain(1.0)
+    , m_commandQueue(COMMAND_QUEUE_CAPACITY)
+    , m_commandOverflow(false)
+    , m_renderPosition(0)
     , m_dynamicDevice(nullptr)
+    , m_levelTimer(new QTimer(this))
+    , m_scopeRing(SCOPE_RING_FRAMES)
+    , m_scopeEnabled(false)
+    , m_loopState(LOOP_IDLE)
+    , m_loopEnabled(true)
+    , m_loopRenderBusy(false)
+    , m_loopFrames(0)
+    , m_reportedLoop(false)
+    , m_analysisRing(ANALYSIS_RING_FRAMES)
+    , m_analysisEnabled(false)
 {
     initializeAudioFormat();
+
+    // GUI-side meter poll; the audio path only publishes into m_levelTap
+    m_levelTimer->setInterval(LEVEL_POLL_INTERVAL_MS);
+    connect(m_levelTimer, &QTimer::timeout, this, &DynamicEngine::pollAudioLevels);
+    connect(m_levelTimer, &QTimer::timeout, this, &DynamicEngine::serviceLoopRender);
+    connect(m_levelTimer, &QTimer::timeout, this, &DynamicEngine::resyncCommands);
 }
 
 DynamicEngine::~DynamicEngine()
 {
     stop();
+    if (m_loopWorker.joinable()) {
+        m_loopWorker.join();
+    }
     delete m_dynamicDevice;
     delete m_audioBuffer;
     delete m_audioOutput;
@@ -50,22 +79,17 @@ bool DynamicEngine::initializeAudioOutput()
         delete m_audioOutput;
     }
 
-    QAudioDevice audioDevice = QMediaDevices::defaultAudioOutput();
-    if (audioDevice.isNull()) {
-        emit errorOccurred("No audio output device available");
-        return false;
-    }
-
-    if (!audioDevice.isFormatSupported(m_audioFormat)) {
-        emit errorOccurred("Audio format not supported by device");
+    QString error;
+    m_audioOutput = OutputSink::create(m_audioFormat, this, &error);
+    if (!m_audioOutput) {
+        emit errorOccurred(error);
         return false;
     }
 
-    m_audioOutput = new QAudioSink(audioDevice, m_audioFormat, this);
     // INCREASE BUFFER SIZE (default is usually 4096-8192)
        // We try values: 8192, 16384, 32768 (higher = more latency but stable)
        m_audioOutput->setBufferSize(32768);
-    connect(m_audioOutput, &QAudioSink::stateChanged,
+    connect(m_audioOutput, &OutputSink::stateChanged,
             this, &DynamicEngine::handleAudioStateChanged);
 
     m_audioOutput->setVolume(m_outputVolume);
@@ -83,113 +107,273 @@ bool DynamicEngine::start()
     return startDynamicPlayback();
 }
 
-bool DynamicEngine::startDynamicPlayback()
-{
-    if (!initializeAudioOutput()) {
-        return false;
+// =================== DYNAMIC AUDIO DEVICE ===================
+// Custom QIODevice pulled by the sink. Each block first drains the command
+// queue into an EngineControl, then renders in spans between due commands
+// and ramp steps, so every change lands at its frame.
+//
+// Streams from a ToneStream while the settings move; once they have been
+// still for LOOP_SETTLE_MS it retunes to loop-aligned frequencies and asks
+// for a loop of the same epoch, then switches to copying that loop when it
+// is ready. Both paths produce frame n of the same render, so the switches
+// are seamless in either direction.
+class DynamicEngine::DynamicAudioDevice : public QIODevice {
+public:
+    DynamicAudioDevice(DynamicEngine* engine)
+        : m_engine(engine)
+        , m_stableFrames(0), m_loopOffset(0)
+        , m_scopeWriter(SCOPE_DECIMATION), m_analysisWriter(1) {
+        m_control.reset(engine->toneParameters(), engine->m_muted, engine->m_fadeGain);
+        m_source = m_control.parameters();
+        m_stream.retune(m_source);
+        setOpenMode(QIODevice::ReadOnly);
+    }
+
+    // Offline pulls take the sink's path
+    qint64 pull(int16_t *interleaved, qint64 frameCount) {
+        const qint64 frameBytes = 2 * sizeof(int16_t);
+        return readData(reinterpret_cast<char*>(interleaved), frameCount * frameBytes) / frameBytes;
     }
 
-    // Create custom QIODevice for dynamic generation
-    class DynamicAudioDevice : public QIODevice {
-    public:
-        DynamicAudioDevice(DynamicEngine* engine) 
-            : m_engine(engine), m_phaseLeft(0.0), m_phaseRight(0.0) {
-            setOpenMode(QIODevice::ReadOnly);
+protected:
+    qint64 readData(char* data, qint64 maxlen) override {
+        int16_t* samples = reinterpret_cast<int16_t*>(data);
+        int sampleCount = maxlen / (2 * sizeof(int16_t)); // Stereo
+        BINAURAL_TRACE_SCOPE("audio", "DynamicEngine::readData", "frames", sampleCount);
+
+        // Everything the GUI posted since the last block
+        m_control.collect(m_engine->m_commandQueue);
+
+        // Visualizer/analyzer taps: frames collected in blocks, memcpy'd to the rings
+        bool tapScope = m_engine->m_scopeEnabled.load(std::memory_order_relaxed);
+        bool tapAnalysis = m_engine->m_analysisEnabled.load(std::memory_order_relaxed);
+
+        // Metered (pre-fader) while writing, published once for the whole block
+        LevelAccumulator levels;
+
+        int done = 0;
+        while (done < sampleCount) {
+            m_control.applyDue();
+            int span = m_control.spanFrames(sampleCount - done);
+            updateLoopState(m_control.parameters());
+
+            int16_t *out = samples + 2 * done;
+            if (m_engine->m_loopState.load(std::memory_order_acquire) == LOOP_PLAYING) {
+                playLoop(out, span, tapScope, tapAnalysis);
+            } else {
+                streamFrames(out, span, levels, tapScope, tapAnalysis);
+            }
+            applyGain(out, span);
+
+            m_control.advance(span);
+            done += span;
         }
-        
-    protected:
-        qint64 readData(char* data, qint64 maxlen) override {
-            // Real-time audio generation
-            int16_t* samples = reinterpret_cast<int16_t*>(data);
-            int sampleCount = maxlen / (2 * sizeof(int16_t)); // Stereo
-            
-            // Get CURRENT values (atomic reads = immediate effect)
-            double leftFreq = m_engine->m_leftFrequency.load();
-            double rightFreq = m_engine->m_rightFrequency.load();
-            double amplitude = m_engine->m_amplitude.load();
-            auto waveform = m_engine->m_currentWaveform.load();
-            double sampleRate = m_engine->m_sampleRate;
-            double pulseFreq = m_engine->m_pulseFrequency;
-            
-            // Check if isochronic mode
-            bool isIsochronic = (ConstantGlobals::currentToneType == 1);
-            
-            for (int i = 0; i < sampleCount; ++i) {
-                double leftSample = 0.0;
-                double rightSample = 0.0;
-                
-                if (isIsochronic) {
-                    // ISOCHRONIC: Carrier × Pulse
-                    double carrierPhaseInc = (2.0 * M_PI * leftFreq) / sampleRate;
-                    double pulsePhaseInc = (2.0 * M_PI * pulseFreq) / sampleRate;
-                    
-                    // Generate carrier
-                    double carrier = 0.0;
-                    switch (waveform) {
-                        case SINE_WAVE: carrier = sin(m_phaseLeft); break;
-                        case SQUARE_WAVE: carrier = (sin(m_phaseLeft) >= 0.0) ? 1.0 : 0.0; break;
-                        case TRIANGLE_WAVE: carrier = m_engine->calculateTriangleSample(m_phaseLeft); break;
-                        case SAWTOOTH_WAVE: carrier = m_engine->calculateSawtoothSample(m_phaseLeft); break;
-                    }
-                    
-                    // Generate pulse (on/off)
-                    double pulse = (sin(m_phaseRight) >= 0.0) ? 1.0 : 0.0;
-                    
-                    leftSample = carrier * pulse * amplitude;
-                    rightSample = leftSample; // Stereo identical
-                    
-                    // Update phases
-                    m_phaseLeft += carrierPhaseInc;
-                    m_phaseRight += pulsePhaseInc;
-                } else {
-                    // BINAURAL: Separate L/R frequencies
-                    double leftPhaseInc = (2.0 * M_PI * leftFreq) / sampleRate;
-                    double rightPhaseInc = (2.0 * M_PI * rightFreq) / sampleRate;
-                    
-                    leftSample = m_engine->calculateSample(m_phaseLeft, waveform);
-                    rightSample = m_engine->calculateSample(m_phaseRight, waveform);
-                    
-                    leftSample *= amplitude;
-                    rightSample *= amplitude;
-                    
-                    // Update phases
-                    m_phaseLeft += leftPhaseInc;
-                    m_phaseRight += rightPhaseInc;
+
+        if (!levels.isEmpty()) {
+            m_engine->m_levelTap.publish(levels.result());
+        }
+        if (tapScope) {
+            m_scopeWriter.flush(m_engine->m_scopeRing);
+        }
+        if (tapAnalysis) {
+            m_analysisWriter.flush(m_engine->m_analysisRing);
+        }
+        m_engine->m_renderPosition.store(m_control.position(), std::memory_order_relaxed);
+
+        return sampleCount * 2 * sizeof(int16_t);
+    }
+
+    qint64 writeData(const char* data, qint64 len) override {
+        Q_UNUSED(data);
+        Q_UNUSED(len);
+        return 0;
+    }
+
+private:
+    void updateLoopState(const ToneKernels::ToneParameters &params) {
+        std::atomic<int> &state = m_engine->m_loopState;
+        bool loopEnabled = m_engine->m_loopEnabled.load(std::memory_order_relaxed);
+        int current = state.load(std::memory_order_acquire);
+
+        if (current == LOOP_PLAYING) {
+            if (loopEnabled && ToneKernels::sameTone(params, m_source)) {
+                return;
+            }
+            // Pick the stream up exactly where the loop is, then apply the edit
+            m_stream.seek(m_engine->m_loopParams, m_loopOffset);
+            m_stream.update(params);
+            m_source = params;
+            m_stableFrames = 0;
+            state.store(LOOP_IDLE, std::memory_order_release);
+            return;
+        }
+
+        if (!ToneKernels::sameTone(params, m_source)) {
+            m_stream.update(params);
+            m_source = params;
+            m_stableFrames = 0;
+            // A loop requested, rendering or ready was made for the old settings
+            for (int stale : { LOOP_REQUESTED, LOOP_RENDERING, LOOP_READY }) {
+                int expected = stale;
+                state.compare_exchange_strong(expected, LOOP_IDLE, std::memory_order_acq_rel);
+            }
+            return;
+        }
+
+        if (current == LOOP_READY) {
+            if (!loopEnabled) {
+                state.store(LOOP_IDLE, std::memory_order_release);
+            } else if (m_stream.frame() >= 2 * NoiseGenerator::SETTLE_FRAMES) {
+                // Both noise paths have converged by now
+                m_loopOffset = m_stream.frame() % m_engine->m_loopFrames;
+                state.store(LOOP_PLAYING, std::memory_order_release);
+            }
+            return;
+        }
+
+        int64_t settleFrames = int64_t(m_engine->m_sampleRate) * LOOP_SETTLE_MS / 1000;
+        if (current == LOOP_IDLE && loopEnabled && m_stableFrames >= settleFrames
+            && !m_engine->m_loopRenderBusy.load(std::memory_order_acquire)) {
+            // Start the loop's epoch here, already on the loop's frequency grid
+            int64_t frames = ToneKernels::loopFrames(m_engine->m_sampleRate, LOOP_SECONDS);
+            m_stream.retune(ToneKernels::loopAligned(params, frames));
+            m_engine->m_loopParams = m_stream.parameters();
+            m_engine->m_loopFrames = frames;
+            state.store(LOOP_REQUESTED, std::memory_order_release);
+        }
+    }
+
+    void streamFrames(int16_t *samples, int frameCount, LevelAccumulator &levels,
+                      bool tapScope, bool tapAnalysis) {
+        for (int done = 0; done < frameCount; done += STREAM_CHUNK_FRAMES) {
+            int count = qMin(STREAM_CHUNK_FRAMES, frameCount - done);
+            m_stream.render(m_left, m_right, count);
+
+            int16_t *out = samples + 2 * done;
+            for (int i = 0; i < count; ++i) {
+                float left = static_cast<float>(m_left[i]);
+                float right = static_cast<float>(m_right[i]);
+                levels.add(left, right);
+
+                if (tapScope) {
+                    m_scopeWriter.push(m_engine->m_scopeRing, left, right);
                 }
-                
+                if (tapAnalysis) {
+                    m_analysisWriter.push(m_engine->m_analysisRing, left, right);
+                }
+
                 // Convert to 16-bit
-                samples[2 * i] = static_cast<int16_t>(leftSample * 32767);
-                samples[2 * i + 1] = static_cast<int16_t>(rightSample * 32767);
-                
-                // Keep phases in range
-                if (m_phaseLeft > 2.0 * M_PI) m_phaseLeft -= 2.0 * M_PI;
-                if (m_phaseRight > 2.0 * M_PI) m_phaseRight -= 2.0 * M_PI;
+                out[2 * i] = static_cast<int16_t>(m_left[i] * 32767);
+                out[2 * i + 1] = static_cast<int16_t>(m_right[i] * 32767);
             }
-            
-            return sampleCount * 2 * sizeof(int16_t);
         }
-        
-        qint64 writeData(const char* data, qint64 len) override {
-            Q_UNUSED(data);
-            Q_UNUSED(len);
-            return 0;
+
+        m_stableFrames += frameCount;
+    }
+
+    void playLoop(int16_t *samples, int frameCount, bool tapScope, bool tapAnalysis) {
+        const int16_t *loop = m_engine->m_loopSamples.data();
+        const AudioLevels *loopLevels = m_engine->m_loopLevels.data();
+        const int64_t loopFrames = m_engine->m_loopFrames;
+
+        int done = 0;
+        while (done < frameCount) {
+            int count = static_cast<int>(qMin<int64_t>(frameCount - done, loopFrames - m_loopOffset));
+            const int16_t *source = loop + 2 * m_loopOffset;
+            std::memcpy(samples + 2 * done, source, size_t(count) * 2 * sizeof(int16_t));
+
+            if (tapScope || tapAnalysis) {
+                for (int i = 0; i < count; ++i) {
+                    float left = source[2 * i] / 32767.0f;
+                    float right = source[2 * i + 1] / 32767.0f;
+                    if (tapScope) {
+                        m_scopeWriter.push(m_engine->m_scopeRing, left, right);
+                    }
+                    if (tapAnalysis) {
+                        m_analysisWriter.push(m_engine->m_analysisRing, left, right);
+                    }
+                }
+            }
+
+            // Meter readings were taken when the loop was rendered
+            int64_t firstBlock = m_loopOffset / ToneKernels::LEVEL_BLOCK_FRAMES;
+            int64_t lastBlock = (m_loopOffset + count - 1) / ToneKernels::LEVEL_BLOCK_FRAMES;
+            for (int64_t block = firstBlock; block <= lastBlock; ++block) {
+                m_engine->m_levelTap.publish(loopLevels[block]);
+            }
+
+            m_loopOffset += count;
+            if (m_loopOffset == loopFrames) {
+                m_loopOffset = 0;
+            }
+            done += count;
+        }
+    }
+
+    void applyGain(int16_t *samples, int frameCount) {
+        // Mute and fades: linear across the span (spans end where ramps do),
+        // evaluated per frame so the result does not depend on the span
+        double startGain = m_control.gain();
+        double endGain = m_control.gainAfter(frameCount);
+        if (startGain == 1.0 && endGain == 1.0) {
+            return;
+        }
+        if (startGain == 0.0 && endGain == 0.0) {
+            std::memset(samples, 0, size_t(frameCount) * 2 * sizeof(int16_t));
+            return;
         }
-        
-    private:
-        DynamicEngine* m_engine;
-        double m_phaseLeft;
-        double m_phaseRight;
-    };
-    
+
+        for (int i = 0; i < frameCount; ++i) {
+            double gain = m_control.gainAfter(i);
+            samples[2 * i] = static_cast<int16_t>(samples[2 * i] * gain);
+            samples[2 * i + 1] = static_cast<int16_t>(samples[2 * i + 1] * gain);
+        }
+    }
+
+    static constexpr int STREAM_CHUNK_FRAMES = 512;
+
+    DynamicEngine* m_engine;
+    EngineControl m_control;
+    ToneKernels::ToneStream m_stream;
+    ToneKernels::ToneParameters m_source; // Settings the stream/loop was made from
+    int64_t m_stableFrames;               // Frames streamed since the last edit
+    int64_t m_loopOffset;
+    double m_left[STREAM_CHUNK_FRAMES];
+    double m_right[STREAM_CHUNK_FRAMES];
+
+    AudioTapWriter m_scopeWriter;
+    AudioTapWriter m_analysisWriter;
+};
+
+bool DynamicEngine::startDynamicPlayback()
+{
+    if (!initializeAudioOutput()) {
+        return false;
+    }
+
     // Create and start dynamic device
-    m_dynamicDevice = new DynamicAudioDevice(this);
+    openRenderer();
     m_audioOutput->start(m_dynamicDevice);
     m_isPlaying = true;
-    
+    m_levelTimer->start();
+
     emit playbackStarted();
     return true;
 }
 
+void DynamicEngine::openRenderer()
+{
+    m_levelTap.clear();
+    m_scopeRing.clear();
+    m_analysisRing.clear();
+    // The device starts from the GUI-side copies, which already hold
+    // everything queued while stopped
+    m_commandQueue.clear();
+    m_commandOverflow = false;
+    m_renderPosition.store(0, std::memory_order_relaxed);
+    m_dynamicDevice = new DynamicAudioDevice(this);
+}
+
 void DynamicEngine::stop()
 {
     stopDynamicPlayback();
@@ -200,6 +384,9 @@ void DynamicEngine::stopDynamicPlayback()
     if (m_audioOutput) {
         m_audioOutput->stop();
     }
+
+    m_levelTimer->stop();
+    m_levelTap.clear();
     
     if (m_dynamicDevice) {
         m_dynamicDevice->close();
@@ -207,11 +394,23 @@ void DynamicEngine::stopDynamicPlayback()
         m_dynamicDevice = nullptr;
     }
     
+    // The next device starts streaming; a render still running finishes
+    // into the void (its READY is refused) and frees the slot
+    m_loopState.store(LOOP_IDLE, std::memory_order_release);
+    if (m_reportedLoop) {
+        m_reportedLoop = false;
+        emit playbackModeChanged(false);
+    }
+
     bool wasPlaying = m_isPlaying;
     m_isPlaying = false;
+    m_offline = false;
     resetPhase();
     
     if (wasPlaying) {
+        // Drop the meter back to silence
+        emit audioLevelsChanged(0.0, 0.0, 0.0, 0.0);
+        emit audioLevelChanged(0.0);
         emit playbackStopped();
     }
 }
@@ -221,6 +420,56 @@ bool DynamicEngine::isPlaying() const
     return m_isPlaying;
 }
 
+// =================== OFFLINE RENDERING ===================
+bool DynamicEngine::startOffline()
+{
+    if (m_isPlaying) {
+        emit errorOccurred("Cannot render offline while playing");
+        return false;
+    }
+
+    openRenderer();
+    m_isPlaying = true;
+    m_offline = true;
+
+    emit playbackStarted();
+    return true;
+}
+
+qint64 DynamicEngine::renderOffline(int16_t *interleaved, qint64 frameCount)
+{
+    if (!m_offline || frameCount <= 0) {
+        return 0;
+    }
+
+    // What the level timer does during playback, then wait for the loop:
+    // a request posted by the last pull is ready before this one
+    resyncCommands();
+    serviceLoopRender();
+    if (m_loopWorker.joinable()) {
+        m_loopWorker.join();
+    }
+
+    return static_cast<DynamicAudioDevice*>(m_dynamicDevice)->pull(interleaved, frameCount);
+}
+
+bool DynamicEngine::isOffline() const
+{
+    return m_offline;
+}
+
+// =================== TONE MODE ===================
+void DynamicEngine::setToneMode(ToneMode mode)
+{
+    m_toneMode = mode;
+    postParameter(EngineCommand::TONE_MODE, mode);
+}
+
+DynamicEngine::ToneMode DynamicEngine::getToneMode() const
+{
+    return m_toneMode;
+}
+
 // =================== FREQUENCY CONTROL ===================
 void DynamicEngine::setLeftFrequency(double hz)
 {
@@ -230,14 +479,14 @@ void DynamicEngine::setLeftFrequency(double hz)
     }
 
     m_leftFrequency = hz;
-    // DYNAMIC: No buffer regeneration needed
+    postParameter(EngineCommand::LEFT_FREQUENCY, hz);
     emit leftFrequencyChanged(hz);
     emit beatFrequencyChanged(getBeatFrequency());
 }
 
 void DynamicEngine::setRightFrequency(double hz)
 {
-    if (ConstantGlobals::currentToneType == 1) {
+    if (m_toneMode == ISOCHRONIC_TONE) {
         // Isochronic mode - use m_rightFrequency for other purposes if needed
     } else {
         if (!validateFrequency(hz)) {
@@ -247,6 +496,7 @@ void DynamicEngine::setRightFrequency(double hz)
     }
 
     m_rightFrequency = hz;
+    postParameter(EngineCommand::RIGHT_FREQUENCY, hz);
     emit rightFrequencyChanged(hz);
     emit beatFrequencyChanged(getBeatFrequency());
 }
@@ -288,7 +538,7 @@ void DynamicEngine::setWaveform(Waveform type)
 {
     if (m_currentWaveform != type) {
         m_currentWaveform = type;
-        // DYNAMIC: No buffer regeneration needed
+        postParameter(EngineCommand::WAVEFORM, type);
         emit waveformChanged(type);
     }
 }
@@ -306,7 +556,7 @@ void DynamicEngine::setAmplitude(double amplitude)
     }
 
     m_amplitude = amplitude;
-    // DYNAMIC: No buffer regeneration needed
+    postParameter(EngineCommand::AMPLITUDE, amplitude);
 }
 
 void DynamicEngine::setVolume(double volume)
@@ -378,7 +628,7 @@ bool DynamicEngine::isEngineActive() const
     return m_isPlaying;
 }
 
-QAudioSink *DynamicEngine::audioOutput() const
+OutputSink *DynamicEngine::audioOutput() const
 {
     return m_audioOutput;
 }
@@ -391,7 +641,34 @@ void DynamicEngine::setPulseFrequency(double hz)
     }
 
     m_pulseFrequency = hz;
-    // DYNAMIC: No buffer regeneration needed
+    postParameter(EngineCommand::PULSE_FREQUENCY, hz);
+}
+
+void DynamicEngine::setNoiseType(NoiseGenerator::NoiseType type)
+{
+    m_noiseType = type;
+    postParameter(EngineCommand::NOISE_TYPE, type);
+}
+
+NoiseGenerator::NoiseType DynamicEngine::getNoiseType() const
+{
+    return m_noiseType;
+}
+
+void DynamicEngine::setNoiseLevel(double level)
+{
+    if (!validateAmplitude(level)) {
+        emit errorOccurred(QString("Invalid noise level: %1").arg(level));
+        return;
+    }
+
+    m_noiseLevel = level;
+    postParameter(EngineCommand::NOISE_LEVEL, level);
+}
+
+double DynamicEngine::getNoiseLevel() const
+{
+    return m_noiseLevel;
 }
 
 QBuffer *DynamicEngine::audioBuffer() const
@@ -463,7 +740,7 @@ double DynamicEngine::calculateSineSample(double phase)
 
 double DynamicEngine::calculateSquareSample(double phase)
 {
-    if (ConstantGlobals::currentToneType == 1) {
+    if (m_toneMode == ISOCHRONIC_TONE) {
         // Isochronic: On/Off (0 or 1)
         return (std::sin(phase) >= 0.0) ? 1.0 : 0.0;
     } else {
@@ -503,9 +780,295 @@ void DynamicEngine::resetPhase()
     m_phaseRight = 0.0;
 }
 
+// =================== SCHEDULED CONTROL ===================
+void DynamicEngine::postCommand(const EngineCommand &command)
+{
+    if (!m_isPlaying) {
+        return; // The next device starts from the GUI-side copies
+    }
+    // After a refused push everything waits for the resync, which keeps
+    // the renderer from applying later commands before earlier ones
+    if (m_commandOverflow || !m_commandQueue.push(command)) {
+        if (!m_commandOverflow) {
+            BINAURAL_TRACE_INSTANT("audio", "DynamicEngine::commandQueueFull");
+        }
+        m_commandOverflow = true;
+    }
+}
+
+void DynamicEngine::postParameter(EngineCommand::Parameter parameter, double value)
+{
+    EngineCommand command;
+    command.type = EngineCommand::SET_PARAMETER;
+    command.parameter = parameter;
+    command.value = value;
+    postCommand(command);
+}
+
+void DynamicEngine::resyncCommands()
+{
+    // One set per parameter plus mute and gain: the burst that overflowed
+    // collapses into the state it was heading for
+    if (!m_commandOverflow || m_commandQueue.freeSpace() < EngineCommand::PARAMETER_COUNT + 2) {
+        return;
+    }
+    m_commandOverflow = false;
+
+    ToneKernels::ToneParameters params = toneParameters();
+    postParameter(EngineCommand::LEFT_FREQUENCY, params.leftFrequency);
+    postParameter(EngineCommand::RIGHT_FREQUENCY, params.rightFrequency);
+    postParameter(EngineCommand::PULSE_FREQUENCY, params.pulseFrequency);
+    postParameter(EngineCommand::AMPLITUDE, params.amplitude);
+    postParameter(EngineCommand::NOISE_LEVEL, params.noiseLevel);
+    postParameter(EngineCommand::WAVEFORM, m_currentWaveform);
+    postParameter(EngineCommand::TONE_MODE, m_toneMode);
+    postParameter(EngineCommand::NOISE_TYPE, m_noiseType);
+
+    EngineCommand mute;
+    mute.type = EngineCommand::SET_MUTED;
+    mute.value = m_muted ? 1.0 : 0.0;
+    postCommand(mute);
+
+    EngineCommand fade;
+    fade.type = EngineCommand::FADE_GAIN;
+    fade.value = m_fadeGain;
+    postCommand(fade);
+}
+
+bool DynamicEngine::validateParameter(EngineCommand::Parameter parameter, double value)
+{
+    switch (parameter) {
+    case EngineCommand::LEFT_FREQUENCY:
+        return validateFrequency(value);
+    case EngineCommand::RIGHT_FREQUENCY:
+        return m_toneMode == ISOCHRONIC_TONE || validateFrequency(value);
+    case EngineCommand::PULSE_FREQUENCY:
+        return value >= 0.5 && value <= 100.0;
+    case EngineCommand::AMPLITUDE:
+    case EngineCommand::NOISE_LEVEL:
+        return validateAmplitude(value);
+    case EngineCommand::WAVEFORM:
+        return value >= SINE_WAVE && value <= SAWTOOTH_WAVE;
+    case EngineCommand::TONE_MODE:
+        return value >= BINAURAL_TONE && value <= GENERATOR_TONE;
+    case EngineCommand::NOISE_TYPE:
+        return value >= NoiseGenerator::NO_NOISE && value <= NoiseGenerator::BROWN_NOISE;
+    default:
+        return false;
+    }
+}
+
+void DynamicEngine::mirrorParameter(EngineCommand::Parameter parameter, double value)
+{
+    // Where a ramp or scheduled change ends up, so a restart starts there
+    switch (parameter) {
+    case EngineCommand::LEFT_FREQUENCY: m_leftFrequency = value; break;
+    case EngineCommand::RIGHT_FREQUENCY: m_rightFrequency = value; break;
+    case EngineCommand::PULSE_FREQUENCY: m_pulseFrequency = value; break;
+    case EngineCommand::AMPLITUDE: m_amplitude = value; break;
+    case EngineCommand::NOISE_LEVEL: m_noiseLevel = value; break;
+    case EngineCommand::WAVEFORM: m_currentWaveform = static_cast<Waveform>(int(value)); break;
+    case EngineCommand::TONE_MODE: m_toneMode = static_cast<ToneMode>(int(value)); break;
+    case EngineCommand::NOISE_TYPE: m_noiseType = static_cast<NoiseGenerator::NoiseType>(int(value)); break;
+    default: break;
+    }
+}
+
+qint64 DynamicEngine::framesForMs(int ms) const
+{
+    return qint64(m_sampleRate) * qMax(0, ms) / 1000;
+}
+
+void DynamicEngine::rampParameter(EngineCommand::Parameter parameter, double target, int durationMs)
+{
+    if (!validateParameter(parameter, target)) {
+        emit errorOccurred(QString("Invalid ramp target: %1").arg(target));
+        return;
+    }
+
+    mirrorParameter(parameter, target);
+    EngineCommand command;
+    command.type = EngineCommand::RAMP_PARAMETER;
+    command.parameter = parameter;
+    command.value = target;
+    command.durationFrames = framesForMs(durationMs);
+    postCommand(command);
+}
+
+void DynamicEngine::scheduleParameter(EngineCommand::Parameter parameter, double value, qint64 frame)
+{
+    if (!validateParameter(parameter, value)) {
+        emit errorOccurred(QString("Invalid scheduled value: %1").arg(value));
+        return;
+    }
+
+    mirrorParameter(parameter, value);
+    EngineCommand command;
+    command.type = EngineCommand::SET_PARAMETER;
+    command.parameter = parameter;
+    command.value = value;
+    command.frame = frame;
+    postCommand(command);
+}
+
+qint64 DynamicEngine::renderPosition() const
+{
+    return m_renderPosition.load(std::memory_order_relaxed);
+}
+
+void DynamicEngine::setMuted(bool muted)
+{
+    m_muted = muted;
+    EngineCommand command;
+    command.type = EngineCommand::SET_MUTED;
+    command.value = muted ? 1.0 : 0.0;
+    postCommand(command);
+}
+
+bool DynamicEngine::isMuted() const
+{
+    return m_muted;
+}
+
+void DynamicEngine::fadeTo(double gain, int durationMs)
+{
+    if (!validateAmplitude(gain)) {
+        emit errorOccurred(QString("Invalid fade gain: %1").arg(gain));
+        return;
+    }
+
+    m_fadeGain = gain;
+    EngineCommand command;
+    command.type = EngineCommand::FADE_GAIN;
+    command.value = gain;
+    command.durationFrames = framesForMs(durationMs);
+    postCommand(command);
+}
+
+double DynamicEngine::getFadeGain() const
+{
+    return m_fadeGain;
+}
+
+// =================== HYBRID PLAYBACK ===================
+void DynamicEngine::setLoopPlaybackEnabled(bool enabled)
+{
+    m_loopEnabled.store(enabled, std::memory_order_relaxed);
+    // DYNAMIC: the audio side leaves or declines loops on its next block
+}
+
+bool DynamicEngine::isLoopPlaybackEnabled() const
+{
+    return m_loopEnabled.load(std::memory_order_relaxed);
+}
+
+bool DynamicEngine::isPlayingLoop() const
+{
+    return m_loopState.load(std::memory_order_acquire) == LOOP_PLAYING;
+}
+
+ToneKernels::ToneParameters DynamicEngine::toneParameters() const
+{
+    ToneKernels::ToneParameters params;
+    params.mode = (m_toneMode == ISOCHRONIC_TONE) ? ToneKernels::ISOCHRONIC_MODE
+                                                  : ToneKernels::BINAURAL_MODE;
+    params.waveform = m_currentWaveform;
+    params.leftFrequency = m_leftFrequency;
+    params.rightFrequency = m_rightFrequency;
+    params.pulseFrequency = m_pulseFrequency;
+    params.amplitude = m_amplitude;
+    params.sampleRate = m_sampleRate;
+    params.noiseType = m_noiseType;
+    params.noiseLevel = static_cast<float>(m_noiseLevel);
+    return params;
+}
+
+void DynamicEngine::serviceLoopRender()
+{
+    // Claim the slot before taking the request, so the audio side cannot
+    // post a new one while the parameters are copied
+    bool idle = false;
+    if (m_loopRenderBusy.compare_exchange_strong(idle, true, std::memory_order_acq_rel)) {
+        int expected = LOOP_REQUESTED;
+        if (m_loopState.compare_exchange_strong(expected, LOOP_RENDERING, std::memory_order_acq_rel)) {
+            if (m_loopWorker.joinable()) {
+                m_loopWorker.join(); // Already finished: the slot was free
+            }
+
+            ToneKernels::ToneParameters params = m_loopParams;
+            int64_t frames = m_loopFrames;
+            m_loopWorker = std::thread([this, params, frames]() {
+                BINAURAL_TRACE_SCOPE("audio", "DynamicEngine::renderLoop", "frames", frames);
+                m_loopSamples.resize(size_t(frames) * 2);
+                m_loopLevels.resize(size_t(ToneKernels::levelCount(frames)));
+                ToneKernels::renderLoop(params, frames, m_loopSamples.data(), m_loopLevels.data());
+
+                // Refused when the settings changed while rendering
+                int rendering = LOOP_RENDERING;
+                m_loopState.compare_exchange_strong(rendering, LOOP_READY, std::memory_order_acq_rel);
+                m_loopRenderBusy.store(false, std::memory_order_release);
+            });
+        } else {
+            m_loopRenderBusy.store(false, std::memory_order_release);
+        }
+    }
+
+    bool playingLoop = isPlayingLoop();
+    if (playingLoop != m_reportedLoop) {
+        m_reportedLoop = playingLoop;
+        emit playbackModeChanged(playingLoop);
+    }
+}
+
+// =================== VISUALIZER TAP ===================
+void DynamicEngine::setScopeEnabled(bool enabled)
+{
+    m_scopeEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool DynamicEngine::isScopeEnabled() const
+{
+    return m_scopeEnabled.load(std::memory_order_relaxed);
+}
+
+const AudioTapRing *DynamicEngine::scopeRing() const
+{
+    return &m_scopeRing;
+}
+
+int DynamicEngine::scopeSampleRate() const
+{
+    return m_sampleRate / SCOPE_DECIMATION;
+}
+
+void DynamicEngine::setAnalysisEnabled(bool enabled)
+{
+    m_analysisEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool DynamicEngine::isAnalysisEnabled() const
+{
+    return m_analysisEnabled.load(std::memory_order_relaxed);
+}
+
+const AudioTapRing *DynamicEngine::analysisRing() const
+{
+    return &m_analysisRing;
+}
+
+// =================== LEVEL METERING ===================
+void DynamicEngine::pollAudioLevels()
+{
+    AudioLevels levels = m_levelTap.take();
+    emit audioLevelsChanged(levels.peakLeft, levels.peakRight,
+                            levels.rmsLeft, levels.rmsRight);
+    emit audioLevelChanged(qMax(levels.peakLeft, levels.peakRight));
+}
+
 // =================== AUDIO STATE HANDLER ===================
 void DynamicEngine::handleAudioStateChanged(QAudio::State state)
 {
+    BINAURAL_TRACE_INSTANT("audio", "DynamicEngine::sinkStateChanged", "state", state);
     
     switch (state) {
         case QAudio::ActiveState:
@@ -2,13 +2,22 @@
 #define DYNAMICENGINE_H
 
 #include <QObject>
-#include <QAudioSink>
 #include <QAudioFormat>
 #include <QBuffer>
 #include <QIODevice>
 #include <QMediaDevices>
 #include <atomic>
 #include <cmath>
+#include <thread>
+#include <vector>
+#include "noisegenerator.h"
+#include "audiolevels.h"
+#include "audiotapring.h"
+#include "tonekernels.h"
+#include "enginecommandqueue.h"
+#include "outputsink.h"
+
+class QTimer;
 
 class DynamicEngine : public QObject
 {
@@ -24,6 +33,14 @@ public:
     };
     Q_ENUM(Waveform)
 
+    // Same values as ConstantGlobals::currentToneType
+    enum ToneMode {
+        BINAURAL_TONE = 0,
+        ISOCHRONIC_TONE = 1,
+        GENERATOR_TONE = 2
+    };
+    Q_ENUM(ToneMode)
+
     // EXACT SAME constructor
     explicit DynamicEngine(QObject *parent = nullptr);
     ~DynamicEngine();
@@ -33,6 +50,11 @@ public:
     void stop();
     bool isPlaying() const;
 
+    // =================== TONE MODE ===================
+    // Owned by the instance, so engines in different modes can run side by side
+    void setToneMode(ToneMode mode);
+    ToneMode getToneMode() const;
+
     // =================== FREQUENCY CONTROL ===================
     void setLeftFrequency(double hz);
     void setRightFrequency(double hz);
@@ -65,11 +87,65 @@ public:
 
     bool isEngineActive() const;
 
-    QAudioSink *audioOutput() const;
+    OutputSink *audioOutput() const;
     void setPulseFrequency(double newPulseFrequency);
     QBuffer *audioBuffer() const; // Returns nullptr for dynamic
     void forceBufferRegeneration(); // No-op for dynamic
 
+    // =================== NOISE LAYER ===================
+    void setNoiseType(NoiseGenerator::NoiseType type);
+    NoiseGenerator::NoiseType getNoiseType() const;
+
+    void setNoiseLevel(double level); // 0.0-1.0 of full scale
+    double getNoiseLevel() const;
+
+    // =================== SCHEDULED CONTROL ===================
+    // Every change reaches the renderer as a command on a lock-free queue,
+    // drained at block boundaries and applied at its render frame. The
+    // setters above post immediate sets; these add glides, scheduling, and
+    // a click-free mute and fade applied inside the renderer.
+    void rampParameter(EngineCommand::Parameter parameter, double target, int durationMs);
+    void scheduleParameter(EngineCommand::Parameter parameter, double value, qint64 frame);
+    qint64 renderPosition() const; // Frame the renderer has reached; schedule relative to it
+
+    void setMuted(bool muted);
+    bool isMuted() const;
+    void fadeTo(double gain, int durationMs); // Output gain 0.0-1.0 on top of the volume
+    double getFadeGain() const;
+
+    // =================== HYBRID PLAYBACK ===================
+    // While the settings are still the engine plays a prerendered loop
+    // (a memcpy per block); while they are being edited or automated it
+    // synthesizes in real time, and it returns to a loop once they settle.
+    // Loops are rendered off the audio path from the same kernels as the
+    // stream, so switching either way is seamless. Loop frequencies sit on
+    // a grid of 1/LOOP_SECONDS Hz, at most half a step from the setting.
+    void setLoopPlaybackEnabled(bool enabled);
+    bool isLoopPlaybackEnabled() const;
+    bool isPlayingLoop() const;
+
+    // =================== OFFLINE RENDERING ===================
+    // Runs the playback renderer without an audio sink (tests, export).
+    // renderOffline() pulls frames the way the sink would and finishes any
+    // loop render it triggers first, so the output never depends on timing.
+    // stop() ends the session.
+    bool startOffline();
+    qint64 renderOffline(int16_t *interleaved, qint64 frameCount);
+    bool isOffline() const;
+
+    // =================== VISUALIZER TAP ===================
+    // Decimated copy of the output for the oscilloscope; costs nothing
+    // in readData while disabled
+    void setScopeEnabled(bool enabled);
+    bool isScopeEnabled() const;
+    const AudioTapRing *scopeRing() const;
+    int scopeSampleRate() const;
+
+    // Full-rate copy of the output for the spectrum analyzer
+    void setAnalysisEnabled(bool enabled);
+    bool isAnalysisEnabled() const;
+    const AudioTapRing *analysisRing() const;
+
 signals:
     // EXACT SAME signals
     void playbackStarted();
@@ -85,9 +161,15 @@ signals:
     void bufferUnderrun();
     void parametersUpdated();
     void audioLevelChanged(double peakLevel);
+    void audioLevelsChanged(double peakLeft, double peakRight,
+                            double rmsLeft, double rmsRight);
+    void playbackModeChanged(bool playingLoop);
 
 private slots:
     void handleAudioStateChanged(QAudio::State state);
+    void pollAudioLevels();
+    void serviceLoopRender();
+    void resyncCommands();
 
 private:
     // =================== PRIVATE METHODS ===================
@@ -115,29 +197,51 @@ private:
     // Dynamic-specific methods
     bool startDynamicPlayback();
     void stopDynamicPlayback();
+    void openRenderer();
+    ToneKernels::ToneParameters toneParameters() const; // Snapshot for the renderer
+    void postCommand(const EngineCommand &command);
+    void postParameter(EngineCommand::Parameter parameter, double value);
+    bool validateParameter(EngineCommand::Parameter parameter, double value);
+    void mirrorParameter(EngineCommand::Parameter parameter, double value);
+    qint64 framesForMs(int ms) const;
 
     // =================== MEMBER VARIABLES ===================
     // EXACT SAME variables (some unused in dynamic)
-    QAudioSink *m_audioOutput;
+    OutputSink *m_audioOutput;
     QBuffer *m_audioBuffer;
     QAudioFormat m_audioFormat;
 
-    std::atomic<double> m_leftFrequency;
-    std::atomic<double> m_rightFrequency;
-    std::atomic<double> m_amplitude;
-    std::atomic<double> m_outputVolume;
-    std::atomic<Waveform> m_currentWaveform;
+    // GUI-side copies of the settings: the renderer never reads these, it
+    // gets changes through m_commandQueue and starts from them on start()
+    double m_leftFrequency;
+    double m_rightFrequency;
+    double m_amplitude;
+    double m_outputVolume;
+    Waveform m_currentWaveform;
+    ToneMode m_toneMode;
 
     double m_phaseLeft;
     double m_phaseRight;
 
     std::atomic<bool> m_isPlaying;
-    std::atomic<bool> m_parametersChanged;
+    bool m_offline; // Playing without a sink: renderOffline() pulls
 
     int m_sampleRate;
     qint64 m_bufferDurationMs;
     double m_pulseFrequency;
 
+    NoiseGenerator::NoiseType m_noiseType;
+    double m_noiseLevel;
+
+    bool m_muted;
+    double m_fadeGain;
+
+    // GUI -> renderer control
+    EngineCommandQueue m_commandQueue;
+    bool m_commandOverflow;               // A push was refused: resync pending
+    std::atomic<int64_t> m_renderPosition; // Frames rendered by the current device
+    static constexpr int COMMAND_QUEUE_CAPACITY = 1024;
+
     // Constants (EXACT SAME)
     static constexpr double MIN_FREQUENCY = 20.0;
     static constexpr double MAX_FREQUENCY = 20000.0;
@@ -145,10 +249,51 @@ private:
     static constexpr double MAX_AMPLITUDE = 1.0;
     static constexpr double DEFAULT_AMPLITUDE = 0.3;
     static constexpr double DEFAULT_VOLUME = 0.15;
+    static constexpr double DEFAULT_NOISE_LEVEL = 0.1;
 
     // Dynamic-specific variables
     QIODevice* m_dynamicDevice;
     class DynamicAudioDevice;
+
+    // Level metering (published by the renderer, polled at ~30 Hz)
+    AudioLevelTap m_levelTap;
+    QTimer* m_levelTimer;
+    static constexpr int LEVEL_POLL_INTERVAL_MS = 33;
+
+    // Visualizer tap
+    AudioTapRing m_scopeRing;
+    std::atomic<bool> m_scopeEnabled;
+    static constexpr int SCOPE_DECIMATION = 2;
+    static constexpr int SCOPE_RING_FRAMES = 8192;
+
+    // Loop slot, handed between the audio side and one render worker:
+    // IDLE -> REQUESTED (audio) -> RENDERING (GUI starts the worker)
+    // -> READY (worker) -> PLAYING (audio) -> IDLE. The audio side drops
+    // any stage back to IDLE when the settings change; the buffers are only
+    // written while no loop is PLAYING.
+    enum LoopState {
+        LOOP_IDLE,
+        LOOP_REQUESTED,
+        LOOP_RENDERING,
+        LOOP_READY,
+        LOOP_PLAYING
+    };
+    std::atomic<int> m_loopState;
+    std::atomic<bool> m_loopEnabled;
+    std::atomic<bool> m_loopRenderBusy;
+    ToneKernels::ToneParameters m_loopParams; // Written by the audio side before REQUESTED
+    int64_t m_loopFrames;
+    std::vector<int16_t> m_loopSamples;
+    std::vector<AudioLevels> m_loopLevels;
+    std::thread m_loopWorker;
+    bool m_reportedLoop;
+    static constexpr int LOOP_SETTLE_MS = 1500;
+    static constexpr double LOOP_SECONDS = 90.0;
+
+    // Analyzer tap (~1.5 s at 44.1 kHz, drained a few times per second)
+    AudioTapRing m_analysisRing;
+    std::atomic<bool> m_analysisEnabled;
+    static constexpr int ANALYSIS_RING_FRAMES = 65536;
 };
 
 #endif // DYNAMICENGINE_H
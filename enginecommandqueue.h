@@ -0,0 +1,107 @@
+#ifndef ENGINECOMMANDQUEUE_H
+#define ENGINECOMMANDQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// One control message from the GUI to the renderer. Commands carry the
+// render frame they act at, so changes land sample-accurately no matter
+// when the sink pulls the next block.
+struct EngineCommand
+{
+    enum Type : uint8_t {
+        SET_PARAMETER,  // parameter = value
+        RAMP_PARAMETER, // parameter glides linearly to value over durationFrames
+        SET_MUTED,      // value != 0 mutes (short declick ramp)
+        FADE_GAIN       // output gain glides to value over durationFrames
+    };
+
+    enum Parameter : uint8_t {
+        LEFT_FREQUENCY,
+        RIGHT_FREQUENCY,
+        PULSE_FREQUENCY,
+        AMPLITUDE,
+        NOISE_LEVEL,
+        // Discrete: ramps on these act as sets
+        WAVEFORM,
+        TONE_MODE,
+        NOISE_TYPE,
+        PARAMETER_COUNT
+    };
+
+    Type type = SET_PARAMETER;
+    Parameter parameter = LEFT_FREQUENCY;
+    double value = 0.0;
+    int64_t frame = 0;          // Acts at this render frame; past frames mean "next block"
+    int64_t durationFrames = 0; // Ramps and fades
+    uint64_t sequence = 0;      // Stamped on push: ties at one frame keep posting order
+};
+
+// Bounded single-producer / single-consumer queue of commands. The GUI
+// pushes, the renderer pops at block boundaries; neither side ever waits or
+// allocates. A full queue refuses the push and the producer resynchronizes
+// later (see DynamicEngine::resyncCommands()).
+class EngineCommandQueue
+{
+public:
+    explicit EngineCommandQueue(int capacity = 1024)
+    {
+        int size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        m_commands.resize(static_cast<size_t>(size));
+        m_mask = static_cast<uint64_t>(size - 1);
+    }
+
+    int capacity() const { return static_cast<int>(m_mask + 1); }
+
+    // Producer
+    bool push(EngineCommand command)
+    {
+        uint64_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) > m_mask) {
+            return false;
+        }
+        command.sequence = m_nextSequence++;
+        m_commands[head & m_mask] = command;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Producer: slots free right now (the consumer may free more meanwhile)
+    int freeSpace() const
+    {
+        uint64_t used = m_head.load(std::memory_order_relaxed) - m_tail.load(std::memory_order_acquire);
+        return capacity() - static_cast<int>(used);
+    }
+
+    // Consumer
+    bool pop(EngineCommand &command)
+    {
+        uint64_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        command = m_commands[tail & m_mask];
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Drop everything; only while no consumer is running
+    void clear()
+    {
+        m_tail.store(m_head.load(std::memory_order_relaxed), std::memory_order_release);
+    }
+
+private:
+    std::vector<EngineCommand> m_commands;
+    uint64_t m_mask = 0;
+    uint64_t m_nextSequence = 0; // Producer only
+    std::atomic<uint64_t> m_head{0};
+    std::atomic<uint64_t> m_tail{0};
+};
+
+#endif // ENGINECOMMANDQUEUE_H
@@ -0,0 +1,210 @@
+#include "enginecontrol.h"
+
+#include <algorithm>
+
+// =================== RAMPS ===================
+double EngineControl::Ramp::valueAt(int64_t frame) const
+{
+    if (frame >= end()) {
+        return to;
+    }
+    double t = static_cast<double>(frame - start) / static_cast<double>(length);
+    return from + (to - from) * t;
+}
+
+void EngineControl::startRamp(Ramp &ramp, double &value, double target, int64_t start, int64_t length)
+{
+    if (length <= 0) {
+        ramp.active = false;
+        value = target;
+        return;
+    }
+    ramp.active = true;
+    ramp.from = value;
+    ramp.to = target;
+    ramp.start = start;
+    ramp.length = length;
+}
+
+// =================== STATE ===================
+EngineControl::EngineControl()
+    : m_fadeGain(1.0)
+    , m_muteGain(1.0)
+    , m_frame(0)
+    , m_pendingHead(0)
+    , m_pendingCount(0)
+{
+    reset(ToneKernels::ToneParameters(), false, 1.0);
+}
+
+void EngineControl::reset(const ToneKernels::ToneParameters &params, bool muted, double gain)
+{
+    m_base = params;
+    m_values[EngineCommand::LEFT_FREQUENCY] = params.leftFrequency;
+    m_values[EngineCommand::RIGHT_FREQUENCY] = params.rightFrequency;
+    m_values[EngineCommand::PULSE_FREQUENCY] = params.pulseFrequency;
+    m_values[EngineCommand::AMPLITUDE] = params.amplitude;
+    m_values[EngineCommand::NOISE_LEVEL] = params.noiseLevel;
+    m_values[EngineCommand::WAVEFORM] = params.waveform;
+    m_values[EngineCommand::TONE_MODE] = params.mode;
+    m_values[EngineCommand::NOISE_TYPE] = params.noiseType;
+    for (Ramp &ramp : m_ramps) {
+        ramp.active = false;
+    }
+
+    m_fadeGain = gain;
+    m_fadeRamp.active = false;
+    m_muteGain = muted ? 0.0 : 1.0;
+    m_muteRamp.active = false;
+
+    m_frame = 0;
+    m_pendingHead = 0;
+    m_pendingCount = 0;
+}
+
+ToneKernels::ToneParameters EngineControl::parameters() const
+{
+    ToneKernels::ToneParameters params = m_base;
+    params.leftFrequency = m_values[EngineCommand::LEFT_FREQUENCY];
+    params.rightFrequency = m_values[EngineCommand::RIGHT_FREQUENCY];
+    params.pulseFrequency = m_values[EngineCommand::PULSE_FREQUENCY];
+    params.amplitude = m_values[EngineCommand::AMPLITUDE];
+    params.noiseLevel = static_cast<float>(m_values[EngineCommand::NOISE_LEVEL]);
+    params.waveform = static_cast<int>(m_values[EngineCommand::WAVEFORM]);
+    // Tone mode 2 (generator) sounds like binaural
+    params.mode = static_cast<int>(m_values[EngineCommand::TONE_MODE]) == ToneKernels::ISOCHRONIC_MODE
+                      ? ToneKernels::ISOCHRONIC_MODE : ToneKernels::BINAURAL_MODE;
+    params.noiseType = static_cast<NoiseGenerator::NoiseType>(static_cast<int>(m_values[EngineCommand::NOISE_TYPE]));
+    return params;
+}
+
+double EngineControl::gainAt(int64_t frame) const
+{
+    double fade = m_fadeRamp.active ? m_fadeRamp.valueAt(frame) : m_fadeGain;
+    double mute = m_muteRamp.active ? m_muteRamp.valueAt(frame) : m_muteGain;
+    return fade * mute;
+}
+
+// =================== COMMANDS ===================
+void EngineControl::collect(EngineCommandQueue &queue)
+{
+    if (m_pendingHead > 0) {
+        std::copy(m_pending + m_pendingHead, m_pending + m_pendingHead + m_pendingCount, m_pending);
+        m_pendingHead = 0;
+    }
+
+    EngineCommand command;
+    for (;;) {
+        if (m_pendingCount == MAX_PENDING) {
+            // Bursts of immediate commands are applied as they come, in
+            // order; only a list full of future ones leaves the rest queued
+            applyDue();
+            if (m_pendingCount == MAX_PENDING) {
+                break;
+            }
+            std::copy(m_pending + m_pendingHead, m_pending + m_pendingHead + m_pendingCount, m_pending);
+            m_pendingHead = 0;
+        }
+        if (!queue.pop(command)) {
+            break;
+        }
+        command.frame = std::max(command.frame, m_frame); // Late means now
+
+        // Insertion from the back: commands nearly always arrive in order
+        int index = m_pendingCount;
+        while (index > 0) {
+            const EngineCommand &previous = m_pending[index - 1];
+            if (previous.frame < command.frame
+                || (previous.frame == command.frame && previous.sequence < command.sequence)) {
+                break;
+            }
+            m_pending[index] = previous;
+            --index;
+        }
+        m_pending[index] = command;
+        ++m_pendingCount;
+    }
+}
+
+void EngineControl::applyDue()
+{
+    while (m_pendingCount > 0 && m_pending[m_pendingHead].frame <= m_frame) {
+        apply(m_pending[m_pendingHead]);
+        ++m_pendingHead;
+        --m_pendingCount;
+    }
+}
+
+void EngineControl::apply(const EngineCommand &command)
+{
+    switch (command.type) {
+    case EngineCommand::SET_PARAMETER:
+        m_ramps[command.parameter].active = false;
+        m_values[command.parameter] = command.value;
+        break;
+    case EngineCommand::RAMP_PARAMETER: {
+        bool discrete = command.parameter >= EngineCommand::WAVEFORM;
+        startRamp(m_ramps[command.parameter], m_values[command.parameter], command.value,
+                  m_frame, discrete ? 0 : command.durationFrames);
+        break;
+    }
+    case EngineCommand::SET_MUTED: {
+        int64_t declick = static_cast<int64_t>(m_base.sampleRate) * MUTE_RAMP_MS / 1000;
+        // Continue from wherever a running mute ramp has got to
+        m_muteGain = m_muteRamp.active ? m_muteRamp.valueAt(m_frame) : m_muteGain;
+        startRamp(m_muteRamp, m_muteGain, command.value != 0.0 ? 0.0 : 1.0, m_frame, declick);
+        break;
+    }
+    case EngineCommand::FADE_GAIN:
+        m_fadeGain = m_fadeRamp.active ? m_fadeRamp.valueAt(m_frame) : m_fadeGain;
+        startRamp(m_fadeRamp, m_fadeGain, std::max(0.0, command.value), m_frame, command.durationFrames);
+        break;
+    }
+}
+
+// =================== CLOCK ===================
+int EngineControl::spanFrames(int maxFrames) const
+{
+    int64_t span = maxFrames;
+    if (m_pendingCount > 0) {
+        span = std::min(span, m_pending[m_pendingHead].frame - m_frame);
+    }
+    for (const Ramp &ramp : m_ramps) {
+        if (ramp.active) {
+            // Steps count from the ramp start, not the block, so the output
+            // does not depend on how the sink sizes its pulls
+            span = std::min<int64_t>(span, RAMP_STEP_FRAMES - (m_frame - ramp.start) % RAMP_STEP_FRAMES);
+            span = std::min(span, ramp.end() - m_frame);
+        }
+    }
+    // Gain is interpolated per sample, so only its ramp ends split a span
+    if (m_fadeRamp.active) {
+        span = std::min(span, m_fadeRamp.end() - m_frame);
+    }
+    if (m_muteRamp.active) {
+        span = std::min(span, m_muteRamp.end() - m_frame);
+    }
+    return static_cast<int>(std::max<int64_t>(1, span));
+}
+
+void EngineControl::advance(int frames)
+{
+    m_frame += frames;
+
+    for (int p = 0; p < EngineCommand::PARAMETER_COUNT; ++p) {
+        Ramp &ramp = m_ramps[p];
+        if (ramp.active) {
+            ramp.active = m_frame < ramp.end();
+            m_values[p] = ramp.active ? ramp.valueAt(m_frame - (m_frame - ramp.start) % RAMP_STEP_FRAMES)
+                                      : ramp.to;
+        }
+    }
+    if (m_fadeRamp.active) {
+        m_fadeGain = m_fadeRamp.valueAt(m_frame);
+        m_fadeRamp.active = m_frame < m_fadeRamp.end();
+    }
+    if (m_muteRamp.active) {
+        m_muteGain = m_muteRamp.valueAt(m_frame);
+        m_muteRamp.active = m_frame < m_muteRamp.end();
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef ENGINECONTROL_H
+#define ENGINECONTROL_H
+
+#include <cstdint>
+#include "enginecommandqueue.h"
+#include "tonekernels.h"
+
+// Renderer-side state driven by an EngineCommandQueue (Qt-free).
+//
+// At each block boundary collect() moves queued commands into a pending
+// list ordered by (frame, sequence). The renderer then walks the block in
+// spans: applyDue() applies everything due at the current frame in that
+// order, spanFrames() says how far it may render before the next command or
+// ramp step, and advance() moves the clock. A burst of GUI events therefore
+// collapses into the state after the last of them, applied in one
+// deterministic order, and the synthesis sees a single change per span.
+class EngineControl
+{
+public:
+    static constexpr int MAX_PENDING = 256;
+    static constexpr int RAMP_STEP_FRAMES = 32; // Parameter ramps move in steps this long
+    static constexpr int MUTE_RAMP_MS = 10;
+
+    EngineControl();
+
+    // Start from a settings snapshot at frame 0
+    void reset(const ToneKernels::ToneParameters &params, bool muted, double gain);
+
+    void collect(EngineCommandQueue &queue);
+    void applyDue();
+    int spanFrames(int maxFrames) const;
+    void advance(int frames);
+
+    int64_t position() const { return m_frame; }
+
+    // Synthesis settings at the current frame
+    ToneKernels::ToneParameters parameters() const;
+
+    // Output gain (fade x mute) at the current frame and `frames` later;
+    // it is linear in between whenever spanFrames() was respected
+    double gain() const { return gainAt(m_frame); }
+    double gainAfter(int frames) const { return gainAt(m_frame + frames); }
+
+private:
+    struct Ramp
+    {
+        bool active = false;
+        double from = 0.0;
+        double to = 0.0;
+        int64_t start = 0;
+        int64_t length = 0;
+
+        double valueAt(int64_t frame) const;
+        int64_t end() const { return start + length; }
+    };
+
+    void apply(const EngineCommand &command);
+    static void startRamp(Ramp &ramp, double &value, double target, int64_t start, int64_t length);
+    double gainAt(int64_t frame) const;
+
+    ToneKernels::ToneParameters m_base; // Fields no command touches (sample rate, seed)
+    double m_values[EngineCommand::PARAMETER_COUNT];
+    Ramp m_ramps[EngineCommand::PARAMETER_COUNT];
+
+    double m_fadeGain;
+    Ramp m_fadeRamp;
+    double m_muteGain;
+    Ramp m_muteRamp;
+
+    int64_t m_frame;
+
+    EngineCommand m_pending[MAX_PENDING];
+    int m_pendingHead;
+    int m_pendingCount;
+};
+
+#endif // ENGINECONTROL_H
@@ -0,0 +1,182 @@
+#include "fft.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define FFT_HAVE_SSE 1
+#endif
+
+FftPlan::FftPlan(int size)
+    : m_size(isPowerOfTwo(size) ? size : 1024)
+{
+    // Bit-reversal permutation as a list of swaps
+    int bits = 0;
+    while ((1 << bits) < m_size) {
+        ++bits;
+    }
+    for (int i = 0; i < m_size; ++i) {
+        int reversed = 0;
+        for (int b = 0; b < bits; ++b) {
+            reversed |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        if (i < reversed) {
+            m_swapPairs.push_back(i);
+            m_swapPairs.push_back(reversed);
+        }
+    }
+
+    // Twiddles for the stage with half-size h live at [h, 2h):
+    // w_k = exp(-2*pi*i*k / (2h)), k = 0..h-1
+    m_twiddleRe.assign(static_cast<size_t>(std::max(2, m_size)), 0.0f);
+    m_twiddleIm.assign(static_cast<size_t>(std::max(2, m_size)), 0.0f);
+    for (int h = 1; h < m_size; h <<= 1) {
+        for (int k = 0; k < h; ++k) {
+            double angle = -M_PI * k / h;
+            m_twiddleRe[h + k] = static_cast<float>(std::cos(angle));
+            m_twiddleIm[h + k] = static_cast<float>(std::sin(angle));
+        }
+    }
+}
+
+void FftPlan::bitReverse(float *re, float *im) const
+{
+    const int *pairs = m_swapPairs.data();
+    const size_t count = m_swapPairs.size();
+    for (size_t p = 0; p < count; p += 2) {
+        std::swap(re[pairs[p]], re[pairs[p + 1]]);
+        std::swap(im[pairs[p]], im[pairs[p + 1]]);
+    }
+}
+
+void FftPlan::transform(float *re, float *im, bool inverse) const
+{
+    bitReverse(re, im);
+
+    // The inverse uses conjugate twiddles: negate the imaginary part
+    const float sign = inverse ? -1.0f : 1.0f;
+
+    for (int h = 1; h < m_size; h <<= 1) {
+        const float *wRe = &m_twiddleRe[h];
+        const float *wIm = &m_twiddleIm[h];
+
+        for (int block = 0; block < m_size; block += 2 * h) {
+            float *aRe = re + block;
+            float *aIm = im + block;
+            float *bRe = aRe + h;
+            float *bIm = aIm + h;
+
+            int k = 0;
+#ifdef FFT_HAVE_SSE
+            const __m128 vSign = _mm_set1_ps(sign);
+            for (; k + 4 <= h; k += 4) {
+                __m128 tr = _mm_loadu_ps(wRe + k);
+                __m128 ti = _mm_mul_ps(_mm_loadu_ps(wIm + k), vSign);
+                __m128 xr = _mm_loadu_ps(bRe + k);
+                __m128 xi = _mm_loadu_ps(bIm + k);
+
+                // t = w * b
+                __m128 pr = _mm_sub_ps(_mm_mul_ps(xr, tr), _mm_mul_ps(xi, ti));
+                __m128 pi = _mm_add_ps(_mm_mul_ps(xr, ti), _mm_mul_ps(xi, tr));
+
+                __m128 ur = _mm_loadu_ps(aRe + k);
+                __m128 ui = _mm_loadu_ps(aIm + k);
+
+                _mm_storeu_ps(aRe + k, _mm_add_ps(ur, pr));
+                _mm_storeu_ps(aIm + k, _mm_add_ps(ui, pi));
+                _mm_storeu_ps(bRe + k, _mm_sub_ps(ur, pr));
+                _mm_storeu_ps(bIm + k, _mm_sub_ps(ui, pi));
+            }
+#endif
+            // Scalar butterflies for the first stages (h < 4) and non-SSE builds
+            for (; k < h; ++k) {
+                float tr = wRe[k];
+                float ti = wIm[k] * sign;
+                float pr = bRe[k] * tr - bIm[k] * ti;
+                float pi = bRe[k] * ti + bIm[k] * tr;
+                float ur = aRe[k];
+                float ui = aIm[k];
+                aRe[k] = ur + pr;
+                aIm[k] = ui + pi;
+                bRe[k] = ur - pr;
+                bIm[k] = ui - pi;
+            }
+        }
+    }
+}
+
+void FftPlan::forward(float *re, float *im) const
+{
+    transform(re, im, false);
+}
+
+void FftPlan::inverse(float *re, float *im) const
+{
+    transform(re, im, true);
+
+    const float scale = 1.0f / m_size;
+    for (int i = 0; i < m_size; ++i) {
+        re[i] *= scale;
+        im[i] *= scale;
+    }
+}
+
+void FftPlan::magnitudes(const float *input, float *magnitudes,
+                         float *scratchRe, float *scratchIm) const
+{
+    std::copy(input, input + m_size, scratchRe);
+    std::fill(scratchIm, scratchIm + m_size, 0.0f);
+
+    forward(scratchRe, scratchIm);
+
+    const int bins = m_size / 2 + 1;
+    for (int k = 0; k < bins; ++k) {
+        magnitudes[k] = std::sqrt(scratchRe[k] * scratchRe[k] + scratchIm[k] * scratchIm[k]);
+    }
+}
+
+// =================== ANALYSIS HELPERS ===================
+namespace FftUtils {
+
+void hannWindow(float *window, int size)
+{
+    for (int i = 0; i < size; ++i) {
+        window[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * M_PI * i / size));
+    }
+}
+
+double interpolateHannPeak(const float *magnitudes, int bin, int binCount)
+{
+    if (bin <= 0 || bin >= binCount - 1) {
+        return bin;
+    }
+
+    // For a Hann-windowed sinusoid the main lobe ratio of the two largest
+    // bins gives the offset in closed form: d = (2*m1 - m0) / (m0 + m1)
+    double peak = magnitudes[bin];
+    double left = magnitudes[bin - 1];
+    double right = magnitudes[bin + 1];
+    if (peak <= 0.0) {
+        return bin;
+    }
+
+    double offset = (right > left)
+        ? (2.0 * right - peak) / (peak + right)
+        : -(2.0 * left - peak) / (peak + left);
+    return bin + std::clamp(offset, -0.5, 0.5);
+}
+
+int findPeakBin(const float *magnitudes, int firstBin, int lastBin)
+{
+    int peak = firstBin;
+    for (int k = firstBin + 1; k < lastBin; ++k) {
+        if (magnitudes[k] > magnitudes[peak]) {
+            peak = k;
+        }
+    }
+    return peak;
+}
+
+}
@@ -0,0 +1,57 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <vector>
+
+// Radix-2 decimation-in-time FFT on split (separate real/imaginary) arrays.
+//
+// A plan owns everything that depends only on the size: the bit-reversal
+// permutation and per-stage twiddle tables laid out contiguously, so each
+// butterfly stage walks three unit-stride arrays and maps directly onto SSE
+// registers. Create a plan once and reuse it; transforms never allocate.
+class FftPlan
+{
+public:
+    explicit FftPlan(int size = 1024);
+
+    int size() const { return m_size; }
+
+    // In-place complex forward transform of re/im (length size())
+    void forward(float *re, float *im) const;
+
+    // In-place complex inverse transform, scaled by 1/size()
+    void inverse(float *re, float *im) const;
+
+    // Real input -> magnitude spectrum of bins 0..size()/2.
+    // `scratchRe`/`scratchIm` must hold size() floats.
+    void magnitudes(const float *input, float *magnitudes,
+                    float *scratchRe, float *scratchIm) const;
+
+    static bool isPowerOfTwo(int n) { return n > 0 && (n & (n - 1)) == 0; }
+
+private:
+    void bitReverse(float *re, float *im) const;
+    void transform(float *re, float *im, bool inverse) const;
+
+    int m_size;
+    std::vector<int> m_swapPairs;   // (i, j) pairs with i < j
+    std::vector<float> m_twiddleRe; // stage of half-size h stored at [h, 2h)
+    std::vector<float> m_twiddleIm;
+};
+
+// Analysis helpers shared by the spectrum analyzer and the accuracy tests
+namespace FftUtils {
+
+// Periodic Hann window of the given length
+void hannWindow(float *window, int size);
+
+// Interpolated peak (in bins) around local maximum `bin` of a Hann-windowed
+// spectrum; exact for an isolated stationary tone
+double interpolateHannPeak(const float *magnitudes, int bin, int binCount);
+
+// Index of the largest magnitude in [firstBin, lastBin)
+int findPeakBin(const float *magnitudes, int firstBin, int lastBin);
+
+}
+
+#endif // FFT_H
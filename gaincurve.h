@@ -0,0 +1,56 @@
+#ifndef GAINCURVE_H
+#define GAINCURVE_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+// Loudness follows decibels, so volume controls and gain ramps move in dB
+// and are turned into amplitude through a table: no pow() per slider tick
+// or per mixed block, and the table is built once, on first use.
+namespace GainCurve {
+
+constexpr float MIN_DB = -48.0f; // Bottom of the taper; below it is silence
+constexpr float DB_STEP = 0.25f; // Table resolution, interpolated between
+constexpr int TABLE_SIZE = int(-MIN_DB / DB_STEP) + 1;
+
+inline const std::array<float, TABLE_SIZE> &table()
+{
+    static const std::array<float, TABLE_SIZE> gains = [] {
+        std::array<float, TABLE_SIZE> values{};
+        for (int i = 0; i < TABLE_SIZE; ++i) {
+            values[size_t(i)] = std::pow(10.0f, (MIN_DB + i * DB_STEP) / 20.0f);
+        }
+        return values;
+    }();
+    return gains;
+}
+
+// Amplitude of `db` (at most 0); 0 below MIN_DB
+inline float dbToGain(float db)
+{
+    if (db < MIN_DB) {
+        return 0.0f;
+    }
+    const float index = (std::min(db, 0.0f) - MIN_DB) / DB_STEP;
+    const int below = std::min(int(index), TABLE_SIZE - 2);
+    const float t = index - float(below);
+    const std::array<float, TABLE_SIZE> &gains = table();
+    return gains[size_t(below)] + (gains[size_t(below) + 1] - gains[size_t(below)]) * t;
+}
+
+// A 0-1 volume control to amplitude: MIN_DB to 0 dB evenly along the
+// control, then down to silence over its lowest tenth
+inline float perceptual(float position)
+{
+    constexpr float KNEE = 0.1f;
+    position = std::clamp(position, 0.0f, 1.0f);
+    if (position < KNEE) {
+        return table()[0] * position / KNEE;
+    }
+    return dbToGain(MIN_DB * (1.0f - position) / (1.0f - KNEE));
+}
+
+}
+
+#endif // GAINCURVE_H
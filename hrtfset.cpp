@@ -0,0 +1,176 @@
+#include "hrtfset.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <iterator>
+
+#include "fft.h"
+
+namespace {
+constexpr double DEGREES = M_PI / 180.0;
+constexpr double HEAD_RADIUS = 0.0875;   // Metres
+constexpr double SPEED_OF_SOUND = 343.0; // Metres per second
+constexpr double SHADOW_MIN_ALPHA = 0.1; // Treble gain where the shadow is deepest,
+constexpr double SHADOW_MIN_ANGLE = 150.0; // this far round from the ear
+constexpr double BULK_DELAY = 16.0;      // Frames before the near ear hears it: room for the EQ's ringing
+constexpr int DESIGN_SIZE = 2 * HrtfSet::LENGTH; // Responses are designed on this FFT
+constexpr int SMOOTH_BINS = 4;           // Of the diffuse-field average, each side
+constexpr int FADE_TAPS = 32;            // Tail faded out after truncation
+
+// Brown & Duda's pinna echoes: a reflection, delayed by
+// scale * cos(azimuth / 2) * sin(tilt * (90° - elevation)) + offset frames
+struct PinnaEcho
+{
+    double reflection;
+    double scale;
+    double offset;
+    double tilt;
+};
+constexpr PinnaEcho PINNA_ECHOES[] = {
+    { 0.5, 1.0, 2.0, 1.0 },
+    { -1.0, 5.0, 4.0, 0.5 },
+    { 0.5, 5.0, 7.0, 0.5 },
+    { -0.25, 5.0, 11.0, 0.5 },
+    { 0.25, 5.0, 13.0, 0.5 },
+};
+
+struct Vector3
+{
+    double x; // Right
+    double y; // Ahead
+    double z; // Up
+};
+
+Vector3 toVector(double azimuth, double elevation)
+{
+    return { std::cos(elevation * DEGREES) * std::sin(azimuth * DEGREES),
+             std::cos(elevation * DEGREES) * std::cos(azimuth * DEGREES),
+             std::sin(elevation * DEGREES) };
+}
+
+// One ear's response at bins 0..DESIGN_SIZE/2; side is 1 for the right
+// ear, -1 for the left
+void earResponse(const HrtfSet::Direction &direction, double side, std::complex<double> *bins)
+{
+    const Vector3 source = toVector(direction.azimuth, direction.elevation);
+    const double incidence = std::acos(std::clamp(source.x * side, -1.0, 1.0)); // From the ear's axis
+
+    // Woodworth: straight to the near ear, around the head to the far one
+    const double path = incidence < M_PI / 2 ? -std::cos(incidence) : incidence - M_PI / 2;
+    const double delay = BULK_DELAY + (1.0 + path) * HEAD_RADIUS / SPEED_OF_SOUND * HrtfSet::SAMPLE_RATE;
+
+    // Head shadow: treble lifted facing the ear, cut behind the head
+    const double alpha = (1.0 + SHADOW_MIN_ALPHA / 2) + (1.0 - SHADOW_MIN_ALPHA / 2)
+                         * std::cos(incidence / (SHADOW_MIN_ANGLE * DEGREES) * M_PI);
+    const double corner = 2.0 * SPEED_OF_SOUND / HEAD_RADIUS / HrtfSet::SAMPLE_RATE; // Radians per frame
+
+    const double fold = std::cos(direction.azimuth * DEGREES / 2); // 1 ahead, 0 behind
+    double echoDelays[std::size(PINNA_ECHOES)];
+    for (size_t e = 0; e < std::size(PINNA_ECHOES); ++e) {
+        const PinnaEcho &echo = PINNA_ECHOES[e];
+        echoDelays[e] = echo.scale * fold * std::sin(echo.tilt * (90.0 - direction.elevation) * DEGREES) + echo.offset;
+    }
+
+    for (int k = 0; k <= DESIGN_SIZE / 2; ++k) {
+        const double omega = 2.0 * M_PI * k / DESIGN_SIZE;
+        const std::complex<double> shadow = std::complex<double>(1.0, alpha * omega / corner)
+                                            / std::complex<double>(1.0, omega / corner);
+        std::complex<double> pinna = 1.0;
+        for (size_t e = 0; e < std::size(PINNA_ECHOES); ++e) {
+            pinna += PINNA_ECHOES[e].reflection * std::polar(1.0, -omega * echoDelays[e]);
+        }
+        bins[k] = shadow * pinna * std::polar(1.0, -omega * delay);
+    }
+}
+}
+
+std::shared_ptr<const HrtfSet> HrtfSet::builtin()
+{
+    static const std::shared_ptr<const HrtfSet> set(new HrtfSet());
+    return set;
+}
+
+HrtfSet::HrtfSet()
+{
+    // Rings every 20° of elevation with about 10° between directions along
+    // each, and one straight overhead
+    for (int elevation = -40; elevation <= 80; elevation += 20) {
+        const int count = std::max(1, int(std::lround(36.0 * std::cos(elevation * DEGREES))));
+        for (int i = 0; i < count; ++i) {
+            m_directions.push_back({ float(std::remainder(360.0 * i / count, 360.0)), float(elevation) });
+        }
+    }
+    m_directions.push_back({ 0.0f, 90.0f });
+
+    const size_t directions = m_directions.size();
+    const int bins = DESIGN_SIZE / 2 + 1;
+    std::vector<std::complex<double>> responses(directions * 2 * size_t(bins));
+    std::vector<double> power(size_t(bins), 0.0);
+    for (size_t d = 0; d < directions; ++d) {
+        for (int ear = 0; ear < 2; ++ear) {
+            std::complex<double> *response = &responses[(d * 2 + size_t(ear)) * size_t(bins)];
+            earResponse(m_directions[d], ear == 0 ? -1.0 : 1.0, response);
+            for (int k = 0; k < bins; ++k) {
+                power[size_t(k)] += std::norm(response[k]);
+            }
+        }
+    }
+
+    // Diffuse-field equalization: over every direction and both ears the
+    // response averages flat. Smoothed, so the correction is short.
+    std::vector<double> equalizer(power.size());
+    for (int k = 0; k < bins; ++k) {
+        double sum = 0.0;
+        int count = 0;
+        for (int j = std::max(0, k - SMOOTH_BINS); j <= std::min(bins - 1, k + SMOOTH_BINS); ++j, ++count) {
+            sum += power[size_t(j)];
+        }
+        equalizer[size_t(k)] = 1.0 / std::sqrt(sum / count / double(2 * directions));
+    }
+
+    FftPlan plan(DESIGN_SIZE);
+    std::vector<float> re(DESIGN_SIZE);
+    std::vector<float> im(DESIGN_SIZE);
+    m_left.resize(directions * LENGTH);
+    m_right.resize(directions * LENGTH);
+    for (size_t d = 0; d < directions; ++d) {
+        for (int ear = 0; ear < 2; ++ear) {
+            const std::complex<double> *response = &responses[(d * 2 + size_t(ear)) * size_t(bins)];
+            for (int k = 0; k < bins; ++k) {
+                const std::complex<double> value = response[k] * equalizer[size_t(k)];
+                const bool real = k == 0 || k == DESIGN_SIZE / 2;
+                re[size_t(k)] = float(value.real());
+                im[size_t(k)] = real ? 0.0f : float(value.imag());
+                if (!real) {
+                    re[size_t(DESIGN_SIZE - k)] = re[size_t(k)];
+                    im[size_t(DESIGN_SIZE - k)] = -im[size_t(k)];
+                }
+            }
+            plan.inverse(re.data(), im.data());
+
+            float *taps = (ear == 0 ? m_left.data() : m_right.data()) + d * LENGTH;
+            for (int i = 0; i < LENGTH; ++i) {
+                const int intoFade = i - (LENGTH - FADE_TAPS);
+                const float fade = intoFade < 0 ? 1.0f : float(0.5 * (1.0 + std::cos(M_PI * intoFade / FADE_TAPS)));
+                taps[i] = re[size_t(i)] * fade;
+            }
+        }
+    }
+}
+
+int HrtfSet::nearest(float azimuth, float elevation) const
+{
+    const Vector3 wanted = toVector(azimuth, std::clamp(elevation, -90.0f, 90.0f));
+    int best = 0;
+    double bestDot = -2.0;
+    for (int i = 0; i < directionCount(); ++i) {
+        const Vector3 candidate = toVector(m_directions[size_t(i)].azimuth, m_directions[size_t(i)].elevation);
+        const double dot = wanted.x * candidate.x + wanted.y * candidate.y + wanted.z * candidate.z;
+        if (dot > bestDot) {
+            bestDot = dot;
+            best = i;
+        }
+    }
+    return best;
+}
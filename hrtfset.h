@@ -0,0 +1,50 @@
+#ifndef HRTFSET_H
+#define HRTFSET_H
+
+#include <memory>
+#include <vector>
+
+// Head-related impulse responses for a grid of directions around the
+// listener: what the spatializer renders ambient layers through on
+// headphones. Qt-free.
+//
+// The set is synthesized, not measured: a spherical head gives the
+// interaural delay (Woodworth) and the head shadow (Brown & Duda's
+// one-pole, one-zero filter), and five pinna echoes whose delays follow
+// the elevation give the up/down and front/back cues. The responses are
+// diffuse-field equalized, so a layer keeps its timbre wherever it is
+// placed. Built once per process and shared.
+class HrtfSet
+{
+public:
+    static constexpr int LENGTH = 256; // Taps per ear, at 44.1 kHz
+    static constexpr int SAMPLE_RATE = 44100;
+
+    // Degrees: azimuth clockwise from ahead (-90 left, 90 right, 180
+    // behind), elevation up from the horizon (90 overhead)
+    struct Direction
+    {
+        float azimuth = 0.0f;
+        float elevation = 0.0f;
+    };
+
+    static std::shared_ptr<const HrtfSet> builtin();
+
+    int directionCount() const { return int(m_directions.size()); }
+    const Direction &direction(int index) const { return m_directions[size_t(index)]; }
+    // The direction of the grid closest to the given one
+    int nearest(float azimuth, float elevation) const;
+
+    // LENGTH taps each
+    const float *left(int index) const { return m_left.data() + size_t(index) * LENGTH; }
+    const float *right(int index) const { return m_right.data() + size_t(index) * LENGTH; }
+
+private:
+    HrtfSet();
+
+    std::vector<Direction> m_directions;
+    std::vector<float> m_left;
+    std::vector<float> m_right;
+};
+
+#endif // HRTFSET_H
@@ -0,0 +1,88 @@
+#include "levelmeterwidget.h"
+
+#include <QPainter>
+#include <QtMath>
+
+LevelMeterWidget::LevelMeterWidget(QWidget *parent)
+    : QWidget(parent)
+{
+    reset();
+    setToolTip("Brainwave output level (L/R)");
+}
+
+QSize LevelMeterWidget::sizeHint() const
+{
+    return QSize(120, 22);
+}
+
+QSize LevelMeterWidget::minimumSizeHint() const
+{
+    return QSize(60, 14);
+}
+
+void LevelMeterWidget::setLevels(double peakLeft, double peakRight, double rmsLeft, double rmsRight)
+{
+    const double peaks[2] = { toMeterScale(peakLeft), toMeterScale(peakRight) };
+    const double rms[2] = { toMeterScale(rmsLeft), toMeterScale(rmsRight) };
+
+    for (int ch = 0; ch < 2; ++ch) {
+        m_peak[ch] = peaks[ch];
+        m_rms[ch] = rms[ch];
+        // Peak hold falls back slowly so short peaks stay readable
+        m_hold[ch] = qMax(peaks[ch], m_hold[ch] - HOLD_DECAY);
+    }
+
+    update();
+}
+
+void LevelMeterWidget::reset()
+{
+    for (int ch = 0; ch < 2; ++ch) {
+        m_peak[ch] = 0.0;
+        m_rms[ch] = 0.0;
+        m_hold[ch] = 0.0;
+    }
+    update();
+}
+
+double LevelMeterWidget::toMeterScale(double linear)
+{
+    if (linear <= 0.0) {
+        return 0.0;
+    }
+    double db = 20.0 * std::log10(linear);
+    return qBound(0.0, (db - FLOOR_DB) / -FLOOR_DB, 1.0);
+}
+
+void LevelMeterWidget::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+
+    QPainter painter(this);
+    painter.fillRect(rect(), QColor("#f0f0f0"));
+    painter.setPen(QColor("#cccccc"));
+    painter.drawRect(rect().adjusted(0, 0, -1, -1));
+
+    const int margin = 2;
+    const int barHeight = (height() - 3 * margin) / 2;
+    const int barWidth = width() - 2 * margin;
+
+    for (int ch = 0; ch < 2; ++ch) {
+        int top = margin + ch * (barHeight + margin);
+
+        // RMS body
+        int rmsWidth = static_cast<int>(barWidth * m_rms[ch]);
+        painter.fillRect(margin, top, rmsWidth, barHeight, QColor("#7B68EE"));
+
+        // Instantaneous peak, red when close to clipping
+        int peakX = margin + static_cast<int>(barWidth * m_peak[ch]);
+        QColor peakColor = m_peak[ch] > 0.98 ? QColor("#DC143C") : QColor("#483D8B");
+        painter.fillRect(margin + rmsWidth, top, qMax(0, peakX - margin - rmsWidth),
+                         barHeight, peakColor.lighter(150));
+
+        // Peak hold marker
+        int holdX = margin + static_cast<int>(barWidth * m_hold[ch]);
+        painter.setPen(peakColor);
+        painter.drawLine(holdX, top, holdX, top + barHeight - 1);
+    }
+}
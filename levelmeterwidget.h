@@ -0,0 +1,36 @@
+#ifndef LEVELMETERWIDGET_H
+#define LEVELMETERWIDGET_H
+
+#include <QWidget>
+
+// Compact stereo VU meter for the brainwave toolbar. It is driven by the
+// engine's ~30 Hz audioLevelsChanged() poll, never by the audio path.
+class LevelMeterWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit LevelMeterWidget(QWidget *parent = nullptr);
+
+    QSize sizeHint() const override;
+    QSize minimumSizeHint() const override;
+
+public slots:
+    void setLevels(double peakLeft, double peakRight, double rmsLeft, double rmsRight);
+    void reset();
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    static double toMeterScale(double linear); // dBFS mapped to 0.0-1.0
+
+    double m_peak[2];
+    double m_rms[2];
+    double m_hold[2];
+
+    static constexpr double FLOOR_DB = -60.0;
+    static constexpr double HOLD_DECAY = 0.02; // Meter units per update
+};
+
+#endif // LEVELMETERWIDGET_H
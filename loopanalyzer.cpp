@@ -0,0 +1,149 @@
+#include "loopanalyzer.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QFileInfo>
+
+#include "ambientclip.h"
+#include "tracerecorder.h"
+
+namespace {
+constexpr quint32 LOOP_CACHE_VERSION = 1; // Bump when detection changes
+}
+
+LoopAnalyzer::LoopAnalyzer(const QString &cacheDirectory, QObject *parent)
+    : QObject(parent)
+    , m_cache(cacheDirectory, DEFAULT_CACHE_BYTES, "loop")
+    , m_busy(false)
+    , m_resultCached(false)
+{
+}
+
+LoopAnalyzer::~LoopAnalyzer()
+{
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+}
+
+QString LoopAnalyzer::cacheKey(const QString &filePath)
+{
+    // A file edited or replaced in place is analyzed again
+    const QFileInfo info(filePath);
+    const QString identity = QString("v%1|%2|size=%3|mtime=%4|rate=%5")
+                                 .arg(LOOP_CACHE_VERSION)
+                                 .arg(info.absoluteFilePath())
+                                 .arg(info.size())
+                                 .arg(info.lastModified().toMSecsSinceEpoch())
+                                 .arg(AmbientClip::SAMPLE_RATE);
+    return MappedFileCache::hashKey(identity.toUtf8());
+}
+
+void LoopAnalyzer::analyze(std::shared_ptr<const AmbientClip> clip)
+{
+    if (!clip) {
+        return;
+    }
+    if (m_busy) {
+        m_pending = std::move(clip);
+        return;
+    }
+
+    const QString key = cacheKey(clip->filePath);
+    LoopPoints points;
+    if (loadCached(key, *clip, &points)) {
+        setResult(clip->filePath, points, true);
+        return;
+    }
+
+    if (m_worker.joinable()) {
+        m_worker.join(); // Already finished: m_busy was clear
+    }
+    m_busy = true;
+    m_worker = std::thread([this, clip, key]() {
+        BINAURAL_TRACE_SCOPE("media", "LoopAnalyzer::detect", "frames", clip->frames());
+        const LoopPoints points = LoopDetection::detect(clip->data(), clip->frames(),
+                                                        AmbientClip::SAMPLE_RATE);
+        // Dropped by Qt if the analyzer is gone by then
+        QMetaObject::invokeMethod(this, [this, clip, key, points]() {
+            detectionFinished(clip, key, points);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void LoopAnalyzer::detectionFinished(std::shared_ptr<const AmbientClip> clip, const QString &key,
+                                     LoopPoints points)
+{
+    m_busy = false;
+    storeCached(key, *clip, points);
+    setResult(clip->filePath, points, false);
+
+    if (m_pending) {
+        std::shared_ptr<const AmbientClip> next = std::move(m_pending);
+        m_pending.reset();
+        analyze(std::move(next));
+    }
+}
+
+void LoopAnalyzer::setResult(const QString &filePath, const LoopPoints &points, bool cached)
+{
+    m_result = points;
+    m_resultPath = filePath;
+    m_resultCached = cached;
+    BINAURAL_TRACE_INSTANT("media", "LoopAnalyzer::finished", "cached", cached);
+    emit finished();
+}
+
+bool LoopAnalyzer::loadCached(const QString &key, const AmbientClip &clip, LoopPoints *points)
+{
+    std::unique_ptr<MappedCacheEntry> entry = m_cache.open(key);
+    if (!entry) {
+        return false;
+    }
+
+    QDataStream in(entry->header());
+    quint32 sampleRate = 0;
+    qint64 frames = 0, start = 0, end = 0, crossfadeFrames = 0;
+    float score = 0.0f;
+    in >> sampleRate >> frames >> start >> end >> crossfadeFrames >> score;
+
+    LoopPoints cached;
+    cached.start = start;
+    cached.end = end;
+    cached.crossfadeFrames = crossfadeFrames;
+    cached.score = score;
+    // Also refused when the decoder now yields a different length
+    if (in.status() != QDataStream::Ok || int(sampleRate) != AmbientClip::SAMPLE_RATE
+        || frames != clip.frames() || !cached.isValid() || cached.end > frames) {
+        m_cache.remove(key);
+        return false;
+    }
+
+    *points = cached;
+    return true;
+}
+
+void LoopAnalyzer::storeCached(const QString &key, const AmbientClip &clip, const LoopPoints &points)
+{
+    QByteArray header;
+    QDataStream out(&header, QIODevice::WriteOnly);
+    out << quint32(AmbientClip::SAMPLE_RATE) << qint64(clip.frames())
+        << qint64(points.start) << qint64(points.end) << qint64(points.crossfadeFrames) << points.score;
+    if (!m_cache.store(key, header, nullptr, 0)) {
+        qWarning() << "Could not cache loop points in" << m_cache.directory();
+    }
+}
+
+std::shared_ptr<const AmbientLoop> LoopAnalyzer::buildLoop(const AmbientClip &clip, const LoopPoints &points)
+{
+    if (!points.isValid() || points.end > clip.frames()) {
+        return nullptr;
+    }
+
+    auto loop = std::make_shared<AmbientLoop>();
+    loop->start = points.start;
+    loop->end = points.end;
+    loop->seam = LoopDetection::crossfadeSeam(clip.data(), points);
+    return loop;
+}
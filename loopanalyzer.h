@@ -0,0 +1,66 @@
+#ifndef LOOPANALYZER_H
+#define LOOPANALYZER_H
+
+#include <QObject>
+#include <QString>
+
+#include <memory>
+#include <thread>
+
+#include "constants.h"
+#include "looppoints.h"
+#include "mappedfilecache.h"
+
+struct AmbientClip;
+struct AmbientLoop;
+
+// Finds the loop points of decoded ambient clips once per file. Detection
+// runs on a worker thread; results are cached by file path, size and
+// modification time, so the next session (or the next player given the
+// same file) gets them from a small file read.
+class LoopAnalyzer : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr qint64 DEFAULT_CACHE_BYTES = 4 * 1024 * 1024; // About a thousand files
+
+    explicit LoopAnalyzer(const QString &cacheDirectory = ConstantGlobals::loopPointCachePath,
+                          QObject *parent = nullptr);
+    ~LoopAnalyzer(); // Waits for a detection in progress
+
+    // finished() follows: before this returns when the file is cached,
+    // otherwise once the worker is done. A clip given while another is
+    // analyzed waits its turn (only the latest one waits).
+    void analyze(std::shared_ptr<const AmbientClip> clip);
+    bool isAnalyzing() const { return m_busy; }
+
+    // The last result, for resultFilePath()
+    LoopPoints result() const { return m_result; }
+    QString resultFilePath() const { return m_resultPath; }
+    bool resultWasCached() const { return m_resultCached; }
+
+    // The region a voice plays for `points`, crossfade seam included
+    static std::shared_ptr<const AmbientLoop> buildLoop(const AmbientClip &clip, const LoopPoints &points);
+
+signals:
+    void finished();
+
+private:
+    static QString cacheKey(const QString &filePath);
+    bool loadCached(const QString &key, const AmbientClip &clip, LoopPoints *points);
+    void storeCached(const QString &key, const AmbientClip &clip, const LoopPoints &points);
+    void detectionFinished(std::shared_ptr<const AmbientClip> clip, const QString &key, LoopPoints points);
+    void setResult(const QString &filePath, const LoopPoints &points, bool cached);
+
+    MappedFileCache m_cache;
+    std::thread m_worker;
+    bool m_busy;
+    std::shared_ptr<const AmbientClip> m_pending;
+
+    LoopPoints m_result;
+    QString m_resultPath;
+    bool m_resultCached;
+};
+
+#endif // LOOPANALYZER_H
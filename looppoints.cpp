@@ -0,0 +1,202 @@
+#include "looppoints.h"
+
+#include "fft.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+inline double monoSample(const float *stereo, int64_t frame)
+{
+    return 0.5 * (double(stereo[2 * frame]) + double(stereo[2 * frame + 1]));
+}
+
+// Normalized dot product of the mono windows [a, a + n) and [b, b + n)
+double windowCorrelation(const float *stereo, int64_t a, int64_t b, int64_t n)
+{
+    double ab = 0.0;
+    double aa = 0.0;
+    double bb = 0.0;
+    for (int64_t i = 0; i < n; ++i) {
+        const double x = monoSample(stereo, a + i);
+        const double y = monoSample(stereo, b + i);
+        ab += x * y;
+        aa += x * x;
+        bb += y * y;
+    }
+    return (aa > 0.0 && bb > 0.0) ? ab / std::sqrt(aa * bb) : 0.0;
+}
+
+int nextPowerOfTwo(int64_t n)
+{
+    int size = 1;
+    while (size < n) {
+        size <<= 1;
+    }
+    return size;
+}
+
+int64_t blocksFor(int64_t frames)
+{
+    return (frames + LoopDetection::HOP_FRAMES - 1) / LoopDetection::HOP_FRAMES;
+}
+
+}
+
+LoopPoints LoopDetection::detect(const float *stereo, int64_t frames, int sampleRate,
+                                 const Settings &settings)
+{
+    LoopPoints whole;
+    whole.end = std::max<int64_t>(0, frames);
+    if (!stereo || frames <= 0 || sampleRate <= 0) {
+        return whole;
+    }
+
+    const int64_t crossfade = std::llround(settings.crossfadeSeconds * sampleRate);
+    const int64_t edge = std::llround(settings.edgeSeconds * sampleRate);
+    const int64_t minLoop = std::max(std::llround(settings.minLoopSeconds * sampleRate),
+                                     std::llround(settings.minLoopFraction * double(frames)));
+
+    // Loudness envelope, one value per hop
+    const int64_t blocks = frames / HOP_FRAMES;
+    std::vector<float> envelope(static_cast<size_t>(blocks));
+    double mean = 0.0;
+    for (int64_t b = 0; b < blocks; ++b) {
+        double sum = 0.0;
+        for (int64_t i = b * HOP_FRAMES; i < (b + 1) * HOP_FRAMES; ++i) {
+            const double x = monoSample(stereo, i);
+            sum += x * x;
+        }
+        envelope[size_t(b)] = float(std::sqrt(sum / HOP_FRAMES));
+        mean += envelope[size_t(b)];
+    }
+    mean = blocks > 0 ? mean / double(blocks) : 0.0;
+
+    // Lags leave room for the edges and for the crossfade windows on both
+    // sides of the seam
+    const int64_t edgeBlocks = blocksFor(edge);
+    const int64_t fadeBlocks = blocksFor(crossfade);
+    const int64_t minLag = blocksFor(minLoop);
+    const int64_t maxLag = blocks - 2 * edgeBlocks - 2 * fadeBlocks;
+    if (minLag > maxLag) {
+        return whole;
+    }
+
+    // Autocorrelation of the centred envelope: inverse FFT of its power
+    // spectrum, zero-padded so the lags do not wrap
+    const int size = nextPowerOfTwo(2 * blocks);
+    FftPlan plan(size);
+    std::vector<float> re(size_t(size), 0.0f);
+    std::vector<float> im(size_t(size), 0.0f);
+    for (int64_t b = 0; b < blocks; ++b) {
+        re[size_t(b)] = float(envelope[size_t(b)] - mean);
+    }
+    plan.forward(re.data(), im.data());
+    for (int k = 0; k < size; ++k) {
+        re[size_t(k)] = re[size_t(k)] * re[size_t(k)] + im[size_t(k)] * im[size_t(k)];
+        im[size_t(k)] = 0.0f;
+    }
+    plan.inverse(re.data(), im.data());
+
+    // Normalized by the energy of the two overlapping parts, so long lags
+    // (short overlaps) are not penalized
+    std::vector<double> energy(size_t(blocks) + 1, 0.0);
+    for (int64_t b = 0; b < blocks; ++b) {
+        const double x = envelope[size_t(b)] - mean;
+        energy[size_t(b) + 1] = energy[size_t(b)] + x * x;
+    }
+
+    int64_t lag = maxLag;
+    double bestScore = -2.0;
+    for (int64_t l = minLag; l <= maxLag; ++l) {
+        const double head = energy[size_t(blocks - l)];
+        const double tail = energy[size_t(blocks)] - energy[size_t(l)];
+        if (head <= 0.0 || tail <= 0.0) {
+            continue;
+        }
+        const double score = re[size_t(l)] / std::sqrt(head * tail);
+        if (score > bestScore) {
+            bestScore = score;
+            lag = l;
+        }
+    }
+
+    // Start where the envelope around the seam matches one loop later
+    // (levels included, which the correlation ignores)
+    std::vector<double> difference(size_t(blocks - lag) + 1, 0.0);
+    for (int64_t b = 0; b < blocks - lag; ++b) {
+        const double d = double(envelope[size_t(b)]) - envelope[size_t(b + lag)];
+        difference[size_t(b) + 1] = difference[size_t(b)] + d * d;
+    }
+    const int64_t firstStart = edgeBlocks + fadeBlocks;
+    const int64_t lastStart = blocks - edgeBlocks - lag - fadeBlocks;
+    int64_t startBlock = firstStart;
+    double bestDifference = -1.0;
+    for (int64_t s = firstStart; s <= lastStart; ++s) {
+        const double d = difference[size_t(s + fadeBlocks)] - difference[size_t(s - fadeBlocks)];
+        if (bestDifference < 0.0 || d < bestDifference) {
+            bestDifference = d;
+            startBlock = s;
+        }
+    }
+
+    // Align the end to the frame: the tail window most in phase with the
+    // window leading up to the start
+    LoopPoints points;
+    points.start = startBlock * HOP_FRAMES;
+    points.crossfadeFrames = crossfade;
+    points.score = float(std::max(-1.0, bestScore));
+
+    const int64_t coarseEnd = points.start + lag * HOP_FRAMES;
+    const int64_t firstEnd = std::max(coarseEnd - HOP_FRAMES, points.start + std::max(crossfade, int64_t(1)));
+    const int64_t lastEnd = std::min(coarseEnd + HOP_FRAMES, frames);
+    points.end = coarseEnd;
+    double bestCorrelation = -2.0;
+    if (crossfade > 0) {
+        for (int64_t end = firstEnd; end <= lastEnd; ++end) {
+            const double c = windowCorrelation(stereo, points.start - crossfade, end - crossfade, crossfade);
+            if (c > bestCorrelation) {
+                bestCorrelation = c;
+                points.end = end;
+            }
+        }
+    }
+
+    return points.isValid() ? points : whole;
+}
+
+std::vector<float> LoopDetection::crossfadeSeam(const float *stereo, const LoopPoints &points)
+{
+    const int64_t frames = points.crossfadeFrames;
+    std::vector<float> seam(size_t(frames) * 2);
+    if (frames <= 0) {
+        return seam;
+    }
+
+    const float *tail = stereo + 2 * (points.end - frames);
+    const float *lead = stereo + 2 * (points.start - frames);
+
+    // Correlated windows add in amplitude rather than in power, so plain
+    // equal-power gains would swell by up to 3 dB mid-fade
+    double ab = 0.0;
+    double aa = 0.0;
+    double bb = 0.0;
+    for (int64_t i = 0; i < 2 * frames; ++i) {
+        ab += double(tail[i]) * lead[i];
+        aa += double(tail[i]) * tail[i];
+        bb += double(lead[i]) * lead[i];
+    }
+    const double rho = (aa > 0.0 && bb > 0.0) ? std::clamp(ab / std::sqrt(aa * bb), 0.0, 1.0) : 0.0;
+
+    for (int64_t i = 0; i < frames; ++i) {
+        const double theta = M_PI / 2.0 * (double(i) + 0.5) / double(frames);
+        const double fadeOut = std::cos(theta);
+        const double fadeIn = std::sin(theta);
+        const double norm = 1.0 / std::sqrt(1.0 + 2.0 * rho * fadeOut * fadeIn);
+        for (int c = 0; c < 2; ++c) {
+            seam[size_t(2 * i + c)] = float((fadeOut * tail[2 * i + c] + fadeIn * lead[2 * i + c]) * norm);
+        }
+    }
+    return seam;
+}
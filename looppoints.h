@@ -0,0 +1,56 @@
+#ifndef LOOPPOINTS_H
+#define LOOPPOINTS_H
+
+#include <cstdint>
+#include <vector>
+
+// Where a recording loops best, for clips that were not cut to loop.
+// Playing [start, end) with the last crossfadeFrames frames replaced by
+// crossfadeSeam() and jumping back to start repeats without a click or a
+// jump in level: the seam fades from the tail into the audio that leads up
+// to start, so the frame after the seam is the one that followed it in
+// the recording.
+struct LoopPoints
+{
+    int64_t start = 0;
+    int64_t end = 0;             // Exclusive
+    int64_t crossfadeFrames = 0; // 0: plain loop of [start, end)
+    float score = 0.0f;          // Envelope correlation at the loop length, -1..1
+
+    int64_t length() const { return end - start; }
+    bool isValid() const { return end > start && crossfadeFrames <= start && crossfadeFrames <= length(); }
+};
+
+// Qt-free detection on interleaved stereo float PCM.
+//
+// The loop length comes from the autocorrelation of the loudness envelope
+// (RMS per HOP_FRAMES), computed with one FFT, so rain that swells every
+// 40 s loops on that period. The start is the position where the envelope
+// one loop length later matches best, and the end is then aligned to the
+// frame at full rate by cross-correlating the two crossfade windows, so the
+// crossfade mixes audio that is in phase. A three-minute file takes a few
+// tens of milliseconds; run it once and cache the result.
+namespace LoopDetection {
+
+constexpr int HOP_FRAMES = 256;
+
+struct Settings
+{
+    double crossfadeSeconds = 0.5;
+    double minLoopSeconds = 5.0;
+    double minLoopFraction = 0.5; // Of the file: long loops repeat less audibly
+    double edgeSeconds = 0.25;    // Skipped at both ends, past fade-ins and fade-outs
+};
+
+// A plain loop of the whole clip when it is too short to search
+LoopPoints detect(const float *stereo, int64_t frames, int sampleRate,
+                  const Settings &settings = Settings());
+
+// The crossfadeFrames frames that replace the end of the loop (interleaved
+// stereo). Equal-power, corrected for how alike the two windows are, so
+// the level holds steady whether they are unrelated or nearly identical.
+std::vector<float> crossfadeSeam(const float *stereo, const LoopPoints &points);
+
+}
+
+#endif // LOOPPOINTS_H
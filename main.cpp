@@ -1,5 +1,6 @@
 #include "mainwindow.h"
 #include"constants.h"
+#include "startupprofiler.h"
 #include <QApplication>
 #include<QDir>
 #include<QTimer>
@@ -7,6 +8,9 @@
 
 int main(int argc, char *argv[])
 {
+    StartupProfiler &profiler = StartupProfiler::instance();
+    profiler.start();
+
     QDir().mkpath(ConstantGlobals::appDirPath);
     QDir().mkpath(ConstantGlobals::ambientFilePath);
     QDir().mkpath(ConstantGlobals::presetFilePath);
@@ -17,10 +21,12 @@ int main(int argc, char *argv[])
     QApplication::setApplicationName("BinauralPlayer");
     QApplication::setOrganizationName("Alamahant");
     QApplication::setApplicationVersion("1.1.0");
+    profiler.mark("directories");
     QApplication a(argc, argv);
-    MainWindow w;
-
+    profiler.mark("QApplication");
+    MainWindow w; // Marks its own phases
     w.show();
+    profiler.mark("show");
     //open with
     if (argc == 2) {
             QString filePath = QString::fromLocal8Bit(argv[1]);
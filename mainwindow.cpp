@@ -20,8 +20,23 @@
 #include<QMenu>
 #include<QMenuBar>
 #include<QApplication>
+#include<QSet>
+#include"ambientclip.h"
+#include"ambientmixer.h"
+#include"ambientpreloader.h"
+#include"ambientscatter.h"
 #include"helpmenudialog.h"
 #include"donationdialog.h"
+#include"levelmeterwidget.h"
+#include"oscilloscopewidget.h"
+#include"spectrumanalyzer.h"
+#include"spectrumwidget.h"
+#include"presetauditioner.h"
+#include"resampler.h"
+#include"startupprofiler.h"
+#include"tracerecorder.h"
+#include<QThread>
+#include <algorithm>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -49,6 +64,9 @@ MainWindow::MainWindow(QWidget *parent)
     , m_masterVolumeLabel(nullptr)
     , m_naturePowerButton(nullptr)
 {
+    StartupProfiler &profiler = StartupProfiler::instance();
+    profiler.mark("binaural engine");
+
     // Window properties
     setWindowTitle("Binaural Media Player");
     setMinimumSize(900, 700);
@@ -58,6 +76,7 @@ MainWindow::MainWindow(QWidget *parent)
     //initializeAudioEngines();
 
     setupAmbientPlayers();
+    profiler.mark("ambient players");
 
 
     // Create toolbars
@@ -74,10 +93,12 @@ MainWindow::MainWindow(QWidget *parent)
     addToolBar(Qt::TopToolBarArea, m_binauralToolbarExt);
     addToolBarBreak(Qt::TopToolBarArea);
     addToolBar(Qt::TopToolBarArea, m_natureToolbar);
+    profiler.mark("toolbars");
 
 
     // Create central widget and layout
     setupLayout();
+    profiler.mark("layout");
 
     // Connect all signals and slots
     //setupConnections();
@@ -91,15 +112,17 @@ MainWindow::MainWindow(QWidget *parent)
     // Set initial states
     updateBinauralPowerState(false);
     updateNaturePowerState(false);
+    profiler.mark("styling");
 
     initializeAudioEngines();
+    profiler.mark("media player");
     addActions();
 
     setupMenus();
-    createInfoDialog();
     setupConnections();
     model = qobject_cast<QStandardItemModel*>(m_waveformCombo->model());
     squareWaveItem = model->item(1);
+    profiler.mark("menus and connections");
 
     // Status bar
     connect(volumeIcon, &QPushButton::clicked, this, &MainWindow::onMuteButtonClicked);
@@ -117,10 +140,17 @@ MainWindow::MainWindow(QWidget *parent)
     statusBar()->addPermanentWidget(m_binauralStatusLabel);
 
     statusBar()->showMessage("Ready to play");
-    showFirstLaunchWarning();
-    createInfoDialog();
     onNaturePowerToggled(false);
-    copyUserFiles();
+    profiler.mark("status bar");
+
+    // Nothing the first frame needs: run once the window is up. The
+    // welcome box is modal, and from here it would block show().
+    QTimer::singleShot(0, this, [this]() {
+        showFirstLaunchWarning();
+        copyUserFiles();
+        // A few ms, instead of on the first ambient file decoded at 48 kHz
+        Resampler::prepareBanks(AmbientClip::SAMPLE_RATE);
+    });
 }
 
 MainWindow::~MainWindow()
@@ -128,6 +158,14 @@ MainWindow::~MainWindow()
        if(m_binauralEngine && m_binauralEngine->isPlaying()) {
            m_binauralEngine->stop();
        }
+       if(m_presetAuditioner) {
+           m_presetAuditioner->stop();
+       }
+       // The analyzer reads the engine's tap ring: stop it before the engine goes
+       if(m_analyzerThread) {
+           m_analyzerThread->quit();
+           m_analyzerThread->wait();
+       }
       // if(m_dynamicEngine && m_dynamicEngine->isPlaying()) {
         //   m_dynamicEngine->stop();
        //}
@@ -352,6 +390,27 @@ QToolBar *MainWindow::createBinauralToolbar()
     m_waveformCombo->setEnabled(false);
     toolbar->addWidget(m_waveformCombo);
 
+    // Masking noise generated by the engine itself
+    m_noiseTypeCombo = new QComboBox(toolbar);
+    m_noiseTypeCombo->addItem("No Noise", NoiseGenerator::NO_NOISE);
+    m_noiseTypeCombo->addItem("White", NoiseGenerator::WHITE_NOISE);
+    m_noiseTypeCombo->addItem("Pink", NoiseGenerator::PINK_NOISE);
+    m_noiseTypeCombo->addItem("Brown", NoiseGenerator::BROWN_NOISE);
+    m_noiseTypeCombo->setMaximumWidth(95);
+    m_noiseTypeCombo->setToolTip("Masking noise mixed with the tones");
+    m_noiseTypeCombo->setEnabled(false);
+    toolbar->addWidget(m_noiseTypeCombo);
+
+    m_noiseLevelInput = new QDoubleSpinBox(toolbar);
+    m_noiseLevelInput->setRange(0.0, 100.0);
+    m_noiseLevelInput->setValue(10.0);
+    m_noiseLevelInput->setDecimals(1);
+    m_noiseLevelInput->setSuffix("%");
+    m_noiseLevelInput->setMaximumWidth(70);
+    m_noiseLevelInput->setToolTip("Noise level (0-100%)");
+    m_noiseLevelInput->setEnabled(false);
+    toolbar->addWidget(m_noiseLevelInput);
+
     //toolbar->addSeparator();
 
     // Volume control
@@ -423,6 +482,8 @@ QToolBar *MainWindow::createBinauralToolbarExt()
         m_waveformCombo->setCurrentIndex(0); // Sine
         m_pulseFreqLabel->setValue(7.83);
         m_binauralVolumeInput->setValue(15.0);
+        m_noiseTypeCombo->setCurrentIndex(0); // No noise
+        m_noiseLevelInput->setValue(10.0);
         updateBinauralBeatDisplay();
         statusBar()->showMessage("Brainwave settings reset to defaults", 3000);
     });
@@ -475,6 +536,12 @@ QToolBar *MainWindow::createBinauralToolbarExt()
     m_countdownLabel->setToolTip("Time remaining until auto-stop");
     m_countdownLabel->setVisible(true); // Only show when timer is active
     toolbar->addWidget(m_countdownLabel);
+    toolbar->addSeparator();
+
+    // Output level meter (fed by the engine's 30 Hz level poll)
+    m_levelMeter = new LevelMeterWidget(toolbar);
+    m_levelMeter->setMaximumWidth(140);
+    toolbar->addWidget(m_levelMeter);
 
 
     return toolbar;
@@ -578,17 +645,38 @@ QToolBar *MainWindow::createNatureToolbar()
     QLabel *playersLabel = new QLabel(toolbar);
     //toolbar->addWidget(playersLabel);
 
-    // Add all 5 ambient player buttons
+    // Add one button per ambient layer, then the button adding another
     if (!m_ambientPlayers.isEmpty()) {
-        QStringList playerOrder = {"player1", "player2", "player3", "player4", "player5"};
-        for (const QString& key : playerOrder) {
-            if (m_ambientPlayers.contains(key)) {
-                toolbar->addWidget(m_ambientPlayers[key]->button());
-            }
+        for (const QString& key : ambientLayerKeys()) {
+            toolbar->addWidget(m_ambientPlayers[key]->button());
         }
+
+        QPushButton *addLayerButton = new QPushButton("+", toolbar);
+        addLayerButton->setToolTip("Add an ambient layer");
+        addLayerButton->setMaximumWidth(30);
+        connect(addLayerButton, &QPushButton::clicked, this, [this]() {
+            if (addAmbientLayer().isEmpty()) {
+                statusBar()->showMessage(QString("At most %1 ambient layers").arg(AmbientMixer::MAX_VOICES));
+                return;
+            }
+            settings.setValue("Ambient/Layers", m_ambientPlayers.size());
+        });
+        m_addAmbientLayerAction = toolbar->addWidget(addLayerButton);
+
+        QPushButton *removeLayerButton = new QPushButton("−", toolbar);
+        removeLayerButton->setToolTip("Remove the last ambient layer");
+        removeLayerButton->setMaximumWidth(30);
+        connect(removeLayerButton, &QPushButton::clicked, this, [this]() {
+            if (!removeAmbientLayer(ambientLayerKeys().last())) {
+                statusBar()->showMessage("At least one ambient layer");
+                return;
+            }
+            settings.setValue("Ambient/Layers", m_ambientPlayers.size());
+        });
+        m_removeAmbientLayerAction = toolbar->addWidget(removeLayerButton);
     } else {
         // Fallback: create placeholder buttons if map is empty
-        for (int i = 1; i <= 5; i++) {
+        for (int i = 1; i <= DEFAULT_AMBIENT_LAYERS; i++) {
             QPushButton* placeholder = new QPushButton(QString("P%1").arg(i), toolbar);
             placeholder->setEnabled(false);
             placeholder->setStyleSheet("QPushButton { color: gray; }");
@@ -806,6 +894,10 @@ void MainWindow::setupConnections()
             this, &MainWindow::onWaveformChanged);
     connect(m_binauralVolumeInput, QOverload<double>::of(&QDoubleSpinBox::valueChanged),
             this, &MainWindow::onBinauralVolumeChanged);
+    connect(m_noiseTypeCombo, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &MainWindow::onNoiseTypeChanged);
+    connect(m_noiseLevelInput, QOverload<double>::of(&QDoubleSpinBox::valueChanged),
+            this, &MainWindow::onNoiseLevelChanged);
     connect(m_binauralPlayButton, &QPushButton::clicked, this, &MainWindow::onBinauralPlayClicked);
     connect(m_binauralStopButton, &QPushButton::clicked, this, &MainWindow::onBinauralStopClicked);
 
@@ -835,8 +927,10 @@ void MainWindow::setupConnections()
     connect(m_trackInfoButton, &QPushButton::clicked, [this](bool checked){
         if(checked){
             //trackInfoDialog->exec();
+            createInfoDialog();
+            metadataBrowser->setText(currentTrackMetadata);
             trackInfoDialog->show();
-        }else{
+        }else if (trackInfoDialog) {
             trackInfoDialog->hide();
         }
     });
@@ -854,10 +948,13 @@ void MainWindow::setupConnections()
             this, &MainWindow::onBinauralPlaybackStopped);
     connect(m_binauralEngine, &DynamicEngine::errorOccurred,
             this, &MainWindow::onBinauralError);
+    connect(m_binauralEngine, &DynamicEngine::audioLevelsChanged,
+            m_levelMeter, &LevelMeterWidget::setLevels);
 
     //save-load connections
     connect(savePresetAction, &QAction::triggered, this, &MainWindow::onSavePresetClicked);
     connect(loadPresetAction, &QAction::triggered, this, &MainWindow::onLoadPresetClicked);
+    connect(auditionPresetAction, &QAction::triggered, this, &MainWindow::onAuditionPresetClicked);
     connect(managePresetsAction, &QAction::triggered, this, &MainWindow::onManagePresetsClicked);
 
     connect(openPlaylistAction, &QAction::triggered, this, &MainWindow::onOpenPlaylistClicked);
@@ -912,7 +1009,9 @@ void MainWindow::updateBinauralBeatDisplay()
     double rightFreq = m_rightFreqInput->value();
     double beatFreq = qAbs(rightFreq - leftFreq);
 
+    // Nominal value; replaced by the measured one while tones play
     m_beatFreqLabel->setText(QString("%1 Hz").arg(beatFreq, 0, 'f', 2));
+    m_beatFreqLabel->setToolTip("Binaural beat frequency (Right - Left)");
     //m_beatFreqLabel->setValue(beatFreq);
 
 }
@@ -923,6 +1022,8 @@ void MainWindow::updateBinauralPowerState(bool enabled)
     m_leftFreqInput->setEnabled(enabled);
     m_rightFreqInput->setEnabled(enabled);
     m_waveformCombo->setEnabled(enabled);
+    m_noiseTypeCombo->setEnabled(enabled);
+    m_noiseLevelInput->setEnabled(enabled);
     m_binauralVolumeInput->setEnabled(enabled);
     m_binauralPlayButton->setEnabled(enabled);
     m_binauralStopButton->setEnabled(enabled);
@@ -963,6 +1064,11 @@ void MainWindow::updateNaturePowerState(bool enabled)
             player->setEnabled(enabled);
         }
     }
+    if (!enabled) {
+        for (AmbientScatterLayer* layer : std::as_const(m_scatterLayers)) {
+            layer->stop();
+        }
+    }
 
     // 3. Update player buttons in toolbar (they should auto-update via AmbientPlayer)
     // No action needed - AmbientPlayer handles its own button updates
@@ -1146,6 +1252,18 @@ void MainWindow::onBinauralVolumeChanged(double value)
     //m_binauralStatusLabel->setText(QString("Binaural volume: %1%").arg(value));
 }
 
+void MainWindow::onNoiseTypeChanged(int index)
+{
+    auto type = static_cast<NoiseGenerator::NoiseType>(m_noiseTypeCombo->itemData(index).toInt());
+    m_binauralEngine->setNoiseType(type);
+    m_binauralEngine->setNoiseLevel(m_noiseLevelInput->value() / 100.0);
+}
+
+void MainWindow::onNoiseLevelChanged(double value)
+{
+    m_binauralEngine->setNoiseLevel(value / 100.0); // Convert percentage to 0.0-1.0
+}
+
 void MainWindow::onBinauralPlayClicked()
 {
 
@@ -1240,6 +1358,12 @@ void MainWindow::onNaturePowerToggled(bool checked)
             player->button()->setEnabled(checked);
         }
     }
+    if (m_addAmbientLayerAction) {
+        m_addAmbientLayerAction->setEnabled(checked);
+    }
+    if (m_removeAmbientLayerAction) {
+        m_removeAmbientLayerAction->setEnabled(checked);
+    }
 }
 
 \
@@ -1252,6 +1376,14 @@ void MainWindow::onBinauralPlaybackStarted()
     //m_binauralPlayButton->setText("⏸");
     //m_binauralPlayButton->setToolTip("Pause binaural tones");
     m_binauralStatusLabel->setText(formatBinauralString());
+
+    // Measure what is actually played from here on
+    ensureSpectrumAnalyzer();
+    m_binauralEngine->setAnalysisEnabled(true);
+    QMetaObject::invokeMethod(m_spectrumAnalyzer, [this, rate = m_binauralEngine->getSampleRate()]() {
+        m_spectrumAnalyzer->setSampleRate(rate);
+        m_spectrumAnalyzer->start();
+    }, Qt::QueuedConnection);
 }
 
 void MainWindow::onBinauralPlaybackStopped()
@@ -1259,6 +1391,15 @@ void MainWindow::onBinauralPlaybackStopped()
     //m_binauralPlayButton->setText("▶");
     m_binauralPlayButton->setToolTip("Start binaural tones");
     m_binauralStatusLabel->setText("Binaural tones stopped");
+
+    if (m_spectrumAnalyzer) {
+        m_binauralEngine->setAnalysisEnabled(false);
+        QMetaObject::invokeMethod(m_spectrumAnalyzer, &SpectrumAnalyzer::stop, Qt::QueuedConnection);
+        if (m_spectrumWidget) {
+            m_spectrumWidget->clear();
+        }
+        updateBinauralBeatDisplay();
+    }
 }
 
 void MainWindow::onBinauralError(const QString &error)
@@ -1479,6 +1620,7 @@ void MainWindow::onBrainwaveDurationChanged(int minutes) {
 //mediaplayer
 void MainWindow::onMediaStatusChanged(QMediaPlayer::MediaStatus status)
 {
+    BINAURAL_TRACE_SCOPE("media", "MainWindow::onMediaStatusChanged", "status", status);
 
     switch (status) {
     case QMediaPlayer::LoadingMedia:
@@ -1518,6 +1660,7 @@ void MainWindow::onMediaStatusChanged(QMediaPlayer::MediaStatus status)
 
 void MainWindow::onPlaybackStateChanged(QMediaPlayer::PlaybackState state)
 {
+    BINAURAL_TRACE_SCOPE("media", "MainWindow::onPlaybackStateChanged", "state", state);
     switch (state) {
        case QMediaPlayer::PlayingState:
            // Playing: can pause, can't play again
@@ -1544,10 +1687,21 @@ void MainWindow::onPlaybackStateChanged(QMediaPlayer::PlaybackState state)
 
            break;
        }
+    updateAmbientDuck();
+}
+
+void MainWindow::updateAmbientDuck()
+{
+    if (!m_ambientVoicePool) {
+        return;
+    }
+    const bool musicPlaying = m_mediaPlayer && m_mediaPlayer->playbackState() == QMediaPlayer::PlayingState;
+    m_ambientVoicePool->mixer()->setDuck(AmbientMixer::DUCK_MUSIC, m_duckAmbientUnderMusic && musicPlaying);
 }
 
 void MainWindow::onMediaPlayerError(QMediaPlayer::Error error, const QString &errorString)
 {
+    BINAURAL_TRACE_INSTANT("media", "MainWindow::onMediaPlayerError", "error", error);
     Q_UNUSED(error);
     statusBar()->showMessage("Media error: " + errorString, 5000);
 }
@@ -1556,6 +1710,7 @@ void MainWindow::onMediaPlayerError(QMediaPlayer::Error error, const QString &er
 
 void MainWindow::playNextTrack()
 {
+    BINAURAL_TRACE_SCOPE("gui", "MainWindow::playNextTrack");
     QListWidget *playlist = currentPlaylistWidget();
     QString playlistName = currentPlaylistName();
 
@@ -1699,6 +1854,7 @@ void MainWindow::onPlaylistItemClicked(QListWidgetItem *item)
 
 void MainWindow::onDurationChanged(qint64 durationMs)
 {
+    BINAURAL_TRACE_SCOPE("gui", "MainWindow::onDurationChanged");
 
     if (durationMs <= 0) {
         m_totalTimeLabel->setText("00:00");
@@ -1737,6 +1893,7 @@ void MainWindow::onDurationChanged(qint64 durationMs)
 
 void MainWindow::onPositionChanged(qint64 positionMs)
 {
+    BINAURAL_TRACE_SCOPE("gui", "MainWindow::onPositionChanged");
     // Don't update slider if user is dragging it
     if (m_seekSlider->isSliderDown()) {
         return;
@@ -1825,6 +1982,7 @@ void MainWindow::playPreviousTrack()
 
 void MainWindow::playPreviousTrack()
 {
+    BINAURAL_TRACE_SCOPE("gui", "MainWindow::playPreviousTrack");
     QListWidget *playlist = currentPlaylistWidget();
     QString playlistName = currentPlaylistName();
 
@@ -1876,6 +2034,7 @@ void MainWindow::onToneTypeComboIndexChanged(int index)
 
     case BINAURAL:
         ConstantGlobals::currentToneType = 0;  // Set to 0
+        m_binauralEngine->setToneMode(DynamicEngine::BINAURAL_TONE);
 
         //m_binauralEngine->forceBufferRegeneration();
 
@@ -1887,6 +2046,7 @@ void MainWindow::onToneTypeComboIndexChanged(int index)
         break;
     case ISOCHRONIC:
         ConstantGlobals::currentToneType = 1;  // Set to 0
+        m_binauralEngine->setToneMode(DynamicEngine::ISOCHRONIC_TONE);
 
         //m_binauralEngine->forceBufferRegeneration();
 
@@ -1900,6 +2060,7 @@ void MainWindow::onToneTypeComboIndexChanged(int index)
     case GENERATOR:
 
         ConstantGlobals::currentToneType = 2;  // Set to 0
+        m_binauralEngine->setToneMode(DynamicEngine::GENERATOR_TONE);
 
         //m_binauralEngine->forceBufferRegeneration();
 
@@ -1927,13 +2088,12 @@ void MainWindow::onMuteButtonClicked()
     //m_masterStopButton->setDisabled(checked);
     //m_stopMusicButton->setDisabled(true);
 
-    QAudioSink* binauralOutput = m_binauralEngine ?
-                                       m_binauralEngine->audioOutput() : nullptr;
+    // The engine ramps its own gain, so muting never clicks and survives
+    // a restart of the tones
+    m_binauralEngine->setMuted(checked);
     if(checked) {
 
-        if(binauralOutput){
-            binEngineVolume = binauralOutput->volume();
-            binauralOutput->setVolume(0);
+        if(m_binauralEngine->isPlaying()){
             m_binauralStopButton->setDisabled(true);
 
         }
@@ -1949,8 +2109,7 @@ void MainWindow::onMuteButtonClicked()
         m_stopMusicButton->setEnabled(true);
         m_masterStopButton->setEnabled(true);
 
-        if(binauralOutput){
-            binauralOutput->setVolume(binEngineVolume);
+        if(m_binauralEngine->isPlaying()){
             m_binauralStopButton->setEnabled(true);
 
         }
@@ -1964,6 +2123,7 @@ void MainWindow::onMuteButtonClicked()
 
 void MainWindow::playRandomTrack()
 {
+    BINAURAL_TRACE_SCOPE("gui", "MainWindow::playRandomTrack");
     // Check current playlist
     QString playlistName = m_currentPlaylistName;
     if (playlistName.isEmpty() || !m_playlistFiles.contains(playlistName)) {
@@ -2290,59 +2450,6 @@ void MainWindow::updatePlaylistButtonsState() {
 
 ////////////////////save-load
 
-QJsonObject MainWindow::BrainwavePreset::toJson() const {
-    QJsonObject json;
-    json["name"] = name;
-    json["toneType"] = toneType;
-    json["leftFrequency"] = leftFrequency;
-    json["rightFrequency"] = rightFrequency;
-    json["waveform"] = waveform;
-    json["pulseFrequency"] = pulseFrequency;
-    json["volume"] = volume;
-    json["version"] = "1.0";
-    json["created"] = QDateTime::currentDateTime().toString(Qt::ISODate);
-    return json;
-}
-
-MainWindow::BrainwavePreset MainWindow::BrainwavePreset::fromJson(const QJsonObject &json) {
-    BrainwavePreset preset;
-    preset.name = json["name"].toString();
-    preset.toneType = json["toneType"].toInt();
-    preset.leftFrequency = json["leftFrequency"].toDouble();
-    preset.rightFrequency = json["rightFrequency"].toDouble();
-    preset.waveform = json["waveform"].toInt();
-    preset.pulseFrequency = json["pulseFrequency"].toDouble();
-    preset.volume = json["volume"].toDouble();
-    return preset;
-}
-
-bool MainWindow::BrainwavePreset::isValid() const {
-    return !name.isEmpty() &&
-           toneType >= 0 && toneType <= 2 &&
-           leftFrequency >= 20.0 && leftFrequency <= 20000.0 &&
-           rightFrequency >= 20.0 && rightFrequency <= 20000.0 &&
-           waveform >= 0 && waveform <= 3 &&
-           pulseFrequency >= 0.0 && pulseFrequency <= 100.0 &&
-           volume >= 0.0 && volume <= 100.0;
-}
-
-// PlaylistTrack methods
-QJsonObject MainWindow::PlaylistTrack::toJson() const {
-    QJsonObject json;
-    json["filePath"] = filePath;
-    json["title"] = title;
-    json["duration"] = duration;
-    return json;
-}
-
-MainWindow::PlaylistTrack MainWindow::PlaylistTrack::fromJson(const QJsonObject &json) {
-    PlaylistTrack track;
-    track.filePath = json["filePath"].toString();
-    track.title = json["title"].toString();
-    track.duration = json["duration"].toVariant().toLongLong();
-    return track;
-}
-
 // =================== HELPER METHODS ===================
 
 QString MainWindow::generateDefaultPresetName() const {
@@ -2405,6 +2512,8 @@ void MainWindow::onSavePresetClicked() {
     preset.waveform = m_waveformCombo->currentIndex();
     preset.pulseFrequency = m_pulseFreqLabel->value();
     preset.volume = m_binauralVolumeInput->value();
+    preset.noiseType = m_noiseTypeCombo->currentData().toInt();
+    preset.noiseLevel = m_noiseLevelInput->value();
 
     // Validate
     if (!preset.isValid()) {
@@ -2422,7 +2531,7 @@ void MainWindow::onSavePresetClicked() {
 
     // Save to file
     QString filename = ConstantGlobals::presetFilePath + "/" + presetName + ".json";
-    if (savePresetToFile(filename, preset)) {
+    if (preset.saveToFile(filename)) {
         statusBar()->showMessage("Preset saved: " + presetName, 3000);
     } else {
         QMessageBox::warning(this, "Save Error",
@@ -2430,7 +2539,7 @@ void MainWindow::onSavePresetClicked() {
     }
 }
 
-void MainWindow::onLoadPresetClicked() {
+QString MainWindow::choosePresetFile(const QString &title, const QString &label) {
     // Get list of preset files
     QDir presetDir(ConstantGlobals::presetFilePath + "/");
     QStringList presetFiles = presetDir.entryList({"*.json"}, QDir::Files);
@@ -2438,7 +2547,7 @@ void MainWindow::onLoadPresetClicked() {
     if (presetFiles.isEmpty()) {
         QMessageBox::information(this, "No Presets",
             "No saved presets found in:\n" + ConstantGlobals::presetFilePath);
-        return;
+        return QString();
     }
 
     // Show selection dialog
@@ -2450,8 +2559,8 @@ void MainWindow::onLoadPresetClicked() {
     bool ok;
     QString selectedPreset = QInputDialog::getItem(
         this,
-        "Load Preset",
-        "Select preset to load:",
+        title,
+        label,
         presetNames,
         0,
         false,
@@ -2459,12 +2568,20 @@ void MainWindow::onLoadPresetClicked() {
     );
 
     if (!ok || selectedPreset.isEmpty()) {
+        return QString();
+    }
+
+    return ConstantGlobals::presetFilePath + "/" + selectedPreset + ".json";
+}
+
+void MainWindow::onLoadPresetClicked() {
+    QString filename = choosePresetFile("Load Preset", "Select preset to load:");
+    if (filename.isEmpty()) {
         return;
     }
 
     // Load preset
-    QString filename = ConstantGlobals::presetFilePath + "/" + selectedPreset + ".json";
-    BrainwavePreset preset = loadPresetFromFile(filename);
+    BrainwavePreset preset = BrainwavePreset::loadFromFile(filename);
 
     if (!preset.isValid()) {
         QMessageBox::warning(this, "Load Error",
@@ -2481,11 +2598,15 @@ void MainWindow::onLoadPresetClicked() {
     // Update UI
     ConstantGlobals::currentToneType = preset.toneType;
     toneTypeCombo->setCurrentIndex(preset.toneType);
+    // No combo signal when the type is unchanged
+    m_binauralEngine->setToneMode(static_cast<DynamicEngine::ToneMode>(preset.toneType));
     m_leftFreqInput->setValue(preset.leftFrequency);
     m_rightFreqInput->setValue(preset.rightFrequency);
     m_waveformCombo->setCurrentIndex(preset.waveform);
     m_pulseFreqLabel->setValue(preset.pulseFrequency);
     m_binauralVolumeInput->setValue(preset.volume);
+    m_noiseLevelInput->setValue(preset.noiseLevel);
+    m_noiseTypeCombo->setCurrentIndex(m_noiseTypeCombo->findData(preset.noiseType));
 
     // Update display
     updateBinauralBeatDisplay();
@@ -2498,68 +2619,40 @@ void MainWindow::onLoadPresetClicked() {
     statusBar()->showMessage("Preset loaded: " + preset.name, 3000);
 }
 
-void MainWindow::onManagePresetsClicked() {
-    // Open preset folder in system file explorer
-    QUrl presetUrl = QUrl::fromLocalFile(ConstantGlobals::presetFilePath);
-    QDesktopServices::openUrl(presetUrl);
-}
-
-bool MainWindow::savePresetToFile(const QString &filename, const BrainwavePreset &preset) {
-    QFile file(filename);
-    if (!file.open(QIODevice::WriteOnly)) {
-        qWarning() << "Could not open preset file for writing:" << filename;
-        return false;
-    }
-
-    QJsonObject json = preset.toJson();
-    QJsonDocument doc(json);
-    file.write(doc.toJson(QJsonDocument::Indented));
-    file.close();
-
-    return true;
-}
-
-MainWindow::BrainwavePreset MainWindow::loadPresetFromFile(const QString &filename) {
-    QFile file(filename);
-    if (!file.open(QIODevice::ReadOnly)) {
-        qWarning() << "Could not open preset file:" << filename;
-        return BrainwavePreset();
+void MainWindow::onAuditionPresetClicked() {
+    QString filename = choosePresetFile("Audition Preset", "Select preset to preview:");
+    if (filename.isEmpty()) {
+        return;
     }
 
-    QByteArray data = file.readAll();
-    file.close();
-
-    QJsonParseError error;
-    QJsonDocument doc = QJsonDocument::fromJson(data, &error);
-
-    if (error.error != QJsonParseError::NoError) {
-        qWarning() << "JSON parse error in preset file:" << error.errorString();
-        return BrainwavePreset();
+    BrainwavePreset preset = BrainwavePreset::loadFromFile(filename);
+    if (!preset.isValid()) {
+        QMessageBox::warning(this, "Audition Error",
+            "Failed to load preset or preset is invalid.");
+        return;
     }
 
-    if (!doc.isObject()) {
-        qWarning() << "Preset file is not a valid JSON object";
-        return BrainwavePreset();
+    if (!m_presetAuditioner) {
+        m_presetAuditioner = new PresetAuditioner(this);
+        connect(m_presetAuditioner, &PresetAuditioner::errorOccurred,
+                this, &MainWindow::onBinauralError);
     }
 
-    BrainwavePreset preset = BrainwavePreset::fromJson(doc.object());
-    return preset;
-}
-
-QList<MainWindow::BrainwavePreset> MainWindow::loadAllPresets() {
-    QList<BrainwavePreset> presets;
-    QDir presetDir(ConstantGlobals::presetFilePath);
+    // Configure the audition engine only: the session engine and UI are untouched
+    preset.applyTo(m_presetAuditioner->engine());
 
-    QStringList presetFiles = presetDir.entryList({"*.json"}, QDir::Files);
-    foreach (const QString &file, presetFiles) {
-        QString filepath = ConstantGlobals::presetFilePath + file;
-        BrainwavePreset preset = loadPresetFromFile(filepath);
-        if (preset.isValid()) {
-            presets.append(preset);
-        }
+    // Never louder than the preset itself
+    m_presetAuditioner->setVolume(qMin(PresetAuditioner::DEFAULT_VOLUME, preset.volume / 100.0));
+    if (m_presetAuditioner->audition()) {
+        statusBar()->showMessage("Auditioning preset: " + preset.name,
+                                 PresetAuditioner::DEFAULT_DURATION_MS);
     }
+}
 
-    return presets;
+void MainWindow::onManagePresetsClicked() {
+    // Open preset folder in system file explorer
+    QUrl presetUrl = QUrl::fromLocalFile(ConstantGlobals::presetFilePath);
+    QDesktopServices::openUrl(presetUrl);
 }
 
 // =================== PLAYLIST OPERATIONS ===================
@@ -2673,6 +2766,7 @@ void MainWindow::onSaveAllPlaylistsClicked() {
 }
 
 bool MainWindow::savePlaylistToFile(const QString &filename, const QString &playlistName) {
+    BINAURAL_TRACE_SCOPE("gui", "MainWindow::savePlaylistToFile");
     QListWidget *playlist = currentPlaylistWidget();
     if (!playlist || playlist->count() == 0) {
         statusBar()->showMessage("Playlist is empty", 2000);
@@ -2682,74 +2776,26 @@ bool MainWindow::savePlaylistToFile(const QString &filename, const QString &play
     // Get file paths from data structure
     QStringList filePaths = m_playlistFiles.value(playlistName, QStringList());
 
-    // Create JSON document
-    QJsonObject playlistJson;
-    playlistJson["name"] = playlistName;
-    playlistJson["version"] = "1.0";
-    playlistJson["created"] = QDateTime::currentDateTime().toString(Qt::ISODate);
-    playlistJson["trackCount"] = filePaths.size();
-
-    QJsonArray tracksArray;
+    PlaylistFile playlistFile;
+    playlistFile.name = playlistName;
     for (int i = 0; i < playlist->count() && i < filePaths.size(); ++i) {
-        QListWidgetItem *item = playlist->item(i);
-
         PlaylistTrack track;
         track.filePath = filePaths.at(i);
-        track.title = item->text();
-
-        // Try to get duration if we have a media player
-        // (This could be enhanced to read actual file metadata)
-        track.duration = 0;
-
-        tracksArray.append(track.toJson());
-    }
-
-    playlistJson["tracks"] = tracksArray;
-
-    // Write to file
-    QFile file(filename);
-    if (!file.open(QIODevice::WriteOnly)) {
-        qWarning() << "Could not open playlist file for writing:" << filename;
-        return false;
+        track.title = playlist->item(i)->text();
+        playlistFile.tracks.append(track);
     }
 
-    QJsonDocument doc(playlistJson);
-    file.write(doc.toJson(QJsonDocument::Indented));
-    file.close();
-
-    return true;
+    return playlistFile.saveToFile(filename);
 }
 
 bool MainWindow::loadPlaylistFromFile(const QString &filename) {
-    QFile file(filename);
-    if (!file.open(QIODevice::ReadOnly)) {
-        qWarning() << "Could not open playlist file:" << filename;
+    BINAURAL_TRACE_SCOPE("gui", "MainWindow::loadPlaylistFromFile");
+    PlaylistFile playlistFile;
+    if (!PlaylistFile::loadFromFile(filename, playlistFile)) {
         return false;
     }
 
-    QByteArray data = file.readAll();
-    file.close();
-
-    QJsonParseError error;
-    QJsonDocument doc = QJsonDocument::fromJson(data, &error);
-
-    if (error.error != QJsonParseError::NoError) {
-        qWarning() << "JSON parse error in playlist file:" << error.errorString();
-        return false;
-    }
-
-    if (!doc.isObject()) {
-        qWarning() << "Playlist file is not a valid JSON object";
-        return false;
-    }
-
-    QJsonObject playlistJson = doc.object();
-    QString playlistName = playlistJson["name"].toString();
-
-    if (playlistName.isEmpty()) {
-        // Use filename as playlist name
-        playlistName = QFileInfo(filename).completeBaseName();
-    }
+    QString playlistName = playlistFile.name;
 
     // Check if playlist already exists
     for (int i = 0; i < m_playlistTabs->count(); ++i) {
@@ -2807,10 +2853,7 @@ bool MainWindow::loadPlaylistFromFile(const QString &filename) {
     m_playlistFiles[playlistName].clear();
 
     // Load tracks
-    QJsonArray tracksArray = playlistJson["tracks"].toArray();
-    foreach (const QJsonValue &trackValue, tracksArray) {
-        PlaylistTrack track = PlaylistTrack::fromJson(trackValue.toObject());
-
+    for (const PlaylistTrack &track : playlistFile.tracks) {
         // Add to UI
         playlist->addItem(track.title);
 
@@ -2846,6 +2889,10 @@ void MainWindow::addActions()
     loadPresetAction->setStatusTip("Load a saved brainwave preset");
     loadPresetAction->setIcon(QIcon(":/icons/folder.svg")); // Optional
 
+    auditionPresetAction = new QAction("&Audition Preset...", this);
+    auditionPresetAction->setStatusTip("Preview a saved preset quietly without interrupting playback");
+    auditionPresetAction->setIcon(QIcon(":/icons/headphones.svg")); // Optional
+
     managePresetsAction = new QAction("&Manage Presets...", this);
     managePresetsAction->setStatusTip("Open presets folder in file explorer");
     managePresetsAction->setIcon(QIcon(":/icons/settings.svg")); // Optional
@@ -2936,6 +2983,40 @@ void MainWindow::setupMenus()
         settings.setValue("UI/NatureToolbarHidden", checked);
     });
     viewMenu->addAction(hideNatureToolbarAction);
+    viewMenu->addSeparator();
+
+    QAction *oscilloscopeAction = new QAction("Oscilloscope", viewMenu);
+    oscilloscopeAction->setIcon(QIcon(":/icons/activity.svg"));
+    oscilloscopeAction->setStatusTip("Show the brainwave output as a scope or Lissajous figure");
+    connect(oscilloscopeAction, &QAction::triggered, this, &MainWindow::showOscilloscope);
+    viewMenu->addAction(oscilloscopeAction);
+
+    QAction *spectrumAction = new QAction("Spectrum Analyzer", viewMenu);
+    spectrumAction->setIcon(QIcon(":/icons/bar-chart-2.svg"));
+    spectrumAction->setStatusTip("Show the output spectrum with measured carrier and beat frequencies");
+    connect(spectrumAction, &QAction::triggered, this, &MainWindow::showSpectrumAnalyzer);
+    viewMenu->addAction(spectrumAction);
+
+    // Only offered when the session is being traced (BINAURAL_TRACE)
+    if (TraceRecorder::isEnabled()) {
+        viewMenu->addSeparator();
+        QAction *saveTraceAction = new QAction("Save Trace...", viewMenu);
+        saveTraceAction->setStatusTip("Save the timeline recorded so far as Chrome trace JSON");
+        connect(saveTraceAction, &QAction::triggered, this, [this]() {
+            QString filename = QFileDialog::getSaveFileName(this, "Save Trace",
+                                                            TraceRecorder::instance().outputPath(),
+                                                            "Chrome trace (*.json)");
+            if (filename.isEmpty()) {
+                return;
+            }
+            if (TraceRecorder::instance().dump(filename)) {
+                statusBar()->showMessage("Trace saved to " + filename, 3000);
+            } else {
+                QMessageBox::warning(this, "Save Trace", "Could not write " + filename);
+            }
+        });
+        viewMenu->addAction(saveTraceAction);
+    }
     //
 
     // ========== Settings Menu =========
@@ -2966,12 +3047,24 @@ void MainWindow::setupMenus()
     });
     settingsMenu->addAction(factoryResetAction);
 
+    QAction *duckAmbientAction = new QAction("Duck Nature Sounds Under Music", settingsMenu);
+    duckAmbientAction->setCheckable(true);
+    duckAmbientAction->setChecked(m_duckAmbientUnderMusic);
+    duckAmbientAction->setStatusTip("Lower the nature sounds smoothly while music plays");
+    connect(duckAmbientAction, &QAction::triggered, this, [this](bool checked) {
+        m_duckAmbientUnderMusic = checked;
+        settings.setValue("Ambient/DuckUnderMusic", checked);
+        updateAmbientDuck();
+    });
+    settingsMenu->addAction(duckAmbientAction);
+
     // ========== PRESETS MENU ==========
     QMenu *presetsMenu = menuBar()->addMenu("&Presets");
 
     // Brainwave preset operations
     presetsMenu->addAction(savePresetAction);
     presetsMenu->addAction(loadPresetAction);
+    presetsMenu->addAction(auditionPresetAction);
     presetsMenu->addSeparator();
     //presetsMenu->addAction(managePresetsAction);
     //presetsMenu->addSeparator();
@@ -3004,6 +3097,8 @@ void MainWindow::setupMenus()
         m_waveformCombo->setCurrentIndex(0); // Sine
         m_pulseFreqLabel->setValue(7.83);
         m_binauralVolumeInput->setValue(15.0);
+        m_noiseTypeCombo->setCurrentIndex(0); // No noise
+        m_noiseLevelInput->setValue(10.0);
         updateBinauralBeatDisplay();
         statusBar()->showMessage("Brainwave settings reset to defaults", 3000);
     });
@@ -3148,6 +3243,7 @@ void MainWindow::onStreamFromUrl()
 
 void MainWindow::playRemoteStream(const QString &urlString)
 {
+    BINAURAL_TRACE_SCOPE("gui", "MainWindow::playRemoteStream");
     if (!m_mediaPlayer) {
         m_mediaPlayer = new QMediaPlayer(this);
         m_audioOutput = new QAudioOutput(this);
@@ -3233,6 +3329,7 @@ void MainWindow::onFileOpened(const QString &filePath)
 
 //metadata for playing track
 QString MainWindow::getTrackMetadata() {
+    BINAURAL_TRACE_SCOPE("gui", "MainWindow::getTrackMetadata");
     metaData = m_mediaPlayer->metaData();
 
     QString displayMetaData = "Metadata:\n";
@@ -3350,6 +3447,7 @@ QString MainWindow::getTrackMetadata() {
 
 
 void MainWindow::handleMetaDataUpdated() {
+    BINAURAL_TRACE_SCOPE("gui", "MainWindow::handleMetaDataUpdated");
     // Metadata is now guaranteed to be available (or updated)
     currentTrackMetadata = getTrackMetadata();
     if (trackInfoDialog) {
@@ -3366,6 +3464,10 @@ void MainWindow::handleMetaDataUpdated() {
 }
 
 void MainWindow::createInfoDialog() {
+    // Built the first time the track info button is checked
+    if (trackInfoDialog) {
+        return;
+    }
 
     trackInfoDialog = new QDialog(this);
     trackInfoDialog->setWindowTitle("Track Information");
@@ -3390,39 +3492,278 @@ void MainWindow::createInfoDialog() {
 
 }
 
+void MainWindow::showOscilloscope()
+{
+    // Built on first use; the scope only taps the engine while visible
+    if (!m_scopeDialog) {
+        m_scopeDialog = new QDialog(this);
+        m_scopeDialog->setWindowTitle("Oscilloscope");
+        m_scopeDialog->setWindowModality(Qt::NonModal);
+
+        m_oscilloscope = new OscilloscopeWidget(m_scopeDialog);
+        m_oscilloscope->setSource(m_binauralEngine->scopeRing(),
+                                  m_binauralEngine->scopeSampleRate());
+        connect(m_oscilloscope, &OscilloscopeWidget::activeChanged,
+                m_binauralEngine, &DynamicEngine::setScopeEnabled);
+
+        QComboBox *modeCombo = new QComboBox(m_scopeDialog);
+        modeCombo->addItem("Scope (L/R vs time)", OscilloscopeWidget::SCOPE_MODE);
+        modeCombo->addItem("Lissajous (L vs R)", OscilloscopeWidget::LISSAJOUS_MODE);
+        connect(modeCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this, modeCombo](int index) {
+            m_oscilloscope->setDisplayMode(
+                static_cast<OscilloscopeWidget::DisplayMode>(modeCombo->itemData(index).toInt()));
+        });
+
+        QDoubleSpinBox *windowInput = new QDoubleSpinBox(m_scopeDialog);
+        windowInput->setRange(1.0, 100.0);
+        windowInput->setValue(10.0);
+        windowInput->setDecimals(1);
+        windowInput->setSuffix(" ms");
+        windowInput->setToolTip("Scope time window");
+        connect(windowInput, QOverload<double>::of(&QDoubleSpinBox::valueChanged),
+                m_oscilloscope, &OscilloscopeWidget::setTimeWindowMs);
+
+        QHBoxLayout *controlsLayout = new QHBoxLayout();
+        controlsLayout->addWidget(modeCombo);
+        controlsLayout->addStretch();
+        controlsLayout->addWidget(new QLabel("Window:", m_scopeDialog));
+        controlsLayout->addWidget(windowInput);
+
+        QVBoxLayout *layout = new QVBoxLayout(m_scopeDialog);
+        layout->addLayout(controlsLayout);
+        layout->addWidget(m_oscilloscope, 1);
+        m_scopeDialog->resize(520, 380);
+    }
+
+    m_scopeDialog->show();
+    m_scopeDialog->raise();
+    m_scopeDialog->activateWindow();
+}
+
+void MainWindow::ensureSpectrumAnalyzer()
+{
+    if (m_spectrumAnalyzer) {
+        return;
+    }
+
+    m_analyzerThread = new QThread(this);
+    m_analyzerThread->setObjectName("SpectrumAnalyzer");
+
+    m_spectrumAnalyzer = new SpectrumAnalyzer(m_binauralEngine->analysisRing(),
+                                              m_binauralEngine->getSampleRate());
+    m_spectrumAnalyzer->moveToThread(m_analyzerThread);
+    connect(m_analyzerThread, &QThread::finished, m_spectrumAnalyzer, &QObject::deleteLater);
+    connect(m_spectrumAnalyzer, &SpectrumAnalyzer::resultReady,
+            this, &MainWindow::onSpectrumResultReady, Qt::QueuedConnection);
+
+    m_analyzerThread->start(QThread::LowPriority);
+}
+
+void MainWindow::onSpectrumResultReady()
+{
+    if (!m_spectrumAnalyzer || !m_binauralEngine->isPlaying()
+        || !m_spectrumAnalyzer->latestResult(m_spectrumResult)) {
+        return;
+    }
+
+    if (m_spectrumDialog && m_spectrumDialog->isVisible()) {
+        m_spectrumWidget->setResult(m_spectrumResult);
+    }
+
+    // Isochronic tones share one carrier: the audible rate is the pulse
+    if (ConstantGlobals::currentToneType == 1) {
+        if (m_spectrumResult.modulationValid) {
+            m_beatFreqLabel->setText(QString("%1 Hz").arg(m_spectrumResult.modulationFrequency, 0, 'f', 2));
+            m_beatFreqLabel->setToolTip("Measured pulse frequency of the output");
+        }
+    } else if (m_spectrumResult.carriersValid) {
+        m_beatFreqLabel->setText(QString("%1 Hz").arg(m_spectrumResult.beatFrequency, 0, 'f', 2));
+        m_beatFreqLabel->setToolTip("Measured beat frequency of the output (Right - Left carrier)");
+    }
+}
+
+void MainWindow::showSpectrumAnalyzer()
+{
+    // Built on first use; analysis itself runs whenever tones play
+    if (!m_spectrumDialog) {
+        m_spectrumDialog = new QDialog(this);
+        m_spectrumDialog->setWindowTitle("Spectrum Analyzer");
+        m_spectrumDialog->setWindowModality(Qt::NonModal);
+
+        m_spectrumWidget = new SpectrumWidget(m_spectrumDialog);
+
+        QVBoxLayout *layout = new QVBoxLayout(m_spectrumDialog);
+        layout->addWidget(m_spectrumWidget, 1);
+        m_spectrumDialog->resize(640, 380);
+    }
+
+    if (m_spectrumAnalyzer && m_spectrumAnalyzer->latestResult(m_spectrumResult)
+        && m_binauralEngine->isPlaying()) {
+        m_spectrumWidget->setResult(m_spectrumResult);
+    }
+
+    m_spectrumDialog->show();
+    m_spectrumDialog->raise();
+    m_spectrumDialog->activateWindow();
+}
+
 ////////   ambience
 
 void MainWindow::setupAmbientPlayers()
 {
-    // Create 5 ambient players
-    for (int i = 1; i <= 5; i++) {
-        QString key = QString("player%1").arg(i);
+    // Files up to this size are decoded once and looped from memory
+    AmbientPlayer::setMaxDecodedBytes(
+        settings.value("Ambient/MaxDecodedMB",
+                       AmbientClipLoader::DEFAULT_MAX_BYTES / (1024 * 1024)).toLongLong() * 1024 * 1024);
+    // Decoded files are kept on disk within this budget and mapped next time
+    AmbientPlayer::setDecodedCacheBytes(
+        settings.value("Ambient/DecodedCacheMB",
+                       AmbientClipLoader::DEFAULT_CACHE_BYTES / (1024 * 1024)).toLongLong() * 1024 * 1024);
+
+    // One mixer and one output for every decoded layer
+    m_ambientVoicePool = new AmbientVoicePool(this);
+    m_sampleBank = new AmbientSampleBank(this);
+    m_sampleBank->setCache(ConstantGlobals::decodedAudioCachePath, AmbientPlayer::decodedCacheBytes());
+
+    // Presets are decoded ahead, then crossfaded in
+    m_ambientCrossfadeMs = qMax(0, settings.value("Ambient/CrossfadeMs", DEFAULT_AMBIENT_CROSSFADE_MS).toInt());
+
+    // The mixer ramps the duck itself; music playback only switches it
+    m_duckAmbientUnderMusic = settings.value("Ambient/DuckUnderMusic", false).toBool();
+    m_ambientVoicePool->mixer()->setDuckShape(settings.value("Ambient/DuckDepthDb", -12.0).toFloat(),
+                                              settings.value("Ambient/DuckAttackMs", 250).toInt(),
+                                              settings.value("Ambient/DuckReleaseMs", 1500).toInt());
+    m_scenePreloader = new AmbientPreloader(this);
+    m_scenePreloader->setCache(ConstantGlobals::decodedAudioCachePath, AmbientPlayer::decodedCacheBytes());
+    connect(m_scenePreloader, &AmbientPreloader::progress, this, [this](int done, int total) {
+        statusBar()->showMessage(QString("Loading ambient preset... %1/%2").arg(done).arg(total));
+    });
+    connect(m_scenePreloader, &AmbientPreloader::finished, this, [this]() {
+        applyAmbientPreset(m_pendingAmbientPreset);
+    });
 
-        // Create the player
-        AmbientPlayer* player = new AmbientPlayer(this);
-        player->setName(QString("Player %1").arg(i));
+    // As many layers as last time; presets add the ones they need
+    const int layers = qBound(1, settings.value("Ambient/Layers", DEFAULT_AMBIENT_LAYERS).toInt(),
+                              int(AmbientMixer::MAX_VOICES));
+    for (int i = 0; i < layers; i++) {
+        addAmbientLayer();
+    }
+}
 
-        // Store in map
-        m_ambientPlayers[key] = player;
-        // Create dialog FOR THIS PLAYER
-               AmbientPlayerDialog* dialog = new AmbientPlayerDialog(player, this);
-               dialog->setWindowTitle(QString("Ambient Player %1").arg(i));
-               dialog->hide();  // Start hidden
-               m_playerDialogs[key] = dialog;
+QString MainWindow::addAmbientLayer(const QString& key)
+{
+    // Next after the highest layer, unless a preset names one
+    QString layerKey = key;
+    if (layerKey.isEmpty()) {
+        const QStringList keys = ambientLayerKeys();
+        const int last = keys.isEmpty() ? 0 : keys.last().mid(6).toInt();
+        layerKey = QString("player%1").arg(last + 1);
+    }
+    if (m_ambientPlayers.contains(layerKey)) {
+        return layerKey;
+    }
+    if (m_ambientPlayers.size() >= AmbientMixer::MAX_VOICES) {
+        return QString();
+    }
 
-               // Connect button to show ITS dialog
-               connect(player->button(), &QPushButton::clicked, this, [this, key]() {
-                   if (m_playerDialogs.contains(key)) {
-                       m_playerDialogs[key]->show();
-                       m_playerDialogs[key]->raise();
-                       m_playerDialogs[key]->activateWindow();
-                   }
-               });
-        // Set player key as property on the button for identification
-        player->button()->setProperty("playerKey", key);
+    // Create the player
+    AmbientPlayer* player = new AmbientPlayer(m_ambientVoicePool, this);
+    player->setName(QString("Player %1").arg(layerKey.mid(6)));
 
+    // Store in map
+    m_ambientPlayers[layerKey] = player;
 
+    // Connect button to show ITS dialog, built on first click
+    connect(player->button(), &QPushButton::clicked, this, [this, layerKey]() {
+        if (AmbientPlayerDialog* dialog = ambientPlayerDialog(layerKey)) {
+            dialog->show();
+            dialog->raise();
+            dialog->activateWindow();
+        }
+    });
+    // Set player key as property on the button for identification
+    player->button()->setProperty("playerKey", layerKey);
+
+    // Added after the toolbar was built: in order, and as the others
+    if (m_addAmbientLayerAction) {
+        const QStringList keys = ambientLayerKeys();
+        const int index = keys.indexOf(layerKey);
+        QAction* before = m_addAmbientLayerAction;
+        if (index + 1 < keys.size()) {
+            for (QAction* action : m_natureToolbar->actions()) {
+                if (m_natureToolbar->widgetForAction(action) == m_ambientPlayers[keys[index + 1]]->button()) {
+                    before = action;
+                    break;
+                }
+            }
+        }
+        m_natureToolbar->insertWidget(before, player->button());
+        const bool powered = m_naturePowerButton->isChecked();
+        player->setEnabled(powered);
+        player->button()->setEnabled(powered);
+    }
+    return layerKey;
+}
+
+bool MainWindow::removeAmbientLayer(const QString& key)
+{
+    AmbientPlayer* player = m_ambientPlayers.value(key);
+    if (!player || m_ambientPlayers.size() <= 1) {
+        return false;
+    }
+    m_ambientPlayers.remove(key);
+    delete m_playerDialogs.take(key);  // Refers to the player
+
+    // The toolbar owns the button through its action
+    QAction* buttonAction = nullptr;
+    if (m_natureToolbar) {
+        for (QAction* action : m_natureToolbar->actions()) {
+            if (m_natureToolbar->widgetForAction(action) == player->button()) {
+                buttonAction = action;
+                break;
+            }
+        }
+    }
+    if (buttonAction) {
+        m_natureToolbar->removeAction(buttonAction);
+        delete buttonAction;
+    } else {
+        delete player->button();
+    }
+
+    // Releases its voice, or its streaming player
+    delete player;
+    return true;
+}
+
+bool MainWindow::isAmbientLayerKey(const QString& key)
+{
+    bool ok = false;
+    return key.startsWith("player") && key.mid(6).toInt(&ok) > 0 && ok;
+}
+
+QStringList MainWindow::ambientLayerKeys() const
+{
+    QStringList keys = m_ambientPlayers.keys();
+    std::sort(keys.begin(), keys.end(), [](const QString& a, const QString& b) {
+        return a.mid(6).toInt() < b.mid(6).toInt();
+    });
+    return keys;
+}
+
+AmbientPlayerDialog* MainWindow::ambientPlayerDialog(const QString& key)
+{
+    // Dialogs that were never opened have nothing to sync, so the
+    // m_playerDialogs lookups elsewhere simply skip them
+    if (!m_playerDialogs.contains(key)) {
+        if (!m_ambientPlayers.contains(key)) {
+            return nullptr;
+        }
+        AmbientPlayerDialog* dialog = new AmbientPlayerDialog(m_ambientPlayers[key], this);
+        dialog->setWindowTitle(QString("Ambient Player %1").arg(key.mid(6)));
+        m_playerDialogs[key] = dialog;
     }
+    return m_playerDialogs[key];
 }
 
 
@@ -3433,11 +3774,8 @@ void MainWindow::onAmbientButtonClicked()
 
     QString playerKey = clickedButton->property("playerKey").toString();
 
-    if (m_playerDialogs.contains(playerKey)) {
-        // Get the dialog FOR THIS SPECIFIC PLAYER
-        AmbientPlayerDialog* dialog = m_playerDialogs[playerKey];
-
-        // Show it - it's already configured for this player
+    if (AmbientPlayerDialog* dialog = ambientPlayerDialog(playerKey)) {
+        // Show it - it's configured for this player
         dialog->show();
         dialog->raise();
         dialog->activateWindow();
@@ -3461,19 +3799,19 @@ void MainWindow::onMasterPlayClicked()
         AmbientPlayer* player = m_ambientPlayers[key];
         if (!player->isEnabled()) continue;
 
-        // Play the internal media player
-        QMediaPlayer* mediaPlayer = player->mediaPlayer();
-        if (mediaPlayer && mediaPlayer->playbackState() != QMediaPlayer::PlayingState) {
-            mediaPlayer->play();  // ensure actual playback
-        }
+        // Play the internal media player, created on first play
+        player->play();
 
         // Update the corresponding dialog's state variable
         if (m_playerDialogs.contains(key)) {
             AmbientPlayerDialog* dlg = m_playerDialogs[key];
-            dlg->state = mediaPlayer->playbackState();  // sync dialog state
+            dlg->state = player->playbackState();  // sync dialog state
             //dlg->updateUI();                             // refresh buttons/slider
         }
     }
+    for (AmbientScatterLayer* layer : std::as_const(m_scatterLayers)) {
+        layer->play();  // Disabled scenes stay silent
+    }
 }
 
 /*
@@ -3494,18 +3832,18 @@ void MainWindow::onMasterPauseClicked()
         if (!player->isEnabled()) continue;
 
         // Pause the internal media player
-        QMediaPlayer* mediaPlayer = player->mediaPlayer();
-        if (mediaPlayer && mediaPlayer->playbackState() == QMediaPlayer::PlayingState) {
-            mediaPlayer->pause();  // pause actual playback
-        }
+        player->pause();
 
         // Update corresponding dialog's state variable
         if (m_playerDialogs.contains(key)) {
             AmbientPlayerDialog* dlg = m_playerDialogs[key];
-            dlg->state = mediaPlayer->playbackState();  // should be PausedState now
+            dlg->state = player->playbackState();  // should be PausedState now
             //dlg->updateUI();                             // refresh buttons, slider, etc.
         }
     }
+    for (AmbientScatterLayer* layer : std::as_const(m_scatterLayers)) {
+        layer->pause();
+    }
 }
 
 /*
@@ -3526,18 +3864,18 @@ void MainWindow::onMasterStopClicked()
         if (!player->isEnabled()) continue;
 
         // Stop the internal media player
-        QMediaPlayer* mediaPlayer = player->mediaPlayer();
-        if (mediaPlayer && mediaPlayer->playbackState() != QMediaPlayer::StoppedState) {
-            mediaPlayer->stop();  // stop actual playback
-        }
+        player->stop();
 
         // Update corresponding dialog's state variable
         if (m_playerDialogs.contains(key)) {
             AmbientPlayerDialog* dlg = m_playerDialogs[key];
-            dlg->state = mediaPlayer->playbackState();  // should be StoppedState now
+            dlg->state = player->playbackState();  // should be StoppedState now
             //dlg->updateUI();                             // refresh buttons, slider, etc.
         }
     }
+    for (AmbientScatterLayer* layer : std::as_const(m_scatterLayers)) {
+        layer->stop();
+    }
 }
 
 void MainWindow::onMasterVolumeChanged(int value)
@@ -3597,16 +3935,19 @@ void MainWindow::saveAmbientPreset(const QString& presetName)
     // Create players array
     QJsonArray playersArray;
 
-    for (auto it = m_ambientPlayers.begin(); it != m_ambientPlayers.end(); ++it) {
-        AmbientPlayer* player = it.value();
+    for (const QString& key : ambientLayerKeys()) {
+        AmbientPlayer* player = m_ambientPlayers[key];
 
         QJsonObject playerObj;
-        playerObj["key"] = it.key();
+        playerObj["key"] = key;
         playerObj["name"] = player->name();
         playerObj["filePath"] = player->filePath();
         playerObj["volume"] = player->volume();
         playerObj["enabled"] = player->isEnabled();
         playerObj["autoRepeat"] = player->autoRepeat();
+        playerObj["spatial"] = player->isSpatial();
+        playerObj["azimuth"] = player->azimuth();
+        playerObj["elevation"] = player->elevation();
         playerObj["playState"] = static_cast<int>(player->playbackState());
 
         playersArray.append(playerObj);
@@ -3614,6 +3955,12 @@ void MainWindow::saveAmbientPreset(const QString& presetName)
 
     presetObject["players"] = playersArray;
 
+    QJsonArray scattersArray;
+    for (AmbientScatterLayer* layer : std::as_const(m_scatterLayers)) {
+        scattersArray.append(layer->settings().toJson());
+    }
+    presetObject["scatters"] = scattersArray;
+
     // Save to file
     QFile file(fileName);
     if (file.open(QIODevice::WriteOnly)) {
@@ -3626,6 +3973,7 @@ void MainWindow::saveAmbientPreset(const QString& presetName)
 
 void MainWindow::loadAmbientPreset(const QString& presetName)
 {
+    BINAURAL_TRACE_SCOPE("gui", "MainWindow::loadAmbientPreset");
     QString fileName;
     QString presetPath = ConstantGlobals::ambientPresetFilePath;
 
@@ -3664,66 +4012,151 @@ void MainWindow::loadAmbientPreset(const QString& presetName)
     }
 
     QJsonObject presetObject = doc.object();
+
+    // The next scene's files are decoded in the background while this one
+    // plays on; applyAmbientPreset() then only swaps voices
+    QStringList filePaths;
+    if (AmbientPlayer::maxDecodedBytes() > 0) {
+        for (const QJsonValue& playerValue : presetObject["players"].toArray()) {
+            QJsonObject playerObj = playerValue.toObject();
+            AmbientPlayer* current = m_ambientPlayers.value(playerObj["key"].toString());
+            QString filePath = playerObj["filePath"].toString();
+            if (playerObj["enabled"].toBool() && (!current || current->filePath() != filePath)) {
+                filePaths.append(filePath);
+            }
+        }
+    }
+    for (const QJsonValue& scatterValue : presetObject["scatters"].toArray()) {
+        m_sampleBank->request(ScatterSettings::fromJson(scatterValue.toObject()).files);
+    }
+
+    m_pendingAmbientPreset = presetObject;
+    statusBar()->showMessage("Loading ambient preset...");
+    m_scenePreloader->preload(filePaths, AmbientPlayer::maxDecodedBytes());
+}
+
+void MainWindow::applyAmbientPreset(const QJsonObject& presetObject)
+{
+    BINAURAL_TRACE_SCOPE("gui", "MainWindow::applyAmbientPreset");
     QJsonArray playersArray = presetObject["players"].toArray();
 
-    // Stop all players first
-    for (AmbientPlayer* player : m_ambientPlayers) {
-        player->stop();
+    // The new scene plays if the current one does
+    bool scenePlaying = false;
+    for (AmbientPlayer* player : std::as_const(m_ambientPlayers)) {
+        scenePlaying = scenePlaying || player->playbackState() == QMediaPlayer::PlayingState;
+    }
+    for (AmbientScatterLayer* layer : std::as_const(m_scatterLayers)) {
+        scenePlaying = scenePlaying || layer->isPlaying();
     }
 
-    // Load each player
+    // Add the layers this session does not have yet; entries keyed other
+    // than playerN go to new layers after the named ones
+    QHash<QString, QJsonObject> presetPlayers;
+    QList<QJsonObject> unkeyed;
     for (const QJsonValue& playerValue : playersArray) {
         QJsonObject playerObj = playerValue.toObject();
         QString key = playerObj["key"].toString();
+        if (!isAmbientLayerKey(key)) {
+            unkeyed.append(playerObj);
+        } else if (!addAmbientLayer(key).isEmpty()) {
+            presetPlayers.insert(key, playerObj);
+        } else {
+            qWarning() << "Ambient preset: no layer left for" << key;
+        }
+    }
+    for (const QJsonObject& playerObj : std::as_const(unkeyed)) {
+        const QString key = addAmbientLayer();
+        if (key.isEmpty()) {
+            qWarning() << "Ambient preset: no layer left for" << playerObj["key"].toString();
+            continue;
+        }
+        qWarning() << "Ambient preset: layer key" << playerObj["key"].toString() << "is not playerN,"
+                   << "loaded as" << key;
+        presetPlayers.insert(key, playerObj);
+    }
 
-        if (m_ambientPlayers.contains(key)) {
-            AmbientPlayer* player = m_ambientPlayers[key];
-
-            player->setName(playerObj["name"].toString());
-            player->setFilePath(playerObj["filePath"].toString());
-            player->setVolume(playerObj["volume"].toInt());
-            player->setEnabled(playerObj["enabled"].toBool());
-            player->setAutoRepeat(playerObj["autoRepeat"].toBool());
-
-            // UPDATE THE DIALOG UI IF IT EXISTS
-            if (m_playerDialogs.contains(key)) {
-                AmbientPlayerDialog* dialog = m_playerDialogs[key];
-                dialog->loadPlayerData();  // This refreshes the dialog UI
-            }
-
-            // Optional: Restore play state
-            //QMediaPlayer::PlaybackState savedState =
-              //  static_cast<QMediaPlayer::PlaybackState>(playerObj["playState"].toInt());
+    // Every layer crossfades to the preset's file; layers the preset does
+    // not name are cleared, so the scene is the preset's whatever was
+    // loaded before
+    for (const QString& key : ambientLayerKeys()) {
+        AmbientPlayer* player = m_ambientPlayers[key];
+        const bool named = presetPlayers.contains(key);
+        QJsonObject playerObj = presetPlayers.value(key);
+        QString filePath = playerObj["filePath"].toString();
+        bool enabled = playerObj["enabled"].toBool();
+
+        player->crossfadeTo(filePath, m_scenePreloader->clip(filePath), m_scenePreloader->failed(filePath),
+                            scenePlaying && enabled && !filePath.isEmpty(), m_ambientCrossfadeMs);
+        player->setName(named ? playerObj["name"].toString() : key);
+        player->setVolume(named ? playerObj["volume"].toInt() : 50);
+        player->setEnabled(enabled);
+        player->setAutoRepeat(named ? playerObj["autoRepeat"].toBool() : true);
+        // After the crossfade, so only the incoming voice moves
+        player->setSpatial(named && playerObj["spatial"].toBool());
+        player->setSpatialPosition(playerObj["azimuth"].toDouble(), playerObj["elevation"].toDouble());
+
+        // UPDATE THE DIALOG UI IF IT EXISTS
+        if (m_playerDialogs.contains(key)) {
+            AmbientPlayerDialog* dialog = m_playerDialogs[key];
+            dialog->loadPlayerData();  // This refreshes the dialog UI
+        }
+    }
 
-          //  if (savedState == QMediaPlayer::PlayingState && player->isEnabled()) {
-            //    QTimer::singleShot(100, player, &AmbientPlayer::play);
-            //}
+    clearScatterLayers();
+    for (const QJsonValue& scatterValue : presetObject["scatters"].toArray()) {
+        AmbientScatterLayer* layer = new AmbientScatterLayer(m_ambientVoicePool, m_sampleBank, this);
+        layer->setSettings(ScatterSettings::fromJson(scatterValue.toObject()));
+        m_scatterLayers.append(layer);
+        if (scenePlaying) {
+            layer->play();
         }
     }
 
+    // Every fade starts on the same frame
+    m_ambientVoicePool->commitFades();
+    m_scenePreloader->clear();
+    statusBar()->showMessage(QString("Ambient preset %1 loaded").arg(presetObject["presetName"].toString()), 3000);
 }
 
 void MainWindow::resetAllPlayersToDefaults()
 {
-    for (auto it = m_ambientPlayers.begin(); it != m_ambientPlayers.end(); ++it) {
-        AmbientPlayer* player = it.value();
+    for (const QString& key : ambientLayerKeys()) {
+        resetAmbientPlayer(key);
+    }
+    clearScatterLayers();
 
-        // Reset to defaults
-        player->setFilePath("");                    // Clear audio file
-        player->setName(it.key());                  // Reset name to default (player1, player2, etc.)
-        player->setVolume(50);                      // Default volume
-        player->setEnabled(false);                  // Enabled: OFF by default
-        player->setAutoRepeat(true);                // Auto-repeat: ON by default
-        player->stop();                             // Stop playback
+    // Update master controls state
 
-        // Update dialog UI if open
-        if (m_playerDialogs.contains(it.key())) {
-            m_playerDialogs[it.key()]->loadPlayerData();
-        }
+}
+
+void MainWindow::resetAmbientPlayer(const QString& key)
+{
+    AmbientPlayer* player = m_ambientPlayers.value(key);
+    if (!player) {
+        return;
     }
 
-    // Update master controls state
+    // Reset to defaults
+    player->setFilePath("");                    // Clear audio file
+    player->setName(key);                       // Reset name to default (player1, player2, etc.)
+    player->setVolume(50);                      // Default volume
+    player->setEnabled(false);                  // Enabled: OFF by default
+    player->setAutoRepeat(true);                // Auto-repeat: ON by default
+    player->setSpatial(false);                  // Plain stereo, straight ahead
+    player->setSpatialPosition(0.0f, 0.0f);
+    player->stop();                             // Stop playback
+
+    // Update dialog UI if open
+    if (m_playerDialogs.contains(key)) {
+        m_playerDialogs[key]->loadPlayerData();
+    }
+}
 
+void MainWindow::clearScatterLayers()
+{
+    // Each releases its scatter and lets the bank drop its samples
+    qDeleteAll(m_scatterLayers);
+    m_scatterLayers.clear();
 }
 
 void MainWindow::saveAmbientPlayersSettings()
@@ -3745,6 +4178,9 @@ void MainWindow::saveAmbientPlayersSettings()
         settings.setValue("volume", player->volume());
         settings.setValue("enabled", player->isEnabled());
         settings.setValue("autoRepeat", player->autoRepeat());
+        settings.setValue("spatial", player->isSpatial());
+        settings.setValue("azimuth", player->azimuth());
+        settings.setValue("elevation", player->elevation());
         settings.endGroup();
     }
 
@@ -3775,6 +4211,9 @@ void MainWindow::loadAmbientPlayersSettings()
             player->setVolume(settings.value("volume", 50).toInt());
             player->setEnabled(settings.value("enabled", true).toBool());  // Changed from false to true
             player->setAutoRepeat(settings.value("autoRepeat", true).toBool());
+            player->setSpatial(settings.value("spatial", false).toBool());
+            player->setSpatialPosition(settings.value("azimuth", 0.0).toFloat(),
+                                       settings.value("elevation", 0.0).toFloat());
 
             settings.endGroup();
 
@@ -3818,6 +4257,13 @@ void MainWindow::closeEvent(QCloseEvent *event)
     QMainWindow::closeEvent(event);
 }
 
+void MainWindow::paintEvent(QPaintEvent *event)
+{
+    QMainWindow::paintEvent(event);
+    // First frame on screen: the end of start-up
+    StartupProfiler::instance().finish("first paint");
+}
+
 
 
 void MainWindow::copyUserFiles()
@@ -3870,16 +4316,19 @@ void MainWindow::mutePlayingAmbientPlayers(bool needMute)
     for (auto it = m_ambientPlayers.begin(); it != m_ambientPlayers.end(); ++it) {
         AmbientPlayer* ambientPlayer = it.value();
 
-        if (ambientPlayer && ambientPlayer->mediaPlayer()) {
-            QMediaPlayer* mediaPlayer = ambientPlayer->mediaPlayer();
-
+        if (ambientPlayer) {
             // Check if the player is in playing state
-            if (mediaPlayer->playbackState() == QMediaPlayer::PlayingState) {
+            if (ambientPlayer->playbackState() == QMediaPlayer::PlayingState) {
                 // Mute the player
-                mediaPlayer->audioOutput()->setMuted(needMute);
+                ambientPlayer->setMuted(needMute);
                 // Optional: Store original volume to restore later
                 // ambientPlayer->setOriginalVolume(mediaPlayer->volume());
             }
         }
     }
+    for (AmbientScatterLayer* layer : std::as_const(m_scatterLayers)) {
+        if (layer->isPlaying() || !needMute) {
+            layer->setMuted(needMute);
+        }
+    }
 }
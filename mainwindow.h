@@ -27,7 +27,21 @@
 #include<QTextBrowser>
 #include"ambientplayerdialog.h"
 #include"ambientplayer.h"
-
+#include"toneanalyzer.h"
+#include"brainwavepreset.h"
+#include"playlistfile.h"
+
+
+class AmbientPreloader;
+class AmbientSampleBank;
+class AmbientScatterLayer;
+class AmbientVoicePool;
+class LevelMeterWidget;
+class OscilloscopeWidget;
+class SpectrumAnalyzer;
+class SpectrumWidget;
+class PresetAuditioner;
+class QThread;
 
 class MainWindow : public QMainWindow
 {
@@ -38,6 +52,7 @@ public:
     ~MainWindow();
 protected:
     void closeEvent(QCloseEvent *event) override;
+    void paintEvent(QPaintEvent *event) override;
 private:
     enum ToneType {
 
@@ -73,6 +88,8 @@ private:
     QDoubleSpinBox *m_pulseFreqLabel;
     QLabel *isoPulseLabel;
     QComboBox *m_waveformCombo;
+    QComboBox *m_noiseTypeCombo;
+    QDoubleSpinBox *m_noiseLevelInput;
     QDoubleSpinBox *m_binauralVolumeInput;
     QPushButton *m_binauralPlayButton;
     QPushButton *m_binauralStopButton;
@@ -89,7 +106,6 @@ private:
     QPushButton *m_clearPlaylistButton;
 
     // =================== AUDIO ENGINES ===================
-    //BinauralEngine *m_binauralEngine;
     DynamicEngine *m_binauralEngine;
 
     // =================== PRIVATE METHODS ===================
@@ -118,6 +134,8 @@ private slots:
     void onRightFrequencyChanged(double value);
     void onWaveformChanged(int index);
     void onBinauralVolumeChanged(double value);
+    void onNoiseTypeChanged(int index);
+    void onNoiseLevelChanged(double value);
     void onBinauralPlayClicked();
     void onBinauralStopClicked();
 
@@ -150,6 +168,7 @@ private:
     int m_remainingSeconds;
     QSpinBox *m_brainwaveDuration;
     QLabel *m_countdownLabel;
+    LevelMeterWidget *m_levelMeter;
     void startAutoStopTimer();
     void stopAutoStopTimer();
     void updateCountdownDisplay();
@@ -193,7 +212,6 @@ private:
     QComboBox *toneTypeCombo = nullptr;
     QStandardItemModel *model;
     QStandardItem *squareWaveItem;
-    qreal binEngineVolume = 1.0;
     void playRandomTrack();
     bool isShuffle = false;
 //tabbedwidget
@@ -219,31 +237,6 @@ private slots:
 
 //save-load
 private:
-    // Data structures
-    struct BrainwavePreset {
-        QString name;
-        int toneType;           // 0=Binaural, 1=Isochronic, 2=Generator
-        double leftFrequency;
-        double rightFrequency;
-        int waveform;           // 0=Sine, 1=Square, 2=Triangle, 3=Sawtooth
-        double pulseFrequency;  // For isochronic
-        double volume;          // 0-100%
-
-        // JSON serialization
-        QJsonObject toJson() const;
-        static BrainwavePreset fromJson(const QJsonObject &json);
-        bool isValid() const;
-    };
-
-    struct PlaylistTrack {
-        QString filePath;
-        QString title;          // Display name (filename or metadata)
-        qint64 duration;        // milliseconds
-
-        QJsonObject toJson() const;
-        static PlaylistTrack fromJson(const QJsonObject &json);
-    };
-
     // Helper methods
     QString generateDefaultPresetName() const;
     bool ensureDirectoryExists(const QString &path);
@@ -252,6 +245,7 @@ private slots:
     // Preset operations
     void onSavePresetClicked();
     void onLoadPresetClicked();
+    void onAuditionPresetClicked();
     void onManagePresetsClicked();
 
     // Playlist file operations
@@ -261,10 +255,6 @@ private slots:
     void onSaveAllPlaylistsClicked();
 
     // Internal save/load methods
-    bool savePresetToFile(const QString &filename, const BrainwavePreset &preset);
-    BrainwavePreset loadPresetFromFile(const QString &filename);
-    QList<BrainwavePreset> loadAllPresets();
-
     bool savePlaylistToFile(const QString &filename, const QString &playlistName);
     bool loadPlaylistFromFile(const QString &filename);
     void updatePlaylistFromCurrentTab(const QString &filename);
@@ -273,8 +263,14 @@ private:
     // Menu actions for presets
     QAction *savePresetAction;
     QAction *loadPresetAction;
+    QAction *auditionPresetAction;
     QAction *managePresetsAction;
 
+    // Previews presets on its own engine while the session keeps playing
+    PresetAuditioner *m_presetAuditioner = nullptr;
+    // Preset picker shared by load and audition; empty when cancelled
+    QString choosePresetFile(const QString &title, const QString &label);
+
     // Menu actions for playlists
     QAction *openPlaylistAction;
     QAction *saveCurrentPlaylistAction;
@@ -309,14 +305,62 @@ private:
     QPushButton *m_trackInfoButton;
     QDialog *trackInfoDialog = nullptr;
     void createInfoDialog();
-    QTextBrowser *metadataBrowser;
+    QTextBrowser *metadataBrowser = nullptr;
     int m_playingTrackIndex = -1;  // Index of the track that's actually playing
 public slots:
     void handleMetaDataUpdated();
 
+    //visualizers
+private:
+    QDialog *m_scopeDialog = nullptr;
+    OscilloscopeWidget *m_oscilloscope = nullptr;
+    QDialog *m_spectrumDialog = nullptr;
+    SpectrumWidget *m_spectrumWidget = nullptr;
+    // Output analysis runs on its own thread while tones play
+    QThread *m_analyzerThread = nullptr;
+    SpectrumAnalyzer *m_spectrumAnalyzer = nullptr;
+    ToneAnalysisResult m_spectrumResult;
+    void ensureSpectrumAnalyzer();
+private slots:
+    void showOscilloscope();
+    void showSpectrumAnalyzer();
+    void onSpectrumResultReady();
+
     ////////////////// ambience
 private:
+    // Layers are keyed player1, player2, ...; all decoded layers play as
+    // voices of one pool, so a layer is cheap until it streams
+    static constexpr int DEFAULT_AMBIENT_LAYERS = 5;
     QMap<QString, AmbientPlayer*> m_ambientPlayers;
+    AmbientVoicePool* m_ambientVoicePool = nullptr;
+    QAction* m_addAmbientLayerAction = nullptr;  // Layer buttons go before it
+    QAction* m_removeAmbientLayerAction = nullptr;
+    QString addAmbientLayer(const QString& key = QString());
+    // Stops the layer and drops its voice, button and dialog; the last
+    // layer stays
+    bool removeAmbientLayer(const QString& key);
+    static bool isAmbientLayerKey(const QString& key);
+    QStringList ambientLayerKeys() const;  // In layer order, player10 after player9
+    void resetAmbientPlayer(const QString& key);
+
+    // One-shot scenes from the preset's "scatters", mixed by the same pool;
+    // their samples are decoded once into the shared bank
+    AmbientSampleBank* m_sampleBank = nullptr;
+    QList<AmbientScatterLayer*> m_scatterLayers;
+    void clearScatterLayers();
+
+    // Preset switches decode the next scene while this one plays, then
+    // crossfade every layer at once (Ambient/CrossfadeMs)
+    static constexpr int DEFAULT_AMBIENT_CROSSFADE_MS = 3000;
+    AmbientPreloader* m_scenePreloader = nullptr;
+    QJsonObject m_pendingAmbientPreset;
+    int m_ambientCrossfadeMs = DEFAULT_AMBIENT_CROSSFADE_MS;
+    void applyAmbientPreset(const QJsonObject& presetObject);
+
+    // Decoded layers and scatters dip while music plays (Ambient/DuckUnderMusic,
+    // shaped by Ambient/DuckDepthDb, DuckAttackMs and DuckReleaseMs)
+    bool m_duckAmbientUnderMusic = false;
+    void updateAmbientDuck();
 
     // Master controls for the toolbar
     QPushButton* m_masterPlayButton;
@@ -325,7 +369,8 @@ private:
     QSlider* m_masterVolumeSlider;
     QLabel* m_masterVolumeLabel;
     // Track which player is being edited
-    QMap<QString, AmbientPlayerDialog*> m_playerDialogs;  // player1 → Dialog*
+    QMap<QString, AmbientPlayerDialog*> m_playerDialogs;  // player1 → Dialog*, once opened
+    AmbientPlayerDialog* ambientPlayerDialog(const QString& key);
 private slots:
     void onAmbientButtonClicked();
     void onMasterPlayClicked();
@@ -0,0 +1,226 @@
+#include "mappedfilecache.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <cstring>
+
+namespace {
+// Fixed preamble at the start of every cache file (native byte order:
+// entries never leave the machine that wrote them)
+struct CachePreamble
+{
+    quint32 magic;
+    quint32 version;
+    quint64 headerSize;
+    quint64 payloadOffset;
+    quint64 payloadSize;
+};
+
+constexpr quint32 CACHE_MAGIC = 0x434D5042; // "BPMC"
+constexpr quint32 CACHE_VERSION = 1;
+constexpr qint64 PAYLOAD_ALIGNMENT = 4096;  // Page aligned for mapping
+}
+
+// =================== MAPPED ENTRY ===================
+MappedCacheEntry::MappedCacheEntry(const QString &path)
+    : m_file(path)
+{
+}
+
+MappedCacheEntry::~MappedCacheEntry()
+{
+    if (m_payload) {
+        m_file.unmap(m_payload);
+    }
+}
+
+// =================== CACHE DIRECTORY ===================
+MappedFileCache::MappedFileCache(const QString &directory, qint64 maxBytes, const QString &suffix)
+    : m_directory(directory)
+    , m_maxBytes(qMax<qint64>(0, maxBytes))
+    , m_suffix(suffix)
+{
+}
+
+void MappedFileCache::setMaxBytes(qint64 maxBytes)
+{
+    m_maxBytes = qMax<qint64>(0, maxBytes);
+    trim();
+}
+
+QString MappedFileCache::hashKey(const QByteArray &identity)
+{
+    return QString::fromLatin1(QCryptographicHash::hash(identity, QCryptographicHash::Sha1).toHex());
+}
+
+QString MappedFileCache::entryPath(const QString &key) const
+{
+    return m_directory + "/" + key + "." + m_suffix;
+}
+
+bool MappedFileCache::contains(const QString &key) const
+{
+    return QFileInfo::exists(entryPath(key));
+}
+
+std::unique_ptr<MappedCacheEntry> MappedFileCache::open(const QString &key)
+{
+    const QString path = entryPath(key);
+    if (!QFileInfo::exists(path)) {
+        return nullptr;
+    }
+
+    std::unique_ptr<MappedCacheEntry> entry(new MappedCacheEntry(path));
+    QFile &file = entry->m_file;
+    if (!file.open(QIODevice::ReadOnly)) {
+        return nullptr;
+    }
+
+    // Anything that does not add up is a stale or torn file: drop it
+    CachePreamble preamble;
+    bool valid = file.read(reinterpret_cast<char *>(&preamble), sizeof(preamble)) == qint64(sizeof(preamble))
+                 && preamble.magic == CACHE_MAGIC
+                 && preamble.version == CACHE_VERSION
+                 && preamble.payloadOffset >= sizeof(preamble) + preamble.headerSize
+                 && qint64(preamble.payloadOffset + preamble.payloadSize) == file.size();
+    if (valid) {
+        entry->m_header = file.read(qint64(preamble.headerSize));
+        valid = entry->m_header.size() == qint64(preamble.headerSize);
+    }
+    if (valid && preamble.payloadSize > 0) {
+        entry->m_payload = file.map(qint64(preamble.payloadOffset), qint64(preamble.payloadSize));
+        valid = entry->m_payload != nullptr;
+    }
+    if (!valid) {
+        entry.reset();
+        QFile::remove(path);
+        return nullptr;
+    }
+    entry->m_payloadSize = qint64(preamble.payloadSize);
+
+    // A hit makes this the most recently used entry
+    file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    return entry;
+}
+
+bool MappedFileCache::store(const QString &key, const QByteArray &header,
+                            const char *payload, qint64 payloadSize)
+{
+    if (!QDir().mkpath(m_directory)) {
+        return false;
+    }
+
+    CachePreamble preamble;
+    preamble.magic = CACHE_MAGIC;
+    preamble.version = CACHE_VERSION;
+    preamble.headerSize = quint64(header.size());
+    qint64 headerEnd = qint64(sizeof(preamble)) + header.size();
+    preamble.payloadOffset = quint64((headerEnd + PAYLOAD_ALIGNMENT - 1) / PAYLOAD_ALIGNMENT * PAYLOAD_ALIGNMENT);
+    preamble.payloadSize = quint64(qMax<qint64>(0, payloadSize));
+
+    QSaveFile file(entryPath(key));
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QByteArray padding(int(preamble.payloadOffset - quint64(headerEnd)), '\0');
+    bool ok = file.write(reinterpret_cast<const char *>(&preamble), sizeof(preamble)) == qint64(sizeof(preamble))
+              && file.write(header) == header.size()
+              && file.write(padding) == padding.size()
+              && (payloadSize <= 0 || file.write(payload, payloadSize) == payloadSize);
+    if (!ok) {
+        file.cancelWriting();
+        return false;
+    }
+    if (!file.commit()) {
+        return false;
+    }
+
+    trim(key);
+    return true;
+}
+
+bool MappedFileCache::remove(const QString &key)
+{
+    return QFile::remove(entryPath(key));
+}
+
+void MappedFileCache::clear()
+{
+    QDir dir(m_directory);
+    const QStringList files = dir.entryList({ "*." + m_suffix }, QDir::Files);
+    for (const QString &name : files) {
+        dir.remove(name);
+    }
+}
+
+void MappedFileCache::trim(const QString &keepKey)
+{
+    QDir dir(m_directory);
+    // Oldest (least recently used) first
+    const QFileInfoList files = dir.entryInfoList({ "*." + m_suffix }, QDir::Files,
+                                                  QDir::Time | QDir::Reversed);
+    qint64 total = 0;
+    for (const QFileInfo &info : files) {
+        total += info.size();
+    }
+
+    const QString keepName = keepKey.isEmpty() ? QString() : keepKey + "." + m_suffix;
+    for (const QFileInfo &info : files) {
+        if (total <= m_maxBytes) {
+            break;
+        }
+        if (info.fileName() == keepName) {
+            continue;
+        }
+        // Mapped entries stay readable after unlink on POSIX; where removal
+        // of an open file fails the entry simply survives until next trim
+        if (QFile::remove(info.absoluteFilePath())) {
+            total -= info.size();
+        }
+    }
+}
+
+qint64 MappedFileCache::totalBytes() const
+{
+    qint64 total = 0;
+    const QFileInfoList files = QDir(m_directory).entryInfoList({ "*." + m_suffix }, QDir::Files);
+    for (const QFileInfo &info : files) {
+        total += info.size();
+    }
+    return total;
+}
+
+// =================== MAPPED DEVICE ===================
+MappedCacheDevice::MappedCacheDevice(std::unique_ptr<MappedCacheEntry> entry, QObject *parent)
+    : QIODevice(parent)
+    , m_entry(std::move(entry))
+{
+    open(QIODevice::ReadOnly);
+}
+
+qint64 MappedCacheDevice::size() const
+{
+    return m_entry ? m_entry->payloadSize() : 0;
+}
+
+qint64 MappedCacheDevice::readData(char *data, qint64 maxlen)
+{
+    qint64 available = size() - pos();
+    qint64 count = qMin(maxlen, available);
+    if (count <= 0) {
+        return 0;
+    }
+    std::memcpy(data, m_entry->payload() + pos(), size_t(count));
+    return count;
+}
+
+qint64 MappedCacheDevice::writeData(const char *data, qint64 len)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(len);
+    return -1;
+}
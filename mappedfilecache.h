@@ -0,0 +1,98 @@
+#ifndef MAPPEDFILECACHE_H
+#define MAPPEDFILECACHE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QIODevice>
+#include <QString>
+#include <memory>
+
+// One cache file opened and memory-mapped read-only. The payload pointer
+// stays valid for the lifetime of the entry; pages are faulted in by the OS
+// on demand, so nothing is copied into heap memory.
+class MappedCacheEntry
+{
+public:
+    ~MappedCacheEntry();
+
+    const QByteArray &header() const { return m_header; }
+    const uchar *payload() const { return m_payload; }
+    qint64 payloadSize() const { return m_payloadSize; }
+    QString filePath() const { return m_file.fileName(); }
+
+private:
+    friend class MappedFileCache;
+    explicit MappedCacheEntry(const QString &path);
+
+    QFile m_file;
+    QByteArray m_header;
+    uchar *m_payload = nullptr;
+    qint64 m_payloadSize = 0;
+};
+
+// Directory of keyed cache files with a total size cap. Each file holds a
+// small header blob and a page-aligned payload; least recently used files
+// (by modification time, refreshed on every hit) are evicted first.
+// Files are written with QSaveFile, so a crash never leaves a torn entry.
+class MappedFileCache
+{
+public:
+    MappedFileCache(const QString &directory, qint64 maxBytes,
+                    const QString &suffix = QStringLiteral("cache"));
+
+    QString directory() const { return m_directory; }
+
+    void setMaxBytes(qint64 maxBytes);
+    qint64 maxBytes() const { return m_maxBytes; }
+
+    // Stable file-name-safe key for an arbitrary identity string
+    static QString hashKey(const QByteArray &identity);
+
+    bool contains(const QString &key) const;
+
+    // Map an entry; nullptr when missing or unreadable (corrupt files are removed)
+    std::unique_ptr<MappedCacheEntry> open(const QString &key);
+
+    // Write an entry and trim the cache (never evicting `key` itself)
+    bool store(const QString &key, const QByteArray &header,
+               const char *payload, qint64 payloadSize);
+
+    bool remove(const QString &key);
+    void clear();
+
+    // Evict least recently used entries until the total fits maxBytes()
+    void trim(const QString &keepKey = QString());
+
+    qint64 totalBytes() const;
+
+private:
+    QString entryPath(const QString &key) const;
+
+    QString m_directory;
+    qint64 m_maxBytes;
+    QString m_suffix;
+};
+
+// Read-only, seekable QIODevice over a mapped entry's payload, suitable
+// for handing straight to QAudioSink::start()
+class MappedCacheDevice : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    explicit MappedCacheDevice(std::unique_ptr<MappedCacheEntry> entry, QObject *parent = nullptr);
+
+    qint64 size() const override;
+    bool isSequential() const override { return false; }
+
+    const MappedCacheEntry *entry() const { return m_entry.get(); }
+
+protected:
+    qint64 readData(char *data, qint64 maxlen) override;
+    qint64 writeData(const char *data, qint64 len) override;
+
+private:
+    std::unique_ptr<MappedCacheEntry> m_entry;
+};
+
+#endif // MAPPEDFILECACHE_H
@@ -0,0 +1,175 @@
+#include "noisegenerator.h"
+
+#include <algorithm>
+#include "cpudispatch.h"
+
+namespace {
+// Output gains that keep shaped noise peaks just inside full scale
+constexpr float PINK_GAIN = 0.11f;
+constexpr float BROWN_GAIN = 3.5f;
+constexpr float INT32_TO_FLOAT = 1.0f / 2147483648.0f;
+
+// Low-bias 32-bit integer hash (bijective, good avalanche)
+inline uint32_t hashIndex(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    return x;
+}
+}
+
+NoiseGenerator::NoiseGenerator(uint32_t seed)
+    : m_type(NO_NOISE)
+    , m_level(0.0f)
+    , m_seed(0)
+    , m_position(0)
+{
+    reset(seed);
+}
+
+void NoiseGenerator::setType(NoiseType type)
+{
+    m_type = type;
+}
+
+void NoiseGenerator::setLevel(float level)
+{
+    m_level = std::clamp(level, 0.0f, 1.0f);
+}
+
+void NoiseGenerator::reset(uint32_t seed)
+{
+    m_seed = seed ? seed : 0x9E3779B9u;
+    m_position = 0;
+    clearFilters();
+}
+
+void NoiseGenerator::seek(uint64_t frame)
+{
+    m_position = frame;
+    clearFilters();
+}
+
+void NoiseGenerator::settle(uint64_t frame, uint64_t period)
+{
+    if (!isActive()) {
+        seek(frame);
+        return;
+    }
+
+    const uint64_t settleFrames = SETTLE_FRAMES;
+    uint64_t start = 0;
+    if (frame >= settleFrames) {
+        start = frame - settleFrames;
+    } else if (period > settleFrames && frame < period) {
+        start = period - (settleFrames - frame); // Run in from the loop's tail
+    }
+    seek(start);
+
+    float left[BLOCK_FRAMES];
+    float right[BLOCK_FRAMES];
+    while (m_position != frame) {
+        uint64_t end = (m_position < frame) ? frame : period;
+        renderBlock(left, right, static_cast<int>(std::min<uint64_t>(BLOCK_FRAMES, end - m_position)));
+        if (m_position == period) {
+            m_position = 0;
+        }
+    }
+}
+
+void NoiseGenerator::clearFilters()
+{
+    std::fill(m_pinkLeft, m_pinkLeft + 7, 0.0f);
+    std::fill(m_pinkRight, m_pinkRight + 7, 0.0f);
+    m_brownLeft = 0.0f;
+    m_brownRight = 0.0f;
+}
+
+BINAURAL_HOT_KERNEL
+void NoiseGenerator::renderBlock(float *left, float *right, int frameCount)
+{
+    frameCount = std::min(frameCount, BLOCK_FRAMES);
+
+    if (!isActive()) {
+        std::fill(left, left + frameCount, 0.0f);
+        std::fill(right, right + frameCount, 0.0f);
+        m_position += static_cast<uint64_t>(std::max(0, frameCount));
+        return;
+    }
+
+    fillWhite(left, frameCount, 0);
+    fillWhite(right, frameCount, 1);
+
+    switch (m_type) {
+    case PINK_NOISE:
+        shapePink(left, m_pinkLeft, frameCount);
+        shapePink(right, m_pinkRight, frameCount);
+        break;
+    case BROWN_NOISE:
+        shapeBrown(left, m_brownLeft, frameCount);
+        shapeBrown(right, m_brownRight, frameCount);
+        break;
+    default:
+        break;
+    }
+
+    const float level = m_level;
+    for (int i = 0; i < frameCount; ++i) {
+        left[i] *= level;
+        right[i] *= level;
+    }
+
+    m_position += static_cast<uint64_t>(frameCount);
+}
+
+void NoiseGenerator::fillWhite(float *out, int count, uint32_t channel)
+{
+    // Per-channel key; the high half of the position only changes every
+    // 2^32 frames, so it is folded into the key once per block
+    uint32_t key = m_seed ^ (channel * 0x9E3779B9u) ^ hashIndex(static_cast<uint32_t>(m_position >> 32));
+    const uint32_t base = static_cast<uint32_t>(m_position);
+
+    // No loop-carried state: vectorizes to packed xor/shift/multiply
+    for (int i = 0; i < count; ++i) {
+        uint32_t x = hashIndex((base + static_cast<uint32_t>(i)) ^ key);
+        out[i] = static_cast<float>(static_cast<int32_t>(x)) * INT32_TO_FLOAT;
+    }
+}
+
+void NoiseGenerator::shapePink(float *samples, float *state, int count)
+{
+    // Paul Kellet's refined pink filter (accurate to +/-0.05 dB above 9.2 Hz)
+    float b0 = state[0], b1 = state[1], b2 = state[2], b3 = state[3];
+    float b4 = state[4], b5 = state[5], b6 = state[6];
+
+    for (int i = 0; i < count; ++i) {
+        float white = samples[i];
+        b0 = 0.99886f * b0 + white * 0.0555179f;
+        b1 = 0.99332f * b1 + white * 0.0750759f;
+        b2 = 0.96900f * b2 + white * 0.1538520f;
+        b3 = 0.86650f * b3 + white * 0.3104856f;
+        b4 = 0.55000f * b4 + white * 0.5329522f;
+        b5 = -0.7616f * b5 - white * 0.0168980f;
+        float pink = b0 + b1 + b2 + b3 + b4 + b5 + b6 + white * 0.5362f;
+        b6 = white * 0.115926f;
+        samples[i] = pink * PINK_GAIN;
+    }
+
+    state[0] = b0; state[1] = b1; state[2] = b2; state[3] = b3;
+    state[4] = b4; state[5] = b5; state[6] = b6;
+}
+
+void NoiseGenerator::shapeBrown(float *samples, float &state, int count)
+{
+    // Leaky integrator: integrates white noise (-6 dB/oct) while the leak
+    // keeps it from drifting into DC
+    float b = state;
+    for (int i = 0; i < count; ++i) {
+        b = (b + 0.02f * samples[i]) * (1.0f / 1.02f);
+        samples[i] = b * BROWN_GAIN;
+    }
+    state = b;
+}
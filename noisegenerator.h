@@ -0,0 +1,78 @@
+#ifndef NOISEGENERATOR_H
+#define NOISEGENERATOR_H
+
+#include <cstdint>
+
+// Native masking-noise source for the tone engines.
+//
+// White noise is counter-based: frame n of each channel is an integer hash
+// of (seed, channel, n). The inner loop has no carried state, so it maps to
+// SIMD multiplies, and any position can be rendered directly (see seek() and
+// settle()), which lets a long render be split across threads. Pink (Paul
+// Kellet's refined filter) and brown (leaky integrator) are shaped from that
+// white block. Everything is rendered in fixed-size blocks so the engines can
+// mix a block of noise into their tone loop without per-sample branching.
+class NoiseGenerator
+{
+public:
+    enum NoiseType {
+        NO_NOISE = 0,
+        WHITE_NOISE = 1,
+        PINK_NOISE = 2,
+        BROWN_NOISE = 3
+    };
+
+    static constexpr int BLOCK_FRAMES = 256;
+
+    explicit NoiseGenerator(uint32_t seed = 0x9E3779B9u);
+
+    void setType(NoiseType type);
+    NoiseType type() const { return m_type; }
+
+    void setLevel(float level); // 0.0-1.0 of full scale
+    float level() const { return m_level; }
+
+    bool isActive() const { return m_type != NO_NOISE && m_level > 0.0f; }
+
+    void reset(uint32_t seed);
+
+    // Jump to an absolute frame with the pink/brown filters cleared
+    void seek(uint64_t frame);
+    uint64_t position() const { return m_position; }
+
+    // Move the counter but keep the filter state, so the output continues
+    // smoothly from a different point of the white sequence
+    void setPosition(uint64_t frame) { m_position = frame; }
+
+    // Jump to `frame` with the filters run over the preceding SETTLE_FRAMES,
+    // so their state matches a render that started at frame 0 to within
+    // about -80 dB. Starting any render at the same frame via settle()
+    // always produces identical samples. With a `period`, the render is a
+    // loop of that many frames: near its start the filters settle over the
+    // loop's tail instead, so the wrap is as smooth as any other frame.
+    void settle(uint64_t frame, uint64_t period = 0);
+    static constexpr int SETTLE_FRAMES = 8192;
+
+    // Renders frameCount (<= BLOCK_FRAMES) level-scaled frames into
+    // separate left/right arrays and advances position(). Left and right
+    // are decorrelated.
+    void renderBlock(float *left, float *right, int frameCount);
+
+private:
+    void fillWhite(float *out, int count, uint32_t channel);
+    void clearFilters();
+    void shapePink(float *samples, float *state, int count);
+    void shapeBrown(float *samples, float &state, int count);
+
+    NoiseType m_type;
+    float m_level;
+
+    uint32_t m_seed;
+    uint64_t m_position;
+    float m_pinkLeft[7];
+    float m_pinkRight[7];
+    float m_brownLeft;
+    float m_brownRight;
+};
+
+#endif // NOISEGENERATOR_H
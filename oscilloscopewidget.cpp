@@ -0,0 +1,187 @@
+#include "oscilloscopewidget.h"
+#include "audiotapring.h"
+
+#include <QPainter>
+#include <QPainterPath>
+#include <QScreen>
+#include <QTimer>
+#include <QtMath>
+
+OscilloscopeWidget::OscilloscopeWidget(QWidget *parent)
+    : QWidget(parent)
+    , m_ring(nullptr)
+    , m_sampleRate(22050)
+    , m_mode(SCOPE_MODE)
+    , m_timeWindowMs(10.0)
+    , m_refreshTimer(new QTimer(this))
+    , m_lastWriteIndex(0)
+    , m_snapshotFrames(0)
+{
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setMinimumSize(200, 150);
+
+    // Snapshot buffer sized once; refresh() never allocates
+    m_snapshot.resize(4096 * 2);
+
+    m_refreshTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_refreshTimer, &QTimer::timeout, this, &OscilloscopeWidget::refresh);
+}
+
+void OscilloscopeWidget::setSource(const AudioTapRing *ring, int sampleRate)
+{
+    m_ring = ring;
+    m_sampleRate = qMax(1, sampleRate);
+    m_lastWriteIndex = 0;
+    m_snapshotFrames = 0;
+    update();
+}
+
+void OscilloscopeWidget::setDisplayMode(DisplayMode mode)
+{
+    m_mode = mode;
+    update();
+}
+
+void OscilloscopeWidget::setTimeWindowMs(double ms)
+{
+    m_timeWindowMs = qBound(1.0, ms, 100.0);
+    update();
+}
+
+QSize OscilloscopeWidget::sizeHint() const
+{
+    return QSize(480, 320);
+}
+
+void OscilloscopeWidget::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+
+    // Never repaint faster than the screen can show
+    double refreshRate = screen() ? screen()->refreshRate() : 60.0;
+    m_refreshTimer->start(qMax(8, qRound(1000.0 / qMax(1.0, refreshRate))));
+    emit activeChanged(true);
+}
+
+void OscilloscopeWidget::hideEvent(QHideEvent *event)
+{
+    m_refreshTimer->stop();
+    emit activeChanged(false);
+    QWidget::hideEvent(event);
+}
+
+void OscilloscopeWidget::refresh()
+{
+    if (!m_ring) {
+        return;
+    }
+
+    // Nothing new rendered since last frame: skip the copy and the repaint
+    quint64 writeIndex = m_ring->writeIndex();
+    if (writeIndex == m_lastWriteIndex) {
+        return;
+    }
+    m_lastWriteIndex = writeIndex;
+
+    int wanted = qMin(int(m_snapshot.size() / 2), m_ring->capacity() / 2);
+    m_snapshotFrames = m_ring->readLatest(m_snapshot.data(), wanted);
+    update();
+}
+
+int OscilloscopeWidget::findTrigger(int searchFrames) const
+{
+    // Rising zero crossing on the left channel keeps the trace still
+    const float *frames = m_snapshot.constData();
+    for (int i = 1; i < searchFrames; ++i) {
+        if (frames[2 * (i - 1)] < 0.0f && frames[2 * i] >= 0.0f) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+void OscilloscopeWidget::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+
+    QPainter painter(this);
+    painter.fillRect(rect(), QColor("#1E1E2E"));
+    drawGrid(painter);
+
+    if (m_snapshotFrames < 2) {
+        painter.setPen(QColor("#888888"));
+        painter.drawText(rect(), Qt::AlignCenter, "No signal");
+        return;
+    }
+
+    painter.setRenderHint(QPainter::Antialiasing);
+    if (m_mode == LISSAJOUS_MODE) {
+        drawLissajous(painter);
+    } else {
+        drawScope(painter);
+    }
+}
+
+void OscilloscopeWidget::drawGrid(QPainter &painter)
+{
+    painter.setPen(QColor("#3A3A4E"));
+    for (int i = 1; i < 8; ++i) {
+        int x = width() * i / 8;
+        painter.drawLine(x, 0, x, height());
+    }
+    for (int i = 1; i < 4; ++i) {
+        int y = height() * i / 4;
+        painter.drawLine(0, y, width(), y);
+    }
+}
+
+void OscilloscopeWidget::drawScope(QPainter &painter)
+{
+    int windowFrames = qMax(2, qRound(m_timeWindowMs * m_sampleRate / 1000.0));
+    windowFrames = qMin(windowFrames, m_snapshotFrames / 2);
+
+    // Trigger in the older half so a full window always follows it
+    int start = findTrigger(m_snapshotFrames - windowFrames);
+    const float *frames = m_snapshot.constData() + 2 * start;
+
+    const double halfHeight = height() / 2.0;
+    const double xStep = double(width()) / (windowFrames - 1);
+    const QColor colors[2] = { QColor("#7B68EE"), QColor("#32CD32") };
+
+    for (int ch = 0; ch < 2; ++ch) {
+        QPainterPath path;
+        path.moveTo(0, halfHeight - frames[ch] * halfHeight);
+        for (int i = 1; i < windowFrames; ++i) {
+            path.lineTo(i * xStep, halfHeight - frames[2 * i + ch] * halfHeight);
+        }
+        painter.setPen(QPen(colors[ch], 1.5));
+        painter.drawPath(path);
+    }
+
+    painter.setPen(QColor("#AAAAAA"));
+    painter.drawText(6, 14, QString("L"));
+    painter.setPen(colors[1]);
+    painter.drawText(18, 14, QString("R"));
+    painter.setPen(QColor("#AAAAAA"));
+    painter.drawText(rect().adjusted(0, 0, -6, -4), Qt::AlignRight | Qt::AlignBottom,
+                     QString("%1 ms").arg(m_timeWindowMs, 0, 'f', 1));
+}
+
+void OscilloscopeWidget::drawLissajous(QPainter &painter)
+{
+    const double side = qMin(width(), height()) / 2.0 - 4.0;
+    const QPointF center(width() / 2.0, height() / 2.0);
+    const float *frames = m_snapshot.constData();
+
+    QPainterPath path;
+    path.moveTo(center.x() + frames[0] * side, center.y() - frames[1] * side);
+    for (int i = 1; i < m_snapshotFrames; ++i) {
+        path.lineTo(center.x() + frames[2 * i] * side, center.y() - frames[2 * i + 1] * side);
+    }
+
+    painter.setPen(QPen(QColor("#7B68EE"), 1.0));
+    painter.drawPath(path);
+
+    painter.setPen(QColor("#AAAAAA"));
+    painter.drawText(6, 14, QString("X: L   Y: R"));
+}
@@ -0,0 +1,64 @@
+#ifndef OSCILLOSCOPEWIDGET_H
+#define OSCILLOSCOPEWIDGET_H
+
+#include <QWidget>
+#include <QVector>
+
+class QTimer;
+class AudioTapRing;
+
+// Scope / Lissajous view of the tone output. It reads snapshots from an
+// AudioTapRing written by the render path, repaints at most at the display
+// refresh rate, and reports activeChanged(false) when hidden so the engine
+// stops feeding the ring altogether.
+class OscilloscopeWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    enum DisplayMode {
+        SCOPE_MODE = 0,     // L and R against time
+        LISSAJOUS_MODE = 1  // L on X, R on Y
+    };
+    Q_ENUM(DisplayMode)
+
+    explicit OscilloscopeWidget(QWidget *parent = nullptr);
+
+    void setSource(const AudioTapRing *ring, int sampleRate);
+
+    void setDisplayMode(DisplayMode mode);
+    DisplayMode displayMode() const { return m_mode; }
+
+    void setTimeWindowMs(double ms);
+
+    QSize sizeHint() const override;
+
+signals:
+    void activeChanged(bool active);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+
+private slots:
+    void refresh();
+
+private:
+    int findTrigger(int searchFrames) const;
+    void drawGrid(QPainter &painter);
+    void drawScope(QPainter &painter);
+    void drawLissajous(QPainter &painter);
+
+    const AudioTapRing *m_ring;
+    int m_sampleRate;
+    DisplayMode m_mode;
+    double m_timeWindowMs;
+
+    QTimer *m_refreshTimer;
+    quint64 m_lastWriteIndex;
+    QVector<float> m_snapshot; // Interleaved stereo frames
+    int m_snapshotFrames;
+};
+
+#endif // OSCILLOSCOPEWIDGET_H
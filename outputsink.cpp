@@ -0,0 +1,496 @@
+#include "outputsink.h"
+
+#include <QAudioSink>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMediaDevices>
+#include <QTimer>
+#include <algorithm>
+#include <cstdint>
+
+namespace {
+struct DefaultBackend {
+    bool resolved = false;
+    OutputSink::Backend backend = OutputSink::DEVICE_BACKEND;
+    QString wavPath;
+};
+
+DefaultBackend &defaults()
+{
+    static DefaultBackend instance;
+    if (!instance.resolved) {
+        instance.resolved = true;
+        const QString spec = qEnvironmentVariable("BINAURAL_AUDIO_SINK").trimmed();
+        if (spec == QLatin1String("null")) {
+            instance.backend = OutputSink::NULL_BACKEND;
+        } else if (spec == QLatin1String("paced")) {
+            instance.backend = OutputSink::PACED_NULL_BACKEND;
+        } else if (spec.startsWith(QLatin1String("wav:")) && spec.size() > 4) {
+            instance.backend = OutputSink::WAV_BACKEND;
+            instance.wavPath = spec.mid(4);
+        } else if (!spec.isEmpty() && spec != QLatin1String("device")) {
+            qWarning() << "Unknown BINAURAL_AUDIO_SINK" << spec << "- using the audio device";
+        }
+    }
+    return instance;
+}
+}
+
+// =================== FACTORY ===================
+OutputSink *OutputSink::create(const QAudioFormat &format, QObject *parent, QString *error)
+{
+    const DefaultBackend &config = defaults();
+
+    switch (config.backend) {
+    case NULL_BACKEND:
+        return new NullOutputSink(format, NullOutputSink::FREE_RUNNING, parent);
+    case PACED_NULL_BACKEND:
+        return new NullOutputSink(format, NullOutputSink::REAL_TIME, parent);
+    case WAV_BACKEND: {
+        auto *sink = new WavOutputSink(format, config.wavPath, NullOutputSink::FREE_RUNNING, parent);
+        if (!sink->isOpen()) {
+            delete sink;
+            if (error) {
+                *error = "Cannot open WAV capture file " + config.wavPath;
+            }
+            return nullptr;
+        }
+        return sink;
+    }
+    case DEVICE_BACKEND:
+    default:
+        break;
+    }
+
+    QAudioDevice audioDevice = QMediaDevices::defaultAudioOutput();
+    if (audioDevice.isNull()) {
+        if (error) {
+            *error = "No audio output device available";
+        }
+        return nullptr;
+    }
+
+    if (!audioDevice.isFormatSupported(format)) {
+        if (error) {
+            *error = "Audio format not supported by device";
+        }
+        return nullptr;
+    }
+
+    return new DeviceOutputSink(new QAudioSink(audioDevice, format), parent);
+}
+
+void OutputSink::setDefaultBackend(Backend backend, const QString &wavPath)
+{
+    DefaultBackend &config = defaults();
+    config.backend = backend;
+    config.wavPath = wavPath;
+}
+
+OutputSink::Backend OutputSink::defaultBackend()
+{
+    return defaults().backend;
+}
+
+// =================== DEVICE ===================
+DeviceOutputSink::DeviceOutputSink(QAudioSink *sink, QObject *parent)
+    : OutputSink(parent)
+    , m_sink(sink)
+{
+    m_sink->setParent(this);
+    connect(m_sink, &QAudioSink::stateChanged, this, &OutputSink::stateChanged);
+}
+
+void DeviceOutputSink::start(QIODevice *source)
+{
+    m_sink->start(source);
+}
+
+void DeviceOutputSink::stop()
+{
+    m_sink->stop();
+}
+
+void DeviceOutputSink::setVolume(qreal volume)
+{
+    m_sink->setVolume(volume);
+}
+
+void DeviceOutputSink::setBufferSize(qsizetype bytes)
+{
+    m_sink->setBufferSize(bytes);
+}
+
+qint64 DeviceOutputSink::processedUSecs() const
+{
+    return m_sink->processedUSecs();
+}
+
+QAudio::Error DeviceOutputSink::error() const
+{
+    return m_sink->error();
+}
+
+QAudio::State DeviceOutputSink::state() const
+{
+    return m_sink->state();
+}
+
+// =================== NULL ===================
+NullOutputSink::NullOutputSink(const QAudioFormat &format, Pacing pacing, QObject *parent)
+    : OutputSink(parent)
+    , m_format(format)
+    , m_pacing(pacing)
+    , m_timer(new QTimer(this))
+    , m_source(nullptr)
+    , m_bufferBytes(DEFAULT_BUFFER_BYTES)
+    , m_volume(1.0)
+    , m_state(QAudio::StoppedState)
+    , m_error(QAudio::NoError)
+    , m_processedFrames(0)
+    , m_pacedFrames(0)
+    , m_nextTickUs(0)
+{
+    if (m_pacing == REAL_TIME) {
+        m_timer->setTimerType(Qt::PreciseTimer);
+        m_timer->setInterval(PACE_INTERVAL_MS);
+    } else {
+        m_timer->setInterval(0);
+    }
+    connect(m_timer, &QTimer::timeout, this, &NullOutputSink::pull);
+}
+
+void NullOutputSink::start(QIODevice *source)
+{
+    m_timer->stop();
+    m_source = source;
+    m_processedFrames = 0; // As QAudioSink: positions are per start()
+
+    m_stats = PacingStats();
+    m_pacedFrames = 0;
+    m_nextTickUs = PACE_INTERVAL_MS * 1000;
+    m_clock.start();
+
+    if (!m_source || !m_source->isOpen()) {
+        setState(QAudio::StoppedState, QAudio::OpenError);
+        return;
+    }
+
+    m_timer->start();
+    setState(QAudio::ActiveState);
+}
+
+void NullOutputSink::stop()
+{
+    m_timer->stop();
+    m_source = nullptr;
+    setState(QAudio::StoppedState);
+}
+
+void NullOutputSink::setVolume(qreal volume)
+{
+    m_volume = std::clamp(volume, qreal(0.0), qreal(1.0));
+}
+
+void NullOutputSink::setBufferSize(qsizetype bytes)
+{
+    m_bufferBytes = qMax<qsizetype>(bytes, m_format.bytesPerFrame());
+}
+
+qint64 NullOutputSink::processedUSecs() const
+{
+    return m_format.sampleRate() > 0 ? m_processedFrames * 1000000 / m_format.sampleRate() : 0;
+}
+
+QAudio::Error NullOutputSink::error() const
+{
+    return m_error;
+}
+
+QAudio::State NullOutputSink::state() const
+{
+    return m_state;
+}
+
+bool NullOutputSink::consume(char *data, qint64 bytes)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(bytes);
+    return true;
+}
+
+void NullOutputSink::setState(QAudio::State state, QAudio::Error error)
+{
+    m_error = error;
+    if (m_state != state) {
+        m_state = state;
+        emit stateChanged(state);
+    }
+}
+
+void NullOutputSink::pull()
+{
+    if (m_state != QAudio::ActiveState || !m_source) {
+        return;
+    }
+
+    const int frameBytes = m_format.bytesPerFrame();
+    qint64 wanted = (m_bufferBytes / frameBytes) * frameBytes;
+
+    if (m_pacing == REAL_TIME) {
+        const qint64 nowUs = m_clock.nsecsElapsed() / 1000;
+        m_stats.maxLatenessUs = qMax(m_stats.maxLatenessUs, nowUs - m_nextTickUs);
+        while (m_nextTickUs <= nowUs) {
+            m_nextTickUs += PACE_INTERVAL_MS * 1000;
+        }
+
+        // Everything due by now; a real device would underrun if this
+        // grew past the buffer, here it shows up as lateness instead
+        qint64 dueFrames = nowUs * m_format.sampleRate() / 1000000 - m_pacedFrames;
+        wanted = qMax<qint64>(0, dueFrames) * frameBytes;
+    }
+
+    while (wanted > 0) {
+        const qint64 chunk = qMin<qint64>(wanted, (m_bufferBytes / frameBytes) * frameBytes);
+        if (m_block.size() < chunk) {
+            m_block.resize(chunk);
+        }
+
+        const qint64 pullStartNs = m_clock.nsecsElapsed();
+        const qint64 read = m_source->read(m_block.data(), chunk);
+        if (m_pacing == REAL_TIME) {
+            const qint64 pullUs = (m_clock.nsecsElapsed() - pullStartNs) / 1000;
+            ++m_stats.pulls;
+            m_stats.totalPullUs += pullUs;
+            m_stats.maxPullUs = qMax(m_stats.maxPullUs, pullUs);
+            if (pullUs > PACE_INTERVAL_MS * 1000) {
+                ++m_stats.overruns;
+            }
+        }
+
+        if (read < 0) {
+            m_timer->stop();
+            setState(QAudio::StoppedState, QAudio::IOError);
+            return;
+        }
+
+        const qint64 frames = read / frameBytes;
+        if (frames > 0 && !consume(m_block.data(), frames * frameBytes)) {
+            m_timer->stop();
+            setState(QAudio::StoppedState, QAudio::IOError);
+            return;
+        }
+        m_processedFrames += frames;
+        m_pacedFrames += frames;
+        wanted -= frames * frameBytes;
+
+        if (frames == 0) {
+            // Source drained: Idle, like a device at the end of a buffer.
+            // Listeners may restart us from the signal, so return at once.
+            m_timer->stop();
+            setState(QAudio::IdleState);
+            return;
+        }
+        if (m_pacing == FREE_RUNNING) {
+            break; // One block per event loop pass keeps timers and signals alive
+        }
+    }
+}
+
+// =================== WAV CAPTURE ===================
+// A capture file and what has been written to it, shared by the sinks
+// writing it in turn; open until the process exits
+class WavCaptureFile
+{
+public:
+    WavCaptureFile(const QString &path, const QAudioFormat &format);
+    ~WavCaptureFile();
+
+    // The file for `path` no other sink is writing, opened on first use;
+    // null if it cannot be opened
+    static std::shared_ptr<WavCaptureFile> claim(const QString &path, const QAudioFormat &format);
+    void release();
+
+    // Patches the header sizes and flushes, so the file plays as it is
+    void sync();
+
+    bool isOpen() const { return m_file.isOpen(); }
+    QString filePath() const { return m_file.fileName(); }
+    bool write(const char *data, qint64 bytes);
+
+private:
+    static QString numberedPath(const QString &path, int number);
+    void writeHeader();
+
+    QAudioFormat m_format;
+    QFile m_file;
+    qint64 m_dataBytes;
+    bool m_claimed;
+};
+
+WavCaptureFile::WavCaptureFile(const QString &path, const QAudioFormat &format)
+    : m_format(format)
+    , m_file(path)
+    , m_dataBytes(0)
+    , m_claimed(false)
+{
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Could not open WAV capture file:" << path;
+        return;
+    }
+    writeHeader();
+}
+
+WavCaptureFile::~WavCaptureFile()
+{
+    if (m_file.isOpen()) {
+        writeHeader();
+        m_file.close();
+    }
+}
+
+std::shared_ptr<WavCaptureFile> WavCaptureFile::claim(const QString &path, const QAudioFormat &format)
+{
+    static QHash<QString, std::shared_ptr<WavCaptureFile>> files;
+
+    // Numbered files only for sinks writing at the same time
+    constexpr int MAX_FILES = 32;
+    for (int number = 1; number <= MAX_FILES; ++number) {
+        const QString candidate = number == 1 ? path : numberedPath(path, number);
+        std::shared_ptr<WavCaptureFile> &file = files[candidate];
+        if (!file) {
+            file = std::make_shared<WavCaptureFile>(candidate, format);
+            if (!file->isOpen()) {
+                files.remove(candidate);
+                return nullptr;
+            }
+        } else if (file->m_claimed || file->m_format != format) {
+            continue;
+        }
+        file->m_claimed = true;
+        return file;
+    }
+    qWarning() << "Too many sinks capturing to" << path;
+    return nullptr;
+}
+
+void WavCaptureFile::release()
+{
+    sync();
+    m_claimed = false;
+}
+
+void WavCaptureFile::sync()
+{
+    if (m_file.isOpen()) {
+        writeHeader();
+        m_file.flush();
+    }
+}
+
+QString WavCaptureFile::numberedPath(const QString &path, int number)
+{
+    const QFileInfo info(path);
+    const QString suffix = info.suffix().isEmpty() ? QString() : "." + info.suffix();
+    return info.dir().filePath(QString("%1-%2%3").arg(info.completeBaseName()).arg(number).arg(suffix));
+}
+
+bool WavCaptureFile::write(const char *data, qint64 bytes)
+{
+    if (!m_file.isOpen() || m_file.write(data, bytes) != bytes) {
+        return false;
+    }
+    m_dataBytes += bytes;
+    return true;
+}
+
+void WavCaptureFile::writeHeader()
+{
+    const bool isFloat = m_format.sampleFormat() == QAudioFormat::Float;
+    const quint32 dataBytes = static_cast<quint32>(qMin<qint64>(m_dataBytes, 0xFFFFFFFFll - 36));
+
+    const qint64 position = m_file.pos();
+    m_file.seek(0);
+
+    QDataStream out(&m_file);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out.writeRawData("RIFF", 4);
+    out << quint32(36 + dataBytes);
+    out.writeRawData("WAVE", 4);
+    out.writeRawData("fmt ", 4);
+    out << quint32(16)
+        << quint16(isFloat ? 3 : 1) // PCM or IEEE float
+        << quint16(m_format.channelCount())
+        << quint32(m_format.sampleRate())
+        << quint32(m_format.sampleRate() * m_format.bytesPerFrame())
+        << quint16(m_format.bytesPerFrame())
+        << quint16(m_format.bytesPerSample() * 8);
+    out.writeRawData("data", 4);
+    out << dataBytes;
+
+    m_file.seek(qMax<qint64>(position, 44));
+}
+
+WavOutputSink::WavOutputSink(const QAudioFormat &format, const QString &path,
+                             Pacing pacing, QObject *parent)
+    : NullOutputSink(format, pacing, parent)
+{
+    if (format.sampleFormat() != QAudioFormat::Int16 && format.sampleFormat() != QAudioFormat::Float) {
+        qWarning() << "WAV capture supports Int16 and Float samples only";
+        return;
+    }
+    m_capture = WavCaptureFile::claim(path, format);
+}
+
+WavOutputSink::~WavOutputSink()
+{
+    if (m_capture) {
+        m_capture->release();
+    }
+}
+
+bool WavOutputSink::isOpen() const
+{
+    return m_capture && m_capture->isOpen();
+}
+
+QString WavOutputSink::filePath() const
+{
+    return m_capture ? m_capture->filePath() : QString();
+}
+
+void WavOutputSink::stop()
+{
+    NullOutputSink::stop();
+    if (m_capture) {
+        m_capture->sync();
+    }
+}
+
+bool WavOutputSink::consume(char *data, qint64 bytes)
+{
+    if (!isOpen()) {
+        return false;
+    }
+
+    // What a device would play: the sink volume applied to the samples
+    const qreal gain = volume();
+    if (gain != 1.0) {
+        if (format().sampleFormat() == QAudioFormat::Int16) {
+            int16_t *samples = reinterpret_cast<int16_t *>(data);
+            for (qint64 i = 0; i < bytes / qint64(sizeof(int16_t)); ++i) {
+                samples[i] = static_cast<int16_t>(samples[i] * gain);
+            }
+        } else {
+            float *samples = reinterpret_cast<float *>(data);
+            for (qint64 i = 0; i < bytes / qint64(sizeof(float)); ++i) {
+                samples[i] = static_cast<float>(samples[i] * gain);
+            }
+        }
+    }
+    return m_capture->write(data, bytes);
+}
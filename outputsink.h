@@ -0,0 +1,179 @@
+#ifndef OUTPUTSINK_H
+#define OUTPUTSINK_H
+
+#include <QObject>
+#include <QAudio>
+#include <QAudioFormat>
+#include <QElapsedTimer>
+#include <QString>
+
+#include <memory>
+
+class QAudioSink;
+class QIODevice;
+class QTimer;
+class WavCaptureFile;
+
+// Where an engine's pull-mode QIODevice is played. The engines only talk
+// to this interface, so the same playback code runs on a sound card, on a
+// machine without one, or into a file:
+//
+//   DEVICE_BACKEND      QAudioSink on the default output device
+//   NULL_BACKEND        pulls as fast as the event loop allows (throughput)
+//   PACED_NULL_BACKEND  pulls at the real-time rate and records how late
+//                       each pull ran and how long it took (jitter)
+//   WAV_BACKEND         NULL_BACKEND writing the PCM to a WAV file
+//
+// create() uses the process default, set with setDefaultBackend() or the
+// BINAURAL_AUDIO_SINK environment variable: device, null, paced or
+// wav:<path> (see WavOutputSink for the files written). The null sinks
+// follow QAudioSink's contract: stateChanged() goes Active/Idle/Stopped
+// the same way, so engines need no special cases.
+class OutputSink : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Backend {
+        DEVICE_BACKEND,
+        NULL_BACKEND,
+        PACED_NULL_BACKEND,
+        WAV_BACKEND
+    };
+    Q_ENUM(Backend)
+
+    // Null on failure, with the reason in `error`
+    static OutputSink *create(const QAudioFormat &format, QObject *parent, QString *error);
+    static void setDefaultBackend(Backend backend, const QString &wavPath = QString());
+    static Backend defaultBackend();
+
+    explicit OutputSink(QObject *parent = nullptr) : QObject(parent) {}
+
+    virtual void start(QIODevice *source) = 0;
+    virtual void stop() = 0;
+    virtual void setVolume(qreal volume) = 0;
+    virtual void setBufferSize(qsizetype bytes) = 0;
+    virtual qint64 processedUSecs() const = 0;
+    virtual QAudio::Error error() const = 0;
+    virtual QAudio::State state() const = 0;
+
+signals:
+    void stateChanged(QAudio::State state);
+};
+
+// =================== DEVICE ===================
+class DeviceOutputSink : public OutputSink
+{
+    Q_OBJECT
+
+public:
+    DeviceOutputSink(QAudioSink *sink, QObject *parent = nullptr); // Takes ownership
+
+    void start(QIODevice *source) override;
+    void stop() override;
+    void setVolume(qreal volume) override;
+    void setBufferSize(qsizetype bytes) override;
+    qint64 processedUSecs() const override;
+    QAudio::Error error() const override;
+    QAudio::State state() const override;
+
+private:
+    QAudioSink *m_sink;
+};
+
+// =================== NULL ===================
+class NullOutputSink : public OutputSink
+{
+    Q_OBJECT
+
+public:
+    enum Pacing {
+        FREE_RUNNING, // Next pull as soon as the event loop is free
+        REAL_TIME     // Pull what is due every PACE_INTERVAL_MS
+    };
+
+    // Pulls measured by a REAL_TIME sink since start()
+    struct PacingStats {
+        qint64 pulls = 0;
+        qint64 maxLatenessUs = 0; // Tick later than scheduled
+        qint64 maxPullUs = 0;     // Time spent in the source's read()
+        qint64 totalPullUs = 0;
+        qint64 overruns = 0;      // Pulls longer than PACE_INTERVAL_MS
+
+        double meanPullUs() const { return pulls > 0 ? double(totalPullUs) / pulls : 0.0; }
+    };
+
+    static constexpr int PACE_INTERVAL_MS = 5;
+    static constexpr qsizetype DEFAULT_BUFFER_BYTES = 16384;
+
+    NullOutputSink(const QAudioFormat &format, Pacing pacing, QObject *parent = nullptr);
+
+    void start(QIODevice *source) override;
+    void stop() override;
+    void setVolume(qreal volume) override;
+    void setBufferSize(qsizetype bytes) override;
+    qint64 processedUSecs() const override;
+    QAudio::Error error() const override;
+    QAudio::State state() const override;
+
+    Pacing pacing() const { return m_pacing; }
+    qint64 processedFrames() const { return m_processedFrames; }
+    PacingStats pacingStats() const { return m_stats; }
+
+protected:
+    // Every pulled block, whole frames only; false stops with an IOError
+    virtual bool consume(char *data, qint64 bytes);
+    void setState(QAudio::State state, QAudio::Error error = QAudio::NoError);
+    qreal volume() const { return m_volume; }
+    const QAudioFormat &format() const { return m_format; }
+
+private:
+    void pull();
+
+    QAudioFormat m_format;
+    Pacing m_pacing;
+    QTimer *m_timer;
+    QIODevice *m_source;
+    QByteArray m_block;
+    qsizetype m_bufferBytes;
+    qreal m_volume;
+    QAudio::State m_state;
+    QAudio::Error m_error;
+    qint64 m_processedFrames;
+
+    // REAL_TIME bookkeeping, restarted by start()
+    QElapsedTimer m_clock;
+    qint64 m_pacedFrames; // Frames pulled since the clock started
+    qint64 m_nextTickUs;
+    PacingStats m_stats;
+};
+
+// =================== WAV CAPTURE ===================
+// Writes into a capture file opened once per process and kept open: a
+// sink made for the same path later (engines make a new one on every
+// start()) appends to it, so stop and play again keep the session. A path
+// whose file another sink is writing right now, such as the ambient
+// layers' output while an engine plays, is captured to <name>-2.wav,
+// <name>-3.wav and so on instead. The header sizes are patched on stop()
+// and when the sink goes. GUI thread only.
+class WavOutputSink : public NullOutputSink
+{
+    Q_OBJECT
+
+public:
+    WavOutputSink(const QAudioFormat &format, const QString &path,
+                  Pacing pacing = FREE_RUNNING, QObject *parent = nullptr);
+    ~WavOutputSink();
+
+    bool isOpen() const;
+    QString filePath() const; // Where this sink writes: `path` or a numbered one
+    void stop() override;
+
+protected:
+    bool consume(char *data, qint64 bytes) override;
+
+private:
+    std::shared_ptr<WavCaptureFile> m_capture;
+};
+
+#endif // OUTPUTSINK_H
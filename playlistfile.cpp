@@ -0,0 +1,92 @@
+#include "playlistfile.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QVariant>
+
+// =================== TRACKS ===================
+QJsonObject PlaylistTrack::toJson() const {
+    QJsonObject json;
+    json["filePath"] = filePath;
+    json["title"] = title;
+    json["duration"] = duration;
+    return json;
+}
+
+PlaylistTrack PlaylistTrack::fromJson(const QJsonObject &json) {
+    PlaylistTrack track;
+    track.filePath = json["filePath"].toString();
+    track.title = json["title"].toString();
+    track.duration = json["duration"].toVariant().toLongLong();
+    return track;
+}
+
+// =================== FILES ===================
+bool PlaylistFile::saveToFile(const QString &filename) const {
+    QJsonObject playlistJson;
+    playlistJson["name"] = name;
+    playlistJson["version"] = "1.0";
+    playlistJson["created"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+    playlistJson["trackCount"] = tracks.size();
+
+    QJsonArray tracksArray;
+    for (const PlaylistTrack &track : tracks) {
+        tracksArray.append(track.toJson());
+    }
+    playlistJson["tracks"] = tracksArray;
+
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Could not open playlist file for writing:" << filename;
+        return false;
+    }
+
+    QJsonDocument doc(playlistJson);
+    file.write(doc.toJson(QJsonDocument::Indented));
+    file.close();
+
+    return true;
+}
+
+bool PlaylistFile::loadFromFile(const QString &filename, PlaylistFile &playlist) {
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Could not open playlist file:" << filename;
+        return false;
+    }
+
+    QByteArray data = file.readAll();
+    file.close();
+
+    QJsonParseError error;
+    QJsonDocument doc = QJsonDocument::fromJson(data, &error);
+
+    if (error.error != QJsonParseError::NoError) {
+        qWarning() << "JSON parse error in playlist file:" << error.errorString();
+        return false;
+    }
+
+    if (!doc.isObject()) {
+        qWarning() << "Playlist file is not a valid JSON object";
+        return false;
+    }
+
+    QJsonObject playlistJson = doc.object();
+    playlist.name = playlistJson["name"].toString();
+    if (playlist.name.isEmpty()) {
+        // Use filename as playlist name
+        playlist.name = QFileInfo(filename).completeBaseName();
+    }
+
+    playlist.tracks.clear();
+    const QJsonArray tracksArray = playlistJson["tracks"].toArray();
+    for (const QJsonValue &trackValue : tracksArray) {
+        playlist.tracks.append(PlaylistTrack::fromJson(trackValue.toObject()));
+    }
+
+    return true;
+}
@@ -0,0 +1,29 @@
+#ifndef PLAYLISTFILE_H
+#define PLAYLISTFILE_H
+
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+
+struct PlaylistTrack {
+    QString filePath;
+    QString title;          // Display name (filename or metadata)
+    qint64 duration = 0;    // milliseconds
+
+    QJsonObject toJson() const;
+    static PlaylistTrack fromJson(const QJsonObject &json);
+};
+
+// A playlist as stored on disk (JSON in ConstantGlobals::playlistFilePath),
+// without any of the GUI's tab and list state
+struct PlaylistFile {
+    QString name;
+    QList<PlaylistTrack> tracks;
+
+    bool saveToFile(const QString &filename) const;
+
+    // False when unreadable; an unnamed playlist takes the file's base name
+    static bool loadFromFile(const QString &filename, PlaylistFile &playlist);
+};
+
+#endif // PLAYLISTFILE_H
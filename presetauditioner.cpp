@@ -0,0 +1,104 @@
+#include "presetauditioner.h"
+#include <QTimer>
+
+// =================== CONSTRUCTOR/DESTRUCTOR ===================
+PresetAuditioner::PresetAuditioner(QObject *parent)
+    : QObject(parent)
+    , m_engine(nullptr)
+    , m_durationTimer(new QTimer(this))
+    , m_fadeTimer(new QTimer(this))
+    , m_volume(DEFAULT_VOLUME)
+{
+    m_durationTimer->setSingleShot(true);
+    connect(m_durationTimer, &QTimer::timeout, this, &PresetAuditioner::beginFadeOut);
+
+    m_fadeTimer->setSingleShot(true);
+    connect(m_fadeTimer, &QTimer::timeout, this, &PresetAuditioner::stop);
+}
+
+PresetAuditioner::~PresetAuditioner()
+{
+    stop();
+}
+
+DynamicEngine *PresetAuditioner::engine()
+{
+    if (!m_engine) {
+        m_engine = new DynamicEngine(this);
+        // A few seconds never repays rendering a loop
+        m_engine->setLoopPlaybackEnabled(false);
+        connect(m_engine, &DynamicEngine::errorOccurred,
+                this, &PresetAuditioner::errorOccurred);
+        connect(m_engine, &DynamicEngine::audioDeviceError,
+                this, &PresetAuditioner::errorOccurred);
+        connect(m_engine, &DynamicEngine::playbackStopped,
+                this, &PresetAuditioner::handlePlaybackStopped);
+    }
+    return m_engine;
+}
+
+// =================== AUDITION CONTROL ===================
+bool PresetAuditioner::audition(int durationMs)
+{
+    DynamicEngine *auditionEngine = engine();
+
+    // Restart so new settings begin from phase zero
+    m_durationTimer->stop();
+    m_fadeTimer->stop();
+    if (auditionEngine->isPlaying()) {
+        auditionEngine->stop();
+    }
+
+    auditionEngine->setVolume(m_volume);
+    auditionEngine->fadeTo(1.0, 0); // Undo the previous fade-out
+    if (!auditionEngine->start()) {
+        return false;
+    }
+
+    m_durationTimer->start(qMax(0, durationMs));
+    emit auditionStarted();
+    return true;
+}
+
+void PresetAuditioner::stop()
+{
+    m_durationTimer->stop();
+    m_fadeTimer->stop();
+    if (m_engine && m_engine->isPlaying()) {
+        m_engine->stop(); // handlePlaybackStopped() reports the end
+    }
+}
+
+bool PresetAuditioner::isAuditioning() const
+{
+    return m_engine && m_engine->isPlaying();
+}
+
+void PresetAuditioner::setVolume(double volume)
+{
+    m_volume = qBound(0.0, volume, 1.0);
+    if (isAuditioning()) {
+        m_engine->setVolume(m_volume);
+    }
+}
+
+double PresetAuditioner::volume() const
+{
+    return m_volume;
+}
+
+// =================== FADE OUT ===================
+void PresetAuditioner::beginFadeOut()
+{
+    // The engine ramps its gain per sample; stop once the ramp is done
+    m_engine->fadeTo(0.0, FADE_MS);
+    m_fadeTimer->start(FADE_MS + 50);
+}
+
+void PresetAuditioner::handlePlaybackStopped()
+{
+    // Also reached when the device goes away mid-audition
+    m_durationTimer->stop();
+    m_fadeTimer->stop();
+    emit auditionFinished();
+}
@@ -0,0 +1,54 @@
+#ifndef PRESETAUDITIONER_H
+#define PRESETAUDITIONER_H
+
+#include <QObject>
+#include "dynamicengine.h"
+
+class QTimer;
+
+// Short, quiet preview of a tone on its own DynamicEngine. The engine owns
+// its tone mode, phases and sink, so an audition runs alongside the main
+// session without touching it. The engine is created on first use and kept
+// for later auditions; its visualizer taps stay disabled.
+class PresetAuditioner : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PresetAuditioner(QObject *parent = nullptr);
+    ~PresetAuditioner();
+
+    // Engine to configure (mode, frequencies, waveform, noise) before audition()
+    DynamicEngine *engine();
+
+    // Play for durationMs at the audition volume, then fade out and stop.
+    // A running audition restarts with the current engine settings.
+    bool audition(int durationMs = DEFAULT_DURATION_MS);
+    void stop(); // Immediate, no fade
+    bool isAuditioning() const;
+
+    void setVolume(double volume); // 0.0-1.0
+    double volume() const;
+
+    static constexpr int DEFAULT_DURATION_MS = 5000;
+    static constexpr double DEFAULT_VOLUME = 0.05;
+
+signals:
+    void auditionStarted();
+    void auditionFinished();
+    void errorOccurred(const QString &errorMessage);
+
+private slots:
+    void beginFadeOut();
+    void handlePlaybackStopped();
+
+private:
+    DynamicEngine *m_engine;
+    QTimer *m_durationTimer;
+    QTimer *m_fadeTimer; // Stops the engine once its fade has run
+    double m_volume;
+
+    static constexpr int FADE_MS = 300;
+};
+
+#endif // PRESETAUDITIONER_H
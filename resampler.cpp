@@ -0,0 +1,395 @@
+#include "resampler.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <tuple>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define RESAMPLER_HAVE_SSE 1
+#endif
+
+// The AVX2 kernel is compiled for its target alone and only called when
+// the CPU has it, so the rest of the build keeps its baseline ISA
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define RESAMPLER_HAVE_AVX2 1
+#endif
+
+namespace {
+
+struct QualityPreset
+{
+    int taps;      // Per phase, at or above unity ratio
+    double beta;   // Of the Kaiser window: the stopband depth
+    double cutoff; // Of the sinc, as a fraction of the lower Nyquist
+};
+// The transition band of each is centred a little below the lower
+// Nyquist, so what would alias is in the stopband by the time it folds
+constexpr QualityPreset PRESETS[] = {
+    { 24, 7.0, 0.84 },   // FAST
+    { 48, 9.0, 0.90 },   // STANDARD
+    { 96, 12.3, 0.95 },  // HIGH
+};
+
+// Where the next output frame is, and what it is read from
+struct Walk
+{
+    const float *coefficients;
+    int taps;
+    int phases;
+    int whole;    // step / phases
+    int fraction; // step % phases
+    const float *left;
+    const float *right;
+    int fill;
+    int index;
+    int phase;
+
+    bool ready() const { return index + taps <= fill; }
+    const float *row() const { return coefficients + size_t(phase) * size_t(taps); }
+    void advance()
+    {
+        index += whole;
+        phase += fraction;
+        if (phase >= phases) {
+            phase -= phases;
+            ++index;
+        }
+    }
+};
+
+using ConvolveKernel = int (*)(Walk &walk, float *out, int limit);
+
+int convolveScalar(Walk &walk, float *out, int limit)
+{
+    int produced = 0;
+    for (; produced < limit && walk.ready(); ++produced) {
+        const float *c = walk.row();
+        const float *l = walk.left + walk.index;
+        const float *r = walk.right + walk.index;
+        float sumLeft = 0.0f;
+        float sumRight = 0.0f;
+        for (int j = 0; j < walk.taps; ++j) {
+            sumLeft += c[j] * l[j];
+            sumRight += c[j] * r[j];
+        }
+        out[2 * produced] = sumLeft;
+        out[2 * produced + 1] = sumRight;
+        walk.advance();
+    }
+    return produced;
+}
+
+#ifdef RESAMPLER_HAVE_SSE
+float horizontalSum(__m128 v)
+{
+    __m128 pairs = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+}
+
+// Eight taps a pass in two accumulators per channel, to keep the adds
+// from waiting on each other
+int convolveSse(Walk &walk, float *out, int limit)
+{
+    int produced = 0;
+    for (; produced < limit && walk.ready(); ++produced) {
+        const float *c = walk.row();
+        const float *l = walk.left + walk.index;
+        const float *r = walk.right + walk.index;
+        __m128 left0 = _mm_setzero_ps();
+        __m128 left1 = _mm_setzero_ps();
+        __m128 right0 = _mm_setzero_ps();
+        __m128 right1 = _mm_setzero_ps();
+        for (int j = 0; j < walk.taps; j += 8) {
+            const __m128 c0 = _mm_loadu_ps(c + j);
+            const __m128 c1 = _mm_loadu_ps(c + j + 4);
+            left0 = _mm_add_ps(left0, _mm_mul_ps(c0, _mm_loadu_ps(l + j)));
+            left1 = _mm_add_ps(left1, _mm_mul_ps(c1, _mm_loadu_ps(l + j + 4)));
+            right0 = _mm_add_ps(right0, _mm_mul_ps(c0, _mm_loadu_ps(r + j)));
+            right1 = _mm_add_ps(right1, _mm_mul_ps(c1, _mm_loadu_ps(r + j + 4)));
+        }
+        out[2 * produced] = horizontalSum(_mm_add_ps(left0, left1));
+        out[2 * produced + 1] = horizontalSum(_mm_add_ps(right0, right1));
+        walk.advance();
+    }
+    return produced;
+}
+#endif
+
+#ifdef RESAMPLER_HAVE_AVX2
+__attribute__((target("avx2"))) int convolveAvx2(Walk &walk, float *out, int limit)
+{
+    int produced = 0;
+    for (; produced < limit && walk.ready(); ++produced) {
+        const float *c = walk.row();
+        const float *l = walk.left + walk.index;
+        const float *r = walk.right + walk.index;
+        __m256 left = _mm256_setzero_ps();
+        __m256 right = _mm256_setzero_ps();
+        for (int j = 0; j < walk.taps; j += 8) {
+            const __m256 coefficients = _mm256_loadu_ps(c + j);
+            left = _mm256_add_ps(left, _mm256_mul_ps(coefficients, _mm256_loadu_ps(l + j)));
+            right = _mm256_add_ps(right, _mm256_mul_ps(coefficients, _mm256_loadu_ps(r + j)));
+        }
+        // Both channels' halves folded together: left in 0..3, right in 4..7
+        const __m256 halves = _mm256_hadd_ps(left, right);
+        const __m128 sums = _mm_add_ps(_mm256_castps256_ps128(halves), _mm256_extractf128_ps(halves, 1));
+        const __m128 pairs = _mm_hadd_ps(sums, sums); // l, r, l, r
+        out[2 * produced] = _mm_cvtss_f32(pairs);
+        out[2 * produced + 1] = _mm_cvtss_f32(_mm_shuffle_ps(pairs, pairs, 1));
+        walk.advance();
+    }
+    return produced;
+}
+#endif
+
+ConvolveKernel kernelFunction(Resampler::Kernel kernel)
+{
+    switch (kernel) {
+#ifdef RESAMPLER_HAVE_AVX2
+    case Resampler::AVX2_KERNEL:
+        return convolveAvx2;
+#endif
+#ifdef RESAMPLER_HAVE_SSE
+    case Resampler::SSE_KERNEL:
+        return convolveSse;
+#endif
+    default:
+        return convolveScalar;
+    }
+}
+
+// Zeroth-order modified Bessel function of the first kind, for the window
+double besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 50 && term > 1e-12 * sum; ++k) {
+        const double half = x / (2.0 * k);
+        term *= half * half;
+        sum += term;
+    }
+    return sum;
+}
+
+}
+
+Resampler::Resampler(int inputRate, int outputRate, Quality quality)
+    : m_inputRate(inputRate)
+    , m_outputRate(outputRate)
+    , m_passThrough(inputRate > 0 && inputRate == outputRate)
+    , m_kernel(bestKernel())
+    , m_fill(0)
+    , m_index(0)
+    , m_phase(0)
+    , m_inputFrames(0)
+    , m_outputFrames(0)
+{
+    if (m_passThrough || inputRate <= 0 || outputRate <= 0) {
+        return;
+    }
+    const int divisor = std::gcd(inputRate, outputRate);
+    const int phases = outputRate / divisor;
+    if (phases > MAX_PHASES) {
+        return;
+    }
+    m_bank = bank(phases, inputRate / divisor, quality);
+    m_left.resize(size_t(m_bank->taps + CHUNK_FRAMES));
+    m_right.resize(m_left.size());
+    reset();
+}
+
+int Resampler::taps() const
+{
+    return m_bank ? m_bank->taps : 0;
+}
+
+Resampler::Kernel Resampler::bestKernel()
+{
+#ifdef RESAMPLER_HAVE_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        return AVX2_KERNEL;
+    }
+#endif
+#ifdef RESAMPLER_HAVE_SSE
+    return SSE_KERNEL;
+#else
+    return SCALAR_KERNEL;
+#endif
+}
+
+bool Resampler::setKernel(Kernel kernel)
+{
+    if (kernel > bestKernel()) {
+        return false;
+    }
+    m_kernel = kernel;
+    return true;
+}
+
+int64_t Resampler::maxOutputFrames(int64_t inputFrames) const
+{
+    if (m_passThrough) {
+        return inputFrames;
+    }
+    return m_bank ? inputFrames * m_bank->phases / m_bank->step + 2 : 0;
+}
+
+int64_t Resampler::maxFinishFrames() const
+{
+    return m_bank ? maxOutputFrames(m_bank->taps / 2) : 0;
+}
+
+void Resampler::reset()
+{
+    if (!m_bank) {
+        return;
+    }
+    // Silence before the start, so the first output frame is centred on
+    // the first input frame
+    m_fill = m_bank->taps / 2 - 1;
+    std::fill(m_left.begin(), m_left.begin() + m_fill, 0.0f);
+    std::fill(m_right.begin(), m_right.begin() + m_fill, 0.0f);
+    m_index = 0;
+    m_phase = 0;
+    m_inputFrames = 0;
+    m_outputFrames = 0;
+}
+
+void Resampler::append(const float *in, int frames)
+{
+    float *left = m_left.data() + m_fill;
+    float *right = m_right.data() + m_fill;
+    for (int i = 0; i < frames; ++i) {
+        left[i] = in[2 * i];
+        right[i] = in[2 * i + 1];
+    }
+    m_fill += frames;
+}
+
+int64_t Resampler::convert(float *out, int64_t limit)
+{
+    Walk walk{ m_bank->coefficients.data(), m_bank->taps, m_bank->phases,
+               m_bank->step / m_bank->phases, m_bank->step % m_bank->phases,
+               m_left.data(), m_right.data(), m_fill, m_index, m_phase };
+    const int produced = kernelFunction(m_kernel)(walk, out, int(std::min<int64_t>(limit, INT_MAX)));
+    m_phase = walk.phase;
+    m_outputFrames += produced;
+
+    // Keep what the next frames' taps still cover
+    const int kept = m_fill - walk.index;
+    std::memmove(m_left.data(), m_left.data() + walk.index, size_t(kept) * sizeof(float));
+    std::memmove(m_right.data(), m_right.data() + walk.index, size_t(kept) * sizeof(float));
+    m_fill = kept;
+    m_index = 0;
+    return produced;
+}
+
+int64_t Resampler::process(const float *in, int64_t frames, float *out)
+{
+    if (m_passThrough) {
+        std::copy(in, in + 2 * frames, out);
+        return frames;
+    }
+    if (!m_bank) {
+        return 0;
+    }
+    int64_t written = 0;
+    for (int64_t done = 0; done < frames;) {
+        const int chunk = int(std::min<int64_t>(CHUNK_FRAMES, frames - done));
+        append(in + 2 * done, chunk);
+        m_inputFrames += chunk;
+        done += chunk;
+        written += convert(out + 2 * written, INT64_MAX);
+    }
+    return written;
+}
+
+int64_t Resampler::finish(float *out)
+{
+    if (!m_bank) {
+        return 0;
+    }
+    // Silence after the end as well, up to the last frame's taps; only the
+    // frames falling within the input are kept
+    const int half = m_bank->taps / 2;
+    std::fill(m_left.begin() + m_fill, m_left.begin() + m_fill + half, 0.0f);
+    std::fill(m_right.begin() + m_fill, m_right.begin() + m_fill + half, 0.0f);
+    m_fill += half;
+    const int64_t total = (m_inputFrames * m_bank->phases + m_bank->step - 1) / m_bank->step;
+    const int64_t written = convert(out, total - m_outputFrames);
+    reset();
+    return written;
+}
+
+void Resampler::prepareBanks(int outputRate, Quality quality)
+{
+    if (outputRate <= 0) {
+        return;
+    }
+    for (int rate : COMMON_RATES) {
+        const int divisor = std::gcd(rate, outputRate);
+        if (rate != outputRate && outputRate / divisor <= MAX_PHASES) {
+            bank(outputRate / divisor, rate / divisor, quality);
+        }
+    }
+}
+
+std::shared_ptr<const Resampler::Bank> Resampler::bank(int phases, int step, Quality quality)
+{
+    static std::mutex mutex;
+    static std::map<std::tuple<int, int, int>, std::shared_ptr<const Bank>> banks;
+
+    const std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<const Bank> &bank = banks[std::make_tuple(phases, step, int(quality))];
+    if (!bank) {
+        bank = designBank(phases, step, quality);
+    }
+    return bank;
+}
+
+std::shared_ptr<const Resampler::Bank> Resampler::designBank(int phases, int step, Quality quality)
+{
+    const QualityPreset &preset = PRESETS[std::clamp(int(quality), 0, int(std::size(PRESETS)) - 1)];
+    const double ratio = double(phases) / step;
+
+    auto bank = std::make_shared<Bank>();
+    bank->phases = phases;
+    bank->step = step;
+    // Downsampling stretches the filter by the ratio, in input frames
+    const int taps = int(std::ceil(preset.taps * std::max(1.0, 1.0 / ratio)));
+    bank->taps = (taps + 7) / 8 * 8;
+    bank->coefficients.resize(size_t(phases) * size_t(bank->taps));
+
+    // Cutoff in cycles per input frame
+    const double cutoff = 0.5 * preset.cutoff * std::min(1.0, ratio);
+    const double half = bank->taps / 2;
+    const double windowScale = 1.0 / besselI0(preset.beta);
+    for (int p = 0; p < phases; ++p) {
+        float *row = bank->coefficients.data() + size_t(p) * size_t(bank->taps);
+        double sum = 0.0;
+        for (int j = 0; j < bank->taps; ++j) {
+            // Distance from the output frame back to input frame index + j
+            const double t = (half - 1 - j) + double(p) / phases;
+            const double x = 2.0 * cutoff * t;
+            const double sinc = x == 0.0 ? 1.0 : std::sin(M_PI * x) / (M_PI * x);
+            const double edge = t / half;
+            const double window = besselI0(preset.beta * std::sqrt(std::max(0.0, 1.0 - edge * edge))) * windowScale;
+            row[j] = float(2.0 * cutoff * sinc * window);
+            sum += row[j];
+        }
+        // Unity gain at DC on every phase, or the phases' gains would
+        // differ by the window's ripple and modulate the signal
+        for (int j = 0; j < bank->taps; ++j) {
+            row[j] = float(row[j] / sum);
+        }
+    }
+    return bank;
+}
@@ -0,0 +1,113 @@
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Streaming sample-rate converter for interleaved stereo float, by
+// polyphase windowed-sinc interpolation. Qt-free; everything but the
+// constructor runs without allocating.
+//
+// The rates' ratio is reduced to outputRate / inputRate = L / M, and the
+// Kaiser-windowed sinc is sampled at the L phases an output frame can fall
+// on between two input frames. That coefficient bank is built once per
+// ratio and quality and shared by every converter using it. Each output
+// frame is then one dot product of a phase's taps with both channels'
+// history, run by an AVX2 or SSE kernel picked for the CPU at run time.
+//
+// Output frame n is the input at n * inputRate / outputRate: there is no
+// delay to compensate, so a decoded loop stays a loop. Converting a file
+// in one go yields ceil(inputFrames * L / M) frames once finish() has run.
+//
+// Cost grows with the taps per output frame: a quality's taps, scaled up
+// by M / L when downsampling so the transition band stays as narrow at the
+// output. bench_resampler times every common ratio, quality and kernel as
+// a share of one core per source in real time, against a budget of 0.5%:
+// at STANDARD with AVX2 or SSE a 48 kHz source costs about 0.1% and a
+// 96 kHz one 0.2%, and HIGH adds up to half again. The scalar kernel costs
+// three to four times as much, which puts HIGH, and STANDARD from 96 kHz,
+// around or over the budget (up to 1.1%): on a CPU without SSE the scalar
+// path is outside it, and the benchmark fails. Ambient files are converted
+// once as they decode, so a mix of any number of layers does not resample
+// at all.
+class Resampler
+{
+public:
+    enum Quality {
+        // Taps, aliasing floor, and where the passband ends at 44.1 kHz
+        // (64%, 77% and 86% of the lower rate's Nyquist)
+        FAST,     // 24 taps, -70 dB, 14 kHz
+        STANDARD, // 48 taps, -90 dB, 17 kHz
+        HIGH      // 96 taps, -120 dB, 19 kHz
+    };
+
+    enum Kernel { SCALAR_KERNEL, SSE_KERNEL, AVX2_KERNEL };
+
+    static constexpr int MAX_PHASES = 4096; // Ratios needing more are not supported
+    static constexpr int CHUNK_FRAMES = 1024; // Input converted per pass
+
+    // The rates a decoder is likely to deliver; their banks are built
+    // ahead of time by prepareBanks()
+    static constexpr int COMMON_RATES[] = { 22050, 32000, 44100, 48000, 88200, 96000 };
+
+    Resampler(int inputRate, int outputRate, Quality quality = STANDARD);
+
+    // False when the ratio needs more than MAX_PHASES phases
+    bool isValid() const { return m_bank != nullptr || m_passThrough; }
+    int inputRate() const { return m_inputRate; }
+    int outputRate() const { return m_outputRate; }
+    int taps() const;
+
+    // The fastest kernel this CPU runs; setKernel() picks a slower one
+    // (tests, benchmarks) and returns false for one the CPU lacks
+    static Kernel bestKernel();
+    Kernel kernel() const { return m_kernel; }
+    bool setKernel(Kernel kernel);
+
+    // Most frames process() writes for `inputFrames` frames, and finish()
+    int64_t maxOutputFrames(int64_t inputFrames) const;
+    int64_t maxFinishFrames() const;
+
+    // Converts `frames` interleaved stereo frames into `out`, returning
+    // the frames written; the last taps() / 2 input frames are held back
+    // until more input or finish()
+    int64_t process(const float *in, int64_t frames, float *out);
+
+    // Writes the held-back output; the converter then starts over
+    int64_t finish(float *out);
+    void reset();
+
+    // Builds the banks from every COMMON_RATES rate to outputRate
+    static void prepareBanks(int outputRate, Quality quality = STANDARD);
+
+private:
+    struct Bank
+    {
+        int phases = 0; // L
+        int step = 0;   // M
+        int taps = 0;   // Per phase, a multiple of 8
+        std::vector<float> coefficients; // Phase, tap
+    };
+
+    static std::shared_ptr<const Bank> bank(int phases, int step, Quality quality);
+    static std::shared_ptr<const Bank> designBank(int phases, int step, Quality quality);
+    int64_t convert(float *out, int64_t limit);
+    void append(const float *in, int frames);
+
+    int m_inputRate;
+    int m_outputRate;
+    bool m_passThrough;
+    std::shared_ptr<const Bank> m_bank;
+    Kernel m_kernel;
+
+    std::vector<float> m_left;  // History, then input not used up yet
+    std::vector<float> m_right;
+    int m_fill;                 // Frames in them
+    int m_index;                // Oldest frame under the next output frame's taps
+    int m_phase;                // And the phase it falls on
+    int64_t m_inputFrames;      // Since the start
+    int64_t m_outputFrames;
+};
+
+#endif // RESAMPLER_H
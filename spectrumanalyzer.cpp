@@ -0,0 +1,79 @@
+#include "spectrumanalyzer.h"
+#include "audiotapring.h"
+
+#include <QMutexLocker>
+#include <QTimer>
+#include <utility>
+
+SpectrumAnalyzer::SpectrumAnalyzer(const AudioTapRing *ring, int sampleRate, QObject *parent)
+    : QObject(parent)
+    , m_ring(ring)
+    , m_analyzer(sampleRate)
+    , m_timer(new QTimer(this))
+    , m_cursor(0)
+    , m_chunk(CHUNK_FRAMES * 2)
+    , m_hasResult(false)
+{
+    // Child of this object, so it follows us to the worker thread
+    m_timer->setInterval(ANALYSIS_INTERVAL_MS);
+    connect(m_timer, &QTimer::timeout, this, &SpectrumAnalyzer::analyze);
+}
+
+void SpectrumAnalyzer::start()
+{
+    // Only what is rendered from now on is analyzed
+    m_cursor = m_ring ? m_ring->writeIndex() : 0;
+    m_analyzer.reset();
+    {
+        QMutexLocker locker(&m_resultMutex);
+        m_hasResult = false;
+    }
+    m_timer->start();
+}
+
+void SpectrumAnalyzer::stop()
+{
+    m_timer->stop();
+}
+
+void SpectrumAnalyzer::setSampleRate(int sampleRate)
+{
+    m_analyzer.setSampleRate(sampleRate);
+}
+
+bool SpectrumAnalyzer::latestResult(ToneAnalysisResult &out) const
+{
+    QMutexLocker locker(&m_resultMutex);
+    if (!m_hasResult) {
+        return false;
+    }
+    // Vector assignment reuses out's capacity after the first copy
+    out = m_published;
+    return true;
+}
+
+void SpectrumAnalyzer::analyze()
+{
+    if (!m_ring) {
+        return;
+    }
+
+    int fresh = 0;
+    int frames;
+    while ((frames = m_ring->readSince(m_cursor, m_chunk.data(), CHUNK_FRAMES)) > 0) {
+        m_analyzer.feed(m_chunk.data(), frames);
+        fresh += frames;
+    }
+
+    // Paused or stalled output: keep the last estimate on screen
+    if (fresh == 0 || !m_analyzer.analyze(m_working)) {
+        return;
+    }
+
+    {
+        QMutexLocker locker(&m_resultMutex);
+        std::swap(m_working, m_published);
+        m_hasResult = true;
+    }
+    emit resultReady();
+}
@@ -0,0 +1,56 @@
+#ifndef SPECTRUMANALYZER_H
+#define SPECTRUMANALYZER_H
+
+#include <QObject>
+#include <QMutex>
+#include <vector>
+#include "toneanalyzer.h"
+
+class QTimer;
+class AudioTapRing;
+
+// Runs a ToneAnalyzer over the engine's analysis tap a few times per second.
+// Meant to live on a worker thread (moveToThread): start()/stop() are slots
+// so they can be invoked queued, and the GUI pulls results through
+// latestResult() after resultReady(). Results are double-buffered and copied
+// into caller-owned storage, so steady state does no allocation on either
+// side.
+class SpectrumAnalyzer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SpectrumAnalyzer(const AudioTapRing *ring, int sampleRate, QObject *parent = nullptr);
+
+    // Thread-safe. Returns false if nothing has been measured yet.
+    bool latestResult(ToneAnalysisResult &out) const;
+
+    static constexpr int ANALYSIS_INTERVAL_MS = 250;
+
+public slots:
+    void start();
+    void stop();
+    void setSampleRate(int sampleRate);
+
+signals:
+    void resultReady();
+
+private slots:
+    void analyze();
+
+private:
+    const AudioTapRing *m_ring;
+    ToneAnalyzer m_analyzer;
+    QTimer *m_timer;
+    quint64 m_cursor;
+    std::vector<float> m_chunk;
+
+    ToneAnalysisResult m_working;
+    ToneAnalysisResult m_published;
+    bool m_hasResult;
+    mutable QMutex m_resultMutex;
+
+    static constexpr int CHUNK_FRAMES = 4096;
+};
+
+#endif // SPECTRUMANALYZER_H
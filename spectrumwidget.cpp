@@ -0,0 +1,162 @@
+#include "spectrumwidget.h"
+
+#include <QPainter>
+#include <QPainterPath>
+#include <QtMath>
+
+SpectrumWidget::SpectrumWidget(QWidget *parent)
+    : QWidget(parent)
+    , m_hasResult(false)
+{
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setMinimumSize(300, 180);
+}
+
+void SpectrumWidget::setResult(const ToneAnalysisResult &result)
+{
+    m_result = result;
+    m_hasResult = true;
+    update();
+}
+
+void SpectrumWidget::clear()
+{
+    m_hasResult = false;
+    update();
+}
+
+QSize SpectrumWidget::sizeHint() const
+{
+    return QSize(560, 320);
+}
+
+double SpectrumWidget::frequencyToX(double hz) const
+{
+    double maxHz = MAX_DISPLAY_HZ;
+    if (m_result.binHz > 0.0 && !m_result.spectrumLeftDb.empty()) {
+        maxHz = qMin(maxHz, m_result.binHz * (m_result.spectrumLeftDb.size() - 1));
+    }
+    double position = qLn(qMax(hz, MIN_DISPLAY_HZ) / MIN_DISPLAY_HZ) / qLn(maxHz / MIN_DISPLAY_HZ);
+    return position * width();
+}
+
+double SpectrumWidget::levelToY(double db) const
+{
+    double position = (qBound(MIN_DISPLAY_DB, db, MAX_DISPLAY_DB) - MAX_DISPLAY_DB)
+                      / (MIN_DISPLAY_DB - MAX_DISPLAY_DB);
+    return position * height();
+}
+
+void SpectrumWidget::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+
+    QPainter painter(this);
+    painter.fillRect(rect(), QColor("#1E1E2E"));
+    drawGrid(painter);
+
+    if (!m_hasResult || m_result.spectrumLeftDb.empty()) {
+        painter.setPen(QColor("#888888"));
+        painter.drawText(rect(), Qt::AlignCenter, "No signal");
+        return;
+    }
+
+    painter.setRenderHint(QPainter::Antialiasing);
+    drawSpectrum(painter, m_result.spectrumLeftDb, QColor("#7B68EE"));
+    drawSpectrum(painter, m_result.spectrumRightDb, QColor("#32CD32"));
+
+    if (m_result.carriersValid) {
+        painter.setPen(QPen(QColor("#7B68EE"), 1, Qt::DashLine));
+        double xLeft = frequencyToX(m_result.carrierLeft);
+        painter.drawLine(QPointF(xLeft, 0), QPointF(xLeft, height()));
+        painter.setPen(QPen(QColor("#32CD32"), 1, Qt::DashLine));
+        double xRight = frequencyToX(m_result.carrierRight);
+        painter.drawLine(QPointF(xRight, 0), QPointF(xRight, height()));
+    }
+
+    drawReadout(painter);
+}
+
+void SpectrumWidget::drawGrid(QPainter &painter)
+{
+    static const double gridHz[] = { 50, 100, 200, 500, 1000, 2000, 5000, 10000 };
+
+    painter.setPen(QColor("#3A3A4E"));
+    for (double hz : gridHz) {
+        double x = frequencyToX(hz);
+        painter.drawLine(QPointF(x, 0), QPointF(x, height()));
+        painter.drawText(QPointF(x + 3, height() - 4),
+                         hz >= 1000 ? QString("%1k").arg(hz / 1000) : QString::number(hz));
+    }
+    for (double db = -20; db > MIN_DISPLAY_DB; db -= 20) {
+        double y = levelToY(db);
+        painter.drawLine(QPointF(0, y), QPointF(width(), y));
+        painter.drawText(QPointF(4, y - 2), QString("%1 dB").arg(db));
+    }
+}
+
+void SpectrumWidget::drawSpectrum(QPainter &painter, const std::vector<float> &spectrumDb, const QColor &color)
+{
+    const int bins = static_cast<int>(spectrumDb.size());
+    const int columns = qMax(1, width());
+
+    // Walk the bins once, keeping the loudest bin per pixel column
+    QPainterPath path;
+    bool started = false;
+    int column = -1;
+    float columnPeak = -1000.0f;
+
+    auto flushColumn = [&]() {
+        if (column < 0) {
+            return;
+        }
+        QPointF point(column, levelToY(columnPeak));
+        if (started) {
+            path.lineTo(point);
+        } else {
+            path.moveTo(point);
+            started = true;
+        }
+    };
+
+    for (int k = 1; k < bins; ++k) {
+        double hz = k * m_result.binHz;
+        if (hz < MIN_DISPLAY_HZ) {
+            continue;
+        }
+        if (hz > MAX_DISPLAY_HZ) {
+            break;
+        }
+        int x = qBound(0, int(frequencyToX(hz)), columns - 1);
+        if (x != column) {
+            flushColumn();
+            column = x;
+            columnPeak = spectrumDb[k];
+        } else {
+            columnPeak = qMax(columnPeak, spectrumDb[k]);
+        }
+    }
+    flushColumn();
+
+    painter.setPen(QPen(color, 1.2));
+    painter.drawPath(path);
+}
+
+void SpectrumWidget::drawReadout(QPainter &painter)
+{
+    QString text;
+    if (m_result.carriersValid) {
+        text = QString("L %1 Hz   R %2 Hz   Beat %3 Hz")
+                   .arg(m_result.carrierLeft, 0, 'f', 2)
+                   .arg(m_result.carrierRight, 0, 'f', 2)
+                   .arg(m_result.beatFrequency, 0, 'f', 2);
+    } else {
+        text = "No carrier";
+    }
+    if (m_result.modulationValid) {
+        text += QString("   Modulation %1 Hz").arg(m_result.modulationFrequency, 0, 'f', 2);
+    }
+
+    painter.setPen(QColor("#DDDDDD"));
+    painter.drawText(rect().adjusted(0, 4, -6, 0), Qt::AlignRight | Qt::AlignTop, text);
+}
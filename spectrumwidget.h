@@ -0,0 +1,42 @@
+#ifndef SPECTRUMWIDGET_H
+#define SPECTRUMWIDGET_H
+
+#include <QWidget>
+#include "toneanalyzer.h"
+
+// Log-frequency spectrum of both output channels with markers at the
+// measured carriers and a readout of carrier, beat and modulation rates.
+// Fed from SpectrumAnalyzer results; painting reduces the FFT bins to one
+// value per pixel column so cost does not depend on the FFT size.
+class SpectrumWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit SpectrumWidget(QWidget *parent = nullptr);
+
+    void setResult(const ToneAnalysisResult &result);
+    void clear();
+
+    QSize sizeHint() const override;
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    double frequencyToX(double hz) const;
+    double levelToY(double db) const;
+    void drawGrid(QPainter &painter);
+    void drawSpectrum(QPainter &painter, const std::vector<float> &spectrumDb, const QColor &color);
+    void drawReadout(QPainter &painter);
+
+    ToneAnalysisResult m_result;
+    bool m_hasResult;
+
+    static constexpr double MIN_DISPLAY_HZ = 20.0;
+    static constexpr double MAX_DISPLAY_HZ = 20000.0;
+    static constexpr double MIN_DISPLAY_DB = -100.0;
+    static constexpr double MAX_DISPLAY_DB = 0.0;
+};
+
+#endif // SPECTRUMWIDGET_H
@@ -0,0 +1,64 @@
+#include "startupprofiler.h"
+
+#include <QDebug>
+
+StartupProfiler::StartupProfiler()
+    : m_lastMarkNs(0)
+    , m_visibleNs(-1)
+    , m_logging(qEnvironmentVariableIntValue("BINAURAL_PROFILE_STARTUP") != 0)
+    , m_finished(false)
+{
+    m_clock.start(); // In case start() is never called
+}
+
+StartupProfiler &StartupProfiler::instance()
+{
+    static StartupProfiler profiler;
+    return profiler;
+}
+
+void StartupProfiler::start()
+{
+    m_phases.clear();
+    m_lastMarkNs = 0;
+    m_visibleNs = -1;
+    m_finished = false;
+    m_clock.restart();
+}
+
+void StartupProfiler::mark(const QString &phase)
+{
+    const qint64 now = m_clock.nsecsElapsed();
+    m_phases.append({phase, m_lastMarkNs, now - m_lastMarkNs});
+    m_lastMarkNs = now;
+
+    if (m_logging) {
+        qInfo().noquote() << QString("startup: %1 %2 ms")
+                                 .arg(phase, -24)
+                                 .arg((now - m_phases.last().startNs) / 1e6, 6, 'f', 1);
+    }
+}
+
+void StartupProfiler::finish(const QString &phase)
+{
+    if (m_finished) {
+        return;
+    }
+    mark(phase);
+    m_finished = true;
+    m_visibleNs = m_lastMarkNs;
+
+    if (m_logging) {
+        const double totalMs = m_visibleNs / 1e6;
+        qInfo().noquote() << QString("startup: window visible after %1 ms (budget %2 ms)")
+                                 .arg(totalMs, 0, 'f', 1).arg(BUDGET_MS);
+        if (totalMs > BUDGET_MS) {
+            qWarning().noquote() << "startup: over budget";
+        }
+    }
+}
+
+qint64 StartupProfiler::elapsedNs() const
+{
+    return m_clock.nsecsElapsed();
+}
@@ -0,0 +1,316 @@
+// Ambient clip tests: mixer voices that loop a decoded clip with no gap or
+// step at the seam, stop at the end when not repeating, and follow seeks;
+// and the loader decoding a WAV file, or refusing one over its size limit,
+// and mapping decoded PCM from its cache on the next load; and the
+// preloader decoding a batch of files at once, telling the files that
+// failed from those it was not asked for:
+//
+//   cmake -DBINAURAL_BUILD_TESTS=ON .. && make tst_ambientclip && ctest
+
+#include "ambientclip.h"
+#include "ambientmixer.h"
+#include "ambientpreloader.h"
+#include "outputsink.h"
+#include "wavfixture.h"
+
+#include <QtTest>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+constexpr int CLIP_FRAMES = 1000;
+
+// Left ramps up, right ramps down: every frame of the clip is distinct,
+// so a dropped, repeated or shifted frame at the seam shows
+std::shared_ptr<const AmbientClip> rampClip()
+{
+    auto clip = std::make_shared<AmbientClip>();
+    for (int i = 0; i < CLIP_FRAMES; ++i) {
+        clip->samples.push_back(float(i) / CLIP_FRAMES);
+        clip->samples.push_back(-float(i) / CLIP_FRAMES);
+    }
+    return clip;
+}
+
+qint16 expectedLeft(qint64 frame)
+{
+    return static_cast<qint16>(float(frame % CLIP_FRAMES) / CLIP_FRAMES * 32767.0f);
+}
+
+// Frames of the mix read into `out`
+qint64 pull(AmbientMixer &mixer, qint16 *out, qint64 frames)
+{
+    const qint64 frameBytes = qint64(AmbientClip::CHANNELS * sizeof(qint16));
+    return mixer.read(reinterpret_cast<char *>(out), frames * frameBytes) / frameBytes;
+}
+
+// A playing voice at unity gain: the mix is its clip, frame for frame
+int playVoice(AmbientMixer &mixer, std::shared_ptr<const AmbientClip> clip)
+{
+    const int voice = mixer.acquire(std::move(clip));
+    mixer.setPlaying(voice, true);
+    return voice;
+}
+
+}
+
+class AmbientClipTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void voiceLoopSeamIsSampleAccurate();
+    void voiceWithoutRepeatStopsAtEnd();
+    void voiceFollowsSeeks();
+    void voiceLoopsOnNullSink();
+    void loaderDecodesWav();
+    void loaderRefusesOversizeFile();
+    void loaderMapsCachedPcm();
+    void preloaderDecodesBatch();
+};
+
+void AmbientClipTest::voiceLoopSeamIsSampleAccurate()
+{
+    AmbientMixer mixer;
+    const int voice = playVoice(mixer, rampClip());
+
+    // Reads that do not divide the clip length put the seam mid-block
+    constexpr int READ_FRAMES = 700;
+    std::vector<qint16> block(READ_FRAMES * AmbientClip::CHANNELS);
+    qint64 frame = 0;
+    for (int read = 0; read < 5; ++read) {
+        QCOMPARE(pull(mixer, block.data(), READ_FRAMES), qint64(READ_FRAMES));
+        for (int i = 0; i < READ_FRAMES; ++i, ++frame) {
+            QCOMPARE(block[2 * i], expectedLeft(frame));
+            QCOMPARE(block[2 * i + 1], qint16(-expectedLeft(frame)));
+        }
+    }
+
+    QCOMPARE(mixer.loopCount(voice), qint64(5 * READ_FRAMES / CLIP_FRAMES));
+    QCOMPARE(mixer.positionFrames(voice), qint64(5 * READ_FRAMES % CLIP_FRAMES));
+    QVERIFY(mixer.isPlaying(voice));
+}
+
+void AmbientClipTest::voiceWithoutRepeatStopsAtEnd()
+{
+    AmbientMixer mixer;
+    const int voice = mixer.acquire(rampClip());
+    mixer.setLooping(voice, false);
+    mixer.setPlaying(voice, true);
+
+    // The mix goes on, silent after the clip's last frame
+    std::vector<qint16> block(2 * CLIP_FRAMES * AmbientClip::CHANNELS);
+    QCOMPARE(pull(mixer, block.data(), 2 * CLIP_FRAMES), qint64(2 * CLIP_FRAMES));
+    QCOMPARE(block[2 * (CLIP_FRAMES - 1)], expectedLeft(CLIP_FRAMES - 1));
+    QVERIFY(std::all_of(block.begin() + 2 * CLIP_FRAMES, block.end(), [](qint16 sample) { return sample == 0; }));
+    QVERIFY(mixer.hasEnded(voice));
+    QVERIFY(!mixer.isPlaying(voice));
+    QCOMPARE(mixer.loopCount(voice), qint64(0));
+    QCOMPARE(mixer.positionFrames(voice), qint64(CLIP_FRAMES));
+}
+
+void AmbientClipTest::voiceFollowsSeeks()
+{
+    AmbientMixer mixer;
+    const int voice = playVoice(mixer, rampClip());
+
+    mixer.setPositionFrames(voice, CLIP_FRAMES - 2);
+    qint16 frames[4 * AmbientClip::CHANNELS];
+    QCOMPARE(pull(mixer, frames, 4), qint64(4));
+    QCOMPARE(frames[0], expectedLeft(CLIP_FRAMES - 2));
+    QCOMPARE(frames[4], expectedLeft(0));
+    QCOMPARE(mixer.positionFrames(voice), qint64(2));
+
+    mixer.setPositionFrames(voice, 10 * CLIP_FRAMES);
+    QCOMPARE(mixer.positionFrames(voice), qint64(CLIP_FRAMES));
+    mixer.setPositionFrames(voice, -5);
+    QCOMPARE(mixer.positionFrames(voice), qint64(0));
+}
+
+void AmbientClipTest::voiceLoopsOnNullSink()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("voice.wav");
+
+    AmbientMixer mixer;
+    const int voice = playVoice(mixer, rampClip());
+    WavOutputSink sink(AmbientClip::outputFormat(), path);
+    QVERIFY(sink.isOpen());
+    sink.start(&mixer);
+    QTRY_VERIFY_WITH_TIMEOUT(mixer.loopCount(voice) >= 20, 5000);
+    sink.stop();
+
+    // The capture is the clip repeated without a gap
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray wav = file.readAll();
+    const auto *samples = reinterpret_cast<const qint16 *>(wav.constData() + WavFixture::HEADER_BYTES);
+    const qint64 frames = (wav.size() - WavFixture::HEADER_BYTES) / qint64(AmbientClip::CHANNELS * sizeof(qint16));
+    QVERIFY(frames >= 20 * CLIP_FRAMES);
+    for (qint64 frame = 0; frame < frames; ++frame) {
+        QCOMPARE(samples[2 * frame], expectedLeft(frame));
+    }
+}
+
+void AmbientClipTest::loaderDecodesWav()
+{
+    if (!WavFixture::decoderAvailable()) {
+        QSKIP("No QAudioDecoder backend");
+    }
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("sine.wav");
+    constexpr int FRAMES = AmbientClip::SAMPLE_RATE / 2;
+    QVERIFY(WavFixture::writeSine(path, FRAMES));
+
+    AmbientClipLoader loader;
+    QSignalSpy finished(&loader, &AmbientClipLoader::finished);
+    QSignalSpy failed(&loader, &AmbientClipLoader::errorOccurred);
+    loader.load(path);
+    QVERIFY(loader.isLoading());
+    QTRY_VERIFY_WITH_TIMEOUT(finished.count() + failed.count() > 0, 10000);
+    QVERIFY2(failed.isEmpty(), qPrintable(failed.isEmpty() ? QString() : failed.first().first().toString()));
+    QVERIFY(!loader.isLoading());
+
+    std::shared_ptr<const AmbientClip> clip = loader.takeClip();
+    QVERIFY(clip);
+    QCOMPARE(clip->filePath, path);
+    QCOMPARE(clip->frames(), qint64(FRAMES));
+    for (int i = 0; i < FRAMES; i += 97) {
+        const float expected = qint16(16000 * std::sin(2.0 * M_PI * 440.0 * i / AmbientClip::SAMPLE_RATE)) / 32768.0f;
+        QVERIFY(std::abs(clip->samples[2 * i] - expected) < 1e-3f);
+        QVERIFY(std::abs(clip->samples[2 * i + 1]) < 1e-3f);
+    }
+    QVERIFY(!loader.takeClip());
+}
+
+void AmbientClipTest::loaderRefusesOversizeFile()
+{
+    if (!WavFixture::decoderAvailable()) {
+        QSKIP("No QAudioDecoder backend");
+    }
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("long.wav");
+    QVERIFY(WavFixture::writeSine(path, AmbientClip::SAMPLE_RATE * 2));
+
+    // One second's worth of float PCM for a two-second file
+    AmbientClipLoader loader;
+    QSignalSpy finished(&loader, &AmbientClipLoader::finished);
+    QSignalSpy failed(&loader, &AmbientClipLoader::errorOccurred);
+    loader.load(path, AmbientClip::SAMPLE_RATE * AmbientClip::CHANNELS * qint64(sizeof(float)));
+    QTRY_COMPARE_WITH_TIMEOUT(failed.count(), 1, 10000);
+    QVERIFY(finished.isEmpty());
+    QVERIFY(!loader.isLoading());
+    QVERIFY(!loader.takeClip());
+}
+
+void AmbientClipTest::loaderMapsCachedPcm()
+{
+    if (!WavFixture::decoderAvailable()) {
+        QSKIP("No QAudioDecoder backend");
+    }
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("sine.wav");
+    QVERIFY(WavFixture::writeSine(path, AmbientClip::SAMPLE_RATE / 2));
+
+    std::shared_ptr<const AmbientClip> decoded;
+    {
+        AmbientClipLoader loader;
+        loader.setCache(dir.filePath("pcm"));
+        QSignalSpy finished(&loader, &AmbientClipLoader::finished);
+        loader.load(path);
+        QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 1, 10000);
+        decoded = loader.takeClip();
+        QVERIFY(!decoded->isMapped());
+        QTRY_VERIFY_WITH_TIMEOUT(!loader.isStoring(), 10000);
+    }
+
+    // Mapped before load() returns, sample for sample what was decoded
+    {
+        AmbientClipLoader loader;
+        loader.setCache(dir.filePath("pcm"));
+        QSignalSpy finished(&loader, &AmbientClipLoader::finished);
+        loader.load(path);
+        QCOMPARE(finished.count(), 1);
+        std::shared_ptr<const AmbientClip> cached = loader.takeClip();
+        QVERIFY(cached->isMapped());
+        QCOMPARE(cached->filePath, path);
+        QCOMPARE(cached->frames(), decoded->frames());
+        QVERIFY(std::equal(decoded->data(), decoded->data() + decoded->sampleCount(), cached->data()));
+
+        // A voice plays a mapped clip as any other
+        AmbientMixer mixer;
+        const int voice = playVoice(mixer, cached);
+        mixer.setPositionFrames(voice, 97);
+        qint16 frame[AmbientClip::CHANNELS];
+        QCOMPARE(pull(mixer, frame, 1), qint64(1));
+        QCOMPARE(frame[0], static_cast<qint16>(decoded->samples[2 * 97] * 32767.0f));
+    }
+
+    // Over the size limit it is decoded, and refused, as before
+    {
+        AmbientClipLoader loader;
+        loader.setCache(dir.filePath("pcm"));
+        QSignalSpy finished(&loader, &AmbientClipLoader::finished);
+        QSignalSpy failed(&loader, &AmbientClipLoader::errorOccurred);
+        loader.load(path, 1024);
+        QVERIFY(finished.isEmpty());
+        QTRY_COMPARE_WITH_TIMEOUT(failed.count(), 1, 10000);
+    }
+}
+
+void AmbientClipTest::preloaderDecodesBatch()
+{
+    if (!WavFixture::decoderAvailable()) {
+        QSKIP("No QAudioDecoder backend");
+    }
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QStringList paths;
+    for (int i = 0; i < AmbientPreloader::maxParallel() + 2; ++i) {
+        paths.append(dir.filePath(QString("sine%1.wav").arg(i)));
+        QVERIFY(WavFixture::writeSine(paths.last(), AmbientClip::SAMPLE_RATE / 4 + i));
+    }
+    const QString missing = dir.filePath("missing.wav");
+
+    // More files than loaders, one that fails and one named twice
+    AmbientPreloader preloader;
+    QSignalSpy progress(&preloader, &AmbientPreloader::progress);
+    QSignalSpy finished(&preloader, &AmbientPreloader::finished);
+    preloader.preload(paths + QStringList{missing, paths.first()}, AmbientClipLoader::DEFAULT_MAX_BYTES);
+    QVERIFY(preloader.isLoading());
+    QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 1, 20000);
+    QVERIFY(!preloader.isLoading());
+    QCOMPARE(progress.count(), int(paths.size()) + 1);
+    QCOMPARE(progress.last().at(1).toInt(), int(paths.size()) + 1);
+
+    for (int i = 0; i < paths.size(); ++i) {
+        std::shared_ptr<const AmbientClip> clip = preloader.clip(paths[i]);
+        QVERIFY(clip);
+        QCOMPARE(clip->frames(), qint64(AmbientClip::SAMPLE_RATE / 4 + i));
+    }
+    QVERIFY(!preloader.clip(missing));
+
+    // Failed is told apart from never asked for
+    QVERIFY(preloader.failed(missing));
+    QVERIFY(!preloader.failed(paths.first()));
+    QVERIFY(!preloader.failed(dir.filePath("unnamed.wav")));
+
+    // A new batch drops the last; an empty one finishes at once
+    preloader.preload(QStringList(), AmbientClipLoader::DEFAULT_MAX_BYTES);
+    QCOMPARE(finished.count(), 2);
+    QVERIFY(!preloader.clip(paths.first()));
+}
+
+QTEST_GUILESS_MAIN(AmbientClipTest)
+#include "tst_ambientclip.moc"
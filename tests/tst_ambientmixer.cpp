@@ -0,0 +1,479 @@
+// Ambient mixer tests: voices summed at their gains through one stream,
+// loops and seeks per voice, a voice that does not repeat ending on its
+// own, slots reused once released, gain changes and ducks ramped in the
+// mix, placed voices heard through the spatializer, fades committed
+// together, and scatters firing one-shots on their frame within their
+// ranges:
+//
+//   cmake -DBINAURAL_BUILD_TESTS=ON .. && make tst_ambientmixer && ctest
+
+#include "ambientclip.h"
+#include "ambientmixer.h"
+#include "ambientspatializer.h"
+
+#include <QtTest>
+
+#include <cmath>
+#include <vector>
+
+namespace {
+
+// Every frame the same level, so a mix is easy to predict
+std::shared_ptr<const AmbientClip> constantClip(float level, int frames)
+{
+    auto clip = std::make_shared<AmbientClip>();
+    clip->samples.assign(size_t(frames) * AmbientClip::CHANNELS, level);
+    return clip;
+}
+
+// Left counts frames: a wrap or a seek shows in the value
+std::shared_ptr<const AmbientClip> rampClip(int frames)
+{
+    auto clip = std::make_shared<AmbientClip>();
+    for (int i = 0; i < frames; ++i) {
+        clip->samples.push_back(float(i) / 32767.0f);
+        clip->samples.push_back(0.0f);
+    }
+    return clip;
+}
+
+// A click on the first `width` frames, silence after
+std::shared_ptr<const AmbientClip> clickClip(float level, int width, int frames = 20)
+{
+    auto clip = std::make_shared<AmbientClip>();
+    clip->samples.assign(size_t(frames) * AmbientClip::CHANNELS, 0.0f);
+    std::fill_n(clip->samples.begin(), width * AmbientClip::CHANNELS, level);
+    return clip;
+}
+
+// Within a step of rounding
+bool near(qint16 sample, double expected)
+{
+    return std::abs(sample - expected) <= 1.0;
+}
+
+std::vector<qint16> pull(AmbientMixer &mixer, qint64 frames)
+{
+    std::vector<qint16> out(size_t(frames) * AmbientClip::CHANNELS);
+    const qint64 bytes = qint64(out.size() * sizeof(qint16));
+    if (mixer.read(reinterpret_cast<char *>(out.data()), bytes) != bytes) {
+        out.clear();
+    }
+    return out;
+}
+
+// Pulled in uneven reads, so triggers fall anywhere in a block
+std::vector<qint16> pullUnevenly(AmbientMixer &mixer, qint64 frames)
+{
+    std::vector<qint16> out;
+    static const qint64 sizes[] = {37, 1000, 333, 4096, 1};
+    for (int i = 0; qint64(out.size()) < frames * AmbientClip::CHANNELS; ++i) {
+        const qint64 left = frames - qint64(out.size()) / AmbientClip::CHANNELS;
+        const std::vector<qint16> part = pull(mixer, std::min(sizes[i % 5], left));
+        out.insert(out.end(), part.begin(), part.end());
+    }
+    return out;
+}
+
+// Frames where the left or right channel sounds
+std::vector<qint64> soundingFrames(const std::vector<qint16> &out)
+{
+    std::vector<qint64> frames;
+    for (size_t i = 0; i < out.size(); i += AmbientClip::CHANNELS) {
+        if (out[i] != 0 || out[i + 1] != 0) {
+            frames.push_back(qint64(i / AmbientClip::CHANNELS));
+        }
+    }
+    return frames;
+}
+
+}
+
+class AmbientMixerTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void mixesVoicesAtTheirGains();
+    void loopsAndSeeksPerVoice();
+    void voiceWithoutRepeatEnds();
+    void reusesReleasedSlots();
+    void gainChangesRamp();
+    void duckRampsPerSource();
+    void placedVoiceIsSpatialized();
+    void crossfadesStartTogether();
+    void scatterTriggersOnItsFrame();
+    void scatterStaysWithinItsRanges();
+    void scatterSlotsAreReleased();
+};
+
+void AmbientMixerTest::mixesVoicesAtTheirGains()
+{
+    AmbientMixer mixer;
+    const int first = mixer.acquire(constantClip(0.25f, 4000));
+    const int second = mixer.acquire(constantClip(0.5f, 4000));
+    QVERIFY(first >= 0 && second >= 0 && first != second);
+    QCOMPARE(mixer.voiceCount(), 2);
+
+    // Acquired voices are silent until they play
+    std::vector<qint16> out = pull(mixer, 100);
+    QCOMPARE(out.size(), size_t(200));
+    QCOMPARE(out[0], qint16(0));
+
+    mixer.setPlaying(first, true);
+    mixer.setPlaying(second, true);
+    mixer.setGain(second, 0.5f);
+    QCOMPARE(mixer.playingCount(), 2);
+    out = pull(mixer, AmbientMixer::BLOCK_FRAMES + 100); // Across a block
+    for (qint16 sample : out) {
+        QCOMPARE(sample, qint16(0.5f * 32767.0f));
+    }
+
+    // A new gain ramps in from the old one; past full scale the sum is
+    // clamped, not wrapped
+    mixer.setGain(first, 4.0f);
+    out = pull(mixer, AmbientMixer::GAIN_RAMP_FRAMES + 10);
+    QCOMPARE(out[0], qint16(0.5f * 32767.0f));
+    QCOMPARE(out.back(), qint16(32767));
+
+    mixer.setPlaying(first, false);
+    out = pull(mixer, 10);
+    QCOMPARE(out[0], qint16(0.25f * 32767.0f));
+    QCOMPARE(mixer.positionFrames(first),
+             qint64(AmbientMixer::BLOCK_FRAMES + 100 + AmbientMixer::GAIN_RAMP_FRAMES + 10));
+}
+
+void AmbientMixerTest::loopsAndSeeksPerVoice()
+{
+    AmbientMixer mixer;
+    const int voice = mixer.acquire(rampClip(1000));
+    mixer.setPlaying(voice, true);
+
+    // Whole clip, then a region
+    std::vector<qint16> out = pull(mixer, 2500);
+    QVERIFY(near(out[2 * 999], 999));
+    QVERIFY(near(out[2 * 1000], 0));
+    QCOMPARE(mixer.loopCount(voice), qint64(2));
+
+    auto loop = std::make_shared<AmbientLoop>();
+    loop->start = 100;
+    loop->end = 200;
+    mixer.setLoop(voice, loop);
+    mixer.setPositionFrames(voice, 150);
+    out = pull(mixer, 100);
+    QVERIFY(near(out[0], 150));
+    QVERIFY(near(out[2 * 49], 199));
+    QVERIFY(near(out[2 * 50], 100));
+    QCOMPARE(mixer.positionFrames(voice), qint64(150));
+
+    // Seeks clamp to the clip
+    mixer.setPositionFrames(voice, 5000);
+    QCOMPARE(mixer.positionFrames(voice), qint64(1000));
+}
+
+void AmbientMixerTest::voiceWithoutRepeatEnds()
+{
+    AmbientMixer mixer;
+    const int once = mixer.acquire(constantClip(0.5f, 300));
+    const int looping = mixer.acquire(constantClip(0.25f, 300));
+    mixer.setLooping(once, false);
+    mixer.setPlaying(once, true);
+    mixer.setPlaying(looping, true);
+
+    // The stream goes on; the voice falls silent where its clip ends
+    std::vector<qint16> out = pull(mixer, 1000);
+    QCOMPARE(out.size(), size_t(2000));
+    QCOMPARE(out[2 * 299], qint16(0.75f * 32767.0f));
+    QCOMPARE(out[2 * 300], qint16(0.25f * 32767.0f));
+    QVERIFY(mixer.hasEnded(once));
+    QVERIFY(!mixer.isPlaying(once));
+    QVERIFY(!mixer.hasEnded(looping));
+
+    // Playing again starts over from a rewind
+    mixer.setPositionFrames(once, 0);
+    QVERIFY(!mixer.hasEnded(once));
+    mixer.setPlaying(once, true);
+    out = pull(mixer, 10);
+    QCOMPARE(out[0], qint16(0.75f * 32767.0f));
+}
+
+void AmbientMixerTest::reusesReleasedSlots()
+{
+    AmbientMixer mixer;
+    std::vector<int> voices;
+    for (int i = 0; i < AmbientMixer::MAX_VOICES; ++i) {
+        voices.push_back(mixer.acquire(constantClip(0.01f, 100)));
+        QVERIFY(voices.back() >= 0);
+        mixer.setPlaying(voices.back(), true);
+    }
+    QCOMPARE(mixer.acquire(constantClip(0.01f, 100)), -1);
+    QVERIFY(near(pull(mixer, 10)[0], 0.01 * AmbientMixer::MAX_VOICES * 32767.0));
+
+    // Released voices are silent at once and their slots are free again
+    std::weak_ptr<const AmbientClip> released = mixer.clip(voices[3]);
+    mixer.release(voices[3]);
+    QCOMPARE(mixer.voiceCount(), AmbientMixer::MAX_VOICES - 1);
+    QVERIFY(!mixer.clip(voices[3]));
+    QVERIFY(near(pull(mixer, 10)[0], 0.01 * (AmbientMixer::MAX_VOICES - 1) * 32767.0));
+    QCOMPARE(mixer.acquire(constantClip(0.01f, 100)), voices[3]);
+    QVERIFY(released.expired());
+}
+
+void AmbientMixerTest::gainChangesRamp()
+{
+    AmbientMixer mixer;
+    const int voice = mixer.acquire(constantClip(0.5f, 10000));
+    mixer.setGain(voice, 0.5f); // Before it plays: at once
+    mixer.setPlaying(voice, true);
+    std::vector<qint16> out = pull(mixer, 100);
+    QCOMPARE(out[0], qint16(0.25f * 32767.0f));
+
+    // In even steps over one ramp, however the reads fall
+    mixer.setGain(voice, 1.0f);
+    out = pullUnevenly(mixer, AmbientMixer::GAIN_RAMP_FRAMES + 10);
+    for (int frame = 0; frame < AmbientMixer::GAIN_RAMP_FRAMES; frame += 37) {
+        QVERIFY(near(out[size_t(2 * frame)], (0.25 + 0.25 * frame / AmbientMixer::GAIN_RAMP_FRAMES) * 32767.0));
+    }
+    QCOMPARE(out[2 * AmbientMixer::GAIN_RAMP_FRAMES], qint16(0.5f * 32767.0f));
+
+    // Paused and played again, it starts at its gain
+    mixer.setPlaying(voice, false);
+    mixer.setGain(voice, 0.25f);
+    pull(mixer, 10);
+    mixer.setPlaying(voice, true);
+    QCOMPARE(pull(mixer, 10)[0], qint16(0.125f * 32767.0f));
+}
+
+void AmbientMixerTest::duckRampsPerSource()
+{
+    constexpr quint32 GUIDANCE = 1u << 1;
+    const double depth = std::pow(10.0, -12.0 / 20.0);
+    AmbientMixer mixer;
+    const int voice = mixer.acquire(constantClip(0.5f, 100000));
+    mixer.setPlaying(voice, true);
+    mixer.setDuckShape(-12.0f, 100, 200);
+    QCOMPARE(mixer.duckGain(), 1.0f);
+
+    // Down over the attack with no step, then held at the depth
+    mixer.setDuck(AmbientMixer::DUCK_MUSIC, true);
+    std::vector<qint16> out = pull(mixer, AmbientClip::SAMPLE_RATE / 10 + AmbientMixer::BLOCK_FRAMES);
+    for (size_t i = 2; i < out.size(); i += 2) {
+        QVERIFY(out[i] <= out[i - 2] && out[i - 2] - out[i] <= 8);
+    }
+    QVERIFY(near(out.back(), 0.5 * depth * 32767.0));
+    QVERIFY(std::abs(mixer.duckGain() - depth) < 1e-3);
+
+    // Another source keeps it down when the music stops
+    mixer.setDuck(GUIDANCE, true);
+    mixer.setDuck(AmbientMixer::DUCK_MUSIC, false);
+    QVERIFY(near(pull(mixer, 2000).back(), 0.5 * depth * 32767.0));
+
+    // Up over the release once none holds it
+    mixer.setDuck(GUIDANCE, false);
+    out = pull(mixer, AmbientClip::SAMPLE_RATE / 5 + AmbientMixer::BLOCK_FRAMES);
+    for (size_t i = 2; i < out.size(); i += 2) {
+        QVERIFY(out[i] >= out[i - 2] && out[i] - out[i - 2] <= 8);
+    }
+    QCOMPARE(out.back(), qint16(0.5f * 32767.0f));
+    QCOMPARE(mixer.duckGain(), 1.0f);
+}
+
+void AmbientMixerTest::placedVoiceIsSpatialized()
+{
+    AmbientMixer mixer;
+    const int voice = mixer.acquire(clickClip(0.5f, 1, 4000));
+    mixer.setLooping(voice, false);
+    mixer.setSpatialPosition(voice, -90.0f, 0.0f);
+    QVERIFY(mixer.isSpatial(voice));
+    mixer.setPlaying(voice, true);
+
+    // A partition late, at the left ear first and louder
+    const std::vector<qint16> out = pullUnevenly(mixer, 2000);
+    auto arrival = [&out](int channel) {
+        for (size_t i = size_t(channel); i < out.size(); i += AmbientClip::CHANNELS) {
+            if (std::abs(out[i]) > 100) {
+                return qint64(i / AmbientClip::CHANNELS);
+            }
+        }
+        return qint64(-1);
+    };
+    auto peak = [&out](int channel) {
+        int most = 0;
+        for (size_t i = size_t(channel); i < out.size(); i += AmbientClip::CHANNELS) {
+            most = std::max(most, std::abs(int(out[i])));
+        }
+        return most;
+    };
+    QVERIFY(arrival(0) >= AmbientSpatializer::DEFAULT_PARTITION_FRAMES);
+    QVERIFY(arrival(1) > arrival(0) + 20);
+    QVERIFY(peak(0) > 2 * peak(1));
+
+    // Played again in stereo, it is the clip's own click
+    pull(mixer, 4000);
+    QVERIFY(mixer.hasEnded(voice));
+    mixer.clearSpatialPosition(voice);
+    QVERIFY(!mixer.isSpatial(voice));
+    mixer.setPositionFrames(voice, 0);
+    mixer.setPlaying(voice, true);
+    const std::vector<qint16> plain = pull(mixer, 10);
+    QCOMPARE(plain[0], qint16(0.5f * 32767.0f));
+    QCOMPARE(plain[1], qint16(0.5f * 32767.0f));
+    QCOMPARE(plain[2], qint16(0));
+}
+
+void AmbientMixerTest::crossfadesStartTogether()
+{
+    AmbientMixer mixer;
+    const int outgoing = mixer.acquire(constantClip(0.5f, 4000));
+    mixer.setPlaying(outgoing, true);
+    pull(mixer, 100);
+
+    // Set up, nothing changes: the incoming voice waits where it is
+    const int incoming = mixer.acquire(rampClip(4000));
+    mixer.setFade(outgoing, -1.0f, 0.0f, 1000, true);
+    mixer.setFade(incoming, 0.0f, 1.0f, 1000);
+    mixer.setPlaying(incoming, true);
+    std::vector<qint16> out = pull(mixer, 100);
+    QCOMPARE(out[2 * 99], qint16(0.5f * 32767.0f));
+    QCOMPARE(mixer.positionFrames(incoming), qint64(0));
+
+    // Committed, both start on the next frame: equal power on the right,
+    // where only the outgoing voice sounds, and the ramp coming in on the left
+    mixer.commitFades();
+    out = pull(mixer, 1200);
+    for (int frame : {0, 250, 500, 999}) {
+        const double t = frame / 1000.0;
+        QVERIFY(near(out[size_t(2 * frame + 1)], 0.5 * std::sqrt(1.0 - t) * 32767.0));
+        QVERIFY(near(out[size_t(2 * frame)], 0.5 * std::sqrt(1.0 - t) * 32767.0 + std::sqrt(t) * frame));
+    }
+    QCOMPARE(out[2 * 1000 + 1], qint16(0));
+    QVERIFY(near(out[2 * 1100], 1100));
+
+    // The outgoing voice stops by itself once silent
+    QVERIFY(mixer.hasEnded(outgoing));
+    QVERIFY(!mixer.isPlaying(outgoing));
+    QCOMPARE(mixer.playingCount(), 1);
+    QCOMPARE(mixer.positionFrames(incoming), qint64(1200));
+}
+
+void AmbientMixerTest::scatterTriggersOnItsFrame()
+{
+    // A fixed interval puts every shot on a known frame
+    auto set = std::make_shared<ScatterSet>();
+    set->clips.push_back(clickClip(0.5f, 1));
+    set->minIntervalSeconds = set->maxIntervalSeconds = 0.01; // 441 frames
+    set->minGain = set->maxGain = 1.0f;
+    set->panWidth = 0.0f;
+    AmbientMixer mixer;
+    const int scatter = mixer.acquireScatter(set);
+    QVERIFY(scatter >= 0);
+
+    // Nothing fires until it plays
+    QVERIFY(soundingFrames(pull(mixer, 1000)).empty());
+    mixer.setScatterPlaying(scatter, true);
+    QCOMPARE(mixer.playingCount(), 1);
+
+    const std::vector<qint16> out = pullUnevenly(mixer, 10000);
+    const std::vector<qint64> frames = soundingFrames(out);
+    QCOMPARE(frames.size(), size_t(22));
+    for (size_t i = 0; i < frames.size(); ++i) {
+        QCOMPARE(frames[i], qint64(441 * (i + 1)));
+        // Centred at unity gain
+        QVERIFY(near(out[size_t(frames[i]) * 2], 0.5 * 32767.0));
+        QVERIFY(near(out[size_t(frames[i]) * 2 + 1], 0.5 * 32767.0));
+    }
+    QCOMPARE(mixer.scatterTriggerCount(scatter), qint64(22));
+
+    // Paused, the scene holds its place: the next shot is 23 * 441 - 10000
+    // frames on
+    mixer.setScatterPlaying(scatter, false);
+    QVERIFY(soundingFrames(pull(mixer, 1000)).empty());
+    mixer.setScatterPlaying(scatter, true);
+    QCOMPARE(soundingFrames(pull(mixer, 441)), std::vector<qint64>{143});
+}
+
+void AmbientMixerTest::scatterStaysWithinItsRanges()
+{
+    // One click wide or two: consecutive shots never use the same clip
+    auto set = std::make_shared<ScatterSet>();
+    set->clips.push_back(clickClip(0.5f, 1));
+    set->clips.push_back(clickClip(0.5f, 2));
+    set->minIntervalSeconds = 0.01;
+    set->maxIntervalSeconds = 0.02;
+    set->minGain = 0.2f;
+    set->maxGain = 0.8f;
+    set->panWidth = 1.0f;
+    set->seed = 7;
+
+    AmbientMixer mixer;
+    const int scatter = mixer.acquireScatter(set);
+    mixer.setScatterPlaying(scatter, true);
+    const std::vector<qint16> out = pullUnevenly(mixer, 2 * AmbientClip::SAMPLE_RATE);
+
+    // Shot starts: a sounding frame after a silent one
+    const std::vector<qint64> frames = soundingFrames(out);
+    std::vector<qint64> starts;
+    std::vector<int> widths;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        if (i == 0 || frames[i] != frames[i - 1] + 1) {
+            starts.push_back(frames[i]);
+            widths.push_back(1);
+        } else {
+            ++widths.back();
+        }
+    }
+    QCOMPARE(qint64(starts.size()), mixer.scatterTriggerCount(scatter));
+    QVERIFY(starts.size() > 90 && starts.size() < 200);
+
+    bool left = false;
+    bool right = false;
+    for (size_t i = 0; i < starts.size(); ++i) {
+        const qint64 interval = starts[i] - (i == 0 ? 0 : starts[i - 1]);
+        QVERIFY2(interval >= 441 && interval <= 882, qPrintable(QString::number(interval)));
+        if (i > 0) {
+            QVERIFY(widths[i] != widths[i - 1]);
+        }
+        // Equal power: the pan moves level between channels, not the sum
+        const double l = out[size_t(starts[i]) * 2] / 32767.0;
+        const double r = out[size_t(starts[i]) * 2 + 1] / 32767.0;
+        const double gain = std::sqrt((l * l + r * r) / 2.0) / 0.5;
+        QVERIFY2(gain > 0.19 && gain < 0.81, qPrintable(QString::number(gain)));
+        left = left || l > 2.0 * r;
+        right = right || r > 2.0 * l;
+    }
+    QVERIFY(left && right);
+
+    // The same seed plays the same scene
+    AmbientMixer again;
+    again.setScatterPlaying(again.acquireScatter(set), true);
+    QVERIFY(pull(again, 2 * AmbientClip::SAMPLE_RATE) == out);
+}
+
+void AmbientMixerTest::scatterSlotsAreReleased()
+{
+    QCOMPARE(AmbientMixer().acquireScatter(std::make_shared<ScatterSet>()), -1);
+
+    auto set = std::make_shared<ScatterSet>();
+    set->clips.push_back(clickClip(0.5f, 20));
+    set->minIntervalSeconds = set->maxIntervalSeconds = 0.001;
+    AmbientMixer mixer;
+    std::vector<int> scatters;
+    for (int i = 0; i < AmbientMixer::MAX_SCATTERS; ++i) {
+        scatters.push_back(mixer.acquireScatter(set));
+        QVERIFY(scatters.back() >= 0);
+    }
+    QCOMPARE(mixer.acquireScatter(set), -1);
+    QCOMPARE(mixer.scatterCount(), AmbientMixer::MAX_SCATTERS);
+
+    // Released mid-shot, a scatter is silent at once
+    mixer.setScatterPlaying(scatters[0], true);
+    pull(mixer, 50);
+    QVERIFY(!soundingFrames(pull(mixer, 5)).empty());
+    mixer.releaseScatter(scatters[0]);
+    QVERIFY(soundingFrames(pull(mixer, 100)).empty());
+    QCOMPARE(mixer.playingCount(), 0);
+    QCOMPARE(mixer.acquireScatter(set), scatters[0]);
+}
+
+QTEST_GUILESS_MAIN(AmbientMixerTest)
+#include "tst_ambientmixer.moc"
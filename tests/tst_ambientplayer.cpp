@@ -0,0 +1,97 @@
+// Ambient player tests: a preset switch streams a layer the preloader
+// tried and could not decode, and leaves one it never tried (a disabled
+// layer) to be decoded once it plays, as a voice of the shared mixer at
+// its volume on the dB taper:
+//
+//   cmake -DBINAURAL_BUILD_TESTS=ON .. && make tst_ambientplayer && ctest
+
+#include "ambientclip.h"
+#include "ambientmixer.h"
+#include "ambientplayer.h"
+#include "gaincurve.h"
+#include "outputsink.h"
+#include "wavfixture.h"
+
+#include <QtTest>
+
+class AmbientPlayerTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanupTestCase();
+
+    void disabledLayerPlaysThroughMixer();
+    void failedPreloadStreams();
+};
+
+void AmbientPlayerTest::init()
+{
+    OutputSink::setDefaultBackend(OutputSink::NULL_BACKEND);
+    AmbientPlayer::setDecodedCacheBytes(0); // Not the user's PCM cache
+}
+
+void AmbientPlayerTest::cleanupTestCase()
+{
+    OutputSink::setDefaultBackend(OutputSink::DEVICE_BACKEND);
+}
+
+void AmbientPlayerTest::disabledLayerPlaysThroughMixer()
+{
+    if (!WavFixture::decoderAvailable()) {
+        QSKIP("No QAudioDecoder backend");
+    }
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString first = dir.filePath("rain.wav");
+    const QString second = dir.filePath("wind.wav");
+    QVERIFY(WavFixture::writeSine(first, AmbientClip::SAMPLE_RATE / 2));
+    QVERIFY(WavFixture::writeSine(second, AmbientClip::SAMPLE_RATE / 2));
+
+    AmbientVoicePool pool;
+    AmbientPlayer player(&pool);
+    player.setFilePath(first);
+
+    // Switched while disabled: the preloader skipped it, nothing was tried
+    player.crossfadeTo(second, nullptr, false, false, 0);
+    player.setEnabled(false);
+    pool.commitFades();
+    QCOMPARE(player.filePath(), second);
+    QVERIFY(!player.isStreaming());
+    QVERIFY(!player.mediaPlayer());
+
+    // Enabled later, it is decoded and mixed like any other layer
+    player.setEnabled(true);
+    player.play();
+    QTRY_COMPARE_WITH_TIMEOUT(pool.mixer()->playingCount(), 1, 10000);
+    QCOMPARE(pool.mixer()->voiceCount(), 1);
+    QCOMPARE(pool.mixer()->clip(0)->filePath, second);
+    QVERIFY(pool.isOutputActive());
+    QVERIFY(!player.isStreaming());
+    QVERIFY(!player.mediaPlayer());
+    QCOMPARE(player.playbackState(), QMediaPlayer::PlayingState);
+
+    // At its volume on the dB taper, not the slider's linear position
+    QCOMPARE(player.volume(), 50);
+    QCOMPARE(pool.mixer()->gain(0), GainCurve::perceptual(0.5f));
+
+    player.stop();
+}
+
+void AmbientPlayerTest::failedPreloadStreams()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    // Not decoded again on play: it streams from the start
+    AmbientVoicePool pool;
+    AmbientPlayer player(&pool);
+    player.crossfadeTo(dir.filePath("missing.wav"), nullptr, true, false, 0);
+    QVERIFY(player.isStreaming());
+    QCOMPARE(pool.mixer()->voiceCount(), 0);
+}
+
+QTEST_MAIN(AmbientPlayerTest)
+#include "tst_ambientplayer.moc"
@@ -0,0 +1,227 @@
+// Loop point tests: detection on a recording that repeats, the level of
+// the crossfade seam, a mixer voice playing across the seam, and the analyzer's
+// cache of results:
+//
+//   cmake -DBINAURAL_BUILD_TESTS=ON .. && make tst_looppoints && ctest
+
+#include "ambientclip.h"
+#include "ambientmixer.h"
+#include "loopanalyzer.h"
+#include "looppoints.h"
+
+#include <QtTest>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr int SAMPLE_RATE = AmbientClip::SAMPLE_RATE;
+constexpr int64_t PERIOD_FRAMES = int64_t(7.3 * SAMPLE_RATE) + 37; // Not a multiple of the hop
+
+// Noise with a slow swell, one period repeated three times: it loops
+// perfectly on any multiple of the period and nowhere else
+std::vector<float> repeatingNoise(int64_t frames)
+{
+    std::mt19937 random(7);
+    std::normal_distribution<float> noise(0.0f, 0.1f);
+    std::vector<float> period(size_t(PERIOD_FRAMES) * 2);
+    for (int64_t i = 0; i < PERIOD_FRAMES; ++i) {
+        const float swell = 0.5f + 0.4f * float(std::sin(2.0 * M_PI * double(i) / (2.1 * SAMPLE_RATE)));
+        period[size_t(2 * i)] = noise(random) * swell;
+        period[size_t(2 * i + 1)] = noise(random) * swell;
+    }
+
+    std::vector<float> samples(size_t(frames) * 2);
+    for (int64_t i = 0; i < frames; ++i) {
+        samples[size_t(2 * i)] = period[size_t(2 * (i % PERIOD_FRAMES))];
+        samples[size_t(2 * i + 1)] = period[size_t(2 * (i % PERIOD_FRAMES) + 1)];
+    }
+    return samples;
+}
+
+std::shared_ptr<AmbientClip> repeatingClip(const QString &filePath = QString())
+{
+    auto clip = std::make_shared<AmbientClip>();
+    clip->filePath = filePath;
+    clip->samples = repeatingNoise(3 * PERIOD_FRAMES);
+    return clip;
+}
+
+double rms(const float *samples, size_t count)
+{
+    double sum = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        sum += double(samples[i]) * samples[i];
+    }
+    return std::sqrt(sum / double(count));
+}
+
+}
+
+class LoopPointsTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void detectsRepeatingPeriod();
+    void shortClipLoopsWhole();
+    void seamKeepsLevel();
+    void voicePlaysAcrossSeam();
+    void analyzerCachesResults();
+};
+
+void LoopPointsTest::detectsRepeatingPeriod()
+{
+    std::shared_ptr<AmbientClip> clip = repeatingClip();
+    const LoopPoints points = LoopDetection::detect(clip->samples.data(), clip->frames(), SAMPLE_RATE);
+
+    QVERIFY(points.isValid());
+    QCOMPARE(points.crossfadeFrames, int64_t(SAMPLE_RATE / 2));
+    QVERIFY(points.start >= points.crossfadeFrames);
+    QVERIFY(points.end <= clip->frames());
+    QVERIFY(points.length() >= clip->frames() / 2);
+    QCOMPARE(points.length() % PERIOD_FRAMES, int64_t(0));
+    QVERIFY(points.score > 0.9f);
+}
+
+void LoopPointsTest::shortClipLoopsWhole()
+{
+    const std::vector<float> samples = repeatingNoise(3 * SAMPLE_RATE);
+    const LoopPoints points = LoopDetection::detect(samples.data(), 3 * SAMPLE_RATE, SAMPLE_RATE);
+
+    QCOMPARE(points.start, int64_t(0));
+    QCOMPARE(points.end, int64_t(3 * SAMPLE_RATE));
+    QCOMPARE(points.crossfadeFrames, int64_t(0));
+    QVERIFY(LoopDetection::crossfadeSeam(samples.data(), points).empty());
+}
+
+void LoopPointsTest::seamKeepsLevel()
+{
+    // Steady noise, so any change of level comes from the fade
+    std::mt19937 random(3);
+    std::normal_distribution<float> noise(0.0f, 0.1f);
+    std::vector<float> samples(size_t(4 * SAMPLE_RATE) * 2);
+    for (float &sample : samples) {
+        sample = noise(random);
+    }
+    const int64_t fade = SAMPLE_RATE / 2;
+    const size_t fadeSamples = size_t(fade) * 2;
+
+    // Unrelated windows: plain equal power
+    LoopPoints unrelated;
+    unrelated.start = SAMPLE_RATE;
+    unrelated.end = 3 * SAMPLE_RATE;
+    unrelated.crossfadeFrames = fade;
+    std::vector<float> seam = LoopDetection::crossfadeSeam(samples.data(), unrelated);
+    QCOMPARE(seam.size(), fadeSamples);
+    const double level = rms(samples.data(), samples.size());
+    QVERIFY(std::abs(rms(seam.data(), fadeSamples) / level - 1.0) < 0.05);
+    QVERIFY(std::abs(rms(seam.data() + fadeSamples / 2 - 2000, 4000) / level - 1.0) < 0.1);
+
+    // Identical windows: no swell, the seam is the audio itself
+    std::copy(samples.begin() + 2 * (SAMPLE_RATE - fade), samples.begin() + 2 * SAMPLE_RATE,
+              samples.begin() + 2 * (3 * SAMPLE_RATE - fade));
+    seam = LoopDetection::crossfadeSeam(samples.data(), unrelated);
+    const float *tail = samples.data() + 2 * (unrelated.end - fade);
+    for (size_t i = 0; i < fadeSamples; ++i) {
+        QVERIFY(std::abs(seam[i] - tail[i]) < 1e-5f);
+    }
+}
+
+void LoopPointsTest::voicePlaysAcrossSeam()
+{
+    std::shared_ptr<AmbientClip> clip = repeatingClip();
+    const LoopPoints points = LoopDetection::detect(clip->samples.data(), clip->frames(), SAMPLE_RATE);
+    std::shared_ptr<const AmbientLoop> loop = LoopAnalyzer::buildLoop(*clip, points);
+    QVERIFY(loop);
+    QCOMPARE(loop->seamFrames(), points.crossfadeFrames);
+
+    AmbientMixer mixer;
+    const int voice = mixer.acquire(clip);
+    mixer.setLoop(voice, loop);
+    mixer.setPlaying(voice, true);
+
+    // Through the seam twice: every frame is the one the recording would
+    // have played next
+    const int64_t frames = points.end + points.length();
+    std::vector<qint16> out(size_t(frames) * 2);
+    QCOMPARE(mixer.read(reinterpret_cast<char *>(out.data()), qint64(out.size() * sizeof(qint16))),
+             qint64(out.size() * sizeof(qint16)));
+    QCOMPARE(mixer.loopCount(voice), qint64(1));
+    for (int64_t i = 0; i < frames; ++i) {
+        const float expected = clip->samples[size_t(2 * (i % PERIOD_FRAMES))];
+        QVERIFY(std::abs(out[size_t(2 * i)] - expected * 32767.0f) <= 1.0f);
+    }
+
+    // Without repeat the clip plays to its end, seam ignored, then falls
+    // silent
+    mixer.setLooping(voice, false);
+    mixer.setPositionFrames(voice, points.end - 10);
+    const int64_t left = clip->frames() - points.end + 10;
+    std::vector<qint16> tail(size_t(left + 100) * 2);
+    QCOMPARE(mixer.read(reinterpret_cast<char *>(tail.data()), qint64(tail.size() * sizeof(qint16))),
+             qint64(tail.size() * sizeof(qint16)));
+    for (int64_t i = 0; i < left; ++i) {
+        const float expected = clip->samples[size_t(2 * (points.end - 10 + i))];
+        QVERIFY(std::abs(tail[size_t(2 * i)] - expected * 32767.0f) <= 1.0f);
+    }
+    QCOMPARE(tail[size_t(2 * left)], qint16(0));
+    QVERIFY(mixer.hasEnded(voice));
+}
+
+void LoopPointsTest::analyzerCachesResults()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    // Only the file's identity is read, not its contents
+    const QString path = dir.filePath("rain.ogg");
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("not decoded");
+    file.close();
+    std::shared_ptr<AmbientClip> clip = repeatingClip(path);
+
+    LoopPoints detected;
+    {
+        LoopAnalyzer analyzer(dir.filePath("cache"));
+        QSignalSpy finished(&analyzer, &LoopAnalyzer::finished);
+        analyzer.analyze(clip);
+        QVERIFY(analyzer.isAnalyzing());
+        QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 1, 10000);
+        QVERIFY(!analyzer.isAnalyzing());
+        QVERIFY(!analyzer.resultWasCached());
+        QCOMPARE(analyzer.resultFilePath(), path);
+        detected = analyzer.result();
+        QCOMPARE(detected.length() % PERIOD_FRAMES, int64_t(0));
+    }
+
+    {
+        LoopAnalyzer analyzer(dir.filePath("cache"));
+        QSignalSpy finished(&analyzer, &LoopAnalyzer::finished);
+        analyzer.analyze(clip);
+        QCOMPARE(finished.count(), 1); // Before analyze() returned
+        QVERIFY(analyzer.resultWasCached());
+        QCOMPARE(analyzer.result().start, detected.start);
+        QCOMPARE(analyzer.result().end, detected.end);
+        QCOMPARE(analyzer.result().crossfadeFrames, detected.crossfadeFrames);
+    }
+
+    // A changed file is analyzed again
+    QVERIFY(file.open(QIODevice::Append));
+    file.write(" any more");
+    file.close();
+    {
+        LoopAnalyzer analyzer(dir.filePath("cache"));
+        QSignalSpy finished(&analyzer, &LoopAnalyzer::finished);
+        analyzer.analyze(clip);
+        QVERIFY(analyzer.isAnalyzing());
+        QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 1, 10000);
+        QVERIFY(!analyzer.resultWasCached());
+    }
+}
+
+QTEST_GUILESS_MAIN(LoopPointsTest)
+#include "tst_looppoints.moc"
@@ -0,0 +1,191 @@
+// Resampler tests: tones keep their pitch and level through every common
+// ratio and quality, the passband is flat to each quality's edge, what
+// would alias is rejected, streaming in uneven blocks matches one call,
+// the SIMD kernels match the scalar one, and ratios beyond the phase limit
+// are refused:
+//
+//   cmake -DBINAURAL_BUILD_TESTS=ON .. && make tst_resampler && ctest
+
+#include "resampler.h"
+
+#include <QtTest>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr int OUTPUT_RATE = 44100;
+constexpr int BLOCKS[] = { 37, 1024, 100, 3000, 1, 511 }; // Input per call, in turn
+constexpr float TOLERANCES[] = { 3e-4f, 3e-5f, 1e-6f };    // Of a 1 kHz tone, by quality
+
+// A cosine of `hz` on the left and a sine on the right, interleaved
+std::vector<float> tone(double hz, int rate, int frames, double amplitude = 0.5)
+{
+    std::vector<float> samples(size_t(frames) * 2);
+    for (int i = 0; i < frames; ++i) {
+        const double phase = 2.0 * M_PI * hz * i / rate;
+        samples[size_t(2 * i)] = float(amplitude * std::cos(phase));
+        samples[size_t(2 * i + 1)] = float(amplitude * std::sin(phase));
+    }
+    return samples;
+}
+
+// All of `in` through `resampler`, in one call or in blocks of uneven size
+std::vector<float> convert(Resampler &resampler, const std::vector<float> &in, bool uneven = false)
+{
+    const int64_t frames = int64_t(in.size() / 2);
+    std::vector<float> out(size_t(2 * (resampler.maxOutputFrames(frames) + resampler.maxFinishFrames())));
+    int64_t written = 0;
+    size_t turn = 0;
+    for (int64_t done = 0; done < frames; ++turn) {
+        const int64_t block = uneven ? std::min<int64_t>(BLOCKS[turn % std::size(BLOCKS)], frames - done)
+                                     : frames;
+        written += resampler.process(in.data() + 2 * done, block, out.data() + 2 * written);
+        done += block;
+    }
+    written += resampler.finish(out.data() + 2 * written);
+    out.resize(size_t(2 * written));
+    return out;
+}
+
+double rms(const std::vector<float> &samples, int64_t first, int64_t last)
+{
+    double sum = 0.0;
+    for (int64_t i = 2 * first; i < 2 * last; ++i) {
+        sum += double(samples[size_t(i)]) * samples[size_t(i)];
+    }
+    return std::sqrt(sum / double(2 * (last - first)));
+}
+
+}
+
+class ResamplerTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void keepsPitchAndLevel();
+    void flatThroughThePassband();
+    void rejectsWhatWouldAlias();
+    void streamsLikeOneCall();
+    void kernelsAgree();
+    void refusesTooManyPhases();
+};
+
+void ResamplerTest::keepsPitchAndLevel()
+{
+    for (int rate : Resampler::COMMON_RATES) {
+        for (Resampler::Quality quality : { Resampler::FAST, Resampler::STANDARD, Resampler::HIGH }) {
+            Resampler resampler(rate, OUTPUT_RATE, quality);
+            QVERIFY(resampler.isValid());
+            const int frames = rate / 2;
+            const std::vector<float> out = convert(resampler, tone(1000.0, rate, frames));
+            const int64_t expected = (int64_t(frames) * OUTPUT_RATE + rate - 1) / rate;
+            QCOMPARE(int64_t(out.size() / 2), expected);
+
+            // Against the tone itself at the output rate, away from the edges
+            const std::vector<float> ideal = tone(1000.0, OUTPUT_RATE, int(expected));
+            float most = 0.0f;
+            for (int64_t i = 2 * resampler.taps(); i < 2 * (expected - resampler.taps()); ++i) {
+                most = std::max(most, std::abs(out[size_t(i)] - ideal[size_t(i)]));
+            }
+            QVERIFY2(most < TOLERANCES[quality], qPrintable(QString("%1 Hz quality %2: %3").arg(rate).arg(quality).arg(most)));
+        }
+    }
+}
+
+void ResamplerTest::flatThroughThePassband()
+{
+    // Each quality's documented edge, from 48 kHz
+    const double edges[] = { 14000.0, 17000.0, 19000.0 };
+    for (Resampler::Quality quality : { Resampler::FAST, Resampler::STANDARD, Resampler::HIGH }) {
+        Resampler resampler(48000, OUTPUT_RATE, quality);
+        const std::vector<float> out = convert(resampler, tone(edges[quality], 48000, 24000));
+        const int64_t frames = int64_t(out.size() / 2);
+        const double db = 20.0 * std::log10(rms(out, resampler.taps(), frames - resampler.taps()) / (0.5 / M_SQRT2));
+        QVERIFY2(std::abs(db) < 0.05, qPrintable(QString("quality %1: %2 dB").arg(quality).arg(db)));
+    }
+}
+
+void ResamplerTest::rejectsWhatWouldAlias()
+{
+    // Above the output's Nyquist, so anything heard is aliasing
+    struct Case
+    {
+        int rate;
+        double hz;
+    };
+    const double floorsDb[] = { -70.0, -90.0, -120.0 };
+    for (const Case &c : { Case{ 48000, 23500.0 }, Case{ 96000, 30000.0 }, Case{ 88200, 40000.0 } }) {
+        for (Resampler::Quality quality : { Resampler::FAST, Resampler::STANDARD, Resampler::HIGH }) {
+            Resampler resampler(c.rate, OUTPUT_RATE, quality);
+            const std::vector<float> out = convert(resampler, tone(c.hz, c.rate, c.rate / 2));
+            const int64_t frames = int64_t(out.size() / 2);
+            const double db = 20.0 * std::log10(rms(out, resampler.taps(), frames - resampler.taps()) / (0.5 / M_SQRT2));
+            QVERIFY2(db < floorsDb[quality], qPrintable(QString("%1 Hz quality %2: %3 dB").arg(c.rate).arg(quality).arg(db)));
+        }
+    }
+}
+
+void ResamplerTest::streamsLikeOneCall()
+{
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> sample(-0.5f, 0.5f);
+    std::vector<float> noise(2 * 20000);
+    for (float &value : noise) {
+        value = sample(random);
+    }
+    for (int rate : { 22050, 48000, 96000 }) {
+        Resampler whole(rate, OUTPUT_RATE);
+        Resampler streamed(rate, OUTPUT_RATE);
+        const std::vector<float> once = convert(whole, noise);
+        QCOMPARE(convert(streamed, noise, true), once);
+
+        // finish() starts it over
+        QCOMPARE(convert(streamed, noise), once);
+    }
+}
+
+void ResamplerTest::kernelsAgree()
+{
+    const std::vector<float> in = tone(3000.0, 48000, 10000);
+    Resampler scalar(48000, OUTPUT_RATE, Resampler::HIGH);
+    QVERIFY(scalar.setKernel(Resampler::SCALAR_KERNEL));
+    const std::vector<float> reference = convert(scalar, in);
+
+    for (Resampler::Kernel kernel : { Resampler::SSE_KERNEL, Resampler::AVX2_KERNEL }) {
+        Resampler resampler(48000, OUTPUT_RATE, Resampler::HIGH);
+        if (!resampler.setKernel(kernel)) {
+            QCOMPARE(kernel > Resampler::bestKernel(), true);
+            continue;
+        }
+        const std::vector<float> out = convert(resampler, in);
+        QCOMPARE(out.size(), reference.size());
+        for (size_t i = 0; i < out.size(); ++i) {
+            QVERIFY(std::abs(out[i] - reference[i]) < 1e-6f);
+        }
+    }
+}
+
+void ResamplerTest::refusesTooManyPhases()
+{
+    Resampler odd(44101, OUTPUT_RATE);
+    QVERIFY(!odd.isValid());
+    std::vector<float> out(16);
+    const float in[4] = { 0.1f, 0.2f, 0.3f, 0.4f };
+    QCOMPARE(odd.process(in, 2, out.data()), int64_t(0));
+
+    // The same rate is passed through as it is
+    Resampler same(OUTPUT_RATE, OUTPUT_RATE);
+    QVERIFY(same.isValid());
+    QCOMPARE(same.process(in, 2, out.data()), int64_t(2));
+    QVERIFY(std::equal(in, in + 4, out.begin()));
+    QCOMPARE(same.finish(out.data()), int64_t(0));
+}
+
+QTEST_GUILESS_MAIN(ResamplerTest)
+#include "tst_resampler.moc"
@@ -0,0 +1,237 @@
+// Spatializer tests: the partitioned convolution against a direct one,
+// sources sharing a direction sharing a bus, the head's cues for a source
+// at the side, a source moving without a click, and sources beyond the
+// last bus falling back to stereo:
+//
+//   cmake -DBINAURAL_BUILD_TESTS=ON .. && make tst_spatializer && ctest
+
+#include "ambientspatializer.h"
+#include "hrtfset.h"
+
+#include <QtTest>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr int MAX_BLOCK = 512;
+constexpr int BLOCKS[] = { 37, 512, 100, 300, 128, 1, 511 }; // Read sizes, in turn
+
+// Mono noise as interleaved stereo, both channels the same
+std::vector<float> noise(int frames, unsigned seed)
+{
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> sample(-0.5f, 0.5f);
+    std::vector<float> samples(size_t(frames) * 2);
+    for (int i = 0; i < frames; ++i) {
+        samples[size_t(2 * i)] = samples[size_t(2 * i + 1)] = sample(random);
+    }
+    return samples;
+}
+
+// Renders `sources` (interleaved stereo, same length) from `directions`,
+// in blocks of uneven size; the output is not delayed back
+std::vector<float> render(AmbientSpatializer &spatializer, const std::vector<std::vector<float>> &sources,
+                          const std::vector<int> &directions)
+{
+    const int frames = int(sources.front().size() / 2);
+    std::vector<float> out(size_t(frames) * 2, 0.0f);
+    size_t turn = 0;
+    for (int done = 0; done < frames; ++turn) {
+        const int block = std::min(BLOCKS[turn % std::size(BLOCKS)], frames - done);
+        for (size_t s = 0; s < sources.size(); ++s) {
+            spatializer.addSource(directions[s], directions[s], sources[s].data() + 2 * done, block,
+                                  out.data() + 2 * done);
+        }
+        spatializer.render(out.data() + 2 * done, block);
+        done += block;
+    }
+    return out;
+}
+
+// Both ears of `direction` applied to the mono of `source`, delayed by
+// `latency` frames
+std::vector<float> convolve(const HrtfSet &set, int direction, const std::vector<float> &source, int latency)
+{
+    const int frames = int(source.size() / 2);
+    std::vector<float> out(source.size(), 0.0f);
+    for (int i = latency; i < frames; ++i) {
+        double left = 0.0;
+        double right = 0.0;
+        for (int tap = 0; tap < HrtfSet::LENGTH && tap <= i - latency; ++tap) {
+            const int from = i - latency - tap;
+            const double mono = 0.5 * (source[size_t(2 * from)] + source[size_t(2 * from + 1)]);
+            left += mono * set.left(direction)[tap];
+            right += mono * set.right(direction)[tap];
+        }
+        out[size_t(2 * i)] = float(left);
+        out[size_t(2 * i + 1)] = float(right);
+    }
+    return out;
+}
+
+float maxDifference(const std::vector<float> &a, const std::vector<float> &b)
+{
+    float most = 0.0f;
+    for (size_t i = 0; i < a.size(); ++i) {
+        most = std::max(most, std::abs(a[i] - b[i]));
+    }
+    return most;
+}
+
+double energy(const std::vector<float> &samples, int channel, int first, int last)
+{
+    double sum = 0.0;
+    for (int i = first; i < last; ++i) {
+        sum += double(samples[size_t(2 * i + channel)]) * samples[size_t(2 * i + channel)];
+    }
+    return sum;
+}
+
+int onset(const std::vector<float> &samples, int channel)
+{
+    float peak = 0.0f;
+    for (size_t i = size_t(channel); i < samples.size(); i += 2) {
+        peak = std::max(peak, std::abs(samples[i]));
+    }
+    for (size_t i = size_t(channel); i < samples.size(); i += 2) {
+        if (std::abs(samples[i]) > 0.2f * peak) {
+            return int(i / 2);
+        }
+    }
+    return -1;
+}
+
+}
+
+class SpatializerTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void matchesDirectConvolution();
+    void sourcesShareADirectionsBus();
+    void sideSourceIsLouderAndEarlierOnItsSide();
+    void movesWithoutAClick();
+    void fallsBackToStereoWithoutABus();
+};
+
+void SpatializerTest::matchesDirectConvolution()
+{
+    const std::shared_ptr<const HrtfSet> set = HrtfSet::builtin();
+    for (int partition : { 64, 128, 256 }) {
+        AmbientSpatializer spatializer(set, MAX_BLOCK, partition);
+        QCOMPARE(spatializer.partitionCount(), HrtfSet::LENGTH / partition);
+        const int direction = set->nearest(30.0f, 20.0f);
+        const std::vector<float> source = noise(4000, 1);
+        const std::vector<float> out = render(spatializer, { source }, { direction });
+        QVERIFY(maxDifference(out, convolve(*set, direction, source, spatializer.latencyFrames())) < 1e-4f);
+    }
+}
+
+void SpatializerTest::sourcesShareADirectionsBus()
+{
+    const std::shared_ptr<const HrtfSet> set = HrtfSet::builtin();
+    AmbientSpatializer spatializer(set, MAX_BLOCK);
+    const int direction = set->nearest(-60.0f, 0.0f);
+    const std::vector<float> first = noise(3000, 2);
+    const std::vector<float> second = noise(3000, 3);
+    const std::vector<float> out = render(spatializer, { first, second }, { direction, direction });
+    QCOMPARE(spatializer.activeBuses(), 1);
+
+    std::vector<float> sum(first.size());
+    for (size_t i = 0; i < sum.size(); ++i) {
+        sum[i] = first[i] + second[i];
+    }
+    QVERIFY(maxDifference(out, convolve(*set, direction, sum, spatializer.latencyFrames())) < 1e-4f);
+
+    // Somewhere else: a bus of its own, freed once it has rung out
+    render(spatializer, { first, second }, { direction, set->nearest(0.0f, 90.0f) });
+    QCOMPARE(spatializer.activeBuses(), 2);
+    render(spatializer, { std::vector<float>(4 * MAX_BLOCK, 0.0f) }, { AmbientSpatializer::PLAIN });
+    QCOMPARE(spatializer.activeBuses(), 0);
+}
+
+void SpatializerTest::sideSourceIsLouderAndEarlierOnItsSide()
+{
+    const std::shared_ptr<const HrtfSet> set = HrtfSet::builtin();
+    std::vector<float> click(2 * 2048, 0.0f);
+    click[0] = click[1] = 1.0f;
+
+    AmbientSpatializer spatializer(set, MAX_BLOCK);
+    const std::vector<float> left = render(spatializer, { click }, { set->nearest(-90.0f, 0.0f) });
+    QVERIFY(energy(left, 0, 0, 2048) > 4.0 * energy(left, 1, 0, 2048)); // Over 6 dB
+    const int delay = onset(left, 1) - onset(left, 0);
+    QVERIFY2(delay > 20 && delay < 40, qPrintable(QString::number(delay))); // About 0.6 ms
+
+    // Ahead and overhead are the same in both ears
+    for (float elevation : { 0.0f, 90.0f }) {
+        AmbientSpatializer centred(set, MAX_BLOCK);
+        const std::vector<float> out = render(centred, { click }, { set->nearest(0.0f, elevation) });
+        QVERIFY(energy(out, 0, 0, 2048) > 0.1);
+        for (int i = 0; i < 2048; ++i) {
+            QVERIFY(std::abs(out[size_t(2 * i)] - out[size_t(2 * i + 1)]) < 1e-5f);
+        }
+    }
+}
+
+void SpatializerTest::movesWithoutAClick()
+{
+    const std::shared_ptr<const HrtfSet> set = HrtfSet::builtin();
+    AmbientSpatializer spatializer(set, MAX_BLOCK);
+    const int left = set->nearest(-90.0f, 0.0f);
+    const int right = set->nearest(90.0f, 0.0f);
+    constexpr int BLOCK = 256;
+    constexpr int MOVE_BLOCK = 40;
+
+    // A tone jumping from left to right, one block crossfading
+    std::vector<float> out(size_t(2 * BLOCK * 80), 0.0f);
+    std::vector<float> tone(size_t(2 * BLOCK));
+    int heard = left;
+    for (int block = 0; block < 80; ++block) {
+        for (int i = 0; i < BLOCK; ++i) {
+            tone[size_t(2 * i)] = tone[size_t(2 * i + 1)] = 0.5f * float(std::sin(2.0 * M_PI * 440.0 * (block * BLOCK + i) / HrtfSet::SAMPLE_RATE));
+        }
+        float *to = out.data() + 2 * block * BLOCK;
+        heard = spatializer.addSource(heard, block < MOVE_BLOCK ? left : right, tone.data(), BLOCK, to);
+        spatializer.render(to, BLOCK);
+    }
+    QCOMPARE(heard, right);
+
+    // No sample steps further than the tone does on either side
+    auto steepest = [&out](int first, int last) {
+        float most = 0.0f;
+        for (int i = first + 1; i < last; ++i) {
+            most = std::max({ most, std::abs(out[size_t(2 * i)] - out[size_t(2 * i - 2)]),
+                              std::abs(out[size_t(2 * i + 1)] - out[size_t(2 * i - 1)]) });
+        }
+        return most;
+    };
+    const float steady = std::max(steepest(10 * BLOCK, (MOVE_BLOCK - 1) * BLOCK),
+                                  steepest((MOVE_BLOCK + 4) * BLOCK, 80 * BLOCK));
+    QVERIFY(steepest((MOVE_BLOCK - 1) * BLOCK, (MOVE_BLOCK + 4) * BLOCK) < steady + 0.02f);
+}
+
+void SpatializerTest::fallsBackToStereoWithoutABus()
+{
+    const std::shared_ptr<const HrtfSet> set = HrtfSet::builtin();
+    AmbientSpatializer spatializer(set, MAX_BLOCK);
+    std::vector<float> source = noise(64, 4);
+    std::vector<float> out(source.size(), 0.0f);
+    for (int s = 0; s < AmbientSpatializer::MAX_BUSES; ++s) {
+        QCOMPARE(spatializer.addSource(s, s, source.data(), 64, out.data()), s);
+    }
+    QCOMPARE(std::count(out.begin(), out.end(), 0.0f), std::ptrdiff_t(out.size()));
+
+    const int extra = AmbientSpatializer::MAX_BUSES;
+    QCOMPARE(spatializer.addSource(extra, extra, source.data(), 64, out.data()), AmbientSpatializer::PLAIN);
+    QCOMPARE(out, source);
+    QCOMPARE(spatializer.activeBuses(), AmbientSpatializer::MAX_BUSES);
+}
+
+QTEST_GUILESS_MAIN(SpatializerTest)
+#include "tst_spatializer.moc"
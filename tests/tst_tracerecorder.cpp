@@ -0,0 +1,232 @@
+// Trace recorder tests: scoped and instant events, per-thread rings that
+// keep the newest events, snapshots taken while a thread records, and the
+// Chrome trace JSON written by dump(), or on exit to the BINAURAL_TRACE
+// file:
+//
+//   cmake -DBINAURAL_BUILD_TESTS=ON .. && make tst_tracerecorder && ctest
+
+#include "tracerecorder.h"
+
+#include <QtTest>
+
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+namespace {
+
+constexpr int RING_EVENTS = 1024;
+
+std::vector<TraceRecorder::Event> eventsNamed(const char *name)
+{
+    std::vector<TraceRecorder::Event> matching;
+    for (const TraceRecorder::Event &event : TraceRecorder::instance().snapshot()) {
+        if (std::strcmp(event.name, name) == 0) {
+            matching.push_back(event);
+        }
+    }
+    return matching;
+}
+
+}
+
+class TraceRecorderTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void recordsScopesAndInstants();
+    void ringKeepsNewestEvents();
+    void exitedThreadRingIsReused();
+    void snapshotWhileRecording();
+    void dumpWritesChromeTrace();
+    void dumpWrittenAtExit();
+    void recordBeforeExit();
+};
+
+void TraceRecorderTest::initTestCase()
+{
+    // Read once, when the recorder is created
+    qputenv("BINAURAL_TRACE_EVENTS", QByteArray::number(RING_EVENTS));
+    TraceRecorder::instance().setEnabled(true);
+}
+
+void TraceRecorderTest::recordsScopesAndInstants()
+{
+#ifdef BINAURAL_NO_TRACING
+    QSKIP("Built with BINAURAL_TRACING=OFF");
+#else
+    {
+        BINAURAL_TRACE_SCOPE("test", "scope", "frames", 512);
+        BINAURAL_TRACE_INSTANT("test", "instant");
+        QTest::qSleep(2);
+    }
+
+    TraceRecorder::instance().setEnabled(false);
+    {
+        BINAURAL_TRACE_SCOPE("test", "disabledScope");
+    }
+    TraceRecorder::instance().setEnabled(true);
+
+    std::vector<TraceRecorder::Event> scopes = eventsNamed("scope");
+    QCOMPARE(scopes.size(), size_t(1));
+    QCOMPARE(scopes[0].category, "test");
+    QVERIFY(scopes[0].durationNs >= 2000000);
+    QCOMPARE(scopes[0].argName, "frames");
+    QCOMPARE(scopes[0].argValue, int64_t(512));
+
+    std::vector<TraceRecorder::Event> instants = eventsNamed("instant");
+    QCOMPARE(instants.size(), size_t(1));
+    QCOMPARE(instants[0].durationNs, TraceRecorder::INSTANT);
+    QVERIFY(instants[0].argName == nullptr);
+    QVERIFY(instants[0].startNs >= scopes[0].startNs);
+    QCOMPARE(instants[0].threadId, scopes[0].threadId);
+
+    QVERIFY(eventsNamed("disabledScope").empty());
+#endif
+}
+
+void TraceRecorderTest::ringKeepsNewestEvents()
+{
+    constexpr int EVENTS = 3 * RING_EVENTS + 17;
+    std::thread writer([]() {
+        for (int i = 0; i < EVENTS; ++i) {
+            TraceRecorder::instance().instant("test", "wrap", "i", i);
+        }
+    });
+    writer.join();
+
+    std::vector<TraceRecorder::Event> events = eventsNamed("wrap");
+    QCOMPARE(int(events.size()), RING_EVENTS);
+    for (int i = 0; i < RING_EVENTS; ++i) {
+        QCOMPARE(events[i].argValue, int64_t(EVENTS - RING_EVENTS + i));
+    }
+}
+
+void TraceRecorderTest::exitedThreadRingIsReused()
+{
+    // Short-lived workers, like the loop renderer, share one track
+    std::thread([]() {
+        TraceRecorder::instance().instant("test", "firstWorker");
+    }).join();
+    std::thread([]() {
+        TraceRecorder::instance().instant("test", "secondWorker");
+    }).join();
+
+    std::vector<TraceRecorder::Event> first = eventsNamed("firstWorker");
+    std::vector<TraceRecorder::Event> second = eventsNamed("secondWorker");
+    QCOMPARE(first.size(), size_t(1));
+    QCOMPARE(second.size(), size_t(1));
+    QCOMPARE(second[0].threadId, first[0].threadId);
+}
+
+void TraceRecorderTest::snapshotWhileRecording()
+{
+    // Synthetic timestamps that equal the argument: a torn copy would
+    // break the pairing or the sequence
+    std::atomic<bool> stop(false);
+    std::thread writer([&stop]() {
+        for (int64_t i = 0; !stop.load(std::memory_order_relaxed); ++i) {
+            TraceRecorder::instance().record("test", "concurrent", i, 0, "i", i);
+        }
+    });
+
+    int snapshots = 0;
+    QElapsedTimer clock;
+    clock.start();
+    while (clock.elapsed() < 300) {
+        std::vector<TraceRecorder::Event> events = eventsNamed("concurrent");
+        QVERIFY(int(events.size()) <= RING_EVENTS);
+        for (size_t i = 0; i < events.size(); ++i) {
+            QCOMPARE(events[i].startNs, events[i].argValue);
+            if (i > 0) {
+                QCOMPARE(events[i].argValue, events[i - 1].argValue + 1);
+            }
+        }
+        ++snapshots;
+    }
+
+    stop.store(true);
+    writer.join();
+    QVERIFY(snapshots > 0);
+}
+
+void TraceRecorderTest::dumpWritesChromeTrace()
+{
+    TraceRecorder::instance().setThreadName("Test \"main\"");
+    TraceRecorder::instance().record("test", "dumped", 1234567, 2500, "frames", 256);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("trace.json");
+    QVERIFY(TraceRecorder::instance().dump(path));
+
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QJsonParseError error;
+    QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &error);
+    QCOMPARE(error.error, QJsonParseError::NoError);
+
+    bool sawThreadName = false;
+    bool sawEvent = false;
+    const QJsonArray events = document.object().value("traceEvents").toArray();
+    for (const QJsonValue &value : events) {
+        const QJsonObject event = value.toObject();
+        if (event.value("ph").toString() == "M"
+            && event.value("args").toObject().value("name").toString() == "Test \"main\"") {
+            sawThreadName = true;
+        }
+        if (event.value("name").toString() == "dumped") {
+            sawEvent = true;
+            QCOMPARE(event.value("ph").toString(), QString("X"));
+            QCOMPARE(event.value("cat").toString(), QString("test"));
+            QCOMPARE(event.value("ts").toDouble(), 1234.567);
+            QCOMPARE(event.value("dur").toDouble(), 2.5);
+            QCOMPARE(event.value("args").toObject().value("frames").toInt(), 256);
+        }
+    }
+    QVERIFY(sawThreadName);
+    QVERIFY(sawEvent);
+}
+
+void TraceRecorderTest::dumpWrittenAtExit()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("exit.json");
+
+    // This test binary again, tracing to `path`, running recordBeforeExit()
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    environment.insert("BINAURAL_TRACE", path);
+    environment.insert("TST_TRACERECORDER_CHILD", "1");
+    QProcess child;
+    child.setProcessEnvironment(environment);
+    child.start(QCoreApplication::applicationFilePath(), { "recordBeforeExit" });
+    QVERIFY(child.waitForFinished(10000));
+    QCOMPARE(child.exitStatus(), QProcess::NormalExit);
+    QCOMPARE(child.exitCode(), 0);
+
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QJsonParseError error;
+    QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &error);
+    QCOMPARE(error.error, QJsonParseError::NoError);
+    bool sawEvent = false;
+    for (const QJsonValue &value : document.object().value("traceEvents").toArray()) {
+        sawEvent = sawEvent || value.toObject().value("name").toString() == "beforeExit";
+    }
+    QVERIFY(sawEvent);
+}
+
+void TraceRecorderTest::recordBeforeExit()
+{
+    if (qEnvironmentVariableIsEmpty("TST_TRACERECORDER_CHILD")) {
+        QSKIP("Run in a child process by dumpWrittenAtExit()");
+    }
+    TraceRecorder::instance().instant("test", "beforeExit");
+}
+
+QTEST_GUILESS_MAIN(TraceRecorderTest)
+#include "tst_tracerecorder.moc"
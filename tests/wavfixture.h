@@ -0,0 +1,63 @@
+#ifndef WAVFIXTURE_H
+#define WAVFIXTURE_H
+
+#include <QAudioDecoder>
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+#include <cmath>
+
+#include "ambientclip.h"
+
+// WAV files for the tests that decode from disk: 16-bit stereo PCM at
+// AmbientClip::SAMPLE_RATE, written with the canonical 44-byte header.
+namespace WavFixture {
+
+constexpr int HEADER_BYTES = 44;
+
+inline void appendLe(QByteArray &out, quint32 value, int bytes)
+{
+    for (int i = 0; i < bytes; ++i) {
+        out += char((value >> (8 * i)) & 0xff);
+    }
+}
+
+// A 440 Hz sine in the left ear only
+inline bool writeSine(const QString &path, int frames)
+{
+    QByteArray data;
+    for (int i = 0; i < frames; ++i) {
+        const qint16 left = qint16(16000 * std::sin(2.0 * M_PI * 440.0 * i / AmbientClip::SAMPLE_RATE));
+        appendLe(data, quint16(left), 2);
+        appendLe(data, 0, 2);
+    }
+
+    QByteArray wav("RIFF");
+    appendLe(wav, quint32(HEADER_BYTES - 8 + data.size()), 4);
+    wav += "WAVEfmt ";
+    appendLe(wav, 16, 4);
+    appendLe(wav, 1, 2); // PCM
+    appendLe(wav, 2, 2);
+    appendLe(wav, AmbientClip::SAMPLE_RATE, 4);
+    appendLe(wav, AmbientClip::SAMPLE_RATE * 4, 4);
+    appendLe(wav, 4, 2);
+    appendLe(wav, 16, 2);
+    wav += "data";
+    appendLe(wav, quint32(data.size()), 4);
+    wav += data;
+
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(wav) == wav.size();
+}
+
+// Tests that decode are skipped without a QAudioDecoder backend
+inline bool decoderAvailable()
+{
+    QAudioDecoder decoder;
+    return decoder.isSupported();
+}
+
+}
+
+#endif // WAVFIXTURE_H
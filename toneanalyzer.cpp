@@ -0,0 +1,201 @@
+#include "toneanalyzer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Peaks quieter than this (-60 dBFS) are treated as "no carrier"
+constexpr double MIN_CARRIER_AMPLITUDE = 1e-3;
+// Envelope component must reach 10% of the mean power to count as modulation
+constexpr double MIN_MODULATION_DEPTH = 0.1;
+// Power envelope smoothing before decimation (keeps carrier ripple out)
+constexpr double ENVELOPE_CUTOFF_HZ = 100.0;
+constexpr float DB_FLOOR = -120.0f;
+}
+
+ToneAnalyzer::ToneAnalyzer(int sampleRate)
+    : m_sampleRate(std::max(1, sampleRate))
+    , m_carrierPlan(CARRIER_FFT_SIZE)
+    , m_carrierWindow(CARRIER_FFT_SIZE)
+    , m_historyLeft(CARRIER_FFT_SIZE)
+    , m_historyRight(CARRIER_FFT_SIZE)
+    , m_historyPos(0)
+    , m_framesSeen(0)
+    , m_envelopePlan(ENVELOPE_FFT_SIZE)
+    , m_envelopeWindow(ENVELOPE_FFT_SIZE)
+    , m_envelopeHistory(ENVELOPE_FFT_SIZE)
+    , m_envelopePos(0)
+    , m_envelopeCount(0)
+    , m_envelopeSmooth(0.0)
+    , m_envelopeCoefficient(0.0)
+    , m_envelopeAccumulator(0.0)
+    , m_envelopePhase(0)
+    , m_windowed(CARRIER_FFT_SIZE)
+    , m_scratchRe(CARRIER_FFT_SIZE)
+    , m_scratchIm(CARRIER_FFT_SIZE)
+    , m_magnitudes(CARRIER_FFT_SIZE / 2 + 1)
+{
+    FftUtils::hannWindow(m_carrierWindow.data(), CARRIER_FFT_SIZE);
+    FftUtils::hannWindow(m_envelopeWindow.data(), ENVELOPE_FFT_SIZE);
+    setSampleRate(m_sampleRate);
+}
+
+void ToneAnalyzer::setSampleRate(int sampleRate)
+{
+    m_sampleRate = std::max(1, sampleRate);
+    m_envelopeCoefficient = 1.0 - std::exp(-2.0 * M_PI * ENVELOPE_CUTOFF_HZ / m_sampleRate);
+    reset();
+}
+
+void ToneAnalyzer::reset()
+{
+    std::fill(m_historyLeft.begin(), m_historyLeft.end(), 0.0f);
+    std::fill(m_historyRight.begin(), m_historyRight.end(), 0.0f);
+    std::fill(m_envelopeHistory.begin(), m_envelopeHistory.end(), 0.0f);
+    m_historyPos = 0;
+    m_framesSeen = 0;
+    m_envelopePos = 0;
+    m_envelopeCount = 0;
+    m_envelopeSmooth = 0.0;
+    m_envelopeAccumulator = 0.0;
+    m_envelopePhase = 0;
+}
+
+void ToneAnalyzer::feed(const float *interleaved, int frameCount)
+{
+    const int mask = CARRIER_FFT_SIZE - 1;
+    const double coefficient = m_envelopeCoefficient;
+
+    for (int i = 0; i < frameCount; ++i) {
+        float left = interleaved[2 * i];
+        float right = interleaved[2 * i + 1];
+
+        m_historyLeft[m_historyPos] = left;
+        m_historyRight[m_historyPos] = right;
+        m_historyPos = (m_historyPos + 1) & mask;
+
+        // Mono power envelope: beats between L and R and isochronic gating
+        // both show up here as low-frequency modulation
+        double mono = 0.5 * (left + right);
+        m_envelopeSmooth += coefficient * (mono * mono - m_envelopeSmooth);
+        m_envelopeAccumulator += m_envelopeSmooth;
+
+        if (++m_envelopePhase == ENVELOPE_DECIMATION) {
+            m_envelopeHistory[m_envelopePos] = static_cast<float>(m_envelopeAccumulator / ENVELOPE_DECIMATION);
+            m_envelopePos = (m_envelopePos + 1) % ENVELOPE_FFT_SIZE;
+            m_envelopeCount = std::min(m_envelopeCount + 1, ENVELOPE_FFT_SIZE);
+            m_envelopeAccumulator = 0.0;
+            m_envelopePhase = 0;
+        }
+    }
+
+    m_framesSeen += static_cast<uint64_t>(std::max(0, frameCount));
+}
+
+bool ToneAnalyzer::analyze(ToneAnalysisResult &result)
+{
+    const int bins = CARRIER_FFT_SIZE / 2 + 1;
+    if (static_cast<int>(result.spectrumLeftDb.size()) != bins) {
+        result.spectrumLeftDb.resize(bins);
+        result.spectrumRightDb.resize(bins);
+    }
+    result.binHz = double(m_sampleRate) / CARRIER_FFT_SIZE;
+
+    if (m_framesSeen < static_cast<uint64_t>(CARRIER_FFT_SIZE)) {
+        result.carriersValid = false;
+        result.modulationValid = false;
+        return false;
+    }
+
+    analyzeCarriers(result);
+    analyzeModulation(result);
+    return true;
+}
+
+// =================== CARRIERS ===================
+double ToneAnalyzer::measureCarrier(const std::vector<float> &history, std::vector<float> &spectrumDb)
+{
+    const int size = CARRIER_FFT_SIZE;
+    const int bins = size / 2 + 1;
+    const int mask = size - 1;
+
+    // Unroll the circular history oldest-first while applying the window
+    for (int i = 0; i < size; ++i) {
+        m_windowed[i] = history[(m_historyPos + i) & mask] * m_carrierWindow[i];
+    }
+    m_carrierPlan.magnitudes(m_windowed.data(), m_magnitudes.data(),
+                             m_scratchRe.data(), m_scratchIm.data());
+
+    // Hann coherent gain is 0.5: a sine of amplitude A peaks at A * N / 4
+    const float toAmplitude = 4.0f / size;
+    for (int k = 0; k < bins; ++k) {
+        float amplitude = m_magnitudes[k] * toAmplitude;
+        spectrumDb[k] = amplitude > 1e-6f ? 20.0f * std::log10(amplitude) : DB_FLOOR;
+    }
+
+    const double binHz = double(m_sampleRate) / size;
+    int firstBin = std::max(2, static_cast<int>(std::ceil(MIN_CARRIER_HZ / binHz)));
+    int peak = FftUtils::findPeakBin(m_magnitudes.data(), firstBin, bins - 1);
+    if (m_magnitudes[peak] * toAmplitude < MIN_CARRIER_AMPLITUDE) {
+        return 0.0;
+    }
+
+    return FftUtils::interpolateHannPeak(m_magnitudes.data(), peak, bins) * binHz;
+}
+
+void ToneAnalyzer::analyzeCarriers(ToneAnalysisResult &result)
+{
+    result.carrierLeft = measureCarrier(m_historyLeft, result.spectrumLeftDb);
+    result.carrierRight = measureCarrier(m_historyRight, result.spectrumRightDb);
+    result.carriersValid = result.carrierLeft > 0.0 && result.carrierRight > 0.0;
+    result.beatFrequency = result.carriersValid
+        ? std::fabs(result.carrierRight - result.carrierLeft) : 0.0;
+}
+
+// =================== MODULATION ===================
+void ToneAnalyzer::analyzeModulation(ToneAnalysisResult &result)
+{
+    result.modulationValid = false;
+    result.modulationFrequency = 0.0;
+
+    // Needs a full envelope window; until then only carriers are reported
+    if (m_envelopeCount < ENVELOPE_FFT_SIZE) {
+        return;
+    }
+
+    const int size = ENVELOPE_FFT_SIZE;
+    const int bins = size / 2 + 1;
+
+    double mean = 0.0;
+    for (int i = 0; i < size; ++i) {
+        mean += m_envelopeHistory[i];
+    }
+    mean /= size;
+    if (mean < 1e-9) {
+        return;
+    }
+
+    for (int i = 0; i < size; ++i) {
+        int index = (m_envelopePos + i) % size;
+        m_windowed[i] = static_cast<float>(m_envelopeHistory[index] - mean) * m_envelopeWindow[i];
+    }
+    m_envelopePlan.magnitudes(m_windowed.data(), m_magnitudes.data(),
+                              m_scratchRe.data(), m_scratchIm.data());
+
+    const double envelopeRate = double(m_sampleRate) / ENVELOPE_DECIMATION;
+    const double binHz = envelopeRate / size;
+    int firstBin = std::max(2, static_cast<int>(std::ceil(MIN_MODULATION_HZ / binHz)));
+    int lastBin = std::min(bins - 1, static_cast<int>(MAX_MODULATION_HZ / binHz) + 1);
+    if (firstBin >= lastBin) {
+        return;
+    }
+
+    int peak = FftUtils::findPeakBin(m_magnitudes.data(), firstBin, lastBin);
+    double depth = m_magnitudes[peak] * (4.0 / size) / mean;
+    if (depth < MIN_MODULATION_DEPTH) {
+        return;
+    }
+
+    result.modulationFrequency = FftUtils::interpolateHannPeak(m_magnitudes.data(), peak, bins) * binHz;
+    result.modulationValid = true;
+}
@@ -0,0 +1,91 @@
+#ifndef TONEANALYZER_H
+#define TONEANALYZER_H
+
+#include <cstdint>
+#include <vector>
+#include "fft.h"
+
+// One analysis snapshot. Spectra are in dB relative to a full-scale sine
+// (0 dB = amplitude 1.0) for bins 0..fftSize/2.
+struct ToneAnalysisResult
+{
+    std::vector<float> spectrumLeftDb;
+    std::vector<float> spectrumRightDb;
+    double binHz = 0.0;
+
+    bool carriersValid = false;
+    double carrierLeft = 0.0;   // Hz, strongest partial per channel
+    double carrierRight = 0.0;
+    double beatFrequency = 0.0; // |right - left|
+
+    bool modulationValid = false;
+    double modulationFrequency = 0.0; // Envelope rate: isochronic pulse / heard beat
+};
+
+// Measures what is actually being played: per-channel carrier frequencies
+// from a Hann-windowed FFT, and the amplitude-modulation rate from the
+// spectrum of the decimated mono power envelope. Feed it rendered frames,
+// then call analyze() whenever a fresh estimate is wanted.
+//
+// All buffers and FFT plans are allocated in the constructor; feed() and
+// analyze() never allocate, so it can run indefinitely without churn.
+class ToneAnalyzer
+{
+public:
+    explicit ToneAnalyzer(int sampleRate = 44100);
+
+    void setSampleRate(int sampleRate);
+    int sampleRate() const { return m_sampleRate; }
+
+    int fftSize() const { return CARRIER_FFT_SIZE; }
+
+    void reset();
+
+    // Append interleaved stereo frames
+    void feed(const float *interleaved, int frameCount);
+
+    // Fill `result` (its vectors are resized once and then reused).
+    // Returns false until at least one carrier window has been seen.
+    bool analyze(ToneAnalysisResult &result);
+
+    static constexpr int CARRIER_FFT_SIZE = 16384;   // ~0.37 s at 44.1 kHz
+    static constexpr int ENVELOPE_FFT_SIZE = 4096;
+    static constexpr int ENVELOPE_DECIMATION = 32;   // ~3 s envelope window
+    static constexpr double MIN_MODULATION_HZ = 0.5;
+    static constexpr double MAX_MODULATION_HZ = 50.0;
+    static constexpr double MIN_CARRIER_HZ = 20.0;
+
+private:
+    void analyzeCarriers(ToneAnalysisResult &result);
+    void analyzeModulation(ToneAnalysisResult &result);
+    double measureCarrier(const std::vector<float> &history, std::vector<float> &spectrumDb);
+
+    int m_sampleRate;
+
+    // Carrier analysis: circular history per channel
+    FftPlan m_carrierPlan;
+    std::vector<float> m_carrierWindow;
+    std::vector<float> m_historyLeft;
+    std::vector<float> m_historyRight;
+    int m_historyPos;
+    uint64_t m_framesSeen;
+
+    // Envelope analysis: one-pole smoothed power, block-averaged
+    FftPlan m_envelopePlan;
+    std::vector<float> m_envelopeWindow;
+    std::vector<float> m_envelopeHistory;
+    int m_envelopePos;
+    int m_envelopeCount;
+    double m_envelopeSmooth;
+    double m_envelopeCoefficient;
+    double m_envelopeAccumulator;
+    int m_envelopePhase;
+
+    // Shared scratch
+    std::vector<float> m_windowed;
+    std::vector<float> m_scratchRe;
+    std::vector<float> m_scratchIm;
+    std::vector<float> m_magnitudes;
+};
+
+#endif // TONEANALYZER_H
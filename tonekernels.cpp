@@ -0,0 +1,294 @@
+#include "tonekernels.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
+#include "cpudispatch.h"
+
+namespace ToneKernels {
+
+namespace {
+constexpr double TWO_PI = 2.0 * M_PI;
+}
+
+double waveformSample(double phase, int waveform, ToneMode mode)
+{
+    switch (waveform) {
+    case SQUARE_WAVE:
+        if (mode == ISOCHRONIC_MODE) {
+            return (std::sin(phase) >= 0.0) ? 1.0 : 0.0; // On/Off
+        }
+        return (std::sin(phase) >= 0.0) ? 1.0 : -1.0;
+    case TRIANGLE_WAVE: {
+        double normalized = phase / TWO_PI;
+        return normalized < 0.5 ? 4.0 * normalized - 1.0 : 3.0 - 4.0 * normalized;
+    }
+    case SAWTOOTH_WAVE: {
+        double normalized = phase / TWO_PI;
+        return 2.0 * (normalized - std::floor(normalized + 0.5));
+    }
+    case SINE_WAVE:
+    default:
+        return std::sin(phase);
+    }
+}
+
+double phaseIncrement(double hz, int sampleRate)
+{
+    return (TWO_PI * hz) / sampleRate;
+}
+
+double phaseAt(double startPhase, double increment, int64_t frame)
+{
+    double phase = std::fmod(startPhase + increment * static_cast<double>(frame), TWO_PI);
+    return phase < 0.0 ? phase + TWO_PI : phase;
+}
+
+double leftIncrement(const ToneParameters &params)
+{
+    return phaseIncrement(params.leftFrequency, params.sampleRate);
+}
+
+double rightIncrement(const ToneParameters &params)
+{
+    return phaseIncrement(params.mode == ISOCHRONIC_MODE ? params.pulseFrequency
+                                                         : params.rightFrequency,
+                          params.sampleRate);
+}
+
+int64_t levelCount(int64_t totalFrames)
+{
+    return (totalFrames + LEVEL_BLOCK_FRAMES - 1) / LEVEL_BLOCK_FRAMES;
+}
+
+bool sameTone(const ToneParameters &a, const ToneParameters &b)
+{
+    return a.mode == b.mode
+           && a.waveform == b.waveform
+           && a.leftFrequency == b.leftFrequency
+           && (a.mode == ISOCHRONIC_MODE ? a.pulseFrequency == b.pulseFrequency
+                                         : a.rightFrequency == b.rightFrequency)
+           && a.amplitude == b.amplitude
+           && a.sampleRate == b.sampleRate
+           && a.noiseType == b.noiseType
+           && a.noiseLevel == b.noiseLevel
+           && a.noiseSeed == b.noiseSeed
+           && a.noisePeriod == b.noisePeriod;
+}
+
+int64_t loopFrames(int sampleRate, double seconds)
+{
+    int64_t segments = std::llround(sampleRate * seconds / SEGMENT_FRAMES);
+    return std::max<int64_t>(1, segments) * SEGMENT_FRAMES;
+}
+
+ToneParameters loopAligned(const ToneParameters &params, int64_t loopFrames)
+{
+    // Hz per whole cycle over the loop
+    const double step = static_cast<double>(params.sampleRate) / static_cast<double>(loopFrames);
+    auto grid = [step](double hz) { return std::round(hz / step) * step; };
+
+    ToneParameters aligned = params;
+    aligned.leftFrequency = grid(params.leftFrequency);
+    if (params.mode == ISOCHRONIC_MODE) {
+        aligned.pulseFrequency = std::max(step, grid(params.pulseFrequency));
+    } else {
+        // Grid the beat rather than the right carrier so it stays exact
+        // to within the same bound
+        aligned.rightFrequency = aligned.leftFrequency + grid(params.rightFrequency - params.leftFrequency);
+    }
+    aligned.noisePeriod = static_cast<uint64_t>(loopFrames);
+    return aligned;
+}
+
+BINAURAL_HOT_KERNEL
+void renderSegment(const ToneParameters &params, int64_t firstFrame, int frameCount,
+                   int16_t *out, AudioLevels *levels)
+{
+    ToneStream stream;
+    stream.seek(params, firstFrame);
+
+    constexpr int CHUNK_FRAMES = 512;
+    double left[CHUNK_FRAMES];
+    double right[CHUNK_FRAMES];
+
+    LevelAccumulator meter;
+    int levelIndex = 0;
+
+    for (int done = 0; done < frameCount; done += CHUNK_FRAMES) {
+        int count = std::min(CHUNK_FRAMES, frameCount - done);
+        stream.render(left, right, count);
+
+        int16_t *chunkOut = out + 2 * done;
+        for (int i = 0; i < count; ++i) {
+            meter.add(static_cast<float>(left[i]), static_cast<float>(right[i]));
+            if (meter.count() == LEVEL_BLOCK_FRAMES) {
+                levels[levelIndex++] = meter.result();
+                meter = LevelAccumulator();
+            }
+
+            chunkOut[2 * i] = static_cast<int16_t>(left[i] * 32767);
+            chunkOut[2 * i + 1] = static_cast<int16_t>(right[i] * 32767);
+        }
+    }
+
+    if (!meter.isEmpty()) {
+        levels[levelIndex] = meter.result();
+    }
+}
+
+void renderLoop(const ToneParameters &params, int64_t totalFrames,
+                int16_t *out, AudioLevels *levels, int threadCount)
+{
+    if (totalFrames <= 0) {
+        return;
+    }
+
+    const int64_t segments = (totalFrames + SEGMENT_FRAMES - 1) / SEGMENT_FRAMES;
+    if (threadCount <= 0) {
+        threadCount = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    threadCount = static_cast<int>(std::min<int64_t>(threadCount, segments));
+
+    // Workers pull segment indices from a shared counter, which balances
+    // load when cores run at different speeds
+    std::atomic<int64_t> nextSegment{0};
+    auto worker = [&]() {
+        for (;;) {
+            int64_t segment = nextSegment.fetch_add(1, std::memory_order_relaxed);
+            if (segment >= segments) {
+                return;
+            }
+            int64_t first = segment * SEGMENT_FRAMES;
+            int count = static_cast<int>(std::min<int64_t>(SEGMENT_FRAMES, totalFrames - first));
+            renderSegment(params, first, count, out + 2 * first, levels + first / LEVEL_BLOCK_FRAMES);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(static_cast<size_t>(threadCount - 1));
+    for (int t = 1; t < threadCount; ++t) {
+        pool.emplace_back(worker);
+    }
+    worker(); // The calling thread takes a share too
+    for (std::thread &thread : pool) {
+        thread.join();
+    }
+}
+
+// =================== STREAMING ===================
+ToneStream::ToneStream()
+    : m_frame(0)
+    , m_leftPhase(0.0)
+    , m_rightPhase(0.0)
+    , m_leftIncrement(0.0)
+    , m_rightIncrement(0.0)
+    , m_withNoise(false)
+    , m_noiseIndex(NoiseGenerator::BLOCK_FRAMES)
+{
+    prepare();
+}
+
+void ToneStream::prepare()
+{
+    m_leftIncrement = leftIncrement(m_params);
+    m_rightIncrement = rightIncrement(m_params);
+
+    float level = std::clamp(m_params.noiseLevel, 0.0f, 1.0f);
+    if (m_noise.type() != m_params.noiseType || m_noise.level() != level) {
+        m_noise.setType(m_params.noiseType);
+        m_noise.setLevel(level);
+        m_withNoise = m_noise.isActive();
+        m_noiseIndex = NoiseGenerator::BLOCK_FRAMES; // Buffered noise used the old level
+    }
+}
+
+void ToneStream::retune(const ToneParameters &params)
+{
+    if (params.noiseSeed != m_params.noiseSeed) {
+        m_noise.reset(params.noiseSeed);
+    }
+
+    m_params = params;
+    m_params.leftPhase = m_leftPhase;
+    m_params.rightPhase = m_rightPhase;
+    m_frame = 0;
+    prepare();
+
+    // Restart the white sequence with the epoch but keep the filters
+    // running, so pink/brown noise continues without a step
+    m_noise.setPosition(0);
+    m_noiseIndex = NoiseGenerator::BLOCK_FRAMES;
+}
+
+void ToneStream::update(const ToneParameters &params)
+{
+    if (params.noiseSeed != m_params.noiseSeed) {
+        m_noise.reset(params.noiseSeed);
+    }
+
+    m_params = params;
+    prepare();
+}
+
+void ToneStream::seek(const ToneParameters &params, int64_t frame)
+{
+    m_params = params;
+    m_frame = frame;
+    prepare();
+
+    m_leftPhase = phaseAt(params.leftPhase, m_leftIncrement, frame);
+    m_rightPhase = phaseAt(params.rightPhase, m_rightIncrement, frame);
+
+    m_noise.reset(params.noiseSeed);
+    m_noiseIndex = NoiseGenerator::BLOCK_FRAMES;
+    m_noise.settle(static_cast<uint64_t>(frame), params.noisePeriod);
+}
+
+BINAURAL_HOT_KERNEL
+void ToneStream::render(double *left, double *right, int frameCount)
+{
+    const bool isochronic = (m_params.mode == ISOCHRONIC_MODE);
+    const double amplitude = m_params.amplitude;
+    const int waveform = m_params.waveform;
+
+    for (int i = 0; i < frameCount; ++i) {
+        double leftSample;
+        double rightSample;
+
+        if (isochronic) {
+            // Carrier x on/off pulse, same tone in both ears
+            double carrier = waveformSample(m_leftPhase, waveform, ISOCHRONIC_MODE);
+            double pulse = (std::sin(m_rightPhase) >= 0.0) ? 1.0 : 0.0;
+            leftSample = carrier * pulse * amplitude;
+            rightSample = leftSample;
+        } else {
+            leftSample = waveformSample(m_leftPhase, waveform, BINAURAL_MODE) * amplitude;
+            rightSample = waveformSample(m_rightPhase, waveform, BINAURAL_MODE) * amplitude;
+        }
+
+        if (m_withNoise) {
+            if (m_noiseIndex == NoiseGenerator::BLOCK_FRAMES) {
+                m_noise.renderBlock(m_noiseLeft, m_noiseRight, NoiseGenerator::BLOCK_FRAMES);
+                m_noiseIndex = 0;
+            }
+            leftSample += m_noiseLeft[m_noiseIndex];
+            rightSample += m_noiseRight[m_noiseIndex];
+            ++m_noiseIndex;
+        }
+
+        left[i] = std::clamp(leftSample, -1.0, 1.0);
+        right[i] = std::clamp(rightSample, -1.0, 1.0);
+
+        m_leftPhase += m_leftIncrement;
+        m_rightPhase += m_rightIncrement;
+        if (m_leftPhase > TWO_PI) m_leftPhase -= TWO_PI;
+        if (m_rightPhase > TWO_PI) m_rightPhase -= TWO_PI;
+    }
+
+    m_frame += frameCount;
+}
+
+}
@@ -0,0 +1,147 @@
+#ifndef TONEKERNELS_H
+#define TONEKERNELS_H
+
+#include <cstdint>
+#include "audiolevels.h"
+#include "noisegenerator.h"
+
+// Qt-free tone synthesis shared by the engines, tests and benchmarks.
+//
+// Long renders are cut into fixed SEGMENT_FRAMES segments. Each segment
+// derives its starting phases analytically (phase0 + n * increment, wrapped)
+// and settles its own noise generator, so segments are independent: the
+// output of renderLoop() is bit-identical whatever the thread count, and a
+// one-thread render is the reference.
+//
+// ToneStream is the same synthesis run sequentially for real-time
+// streaming. Because frame n of a stream and frame n of a render of the
+// same parameters share their phases, an engine can switch between the two
+// mid-playback without a step in the waveform.
+namespace ToneKernels {
+
+// Same values as the engines' Waveform enums
+enum Waveform {
+    SINE_WAVE = 0,
+    SQUARE_WAVE = 1,
+    TRIANGLE_WAVE = 2,
+    SAWTOOTH_WAVE = 3
+};
+
+enum ToneMode {
+    BINAURAL_MODE = 0,   // Independent left/right carriers
+    ISOCHRONIC_MODE = 1  // Left carrier gated on/off at the pulse rate, both ears
+};
+
+struct ToneParameters
+{
+    ToneMode mode = BINAURAL_MODE;
+    int waveform = SINE_WAVE;
+    double leftFrequency = 360.0;  // Carrier in isochronic mode
+    double rightFrequency = 367.83;
+    double pulseFrequency = 7.83;
+    double amplitude = 0.3;
+    int sampleRate = 44100;
+
+    // Phases at frame 0: left/right carriers, or carrier/pulse when isochronic
+    double leftPhase = 0.0;
+    double rightPhase = 0.0;
+
+    NoiseGenerator::NoiseType noiseType = NoiseGenerator::NO_NOISE;
+    float noiseLevel = 0.0f;
+    uint32_t noiseSeed = 0x9E3779B9u;
+
+    // Frames after which the noise repeats (0 = never), for seamless loops;
+    // must be a multiple of SEGMENT_FRAMES
+    uint64_t noisePeriod = 0;
+};
+
+constexpr int SEGMENT_FRAMES = 65536;
+constexpr int LEVEL_BLOCK_FRAMES = 1024; // One meter reading per block
+static_assert(SEGMENT_FRAMES % LEVEL_BLOCK_FRAMES == 0, "meter blocks must not straddle segments");
+
+// Waveform value at phase in [0, 2*pi). Isochronic square carriers are
+// on/off (0/1) rather than +/-1.
+double waveformSample(double phase, int waveform, ToneMode mode);
+
+double phaseIncrement(double hz, int sampleRate);
+
+// Phase after `frame` increments from startPhase, wrapped to [0, 2*pi)
+double phaseAt(double startPhase, double increment, int64_t frame);
+
+// Increments for the two phase accumulators of `params`
+double leftIncrement(const ToneParameters &params);
+double rightIncrement(const ToneParameters &params);
+
+// Meter readings produced for a render of totalFrames
+int64_t levelCount(int64_t totalFrames);
+
+// True when a and b produce the same sound apart from their start phases
+bool sameTone(const ToneParameters &a, const ToneParameters &b);
+
+// Loop length of about `seconds`, rounded to whole segments
+int64_t loopFrames(int sampleRate, double seconds);
+
+// `params` with every frequency moved to a whole number of cycles per
+// loopFrames (at most sampleRate / (2 * loopFrames) Hz away; the beat or
+// pulse is gridded the same way) and the noise repeating with the loop,
+// so a render of loopFrames frames repeats without a seam.
+ToneParameters loopAligned(const ToneParameters &params, int64_t loopFrames);
+
+// Render frames [firstFrame, firstFrame + frameCount) as interleaved int16
+// into `out`. `levels` receives one reading per LEVEL_BLOCK_FRAMES
+// (firstFrame must be block aligned; a trailing partial block is included).
+void renderSegment(const ToneParameters &params, int64_t firstFrame, int frameCount,
+                   int16_t *out, AudioLevels *levels);
+
+// Render totalFrames frames split into segments over threadCount threads
+// (0 = one per hardware thread). `levels` must hold levelCount(totalFrames).
+void renderLoop(const ToneParameters &params, int64_t totalFrames,
+                int16_t *out, AudioLevels *levels, int threadCount = 0);
+
+// Sequential renderer for streaming playback
+class ToneStream
+{
+public:
+    ToneStream();
+
+    // Start a new epoch at the current position: frame() restarts at 0 with
+    // the new parameters and the phases carry over, so the waveform has no
+    // step. parameters() then hold the carried phases, which makes frame n
+    // of this stream frame n of a render of parameters().
+    void retune(const ToneParameters &params);
+
+    // Change settings mid-epoch (edits, ramps): phases and noise simply
+    // continue and frame() keeps counting, but the stream no longer matches
+    // a render of parameters() until the next retune()
+    void update(const ToneParameters &params);
+
+    // Continue from frame `frame` of a render of `params`. A stream does not
+    // wrap at noisePeriod itself: retune() before playing past a loop's end.
+    void seek(const ToneParameters &params, int64_t frame);
+
+    const ToneParameters &parameters() const { return m_params; }
+    int64_t frame() const { return m_frame; }
+
+    // Render frameCount frames, clamped to [-1, 1], and advance frame()
+    void render(double *left, double *right, int frameCount);
+
+private:
+    void prepare();
+
+    ToneParameters m_params;
+    int64_t m_frame;
+    double m_leftPhase;
+    double m_rightPhase;
+    double m_leftIncrement;
+    double m_rightIncrement;
+
+    NoiseGenerator m_noise;
+    bool m_withNoise;
+    int m_noiseIndex;
+    float m_noiseLeft[NoiseGenerator::BLOCK_FRAMES];
+    float m_noiseRight[NoiseGenerator::BLOCK_FRAMES];
+};
+
+}
+
+#endif // TONEKERNELS_H
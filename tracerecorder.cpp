@@ -0,0 +1,263 @@
+#include "tracerecorder.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QThread>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+namespace {
+const std::chrono::steady_clock::time_point g_epoch = std::chrono::steady_clock::now();
+
+// Names are literals from our own code, but keep the JSON valid regardless
+void appendJsonString(QByteArray &out, const char *text)
+{
+    out += '"';
+    for (const char *c = text; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            out += '\\';
+            out += *c;
+        } else if (static_cast<unsigned char>(*c) < 0x20) {
+            out += ' ';
+        } else {
+            out += *c;
+        }
+    }
+    out += '"';
+}
+
+void appendMicroseconds(QByteArray &out, int64_t ns)
+{
+    out += QByteArray::number(ns / 1000);
+    out += '.';
+    out += QByteArray::number(ns % 1000).rightJustified(3, '0');
+}
+}
+
+// One writer (the owning thread), any number of readers. `written` counts
+// every event ever recorded; event i lives in events[i % slots]. One slot
+// more than the capacity: the one the writer may be filling right now.
+struct TraceRecorder::ThreadBuffer {
+    ThreadBuffer(size_t capacity, int id) : events(capacity + 1), written(0), threadId(id) {}
+
+    std::vector<Event> events;
+    std::atomic<uint64_t> written;
+    const int threadId;
+    QString name; // Guarded by m_registryMutex
+};
+
+// Returns the thread's ring for reuse when the thread exits
+struct TraceRecorder::ThreadSlot {
+    ThreadBuffer *buffer = nullptr;
+
+    ~ThreadSlot()
+    {
+        if (buffer) {
+            TraceRecorder::instance().releaseBuffer(buffer);
+        }
+    }
+};
+
+// Enabled before anything constructs the recorder, so the first traced
+// scope is not lost
+std::atomic<bool> TraceRecorder::s_enabled(!qEnvironmentVariableIsEmpty("BINAURAL_TRACE"));
+
+TraceRecorder::TraceRecorder()
+    : m_capacity(DEFAULT_CAPACITY)
+{
+    bool ok = false;
+    int capacity = qEnvironmentVariableIntValue("BINAURAL_TRACE_EVENTS", &ok);
+    if (ok && capacity > 0) {
+        m_capacity = static_cast<size_t>(capacity);
+    }
+
+    m_outputPath = qEnvironmentVariable("BINAURAL_TRACE").trimmed();
+    if (!m_outputPath.isEmpty()) {
+        std::atexit(&TraceRecorder::dumpAtExit);
+    }
+}
+
+TraceRecorder &TraceRecorder::instance()
+{
+    // Never destroyed: dumpAtExit(), registered while this is still being
+    // constructed, would run after a static's destructor, and threads
+    // exiting late still return their rings
+    static TraceRecorder *const recorder = new TraceRecorder;
+    return *recorder;
+}
+
+int64_t TraceRecorder::nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - g_epoch).count();
+}
+
+void TraceRecorder::setEnabled(bool enabled)
+{
+    s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+TraceRecorder::ThreadBuffer *TraceRecorder::threadBuffer()
+{
+    static thread_local ThreadSlot slot;
+    ThreadBuffer *&buffer = slot.buffer;
+    if (!buffer) {
+        std::lock_guard<std::mutex> lock(m_registryMutex);
+        if (!m_freeBuffers.empty()) {
+            buffer = m_freeBuffers.back();
+            m_freeBuffers.pop_back();
+        } else {
+            m_buffers.push_back(std::make_unique<ThreadBuffer>(m_capacity, int(m_buffers.size()) + 1));
+            buffer = m_buffers.back().get();
+        }
+
+        QThread *thread = QThread::currentThread();
+        if (QCoreApplication::instance() && thread == QCoreApplication::instance()->thread()) {
+            buffer->name = "GUI";
+        } else if (thread && !thread->objectName().isEmpty()) {
+            buffer->name = thread->objectName();
+        } else {
+            buffer->name = QString("Thread %1").arg(buffer->threadId);
+        }
+    }
+    return buffer;
+}
+
+void TraceRecorder::releaseBuffer(ThreadBuffer *buffer)
+{
+    // Its events stay until the next owner overwrites them
+    std::lock_guard<std::mutex> lock(m_registryMutex);
+    m_freeBuffers.push_back(buffer);
+}
+
+void TraceRecorder::record(const char *category, const char *name, int64_t startNs, int64_t durationNs,
+                           const char *argName, int64_t argValue)
+{
+    ThreadBuffer *buffer = threadBuffer();
+    uint64_t index = buffer->written.load(std::memory_order_relaxed);
+    buffer->events[index % buffer->events.size()] =
+        Event{category, name, argName, startNs, durationNs, argValue, buffer->threadId};
+    buffer->written.store(index + 1, std::memory_order_release);
+}
+
+void TraceRecorder::instant(const char *category, const char *name, const char *argName, int64_t argValue)
+{
+    record(category, name, nowNs(), INSTANT, argName, argValue);
+}
+
+void TraceRecorder::setThreadName(const QString &name)
+{
+    ThreadBuffer *buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(m_registryMutex);
+    buffer->name = name;
+}
+
+std::vector<TraceRecorder::Event> TraceRecorder::snapshot() const
+{
+    std::vector<Event> events;
+    std::lock_guard<std::mutex> lock(m_registryMutex);
+
+    for (const std::unique_ptr<ThreadBuffer> &buffer : m_buffers) {
+        const uint64_t slots = buffer->events.size();
+        const uint64_t capacity = slots - 1;
+        const uint64_t end = buffer->written.load(std::memory_order_acquire);
+        const uint64_t begin = end > capacity ? end - capacity : 0;
+
+        const size_t first = events.size();
+        for (uint64_t i = begin; i < end; ++i) {
+            events.push_back(buffer->events[i % slots]);
+        }
+
+        // The writer kept going while we copied: event `after` is being
+        // written over event after - slots, so anything up to that may be torn
+        const uint64_t after = buffer->written.load(std::memory_order_acquire);
+        const uint64_t valid = after >= capacity ? after - capacity : 0;
+        if (valid > begin) {
+            const size_t torn = static_cast<size_t>(std::min<uint64_t>(valid - begin, end - begin));
+            events.erase(events.begin() + first, events.begin() + first + torn);
+        }
+    }
+
+    std::sort(events.begin(), events.end(), [](const Event &a, const Event &b) {
+        return a.startNs < b.startNs;
+    });
+    return events;
+}
+
+bool TraceRecorder::dump(const QString &path) const
+{
+    const std::vector<Event> events = snapshot();
+    const QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Could not write trace file:" << path;
+        return false;
+    }
+
+    QByteArray out;
+    out.reserve(1 << 20);
+    out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    bool first = true;
+    auto separate = [&]() {
+        if (!first) {
+            out += ",\n";
+        }
+        first = false;
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(m_registryMutex);
+        for (const std::unique_ptr<ThreadBuffer> &buffer : m_buffers) {
+            separate();
+            out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + pid
+                   + ",\"tid\":" + QByteArray::number(buffer->threadId) + ",\"args\":{\"name\":";
+            appendJsonString(out, buffer->name.toUtf8().constData());
+            out += "}}";
+        }
+    }
+
+    for (const Event &event : events) {
+        separate();
+        out += "{\"name\":";
+        appendJsonString(out, event.name);
+        out += ",\"cat\":";
+        appendJsonString(out, event.category);
+        if (event.durationNs == INSTANT) {
+            out += ",\"ph\":\"i\",\"s\":\"t\"";
+        } else {
+            out += ",\"ph\":\"X\",\"dur\":";
+            appendMicroseconds(out, event.durationNs);
+        }
+        out += ",\"ts\":";
+        appendMicroseconds(out, event.startNs);
+        out += ",\"pid\":" + pid + ",\"tid\":" + QByteArray::number(event.threadId);
+        if (event.argName) {
+            out += ",\"args\":{";
+            appendJsonString(out, event.argName);
+            out += ':' + QByteArray::number(static_cast<qlonglong>(event.argValue)) + '}';
+        }
+        out += '}';
+
+        if (out.size() > (1 << 20) - 512) {
+            file.write(out);
+            out.clear();
+        }
+    }
+
+    out += "\n]}\n";
+    file.write(out);
+    return file.error() == QFileDevice::NoError;
+}
+
+void TraceRecorder::dumpAtExit()
+{
+    TraceRecorder &recorder = instance();
+    if (!recorder.m_outputPath.isEmpty() && recorder.dump(recorder.m_outputPath)) {
+        qInfo().noquote() << "Trace written to" << recorder.m_outputPath;
+    }
+}
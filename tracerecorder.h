@@ -0,0 +1,139 @@
+#ifndef TRACERECORDER_H
+#define TRACERECORDER_H
+
+#include <QString>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Timeline of render callbacks, GUI slots and media events, written as
+// Chrome trace JSON for chrome://tracing or ui.perfetto.dev. Off unless
+// BINAURAL_TRACE names the output file, which is written on exit:
+//
+//   BINAURAL_TRACE=session.json ./BinauralPlayer
+//
+// dump() writes a snapshot at any time (View > Save Trace in the app).
+//
+// Each thread records into its own ring, registered on its first event
+// (the only allocation). After that an event is two clock reads and a few
+// stores: no locks, safe in the audio callback. Rings keep the newest
+// BINAURAL_TRACE_EVENTS events per thread (default 65536); the ring of an
+// exited thread is handed to the next new one, so short-lived workers
+// share a track instead of adding a ring each. Names,
+// categories and argument names must be string literals: only the
+// pointers are stored.
+//
+// Configure with -DBINAURAL_TRACING=OFF to compile the macros out.
+class TraceRecorder
+{
+public:
+    struct Event {
+        const char *category;
+        const char *name;
+        const char *argName; // Null: no argument
+        int64_t startNs;     // Since the recorder was created
+        int64_t durationNs;  // INSTANT for a point event
+        int64_t argValue;
+        int threadId;        // Registration order, 1 = first thread to record
+    };
+
+    static constexpr int64_t INSTANT = -1;
+    static constexpr size_t DEFAULT_CAPACITY = 65536;
+
+    static TraceRecorder &instance();
+
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+    static int64_t nowNs();
+
+    void setEnabled(bool enabled);
+    QString outputPath() const { return m_outputPath; }
+
+    void record(const char *category, const char *name, int64_t startNs, int64_t durationNs,
+                const char *argName = nullptr, int64_t argValue = 0);
+    void instant(const char *category, const char *name,
+                 const char *argName = nullptr, int64_t argValue = 0);
+
+    // Track name for the calling thread; also registers its ring up front,
+    // so e.g. an audio thread can do so before its first callback
+    void setThreadName(const QString &name);
+
+    // Safe while other threads record: events overwritten during the copy
+    // are dropped rather than written torn
+    std::vector<Event> snapshot() const;
+    bool dump(const QString &path) const;
+
+private:
+    struct ThreadBuffer;
+    struct ThreadSlot;
+
+    TraceRecorder();
+
+    ThreadBuffer *threadBuffer();
+    void releaseBuffer(ThreadBuffer *buffer);
+    static void dumpAtExit();
+
+    static std::atomic<bool> s_enabled;
+
+    mutable std::mutex m_registryMutex; // Thread registration and names
+    std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+    std::vector<ThreadBuffer *> m_freeBuffers; // Rings of exited threads
+    size_t m_capacity;
+    QString m_outputPath;
+};
+
+// Complete event covering the enclosing scope
+class TraceScope
+{
+public:
+    TraceScope(const char *category, const char *name,
+               const char *argName = nullptr, int64_t argValue = 0)
+        : m_category(category)
+        , m_name(name)
+        , m_argName(argName)
+        , m_argValue(argValue)
+        , m_startNs(TraceRecorder::isEnabled() ? TraceRecorder::nowNs() : -1)
+    {
+    }
+
+    ~TraceScope()
+    {
+        if (m_startNs >= 0) {
+            TraceRecorder::instance().record(m_category, m_name, m_startNs,
+                                             TraceRecorder::nowNs() - m_startNs,
+                                             m_argName, m_argValue);
+        }
+    }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    const char *m_category;
+    const char *m_name;
+    const char *m_argName;
+    int64_t m_argValue;
+    int64_t m_startNs;
+};
+
+#ifdef BINAURAL_NO_TRACING
+#define BINAURAL_TRACE_SCOPE(...) static_cast<void>(0)
+#define BINAURAL_TRACE_INSTANT(...) static_cast<void>(0)
+#else
+#define BINAURAL_TRACE_CONCAT_(a, b) a##b
+#define BINAURAL_TRACE_CONCAT(a, b) BINAURAL_TRACE_CONCAT_(a, b)
+// BINAURAL_TRACE_SCOPE("audio", "DynamicEngine::readData"[, "frames", n])
+#define BINAURAL_TRACE_SCOPE(...) \
+    TraceScope BINAURAL_TRACE_CONCAT(traceScope_, __LINE__)(__VA_ARGS__)
+// BINAURAL_TRACE_INSTANT("media", "playbackStateChanged"[, "state", s])
+#define BINAURAL_TRACE_INSTANT(...) \
+    do { \
+        if (TraceRecorder::isEnabled()) { \
+            TraceRecorder::instance().instant(__VA_ARGS__); \
+        } \
+    } while (0)
+#endif
+
+#endif // TRACERECORDER_H